@@ -1,14 +1,448 @@
 #include "bazuu_bitboard_ops.hpp"
 #include "defs.hpp"
+#include <algorithm>
+#include <bazuu_ce_analysis.hpp>
+#include <bazuu_ce_bench.hpp>
 #include <bazuu_ce_board.hpp>
+#include <bazuu_ce_datagen.hpp>
+#include <bazuu_ce_match.hpp>
+#include <bazuu_ce_packed_position.hpp>
+#include <bazuu_ce_perf_counters.hpp>
+#include <bazuu_ce_search.hpp>
+#include <bazuu_ce_trace.hpp>
+#include <bazuu_ce_uci.hpp>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <iostream>
 #include <memory>
+#include <optional>
 #include <print>
+#include <string>
+#include <string_view>
+#include <thread>
 
-int main() {
-  std::unique_ptr<BazuuBoard> board = std::make_unique<BazuuBoard>();
-  board->setup_fen("rnbqkbnr/pp2p1p1/2p5/3pPp2/3P2Pp/2N2N2/PPP2P1P/R1BQKB1R b KQkq g3 0 6");
-  board->verify_all_magics();
-  board->print_board();
-  board->generate_moves();
+static constexpr const char *ANALYZE_USAGE =
+    "usage: bazuu analyze --epd <file> (--depth <plies> | --nodes <nodes>) [--threads <n>] [--output <file>]";
+static constexpr const char *DATAGEN_USAGE =
+    "usage: bazuu datagen --output <file> --games <n> [--nodes <nodes>] [--threads <n>] [--random-plies <n>] "
+    "[--seed <n>]";
+static constexpr const char *BENCH_USAGE =
+    "usage: bazuu bench [--depth <plies>] [--multipv <lines>] [--json <file>] [--trace <file>] [--counters] "
+    "[--attacks] [--no-nmp] [--no-lmr] [--no-rfp] [--no-fp] [--no-lmp] [--no-killers] [--no-history] "
+    "[--no-counter-moves] [--no-cont-history]";
+// Bench flags switching off one search technique or ordering heuristic each.
+struct BenchSwitch {
+  std::string_view flag;
+  bool BazuuSearchOptions::*option;
+};
+static constexpr BenchSwitch BENCH_SWITCHES[] = {
+    {"--no-nmp", &BazuuSearchOptions::null_move_pruning},
+    {"--no-lmr", &BazuuSearchOptions::late_move_reductions},
+    {"--no-rfp", &BazuuSearchOptions::reverse_futility_pruning},
+    {"--no-fp", &BazuuSearchOptions::futility_pruning},
+    {"--no-lmp", &BazuuSearchOptions::late_move_pruning},
+    {"--no-killers", &BazuuSearchOptions::killer_moves},
+    {"--no-history", &BazuuSearchOptions::history},
+    {"--no-counter-moves", &BazuuSearchOptions::counter_moves},
+    {"--no-cont-history", &BazuuSearchOptions::continuation_history},
+};
+static constexpr const char *PERFT_USAGE = "usage: bazuu perft [--depth <plies>] [--fen <fen>] [--counters]";
+static constexpr const char *MATCH_USAGE =
+    "usage: bazuu match --engine1 <path> --engine2 <path> (--depth <plies> | --nodes <nodes> | --movetime <ms> | "
+    "--tc <seconds>+<increment>) [--games <n>] [--concurrency <n>] [--openings <file>] [--max-plies <n>] "
+    "[--sprt <elo0> <elo1>] [--alpha <a>] [--beta <b>]";
+
+// Parse a whole argument as a number.
+template <typename T> static bool parse_number(std::string_view argument, T &value) {
+  auto [end, error] = std::from_chars(argument.data(), argument.data() + argument.size(), value);
+  return error == std::errc() && end == argument.data() + argument.size();
+}
+
+/*
+ * Analyse every position of an EPD file and write the results in input order.
+ * @param argc - number of arguments after "analyze".
+ * @param argv - the arguments after "analyze".
+ * @return exit status.
+ */
+static int analyze(int argc, char **argv) {
+  BazuuAnalysisOptions options;
+  options.limits.depth = 0;
+  std::string_view epd_path;
+  std::string_view output_path;
+  for (int i = 0; i < argc; i++) {
+    const std::string_view option = argv[i];
+    if (i + 1 == argc) {
+      std::println(stderr, "{}", ANALYZE_USAGE);
+      return 1;
+    }
+    const std::string_view value = argv[++i];
+    bool valid = true;
+    if (option == "--epd")
+      epd_path = value;
+    else if (option == "--output")
+      output_path = value;
+    else if (option == "--depth")
+      valid = parse_number(value, options.limits.depth);
+    else if (option == "--nodes")
+      valid = parse_number(value, options.limits.nodes);
+    else if (option == "--threads")
+      valid = parse_number(value, options.threads) && options.threads > 0;
+    else
+      valid = false;
+    if (!valid) {
+      std::println(stderr, "bad option {} {}\n{}", option, value, ANALYZE_USAGE);
+      return 1;
+    }
+  }
+  if (epd_path.empty() || (!options.limits.depth && !options.limits.nodes)) {
+    std::println(stderr, "{}", ANALYZE_USAGE);
+    return 1;
+  }
+
+  std::ifstream input{std::string(epd_path)};
+  if (!input) {
+    std::println(stderr, "can not open {}", epd_path);
+    return 1;
+  }
+  std::ofstream output_file;
+  if (!output_path.empty()) {
+    output_file.open(std::string(output_path));
+    if (!output_file) {
+      std::println(stderr, "can not open {}", output_path);
+      return 1;
+    }
+  }
+  BazuuAnalysis analysis(options);
+  BazuuAnalysisSummary summary = analysis.run(input, output_path.empty() ? std::cout : output_file);
+  std::println(stderr, "{} positions ({} invalid), {} nodes in {} ms, {} nps", summary.positions,
+               summary.invalid_positions, summary.nodes, summary.elapsed_ms,
+               summary.nodes * 1000 / (summary.elapsed_ms ? summary.elapsed_ms : 1));
+  return 0;
+}
+
+/*
+ * Generate training positions by self-play into a packed position file, reporting progress every ten seconds.
+ * @param argc - number of arguments after "datagen".
+ * @param argv - the arguments after "datagen".
+ * @return exit status.
+ */
+static int datagen(int argc, char **argv) {
+  BazuuDatagenOptions options;
+  options.games = 0;
+  std::string_view output_path;
+  for (int i = 0; i < argc; i++) {
+    const std::string_view option = argv[i];
+    if (i + 1 == argc) {
+      std::println(stderr, "{}", DATAGEN_USAGE);
+      return 1;
+    }
+    const std::string_view value = argv[++i];
+    bool valid = true;
+    if (option == "--output")
+      output_path = value;
+    else if (option == "--games")
+      valid = parse_number(value, options.games);
+    else if (option == "--nodes")
+      valid = parse_number(value, options.nodes) && options.nodes > 0;
+    else if (option == "--threads")
+      valid = parse_number(value, options.threads) && options.threads > 0;
+    else if (option == "--random-plies")
+      valid = parse_number(value, options.random_plies);
+    else if (option == "--seed")
+      valid = parse_number(value, options.seed);
+    else
+      valid = false;
+    if (!valid) {
+      std::println(stderr, "bad option {} {}\n{}", option, value, DATAGEN_USAGE);
+      return 1;
+    }
+  }
+  if (output_path.empty() || !options.games) {
+    std::println(stderr, "{}", DATAGEN_USAGE);
+    return 1;
+  }
+
+  BazuuPackedWriter writer;
+  if (!writer.open(std::string(output_path), true)) {
+    std::println(stderr, "can not open {}", output_path);
+    return 1;
+  }
+  BazuuDatagen generator(options);
+  auto report = [](const BazuuDatagenSummary &summary) {
+    std::println(stderr, "{} games, {} positions ({} filtered) in {} s, {} positions/hour", summary.games,
+                 summary.positions, summary.filtered_positions, summary.elapsed_ms / 1000,
+                 summary.positions_per_hour());
+  };
+  auto done = std::async(std::launch::async, [&generator, &writer] { return generator.run(writer); });
+  while (done.wait_for(std::chrono::seconds(10)) != std::future_status::ready)
+    report(generator.progress());
+  report(done.get());
+  return writer.close() ? 0 : 1;
+}
+
+/*
+ * Print the hardware counters of a run per node, or why they are missing.
+ * @param counters - stopped counters of the run.
+ * @param nodes - nodes of the run.
+ */
+static void print_counters(const BazuuPerfCounters &counters, U64 nodes) {
+  if (!counters.any_available()) {
+    std::println("Counters        : unavailable (not Linux, no PMU or perf_event_paranoid too high)");
+    return;
+  }
+  for (std::uint8_t i = 0; i < BazuuPerfCounters::EVENTS; i++) {
+    const auto event = static_cast<BazuuPerfEvent>(i);
+    const std::optional<double> count = counters.count(event);
+    if (count)
+      std::println("{:<16}: {:.2f}/node", BazuuPerfCounters::event_name(event), *count / (nodes ? nodes : 1));
+    else
+      std::println("{:<16}: unavailable", BazuuPerfCounters::event_name(event));
+  }
+}
+
+/*
+ * Search the built-in bench suite and print the node signature and speed, per position timings optionally go to a
+ * JSON file and, in a build with WITH_TRACING, the traced zones to a folded stacks file. With --attacks, time the ways
+ * to compute slider attacks on the suite instead. With --counters, hardware counters of the search are printed per
+ * node.
+ * @param argc - number of arguments after "bench".
+ * @param argv - the arguments after "bench".
+ * @return exit status.
+ */
+static int bench(int argc, char **argv) {
+  std::uint8_t depth = BazuuBench::DEFAULT_DEPTH;
+  std::uint8_t multi_pv = 1;
+  std::string_view json_path;
+  std::string_view trace_path;
+  bool attacks = false;
+  bool counters = false;
+  BazuuSearchOptions options;
+  for (int i = 0; i < argc; i++) {
+    const std::string_view option = argv[i];
+    if (option == "--attacks") {
+      attacks = true;
+      continue;
+    }
+    if (option == "--counters") {
+      counters = true;
+      continue;
+    }
+    const auto known = std::ranges::find(BENCH_SWITCHES, option, &BenchSwitch::flag);
+    if (known != std::end(BENCH_SWITCHES)) {
+      options.*known->option = false;
+      continue;
+    }
+    if (i + 1 == argc) {
+      std::println(stderr, "{}", BENCH_USAGE);
+      return 1;
+    }
+    const std::string_view value = argv[++i];
+    bool valid = true;
+    if (option == "--depth")
+      valid = parse_number(value, depth) && depth > 0;
+    else if (option == "--multipv")
+      valid = parse_number(value, multi_pv) && multi_pv > 0;
+    else if (option == "--json")
+      json_path = value;
+    else if (option == "--trace")
+      trace_path = value;
+    else
+      valid = false;
+    if (!valid) {
+      std::println(stderr, "bad option {} {}\n{}", option, value, BENCH_USAGE);
+      return 1;
+    }
+  }
+
+  if (attacks) {
+    for (const BazuuAttackBench &result : BazuuBench::run_attacks())
+      std::println("{:<28}: {:6.2f} ns/position (checksum {:016x})", result.method, result.ns_per_position,
+                   result.checksum);
+    return 0;
+  }
+  if (!trace_path.empty() && !BazuuTrace::ENABLED) {
+    std::println(stderr, "--trace needs a build configured with -DWITH_TRACING=ON");
+    return 1;
+  }
+  BazuuTrace::reset();
+  BazuuPerfCounters perf_counters;
+  perf_counters.start();
+  const BazuuBenchSummary summary = BazuuBench::run(depth, multi_pv, options);
+  perf_counters.stop();
+  for (std::size_t i = 0; i < summary.positions.size(); i++)
+    std::println(stderr, "position {:2}: {:>10} nodes {:>8} us", i + 1, summary.positions[i].nodes,
+                 summary.positions[i].elapsed_us);
+  std::println("Total time (ms) : {}", summary.elapsed_us / 1000);
+  std::println("Nodes searched  : {}", summary.nodes);
+  std::println("Nodes/second    : {}", summary.nps());
+  std::println("Null move cuts  : {}", summary.stats.null_move_cutoffs);
+  std::println("Reduced (LMR)   : {} searches, {} re-searched", summary.stats.reduced_searches,
+               summary.stats.reduction_researches);
+  std::println("RFP cutoffs     : {}", summary.stats.reverse_futility_cutoffs);
+  std::println("Futility prunes : {}", summary.stats.futility_prunes);
+  std::println("LMP prunes      : {}", summary.stats.late_move_prunes);
+  if (counters)
+    print_counters(perf_counters, summary.nodes);
+  if (!json_path.empty()) {
+    std::ofstream json{std::string(json_path)};
+    BazuuBench::write_json(summary, json);
+    if (!json.flush()) {
+      std::println(stderr, "can not write {}", json_path);
+      return 1;
+    }
+  }
+  if (!trace_path.empty()) {
+    std::ofstream trace{std::string(trace_path)};
+    BazuuTrace::write_folded(trace);
+    if (!trace.flush()) {
+      std::println(stderr, "can not write {}", trace_path);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Count the leaf nodes of the move tree of a position and print the speed, and with --counters the hardware counters
+ * per node.
+ * @param argc - number of arguments after "perft".
+ * @param argv - the arguments after "perft".
+ * @return exit status.
+ */
+static int perft(int argc, char **argv) {
+  std::uint8_t depth = 5;
+  std::string fen = BazuuBoard::STARTING_FEN;
+  bool counters = false;
+  for (int i = 0; i < argc; i++) {
+    const std::string_view option = argv[i];
+    if (option == "--counters") {
+      counters = true;
+      continue;
+    }
+    if (i + 1 == argc) {
+      std::println(stderr, "{}", PERFT_USAGE);
+      return 1;
+    }
+    const std::string_view value = argv[++i];
+    bool valid = true;
+    if (option == "--depth")
+      valid = parse_number(value, depth) && depth > 0;
+    else if (option == "--fen")
+      fen = value;
+    else
+      valid = false;
+    if (!valid) {
+      std::println(stderr, "bad option {} {}\n{}", option, value, PERFT_USAGE);
+      return 1;
+    }
+  }
+
+  auto board = std::make_unique<BazuuBoard>();
+  if (board->setup_fen(fen) != FenError::Ok) {
+    std::println(stderr, "bad fen {}", fen);
+    return 1;
+  }
+  BazuuPerfCounters perf_counters;
+  const auto start = std::chrono::steady_clock::now();
+  perf_counters.start();
+  const U64 nodes = board->perft(depth);
+  perf_counters.stop();
+  const U64 elapsed_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  std::println("Total time (ms) : {}", elapsed_us / 1000);
+  std::println("Nodes           : {}", nodes);
+  std::println("Nodes/second    : {}", nodes * 1000000 / (elapsed_us ? elapsed_us : 1));
+  if (counters)
+    print_counters(perf_counters, nodes);
+  return 0;
+}
+
+/*
+ * Play a match between two UCI engines and report the score, Elo, LOS and SPRT verdict after every game.
+ * @param argc - number of arguments after "match".
+ * @param argv - the arguments after "match".
+ * @return exit status, 0 when the match was played.
+ */
+static int match(int argc, char **argv) {
+  BazuuMatchOptions options;
+  options.concurrency = std::max(std::thread::hardware_concurrency(), 1U);
+  for (int i = 0; i < argc; i++) {
+    const std::string_view option = argv[i];
+    if (i + 1 == argc || (option == "--sprt" && i + 2 == argc)) {
+      std::println(stderr, "{}", MATCH_USAGE);
+      return 1;
+    }
+    const std::string_view value = argv[++i];
+    bool valid = true;
+    if (option == "--engine1") {
+      options.engines[0] = value;
+    } else if (option == "--engine2") {
+      options.engines[1] = value;
+    } else if (option == "--openings") {
+      options.openings = value;
+    } else if (option == "--games") {
+      valid = parse_number(value, options.games) && options.games > 0;
+    } else if (option == "--concurrency") {
+      valid = parse_number(value, options.concurrency) && options.concurrency > 0;
+    } else if (option == "--depth") {
+      valid = parse_number(value, options.depth) && options.depth > 0;
+    } else if (option == "--nodes") {
+      valid = parse_number(value, options.nodes) && options.nodes > 0;
+    } else if (option == "--movetime") {
+      valid = parse_number(value, options.movetime_ms) && options.movetime_ms > 0;
+    } else if (option == "--max-plies") {
+      valid = parse_number(value, options.max_plies);
+    } else if (option == "--tc") {
+      const std::size_t plus = value.find('+');
+      double base = 0;
+      double increment = 0;
+      valid = parse_number(value.substr(0, plus), base) && base > 0 &&
+              (plus == std::string_view::npos || (parse_number(value.substr(plus + 1), increment) && increment >= 0));
+      options.base_ms = static_cast<U64>(base * 1000);
+      options.increment_ms = static_cast<U64>(increment * 1000);
+    } else if (option == "--sprt") {
+      options.sprt = true;
+      valid = parse_number(value, options.elo0) && parse_number(std::string_view(argv[++i]), options.elo1) &&
+              options.elo1 > options.elo0;
+    } else if (option == "--alpha") {
+      valid = parse_number(value, options.alpha) && options.alpha > 0 && options.alpha < 1;
+    } else if (option == "--beta") {
+      valid = parse_number(value, options.beta) && options.beta > 0 && options.beta < 1;
+    } else {
+      valid = false;
+    }
+    if (!valid) {
+      std::println(stderr, "bad option {} {}\n{}", option, value, MATCH_USAGE);
+      return 1;
+    }
+  }
+  if (options.engines[0].empty() || options.engines[1].empty() ||
+      (!options.depth && !options.nodes && !options.movetime_ms && !options.base_ms)) {
+    std::println(stderr, "{}", MATCH_USAGE);
+    return 1;
+  }
+
+  BazuuMatch bazuu_match(options);
+  BazuuMatchSummary summary = bazuu_match.run(std::cout);
+  return summary.failed ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && std::string_view(argv[1]) == "analyze")
+    return analyze(argc - 2, argv + 2);
+  if (argc > 1 && std::string_view(argv[1]) == "datagen")
+    return datagen(argc - 2, argv + 2);
+  if (argc > 1 && std::string_view(argv[1]) == "bench")
+    return bench(argc - 2, argv + 2);
+  if (argc > 1 && std::string_view(argv[1]) == "perft")
+    return perft(argc - 2, argv + 2);
+  if (argc > 1 && std::string_view(argv[1]) == "match")
+    return match(argc - 2, argv + 2);
+  BazuuUci uci;
+  uci.run(std::cin, std::cout);
   return 0;
 }
@@ -33,54 +33,150 @@ inline constexpr U64 NOT_AB_FILES = 0xfcfcfcfcfcfcfcfc;
 inline constexpr U64 NOT_GH_FILES = 0x3f3f3f3f3f3f3f3f;
 
 // North Operations
-inline BitBoard shiftNorth(BitBoard board) { return board << 8; }
-inline BitBoard shiftNorthWest(BitBoard board) { return board << 7 & NOT_H_FILE; }
-inline BitBoard shiftNorthEast(BitBoard board) { return board << 9 & NOT_A_FILE; }
+constexpr BitBoard shiftNorth(BitBoard board) { return board << 8; }
+constexpr BitBoard shiftNorthWest(BitBoard board) { return board << 7 & NOT_H_FILE; }
+constexpr BitBoard shiftNorthEast(BitBoard board) { return board << 9 & NOT_A_FILE; }
 
 // South Operations
-inline BitBoard shiftSouth(BitBoard board) { return board >> 8; }
-inline BitBoard shiftSouthWest(BitBoard board) { return board >> 9 & NOT_H_FILE; }
-inline BitBoard shiftSouthEast(BitBoard board) { return board >> 7 & NOT_A_FILE; }
+constexpr BitBoard shiftSouth(BitBoard board) { return board >> 8; }
+constexpr BitBoard shiftSouthWest(BitBoard board) { return board >> 9 & NOT_H_FILE; }
+constexpr BitBoard shiftSouthEast(BitBoard board) { return board >> 7 & NOT_A_FILE; }
+
+// Pawn Traits, what sets the pawns of a side apart, known at compile time.
+template <Colours Us> struct PawnTraits {
+  static constexpr Colours THEM = Us == Colours::White ? Colours::Black : Colours::White;
+  static constexpr int PUSH = Us == Colours::White ? 8 : -8; // Square offset of a push on the 64 square board.
+  static constexpr U64 PROMOTION_RANK = Us == Colours::White ? RANK_8 : RANK_1;
+  static constexpr U64 DOUBLE_PUSH_RANK = Us == Colours::White ? 0x00000000FF000000ULL : 0x000000FF00000000ULL;
+  static constexpr BitBoard push(BitBoard pawns) {
+    return Us == Colours::White ? shiftNorth(pawns) : shiftSouth(pawns);
+  }
+  static constexpr BitBoard attack_west(BitBoard pawns) {
+    return Us == Colours::White ? shiftNorthWest(pawns) : shiftSouthWest(pawns);
+  }
+  static constexpr BitBoard attack_east(BitBoard pawns) {
+    return Us == Colours::White ? shiftNorthEast(pawns) : shiftSouthEast(pawns);
+  }
+};
+
+// Pawn Operations
+template <Colours Us> constexpr BitBoard singlePushTargets(BitBoard pawns, BitBoard empty) {
+  return PawnTraits<Us>::push(pawns) & empty;
+}
+template <Colours Us> constexpr BitBoard doublePushTargets(BitBoard pawns, BitBoard empty) {
+  return PawnTraits<Us>::push(singlePushTargets<Us>(pawns, empty)) & empty & PawnTraits<Us>::DOUBLE_PUSH_RANK;
+}
+template <Colours Us> constexpr BitBoard promotionTargets(BitBoard pawns, BitBoard empty) {
+  return singlePushTargets<Us>(pawns, empty) & PawnTraits<Us>::PROMOTION_RANK;
+}
+template <Colours Us> constexpr BitBoard pawnPossibleAttacksTargets(BitBoard pawns) {
+  return PawnTraits<Us>::attack_east(pawns) | PawnTraits<Us>::attack_west(pawns);
+}
+template <Colours Us> constexpr BitBoard pawnAttacksTargets(BitBoard pawns, BitBoard occupancy) {
+  return pawnPossibleAttacksTargets<Us>(pawns) & occupancy;
+}
+template <Colours Us> constexpr BitBoard pawnAttacksWithPromotionTargets(BitBoard pawns, BitBoard occupancy) {
+  return pawnAttacksTargets<Us>(pawns, occupancy) & PawnTraits<Us>::PROMOTION_RANK;
+}
 
 // White Operations
-inline BitBoard WhiteSinglePushTargets(BitBoard whitePawns, BitBoard empty) { return shiftNorth(whitePawns) & empty; }
-inline BitBoard WhiteDoublePushTargets(BitBoard whitePawns, BitBoard empty) {
-  const U64 rank4 = 0x00000000FF000000ULL;
-  U64 singlePushs = WhiteSinglePushTargets(whitePawns, empty);
-  return shiftNorth(singlePushs) & empty & rank4;
+constexpr BitBoard WhiteSinglePushTargets(BitBoard whitePawns, BitBoard empty) {
+  return singlePushTargets<Colours::White>(whitePawns, empty);
+}
+constexpr BitBoard WhiteDoublePushTargets(BitBoard whitePawns, BitBoard empty) {
+  return doublePushTargets<Colours::White>(whitePawns, empty);
 }
-inline BitBoard WhitePromotionTargets(BitBoard whitePawns, BitBoard empty) {
-  return shiftNorth(whitePawns) & 0xFF00000000000000ULL & empty;
+constexpr BitBoard WhitePromotionTargets(BitBoard whitePawns, BitBoard empty) {
+  return promotionTargets<Colours::White>(whitePawns, empty);
 }
-inline BitBoard WhitePawnAttacksTargets(BitBoard whitePawns, BitBoard occupancy) {
-  return (shiftNorthEast(whitePawns) | shiftNorthWest(whitePawns)) & occupancy;
+constexpr BitBoard WhitePawnAttacksTargets(BitBoard whitePawns, BitBoard occupancy) {
+  return pawnAttacksTargets<Colours::White>(whitePawns, occupancy);
 }
-inline BitBoard WhitePawnPossibleAttacksTargets(BitBoard whitePawns) {
-  return shiftNorthEast(whitePawns) | shiftNorthWest(whitePawns);
+constexpr BitBoard WhitePawnPossibleAttacksTargets(BitBoard whitePawns) {
+  return pawnPossibleAttacksTargets<Colours::White>(whitePawns);
 }
-inline BitBoard WhitePawnAttacksWithPromotionTargets(BitBoard whitePawns, BitBoard occupancy) {
-  return WhitePawnAttacksTargets(whitePawns, occupancy) & 0xFF00000000000000ULL;
+constexpr BitBoard WhitePawnAttacksWithPromotionTargets(BitBoard whitePawns, BitBoard occupancy) {
+  return pawnAttacksWithPromotionTargets<Colours::White>(whitePawns, occupancy);
 }
 
 // Black Operations
-inline BitBoard BlackSinglePushTargets(BitBoard blackPawns, BitBoard empty) { return shiftSouth(blackPawns) & empty; }
-inline BitBoard BlackDoublePushTargets(BitBoard blackPawns, BitBoard empty) {
-  const U64 rank5 = 0x000000FF00000000ULL;
-  U64 singlePushs = BlackSinglePushTargets(blackPawns, empty);
-  return shiftSouth(singlePushs) & empty & rank5;
+constexpr BitBoard BlackSinglePushTargets(BitBoard blackPawns, BitBoard empty) {
+  return singlePushTargets<Colours::Black>(blackPawns, empty);
 }
-inline BitBoard BlackPromotionTargets(BitBoard blackPawns, BitBoard empty) {
-  return shiftSouth(blackPawns) & 0x00000000000000FFULL & empty;
+constexpr BitBoard BlackDoublePushTargets(BitBoard blackPawns, BitBoard empty) {
+  return doublePushTargets<Colours::Black>(blackPawns, empty);
 }
-inline BitBoard BlackPawnAttacksTargets(BitBoard blackPawns, BitBoard occupancy) {
-  return (shiftSouthEast(blackPawns) | shiftSouthWest(blackPawns)) & occupancy;
+constexpr BitBoard BlackPromotionTargets(BitBoard blackPawns, BitBoard empty) {
+  return promotionTargets<Colours::Black>(blackPawns, empty);
 }
-inline BitBoard BlackPawnPossibleAttacksTargets(BitBoard blackPawns) {
-  return shiftSouthEast(blackPawns) | shiftSouthWest(blackPawns);
+constexpr BitBoard BlackPawnAttacksTargets(BitBoard blackPawns, BitBoard occupancy) {
+  return pawnAttacksTargets<Colours::Black>(blackPawns, occupancy);
 }
-inline BitBoard BlackPawnAttacksWithPromotionTargets(BitBoard blackPawns, BitBoard occupancy) {
-  return BlackPawnAttacksTargets(blackPawns, occupancy) & 0x00000000000000FFULL;
+constexpr BitBoard BlackPawnPossibleAttacksTargets(BitBoard blackPawns) {
+  return pawnPossibleAttacksTargets<Colours::Black>(blackPawns);
 }
+constexpr BitBoard BlackPawnAttacksWithPromotionTargets(BitBoard blackPawns, BitBoard occupancy) {
+  return pawnAttacksWithPromotionTargets<Colours::Black>(blackPawns, occupancy);
+}
+
+// Setwise Sliding Attacks
+/*
+ * Occluded fill (Kogge-Stone) of a set of sliders along one direction, in three steps of 1, 2 and 4 squares.
+ * Shift is the direction on the compass rose and Wrap masks the file a shift by it can not land on.
+ * @param sliders - the sliders, they all move the same way.
+ * @param empty - squares the sliders can slide through.
+ * @return the sliders and the squares they reach before an occupied square.
+ */
+template <int Shift, U64 Wrap> constexpr BitBoard occludedFill(BitBoard sliders, BitBoard empty) {
+  auto shift = [](BitBoard board, int by) { return by > 0 ? board << by : board >> -by; };
+  empty &= Wrap;
+  sliders |= empty & shift(sliders, Shift);
+  empty &= shift(empty, Shift);
+  sliders |= empty & shift(sliders, 2 * Shift);
+  empty &= shift(empty, 2 * Shift);
+  sliders |= empty & shift(sliders, 4 * Shift);
+  return sliders;
+}
+// Attacks of the fill, one more step along the direction reaches the blocking pieces.
+template <int Shift, U64 Wrap> constexpr BitBoard slidingAttacks(BitBoard sliders, BitBoard empty) {
+  const BitBoard fill = occludedFill<Shift, Wrap>(sliders, empty);
+  return (Shift > 0 ? fill << Shift : fill >> -Shift) & Wrap;
+}
+
+/*
+ * Attacks of straight sliders along the ranks and files and of diagonal sliders along the diagonals, one bitboard
+ * per direction in the order north, east, northeast, northwest, south, west, southwest and southeast.
+ * Pieces of a set never attack the same square along the same direction, the first one stops the others.
+ * @param straight - rooks and queens, or any set moving along ranks and files.
+ * @param diagonal - bishops and queens, or any set moving along diagonals.
+ * @param empty - the empty squares.
+ * @param rays - receives the attacks of each direction.
+ */
+constexpr void slidingAttacks(BitBoard straight, BitBoard diagonal, BitBoard empty, BitBoard (&rays)[8]) {
+  rays[0] = slidingAttacks<8, ~0ULL>(straight, empty);
+  rays[1] = slidingAttacks<1, NOT_A_FILE>(straight, empty);
+  rays[2] = slidingAttacks<9, NOT_A_FILE>(diagonal, empty);
+  rays[3] = slidingAttacks<7, NOT_H_FILE>(diagonal, empty);
+  rays[4] = slidingAttacks<-8, ~0ULL>(straight, empty);
+  rays[5] = slidingAttacks<-1, NOT_H_FILE>(straight, empty);
+  rays[6] = slidingAttacks<-9, NOT_H_FILE>(diagonal, empty);
+  rays[7] = slidingAttacks<-7, NOT_A_FILE>(diagonal, empty);
+}
+
+// Squares attacked by any of the sliders, see slidingAttacks().
+constexpr BitBoard sliderAttacks(BitBoard straight, BitBoard diagonal, BitBoard empty) {
+  BitBoard rays[8];
+  slidingAttacks(straight, diagonal, empty, rays);
+  return rays[0] | rays[1] | rays[2] | rays[3] | rays[4] | rays[5] | rays[6] | rays[7];
+}
+
+/*
+ * slidingAttacks() and sliderAttacks() with four directions per AVX2 instruction, in bazuu_bitboard_ops.cc.
+ * They may only be called when hasAvx2() is true.
+ */
+bool hasAvx2();
+void slidingAttacksAvx2(BitBoard straight, BitBoard diagonal, BitBoard empty, BitBoard (&rays)[8]);
+BitBoard sliderAttacksAvx2(BitBoard straight, BitBoard diagonal, BitBoard empty);
 } // namespace BazuuBitBoardOps
 
 #endif
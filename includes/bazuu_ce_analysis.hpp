@@ -0,0 +1,61 @@
+#ifndef BAZUU_CE_ANALYSIS_H_
+#define BAZUU_CE_ANALYSIS_H_
+#include <bazuu_ce_search.hpp>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <defs.hpp>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct BazuuAnalysisOptions {
+  BazuuSearchLimits limits;
+  std::uint16_t threads = 1;
+  std::size_t queue_size = 0; // Positions in flight, four per thread when zero.
+};
+
+struct BazuuAnalysisSummary {
+  U64 positions = 0;
+  U64 invalid_positions = 0;
+  U64 nodes = 0;
+  U64 elapsed_ms = 0;
+};
+
+/*
+ * Batch analysis of EPD records. The calling thread reads the input and writes the results while worker threads search
+ * one position each on their own board. At most queue_size positions are in flight, so memory does not grow with the
+ * input, and results are written in input order as "<position> bm <move>; ce <cp>; acd <depth>; acn <nodes>; pv ...;"
+ * with moves in UCI notation and dm replacing ce for mate scores.
+ */
+class BazuuAnalysis {
+public:
+  explicit BazuuAnalysis(const BazuuAnalysisOptions &options);
+  BazuuAnalysisSummary run(std::istream &input, std::ostream &output);
+  static std::string format_result(std::string_view epd, const BazuuSearchResult &result);
+
+private:
+  struct Slot {
+    std::string line;
+    std::string result;
+    bool done = false;
+  };
+  BazuuAnalysisOptions options;
+  std::unique_ptr<BazuuEvalCache> eval_cache; // Shared by the workers, evaluations do not depend on who stored them.
+  std::vector<Slot> slots;
+  std::mutex mutex;
+  std::condition_variable work_ready;
+  std::condition_variable result_ready;
+  U64 read_count = 0; // Positions queued, the slot of position i is i % slots.size().
+  U64 next_job = 0;   // Next position for a worker to search.
+  bool input_done = false;
+  BazuuAnalysisSummary summary;
+
+  void worker();
+  bool analyse(BazuuBoard &board, std::string_view line, std::string &result, U64 &nodes) const;
+};
+#endif
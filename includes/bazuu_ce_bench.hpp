@@ -0,0 +1,51 @@
+#ifndef BAZUU_CE_BENCH_H_
+#define BAZUU_CE_BENCH_H_
+#include <array>
+#include <bazuu_ce_move.hpp>
+#include <bazuu_ce_search.hpp>
+#include <cstdint>
+#include <defs.hpp>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct BazuuBenchPosition {
+  std::string fen;
+  BazuuMove best_move;
+  U64 nodes = 0;
+  U64 elapsed_us = 0;
+};
+
+struct BazuuBenchSummary {
+  std::uint8_t depth = 0;
+  std::uint8_t multi_pv = 1;
+  std::vector<BazuuBenchPosition> positions;
+  U64 nodes = 0; // Signature of the search, any functional change of it changes the node count.
+  U64 elapsed_us = 0;
+  BazuuSearchStats stats; // Summed over the positions, how often each selective technique fired.
+  U64 nps() const { return this->nodes * 1000000 / (this->elapsed_us ? this->elapsed_us : 1); }
+};
+
+// Speed of one way to compute the slider attacks of both sides.
+struct BazuuAttackBench {
+  std::string method;
+  double ns_per_position = 0.0;
+  BitBoard checksum = 0ULL; // Equal for the methods computing the same attacks.
+};
+
+/*
+ * Fixed depth search of a built-in suite of positions on a single thread. Each position gets a fresh search and an
+ * emptied transposition table and evaluation cache so that the node counts only depend on the engine, they are the
+ * signature to compare builds with and the timings give its speed.
+ */
+class BazuuBench {
+public:
+  static constexpr std::uint8_t DEFAULT_DEPTH = 8;
+  static const std::array<const char *, 50> POSITIONS;
+  static BazuuBenchSummary run(std::uint8_t depth = DEFAULT_DEPTH, std::uint8_t multi_pv = 1,
+                               const BazuuSearchOptions &options = {});
+  static void write_json(const BazuuBenchSummary &summary, std::ostream &output);
+  static constexpr U64 ATTACK_ROUNDS = 100000;
+  static std::vector<BazuuAttackBench> run_attacks(U64 rounds = ATTACK_ROUNDS);
+};
+#endif
@@ -3,15 +3,50 @@
 
 #include "bazuu_magic_data.hpp"
 #include <bazuu_ce_game_state.hpp>
+#include <bazuu_ce_move.hpp>
 #include <bazuu_ce_zobrist.hpp>
+#include <cstddef>
 #include <cstdint>
 #include <defs.hpp>
-#include <memory>
 #include <print>
 #include <prng.hpp>
 #include <string>
+#include <string_view>
 #include <utility>
 
+// Outcome of setup_fen, the board is left untouched on any error.
+enum class FenError : std::uint8_t {
+  Ok = 0,
+  BadPiecePlacement,
+  BadSideToMove,
+  BadCastling,
+  BadEnPassant,
+  BadMoveCounters,
+  BadPieceCount,
+  BadKings,
+  PawnOnBackRank,
+  OpponentInCheck
+};
+
+struct BazuuPackedPosition;
+
+/*
+ * Attack maps of a position, filled in by BazuuBoard on first request and dropped when a move changes the position.
+ * The checkers and pins are computed on their own as the search needs them at every node, the attack maps only when
+ * a caller asks for them.
+ */
+struct BazuuAttackInfo {
+  static constexpr std::uint8_t KING_SAFETY = 1; // checkers and pinned are set.
+  static constexpr std::uint8_t ATTACK_MAPS = 2; // attacked_by and double_attacks are set.
+  // Squares attacked by each piece type of a side, PieceType::Empty holds the squares attacked by any of them.
+  BitBoard attacked_by[std::to_underlying(Colours::Both)][std::to_underlying(PieceType::Empty) + 1];
+  BitBoard double_attacks[std::to_underlying(Colours::Both)]; // Squares attacked by at least two pieces of a side.
+  BitBoard checkers; // Pieces giving check to the king of the side to move.
+  BitBoard pinned;   // Pieces of the side to move that can not leave the line between their king and an enemy slider.
+  std::uint8_t computed = 0;
+  std::uint16_t history_ply = 0; // Ply of the position the entry was filled in for.
+};
+
 class BazuuBoard {
 public:
   BazuuBoard();
@@ -19,9 +54,12 @@ public:
   static constexpr std::string VERSION = "1.0.0";
   static constexpr std::uint8_t BRD_SQ_NUM = 120;
   static constexpr std::uint16_t MAX_PLY = 2048;
+  static constexpr std::uint16_t ATTACK_CACHE_SIZE = 64; // Plies of attack info kept, a power of two.
   // Each piece type has a maximum number of 10 pieces i.e. the initial
   // two pieces plus 8 possible pawns that can be promoted.
   static constexpr std::uint8_t MAX_NUM_OF_PIECES_PER_TYPE = 10;
+  static constexpr std::uint8_t MAX_PIECES_PER_SIDE = 16;
+  static constexpr std::uint8_t MAX_PAWNS_PER_SIDE = 8;
   static constexpr std::uint8_t BOARD_64_OFFSET = 21;
   static constexpr std::uint8_t INVALID_SQUARE_ON_64 = 64;
   static const std::string STARTING_FEN;
@@ -35,10 +73,11 @@ public:
       10, 10, 10, 11, 11, 10, 10, 10, 10, 10, 10, 11, 12, 11, 11, 11, 11, 11, 11, 12};
   std::uint16_t current_king_square[2];
   std::uint16_t pieces_on_board[13];
-  std::uint16_t non_pawn_pieces[3]; // White, Black and Both Colors.
+  std::uint16_t non_pawn_pieces[3]; // White, Black and Both Colors. Knights, bishops, rooks and queens.
   std::uint16_t major_pieces[3];    // White, Black and Both Colors.
   std::uint16_t minor_pieces[3];    // White, Black and Both Colors.
-  BazuuGameState history[MAX_PLY];
+  BazuuUndo history[MAX_PLY]; // Undo records of the moves played, the keys are read by the repetition checks.
+  std::uint16_t history_ply = 0;
   BitBoard knight_attacks[std::to_underlying(BoardSquares::NO_SQ)];
   BitBoard king_attacks[std::to_underlying(BoardSquares::NO_SQ)];
   BitBoard pawn_attacks[std::to_underlying(Colours::Both)][std::to_underlying(BoardSquares::NO_SQ)];
@@ -55,8 +94,13 @@ public:
   void print_bit_board(BitBoard bit_board);
   void print_board();
   void print_attacked_squares(Colours attacking_colour);
-  void setup_fen(const std::string fen_position = STARTING_FEN);
+  FenError setup_fen(std::string_view fen_position = STARTING_FEN, bool validate_position = true);
+  std::string to_fen() const;
+  std::string to_epd() const;
+  FenError setup_packed(const BazuuPackedPosition &packed, bool validate_position = true);
+  bool pack(BazuuPackedPosition &packed) const;
   ZobristKey generate_hash_keys();
+  ZobristKey polyglot_key();
   std::uint8_t to_64_board_square(BoardSquares square_on_120_board) const;
   BoardSquares to_120_board_square(std::uint8_t square_on_64_board) const;
   BoardSquares file_rank_to_120_board(File file, Rank rank) const;
@@ -72,11 +116,19 @@ public:
   BitBoard mask_rook_attacks(BoardSquares square_on_120_board);
   BitBoard mask_bishop_attacks_realtime(BoardSquares square_on_120_board, BitBoard block);
   BitBoard mask_rook_attacks_realtime(BoardSquares square_on_120_board, BitBoard block);
-  BitBoard get_bishop_attacks_lookup(BoardSquares square_on_120_board, BitBoard occupancy);
-  BitBoard get_rook_attacks_lookup(BoardSquares square_on_120_board, BitBoard occupancy);
-  BitBoard get_queen_attacks_lookup(BoardSquares square_on_120_board, BitBoard occupancy);
+  BitBoard get_bishop_attacks_lookup(BoardSquares square_on_120_board, BitBoard occupancy) const;
+  BitBoard get_rook_attacks_lookup(BoardSquares square_on_120_board, BitBoard occupancy) const;
+  BitBoard get_queen_attacks_lookup(BoardSquares square_on_120_board, BitBoard occupancy) const;
+  BitBoard slider_attacks(Colours colour, BitBoard occupancy) const;
   BitBoard create_occupancy_board(std::uint16_t occupancy_index, std::uint8_t bits_in_mask, BitBoard attack_mask);
   BoardSquares king_square(Colours colour) const;
+  Colours side_to_move() const;
+  ZobristKey zobrist_key() const;
+  std::uint16_t halfmove_clock() const;
+  CastlePermissions castling_rights() const;
+  bool is_repetition(std::uint16_t search_ply) const;
+  bool has_upcoming_repetition(std::uint16_t search_ply) const;
+  bool has_insufficient_material() const;
   bool has_bishop_pair(Colours colour);
   bool is_square_attacked(BoardSquares square, Colours attacking_colour);
   std::pair<File, Rank> get_file_and_rank(BoardSquares square_on_120_board) const;
@@ -86,25 +138,63 @@ public:
   void reset();
   void verify_all_magics();
   void generate_moves();
+  void generate_moves(BazuuMoveList &list);
+  void generate_captures(BazuuMoveList &list);
+  bool make_move(BazuuMove move);
+  void unmake_move(BazuuMove move);
+  bool make_null_move();
+  void unmake_null_move();
+  bool in_check();
+  BitBoard checkers() const;
+  BitBoard pinned() const;
+  const BazuuAttackInfo &attack_info() const;
+  Pieces piece_on_square(std::uint8_t square_on_64_board) const;
+  bool is_consistent() const;
+  U64 perft(std::uint8_t depth);
+  static std::pair<std::uint8_t, std::uint8_t> castling_rook_squares(std::uint8_t king_to_64);
   constexpr inline void pop_bit(U64 &bb, int bit) noexcept { bb &= ~(1ULL << bit); }
 
 private:
   std::uint8_t sq_120_to_sq_64[BRD_SQ_NUM];
   BoardSquares sq_64_to_sq_120[64];
-  std::shared_ptr<BazuuZobrist> zobrist;
-  std::shared_ptr<BazuuGameState> game_state;
-  std::unique_ptr<PRNG> prng;
+  BazuuGameState game_state;
+  PRNG prng{Magic::seed};
   BitBoard bitboards_for_pieces[std::to_underlying(Colours::Both)][std::to_underlying(PieceType::Empty)];
   BitBoard bitboards_for_sides[std::to_underlying(Colours::Both)];
   BoardSquares piece_list[std::to_underlying(Colours::Both)][std::to_underlying(PieceType::Empty)]
                          [MAX_NUM_OF_PIECES_PER_TYPE];
   std::uint8_t piece_count[std::to_underlying(Colours::Both)][std::to_underlying(PieceType::Empty)];
+  Pieces mailbox[64] = {}; // Piece on each square of the 64 square board, kept in step with the bitboards.
+  // Attack info of the positions at the last ATTACK_CACHE_SIZE history plies, a move clears the entry of the new ply
+  // and unmaking it returns to the still valid entry of the position before, unless a deeper ply took it over since.
+  mutable BazuuAttackInfo attack_cache[ATTACK_CACHE_SIZE];
   static constexpr auto &rook_magic_data = Magic::ROOK_DATA;
   static constexpr auto &bishop_magic_data = Magic::BISHOP_DATA;
-  std::pair<File, Rank> file_rank_to_board_mapper[BRD_SQ_NUM];
+  File square_files[BRD_SQ_NUM];
+  Rank square_ranks[BRD_SQ_NUM];
   BitBoard mask_knight_attacks(BoardSquares square_on_120_board);
   BitBoard mask_king_attacks(BoardSquares square_on_120_board);
   BitBoard mask_pawn_attacks(Colours side, BoardSquares square_on_120_board);
+  void add_piece(Colours colour, PieceType piece, std::uint8_t square_on_64_board);
+  void remove_piece(Colours colour, PieceType piece, std::uint8_t square_on_64_board);
+  void move_piece(Colours colour, PieceType piece, std::uint8_t from_64, std::uint8_t to_64);
+  void update_piece_counts(Colours colour, PieceType piece, int delta);
+  bool push_undo();
+  void pop_undo();
+  BazuuAttackInfo &current_attack_info() const;
+  void compute_king_safety(BazuuAttackInfo &info) const;
+  void compute_attack_maps(BazuuAttackInfo &info) const;
+  template <Colours Us> void generate(BazuuMoveList &list, bool include_quiets);
+  template <Colours Us> bool make_move(BazuuMove move);
+  template <Colours Attacker> bool is_attacked_by(BoardSquares square_on_120_board, BitBoard occupancy) const;
+  bool is_square_attacked(
+      BoardSquares square_on_120_board, Colours attacking_colour,
+      const BitBoard (&pieces)[std::to_underlying(Colours::Both)][std::to_underlying(PieceType::Empty)],
+      BitBoard occupancy);
+  std::size_t write_epd_fields(char *buffer) const;
+  FenError set_position(
+      const BitBoard (&pieces)[std::to_underlying(Colours::Both)][std::to_underlying(PieceType::Empty)],
+      const BazuuGameState &state, bool validate_position);
   void print_bits(U64 n) {
     unsigned long long i;
     std::string buf;
@@ -0,0 +1,45 @@
+#ifndef BAZUU_CE_BOOK_H_
+#define BAZUU_CE_BOOK_H_
+#include <bazuu_ce_mapped_file.hpp>
+#include <bazuu_ce_move.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <defs.hpp>
+#include <string>
+#include <vector>
+
+class BazuuBoard;
+
+/*
+ * An entry of a Polyglot book, stored as 16 big-endian bytes sorted by key.
+ * The move is to square (bits 0-5), from square (bits 6-11) and promotion (bits 12-14, knight = 1 ... queen = 4),
+ * castling is written as the king taking its own rook.
+ */
+struct BazuuBookEntry {
+  ZobristKey key = 0ULL;
+  std::uint16_t move = 0;
+  std::uint16_t weight = 0;
+  std::uint32_t learn = 0;
+};
+
+/*
+ * Polyglot opening book read through a memory mapping, probes binary search the file in place.
+ */
+class BazuuBook {
+public:
+  static constexpr std::size_t ENTRY_SIZE = 16;
+  bool open(const std::string &path);
+  void close();
+  bool is_open() const { return this->file.is_open(); }
+  std::size_t size() const { return this->file.size() / ENTRY_SIZE; }
+  BazuuBookEntry entry(std::size_t index) const;
+  std::size_t find(ZobristKey key) const;
+  BazuuMove probe(BazuuBoard &board, U64 random) const;
+  static std::uint16_t encode_move(BazuuMove move);
+  static BazuuMove decode_move(BazuuBoard &board, std::uint16_t book_move);
+  static bool write(const std::string &path, std::vector<BazuuBookEntry> entries);
+
+private:
+  BazuuMappedFile file;
+};
+#endif
@@ -0,0 +1,36 @@
+#ifndef BAZUU_CE_CUCKOO_H_
+#define BAZUU_CE_CUCKOO_H_
+#include <cstdint>
+#include <defs.hpp>
+
+/*
+ * Cuckoo hash of the zobrist key change of every reversible move (a non-pawn piece going from one square to another
+ * on an empty board, plus the side to move flip). A key difference between the current position and one an even
+ * number of plies back that is found here means one move can bring the position back, i.e. a repetition is reachable.
+ * See Marcel van Kervinck, "The design of a cuckoo hash for upcoming repetitions".
+ */
+class BazuuCuckoo {
+public:
+  static constexpr std::uint16_t SIZE = 8192;
+  // Number of distinct reversible moves of both colours, all of them must fit in the table.
+  static constexpr std::uint16_t REVERSIBLE_MOVES = 3668;
+
+  struct Entry {
+    ZobristKey key = 0ULL;
+    BitBoard path = 0ULL; // Squares strictly between from_64 and to_64, they must be empty for the move to be played.
+    std::uint8_t from_64 = 0;
+    std::uint8_t to_64 = 0;
+  };
+
+  BazuuCuckoo();
+  const Entry *probe(ZobristKey move_key) const;
+  std::uint16_t count() const;
+  static constexpr std::uint16_t h1(ZobristKey key) { return key & (SIZE - 1); }
+  static constexpr std::uint16_t h2(ZobristKey key) { return (key >> 16) & (SIZE - 1); }
+
+private:
+  Entry entries[SIZE];
+  std::uint16_t entry_count = 0;
+  void insert(Entry entry);
+};
+#endif
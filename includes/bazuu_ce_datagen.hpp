@@ -0,0 +1,57 @@
+#ifndef BAZUU_CE_DATAGEN_H_
+#define BAZUU_CE_DATAGEN_H_
+#include <atomic>
+#include <bazuu_ce_packed_position.hpp>
+#include <bazuu_ce_search.hpp>
+#include <chrono>
+#include <cstdint>
+#include <defs.hpp>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct BazuuDatagenOptions {
+  U64 games = 1;
+  std::uint16_t threads = 1;
+  U64 nodes = 5000;                     // Node budget of the search of each move.
+  std::uint8_t random_plies = 8;        // Random moves played from the starting position before searching.
+  std::uint16_t max_plies = 400;        // Longer games are drawn.
+  std::int32_t adjudicate_score = 2500; // A game is won once the score stays this large...
+  std::uint8_t adjudicate_plies = 8;    // ... for this many plies in a row.
+  U64 seed = 1;
+};
+
+struct BazuuDatagenSummary {
+  U64 games = 0;
+  U64 positions = 0;
+  U64 filtered_positions = 0;
+  U64 elapsed_ms = 0;
+  U64 positions_per_hour() const { return this->positions * 3600000 / (this->elapsed_ms ? this->elapsed_ms : 1); }
+};
+
+/*
+ * Self-play generator of labelled positions. Every thread plays its own games from a few random opening moves,
+ * searching each move to a fixed node budget. Quiet positions are kept with their search score in a buffer of the
+ * thread, labelled with the game result once the game is over and handed to the shared writer a block at a time.
+ */
+class BazuuDatagen {
+public:
+  explicit BazuuDatagen(const BazuuDatagenOptions &options);
+  BazuuDatagenSummary run(BazuuPackedWriter &writer);
+  BazuuDatagenSummary progress() const;
+
+private:
+  BazuuDatagenOptions options;
+  std::unique_ptr<BazuuEvalCache> eval_cache; // Shared by the workers.
+  BazuuPackedWriter *writer = nullptr;
+  std::mutex writer_mutex;
+  std::atomic<U64> next_game = 0;
+  std::atomic<U64> games_played = 0;
+  std::atomic<U64> positions_written = 0;
+  std::atomic<U64> positions_filtered = 0;
+  std::atomic<std::chrono::steady_clock::time_point> start_time;
+
+  void worker(std::uint16_t thread_index);
+  void write_block(std::vector<BazuuPackedPosition> &block);
+};
+#endif
@@ -0,0 +1,13 @@
+#ifndef BAZUU_CE_EVAL_H_
+#define BAZUU_CE_EVAL_H_
+#include <cstdint>
+#include <defs.hpp>
+
+class BazuuBoard;
+
+// Classical material and piece-square evaluation, used when no network is loaded.
+namespace BazuuEval {
+inline constexpr std::int32_t PIECE_VALUE[std::to_underlying(PieceType::Empty) + 1] = {100, 320, 330, 500, 900, 0, 0};
+std::int32_t evaluate(BazuuBoard &board);
+} // namespace BazuuEval
+#endif
@@ -0,0 +1,28 @@
+#ifndef BAZUU_CE_EVAL_CACHE_H_
+#define BAZUU_CE_EVAL_CACHE_H_
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <defs.hpp>
+#include <memory>
+
+/*
+ * Lockless cache of static evaluations indexed by the zobrist key of the position.
+ * Each entry is a single 64-bit word: the upper 32 bits of the key for verification and a 16-bit score,
+ * so it can be shared between search threads without locks and never returns a torn entry.
+ */
+class BazuuEvalCache {
+public:
+  static constexpr std::size_t DEFAULT_SIZE_MB = 4;
+  explicit BazuuEvalCache(std::size_t size_mb = DEFAULT_SIZE_MB);
+  void resize(std::size_t size_mb);
+  void clear();
+  bool probe(ZobristKey key, std::int16_t &score) const;
+  void store(ZobristKey key, std::int32_t score);
+  std::size_t size() const { return this->mask + 1; }
+
+private:
+  std::unique_ptr<std::atomic<std::uint64_t>[]> entries;
+  std::size_t mask = 0;
+};
+#endif
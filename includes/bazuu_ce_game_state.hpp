@@ -9,6 +9,7 @@ struct BazuuGameState {
   BoardSquares en_passant_square = BoardSquares::NO_SQ;
   std::uint16_t ply_since_pawn_move = 0;
   std::uint16_t total_moves = 0;
+  std::uint16_t plies_from_null = 0; // Repetitions can not span a null move.
 
   void reset() {
     this->active_side = Colours::Both;
@@ -17,6 +18,20 @@ struct BazuuGameState {
     this->en_passant_square = BoardSquares::NO_SQ;
     this->ply_since_pawn_move = 0;
     this->total_moves = 0;
+    this->plies_from_null = 0;
   }
 };
+
+/*
+ * Entry of the board's undo stack: the part of the state a move can not give back by itself. The captured piece is
+ * in the move, the side to move and the move number follow from the position after the move.
+ */
+struct BazuuUndo {
+  ZobristKey zobrist_key = 0ULL;
+  std::uint16_t ply_since_pawn_move = 0;
+  std::uint16_t plies_from_null = 0;
+  CastlePermissions castling = 0;
+  BoardSquares en_passant_square = BoardSquares::NO_SQ;
+};
+static_assert(sizeof(BazuuUndo) == 16);
 #endif
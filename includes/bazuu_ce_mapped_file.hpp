@@ -0,0 +1,28 @@
+#ifndef BAZUU_CE_MAPPED_FILE_H_
+#define BAZUU_CE_MAPPED_FILE_H_
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * Read only memory mapping of a whole file, the mapping is released with the object.
+ */
+class BazuuMappedFile {
+public:
+  BazuuMappedFile() = default;
+  ~BazuuMappedFile();
+  BazuuMappedFile(const BazuuMappedFile &) = delete;
+  BazuuMappedFile &operator=(const BazuuMappedFile &) = delete;
+  BazuuMappedFile(BazuuMappedFile &&other) noexcept;
+  BazuuMappedFile &operator=(BazuuMappedFile &&other) noexcept;
+  bool open(const std::string &path, bool sequential = false);
+  void close();
+  bool is_open() const { return this->mapping != nullptr; }
+  const std::uint8_t *data() const { return this->mapping; }
+  std::size_t size() const { return this->length; }
+
+private:
+  const std::uint8_t *mapping = nullptr;
+  std::size_t length = 0;
+};
+#endif
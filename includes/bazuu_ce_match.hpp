@@ -0,0 +1,112 @@
+#ifndef BAZUU_CE_MATCH_H_
+#define BAZUU_CE_MATCH_H_
+#include <atomic>
+#include <bazuu_ce_board.hpp>
+#include <bazuu_ce_packed_position.hpp>
+#include <cstdint>
+#include <defs.hpp>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <vector>
+
+/*
+ * A UCI engine running as a child process, talking over a pipe to its standard input and one from its standard output.
+ */
+class BazuuEngineProcess {
+public:
+  BazuuEngineProcess() = default;
+  BazuuEngineProcess(const BazuuEngineProcess &) = delete;
+  BazuuEngineProcess &operator=(const BazuuEngineProcess &) = delete;
+  ~BazuuEngineProcess();
+  bool start(const std::string &path);
+  void stop();
+  bool is_running() const { return this->pid > 0; }
+  bool send(std::string_view line);
+  bool read_line(std::string &line, U64 timeout_ms);
+  bool wait_for(std::string_view prefix, std::string &line, U64 timeout_ms);
+
+private:
+  pid_t pid = -1;
+  int to_engine = -1;
+  int from_engine = -1;
+  std::string buffer; // Output read past the last line returned.
+};
+
+enum class SprtVerdict : std::uint8_t { Continue = 0, AcceptH0, AcceptH1 };
+
+/*
+ * Games of the first engine against the second and the statistics of the match.
+ */
+struct BazuuMatchScore {
+  U64 wins = 0;
+  U64 draws = 0;
+  U64 losses = 0;
+  U64 games() const { return this->wins + this->draws + this->losses; }
+  double score() const;
+  double variance() const;
+  double elo() const;
+  double elo_error() const;
+  double los() const;
+  double llr(double elo0, double elo1) const;
+  static double expected_score(double elo);
+  static double elo_of_score(double score);
+};
+
+struct BazuuMatchOptions {
+  std::string engines[2];
+  std::string openings; // File with a FEN or EPD position per line, the starting position when empty.
+  U64 games = 2;
+  std::uint16_t concurrency = 1;
+  std::uint8_t depth = 0;
+  U64 nodes = 0;
+  U64 movetime_ms = 0;
+  U64 base_ms = 0; // Clock of each side, with increment_ms added after every move.
+  U64 increment_ms = 0;
+  U64 timeout_ms = 60000; // A move without a clock taking longer loses.
+  std::uint16_t max_plies = 400; // Longer games are drawn.
+  bool sprt = false;
+  double elo0 = 0;
+  double elo1 = 5;
+  double alpha = 0.05;
+  double beta = 0.05;
+};
+
+struct BazuuMatchSummary {
+  BazuuMatchScore score;
+  SprtVerdict verdict = SprtVerdict::Continue;
+  bool failed = false; // An engine could not be started.
+};
+
+/*
+ * Engine against engine match. Every worker thread owns a process of each engine and plays one game at a time, each
+ * opening twice with the colours swapped. The moves are checked and the games adjudicated with the board's own rules:
+ * mate, stalemate, fifty moves, threefold repetition and insufficient material, while an illegal move, a crash or a
+ * loss on time loses the game. The score and, with sprt set, the verdict of a sequential probability ratio test are
+ * written after every game and the match stops early once the test accepts a hypothesis.
+ */
+class BazuuMatch {
+public:
+  explicit BazuuMatch(const BazuuMatchOptions &options);
+  BazuuMatchSummary run(std::ostream &log);
+  SprtVerdict sprt_verdict(const BazuuMatchScore &score) const;
+  double lower_bound() const;
+  double upper_bound() const;
+
+private:
+  BazuuMatchOptions options;
+  std::vector<std::string> openings;
+  std::mutex mutex; // Guards the score and the log.
+  std::ostream *log = nullptr;
+  BazuuMatchSummary summary;
+  std::atomic<U64> next_game = 0;
+  std::atomic<bool> finished = false;
+
+  void worker();
+  GameResult play_game(BazuuEngineProcess (&engines)[2], BazuuBoard &board, std::string_view opening,
+                       std::uint8_t white, std::string &reason);
+  std::string go_command(const std::int64_t (&clock)[2]) const;
+};
+#endif
@@ -0,0 +1,66 @@
+#ifndef BAZUU_CE_MOVE_H_
+#define BAZUU_CE_MOVE_H_
+#include <cstdint>
+#include <defs.hpp>
+#include <string>
+#include <utility>
+
+enum class MoveFlag : std::uint8_t { None = 0, DoublePush = 1, EnPassant = 2, Castling = 4 };
+
+/*
+ * A move packed into 32 bits, squares are on the 64 square board.
+ *  0- 5 from square
+ *  6-11 to square
+ * 12-15 moving piece
+ * 16-19 captured piece
+ * 20-23 promotion piece
+ * 24-27 flags
+ */
+struct BazuuMove {
+  std::uint32_t data = 0;
+
+  static constexpr BazuuMove encode(std::uint8_t from_64, std::uint8_t to_64, Pieces piece,
+                                    Pieces captured = Pieces::Empty, Pieces promotion = Pieces::Empty,
+                                    MoveFlag flag = MoveFlag::None) {
+    return BazuuMove{static_cast<std::uint32_t>(from_64) | static_cast<std::uint32_t>(to_64) << 6 |
+                     static_cast<std::uint32_t>(std::to_underlying(piece)) << 12 |
+                     static_cast<std::uint32_t>(std::to_underlying(captured)) << 16 |
+                     static_cast<std::uint32_t>(std::to_underlying(promotion)) << 20 |
+                     static_cast<std::uint32_t>(std::to_underlying(flag)) << 24};
+  }
+  constexpr std::uint8_t from_64() const { return this->data & 0x3F; }
+  constexpr std::uint8_t to_64() const { return (this->data >> 6) & 0x3F; }
+  constexpr Pieces piece() const { return static_cast<Pieces>((this->data >> 12) & 0xF); }
+  constexpr Pieces captured() const { return static_cast<Pieces>((this->data >> 16) & 0xF); }
+  constexpr Pieces promotion() const { return static_cast<Pieces>((this->data >> 20) & 0xF); }
+  constexpr MoveFlag flag() const { return static_cast<MoveFlag>((this->data >> 24) & 0xF); }
+  constexpr bool is_capture() const { return this->captured() != Pieces::Empty; }
+  constexpr bool is_promotion() const { return this->promotion() != Pieces::Empty; }
+  constexpr bool is_quiet() const { return !this->is_capture() && !this->is_promotion(); }
+  constexpr bool is_null() const { return this->data == 0; }
+  constexpr bool operator==(const BazuuMove &other) const = default;
+
+  /*
+   * Get the move in UCI long algebraic notation e.g. e2e4, e7e8q.
+   */
+  std::string to_uci() const {
+    std::string uci = std::string(square_to_coordinates[this->from_64()]) + square_to_coordinates[this->to_64()];
+    if (this->is_promotion())
+      uci += AsciiPieceChars[1][std::to_underlying(piece_type(this->promotion()))][0];
+    return uci;
+  }
+};
+
+/*
+ * Fixed capacity list of moves with their ordering scores.
+ */
+struct BazuuMoveList {
+  static constexpr std::uint16_t MAX_MOVES = 256;
+  BazuuMove moves[MAX_MOVES];
+  std::int32_t scores[MAX_MOVES];
+  std::uint16_t count = 0;
+
+  void add(BazuuMove move) { this->moves[this->count++] = move; }
+  void clear() { this->count = 0; }
+};
+#endif
@@ -0,0 +1,60 @@
+#ifndef BAZUU_CE_MOVE_ORDERING_H_
+#define BAZUU_CE_MOVE_ORDERING_H_
+#include <bazuu_ce_board.hpp>
+#include <bazuu_ce_move.hpp>
+#include <cstdint>
+#include <defs.hpp>
+
+/*
+ * Quiet move heuristics, each one can be switched off to measure it on a fixed bench. A switched off heuristic is
+ * neither updated nor used for scoring.
+ */
+struct BazuuOrderingOptions {
+  bool killer_moves = true;
+  bool history = true;
+  bool counter_moves = true;
+  bool continuation_history = true;
+};
+
+/*
+ * Per thread move ordering heuristics: killer moves, butterfly history, counter moves and
+ * 1-ply/2-ply continuation history. History tables are int16 and updated with a gravity formula
+ * which keeps every entry within [-HISTORY_MAX, HISTORY_MAX].
+ */
+class BazuuMoveOrdering {
+public:
+  static constexpr std::int32_t HISTORY_MAX = 16384;
+  static constexpr std::uint8_t KILLER_SLOTS = 2;
+  // Score bands, from searched first to searched last.
+  static constexpr std::int32_t TT_MOVE_SCORE = 1 << 30;
+  static constexpr std::int32_t CAPTURE_SCORE = 1 << 28;
+  static constexpr std::int32_t KILLER_SCORE = 1 << 26;
+  static constexpr std::int32_t COUNTER_MOVE_SCORE = KILLER_SCORE - KILLER_SLOTS;
+  // A piece-to table: the continuation history of one previous (piece, to) move.
+  using PieceToHistory = std::int16_t[12][64];
+
+  BazuuMoveOrdering();
+  void clear();
+  void update_killers(std::uint16_t ply, BazuuMove move);
+  BazuuMove killer(std::uint16_t ply, std::uint8_t slot) const;
+  BazuuMove counter_move(BazuuMove previous) const;
+  std::int16_t butterfly_history(Colours side, BazuuMove move) const;
+  std::int16_t continuation_history(std::uint8_t plies_ago, BazuuMove previous, BazuuMove move) const;
+  void update_quiet_histories(Colours side, std::uint16_t ply, std::uint8_t depth, BazuuMove best_move,
+                              const BazuuMove *quiets_tried, std::uint16_t quiet_count, BazuuMove previous_1,
+                              BazuuMove previous_2);
+  void score_moves(BazuuMoveList &list, Colours side, std::uint16_t ply, BazuuMove tt_move, BazuuMove previous_1,
+                   BazuuMove previous_2) const;
+  static BazuuMove pick_move(BazuuMoveList &list, std::uint16_t start);
+  static std::int32_t history_bonus(std::uint8_t depth);
+  static void apply_gravity(std::int16_t &entry, std::int32_t bonus);
+  BazuuOrderingOptions options;
+
+private:
+  BazuuMove killers[BazuuBoard::MAX_PLY][KILLER_SLOTS];
+  std::int16_t butterfly[std::to_underlying(Colours::Both)][64][64];
+  BazuuMove counter_moves[12][64];
+  PieceToHistory continuation[2][12][64];
+  static std::uint8_t piece_index(Pieces piece) { return std::to_underlying(piece) - 1; }
+};
+#endif
@@ -0,0 +1,167 @@
+#ifndef BAZUU_CE_NNUE_H_
+#define BAZUU_CE_NNUE_H_
+#include <cstdint>
+#include <defs.hpp>
+#include <memory>
+#include <string>
+
+class BazuuBoard;
+class BazuuEvalCache;
+
+// Network layout: (king bucket x piece x square) features per perspective -> HIDDEN_SIZE int16 accumulator per
+// perspective -> clipped ReLU to uint8 -> int8 affine to L1_SIZE int32 -> clipped ReLU -> single int32 output.
+namespace BazuuNNUEArch {
+inline constexpr std::uint32_t FILE_MAGIC = 0x4E4E5A42; // "BZNN" little-endian.
+inline constexpr std::uint32_t FILE_VERSION = 2;
+inline constexpr std::uint32_t KING_BUCKETS = 4;
+inline constexpr std::uint32_t FEATURES_PER_BUCKET = 2 * std::to_underlying(PieceType::Empty) * 64;
+inline constexpr std::uint32_t INPUT_FEATURES = KING_BUCKETS * FEATURES_PER_BUCKET;
+inline constexpr std::uint32_t HIDDEN_SIZE = 256;
+inline constexpr std::uint32_t L1_SIZE = 16;
+// Quantization: activations are clipped to [0, QA], hidden weights are scaled by 2^L1_SHIFT and output weights by QB.
+// QA stays below 128 so two products of an activation and an int8 weight never saturate an int16 lane.
+inline constexpr std::int32_t QA = 127;
+inline constexpr std::int32_t L1_SHIFT = 6;
+inline constexpr std::int32_t QB = 64;
+inline constexpr std::int32_t OUTPUT_SCALE = 400;
+// Depth of the lazily updated accumulator stack.
+inline constexpr std::uint16_t MAX_ACCUMULATOR_PLY = 256;
+// King bucket of each square, seen from the perspective's own side (a1 = 0).
+// Back rank queen side, back rank king side, second rank, everything else.
+inline constexpr std::uint8_t KING_BUCKET[64] = {
+    0, 0, 0, 0, 1, 1, 1, 1, //
+    2, 2, 2, 2, 2, 2, 2, 2, //
+    3, 3, 3, 3, 3, 3, 3, 3, //
+    3, 3, 3, 3, 3, 3, 3, 3, //
+    3, 3, 3, 3, 3, 3, 3, 3, //
+    3, 3, 3, 3, 3, 3, 3, 3, //
+    3, 3, 3, 3, 3, 3, 3, 3, //
+    3, 3, 3, 3, 3, 3, 3, 3, //
+};
+} // namespace BazuuNNUEArch
+
+enum class SimdLevel : std::uint8_t { Scalar = 0, SSE41, AVX2, AVX512 };
+enum class NNUELoadStatus : std::uint8_t { Ok = 0, FileNotFound, BadMagic, VersionMismatch, ArchMismatch, Truncated };
+
+/*
+ * A piece change of a move, squares are on the 64 square board.
+ * from_64 is 64 for a piece entering the board (promotion), to_64 is 64 for a piece leaving it (capture).
+ */
+struct BazuuDirtyPiece {
+  Colours colour;
+  PieceType piece;
+  std::uint8_t from_64;
+  std::uint8_t to_64;
+};
+
+/*
+ * Accumulator of the feature transformer for both perspectives (White, Black).
+ * The dirty pieces are the changes from the accumulator one ply below, applied only once it is evaluated.
+ */
+struct BazuuAccumulator {
+  alignas(64) std::int16_t values[std::to_underlying(Colours::Both)][BazuuNNUEArch::HIDDEN_SIZE];
+  bool computed[std::to_underlying(Colours::Both)] = {false, false};
+  BazuuDirtyPiece dirty[3];
+  std::uint8_t dirty_count = 0;
+  std::uint8_t king_squares[std::to_underlying(Colours::Both)] = {64, 64};
+};
+
+/*
+ * Stack of accumulators, one per ply, pushed by make_move and popped by unmake_move.
+ */
+struct BazuuAccumulatorStack {
+  BazuuAccumulator accumulators[BazuuNNUEArch::MAX_ACCUMULATOR_PLY];
+  std::uint16_t ply = 0;
+
+  BazuuAccumulator &current() { return this->accumulators[this->ply]; }
+  void reset(const std::uint8_t king_squares[2]) {
+    this->ply = 0;
+    this->accumulators[0].computed[0] = this->accumulators[0].computed[1] = false;
+    this->accumulators[0].dirty_count = 0;
+    this->accumulators[0].king_squares[0] = king_squares[0];
+    this->accumulators[0].king_squares[1] = king_squares[1];
+  }
+  void push(const BazuuDirtyPiece *dirty, std::uint8_t dirty_count, const std::uint8_t king_squares[2]) {
+    BazuuAccumulator &next = this->accumulators[++this->ply];
+    next.computed[0] = next.computed[1] = false;
+    next.dirty_count = dirty_count;
+    for (std::uint8_t i = 0; i < dirty_count; i++)
+      next.dirty[i] = dirty[i];
+    next.king_squares[0] = king_squares[0];
+    next.king_squares[1] = king_squares[1];
+  }
+  void pop() { this->ply--; }
+};
+
+/*
+ * Per thread cache of the last accumulator seen for every king square and perspective ("Finny tables").
+ * A refresh only applies the difference between the cached piece bitboards and the board's.
+ */
+struct BazuuAccumulatorCache {
+  struct Entry {
+    alignas(64) std::int16_t values[BazuuNNUEArch::HIDDEN_SIZE];
+    BitBoard pieces[std::to_underlying(Colours::Both)][std::to_underlying(PieceType::Empty)];
+  };
+  Entry entries[64][std::to_underlying(Colours::Both)];
+};
+
+/*
+ * The SIMD kernels used by the network, one table per instruction set.
+ */
+struct BazuuNNUEKernels {
+  SimdLevel level;
+  void (*add_column)(std::int16_t *accumulator, const std::int16_t *column);
+  void (*sub_column)(std::int16_t *accumulator, const std::int16_t *column);
+  void (*crelu_pack)(const std::int16_t *accumulator, std::uint8_t *output);
+  void (*affine_int8)(const std::uint8_t *input, const std::int8_t *weights, const std::int32_t *bias,
+                      std::int32_t *output);
+};
+
+class BazuuNNUE {
+public:
+  BazuuNNUE();
+  NNUELoadStatus load(const std::string &path);
+  bool save(const std::string &path) const;
+  void init_random(U64 seed);
+  void refresh(BazuuAccumulator &accumulator, BazuuBoard &board, Colours perspective) const;
+  void refresh(BazuuAccumulator &accumulator, BazuuBoard &board) const;
+  void refresh(BazuuAccumulator &accumulator, BazuuBoard &board, Colours perspective,
+               BazuuAccumulatorCache &cache) const;
+  void reset_cache(BazuuAccumulatorCache &cache) const;
+  void update(BazuuAccumulatorStack &stack, BazuuBoard &board, BazuuAccumulatorCache &cache) const;
+  void add_feature(BazuuAccumulator &accumulator, Colours perspective, std::uint32_t feature) const;
+  void remove_feature(BazuuAccumulator &accumulator, Colours perspective, std::uint32_t feature) const;
+  void add_piece(BazuuAccumulator &accumulator, const std::uint8_t king_squares[2], Colours colour, PieceType piece,
+                 std::uint8_t square_on_64_board) const;
+  void remove_piece(BazuuAccumulator &accumulator, const std::uint8_t king_squares[2], Colours colour, PieceType piece,
+                    std::uint8_t square_on_64_board) const;
+  void move_piece(BazuuAccumulator &accumulator, const std::uint8_t king_squares[2], Colours colour, PieceType piece,
+                  std::uint8_t from_64, std::uint8_t to_64) const;
+  std::int32_t evaluate(const BazuuAccumulator &accumulator, Colours side_to_move) const;
+  std::int32_t evaluate(BazuuAccumulatorStack &stack, BazuuBoard &board, BazuuAccumulatorCache &cache,
+                        Colours side_to_move) const;
+  std::int32_t evaluate(BazuuAccumulatorStack &stack, BazuuBoard &board, BazuuAccumulatorCache &cache,
+                        BazuuEvalCache &eval_cache) const;
+  std::int32_t evaluate_scalar(const BazuuAccumulator &accumulator, Colours side_to_move) const;
+  SimdLevel simd_level() const;
+  SimdLevel set_simd_level(SimdLevel level);
+  static SimdLevel detect_simd_level();
+  static std::uint32_t feature_index(Colours perspective, std::uint8_t king_square_64, Colours colour,
+                                     PieceType piece, std::uint8_t square_on_64_board);
+
+private:
+  struct Weights {
+    alignas(64) std::int16_t feature_weights[BazuuNNUEArch::INPUT_FEATURES][BazuuNNUEArch::HIDDEN_SIZE];
+    alignas(64) std::int16_t feature_bias[BazuuNNUEArch::HIDDEN_SIZE];
+    alignas(64) std::int8_t hidden_weights[BazuuNNUEArch::L1_SIZE][2 * BazuuNNUEArch::HIDDEN_SIZE];
+    alignas(64) std::int32_t hidden_bias[BazuuNNUEArch::L1_SIZE];
+    alignas(64) std::int16_t output_weights[BazuuNNUEArch::L1_SIZE];
+    std::int32_t output_bias;
+  };
+  std::unique_ptr<Weights> weights;
+  const BazuuNNUEKernels *kernels;
+  std::int32_t forward(const BazuuAccumulator &accumulator, Colours side_to_move,
+                       const BazuuNNUEKernels &kernels) const;
+  void apply_dirty_pieces(const BazuuAccumulator &previous, BazuuAccumulator &next, Colours perspective) const;
+};
+#endif
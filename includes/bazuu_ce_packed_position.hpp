@@ -0,0 +1,78 @@
+#ifndef BAZUU_CE_PACKED_POSITION_H_
+#define BAZUU_CE_PACKED_POSITION_H_
+#include <bazuu_ce_mapped_file.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <defs.hpp>
+#include <fstream>
+#include <string>
+
+// Game result of a training position, from white's point of view.
+enum class GameResult : std::uint8_t { None = 0, WhiteWins, Draw, BlackWins };
+
+/*
+ * A position in 32 little-endian bytes:
+ *   bytes 0-7    occupancy bitboard.
+ *   bytes 8-23   one 4 bit Pieces code per occupied square from a1 to h8, low nibble first.
+ *   bytes 24-31  side to move (bit 0), castling (bits 1-4), en passant square on the 64 square board or 64 (bits 5-11),
+ *                halfmove clock (bits 12-21), fullmove number (bits 22-37), score for the side to move
+ *                (bits 38-53) and game result (bits 54-55).
+ */
+struct BazuuPackedPosition {
+  static constexpr std::size_t SIZE = 32;
+  static constexpr std::uint8_t MAX_PIECES = 32;
+  static constexpr std::uint16_t MAX_HALFMOVE_CLOCK = 1023;
+  std::uint8_t bytes[SIZE] = {};
+
+  BitBoard occupancy() const;
+  Pieces piece(std::uint8_t index) const;
+  U64 state() const;
+  std::int16_t score() const;
+  GameResult result() const;
+  void set_occupancy(BitBoard occupancy);
+  void set_piece(std::uint8_t index, Pieces piece);
+  void set_state(U64 state);
+  void set_score(std::int16_t score);
+  void set_result(GameResult result);
+};
+static_assert(sizeof(BazuuPackedPosition) == BazuuPackedPosition::SIZE);
+
+/*
+ * Memory mapped file of packed positions, read in place.
+ */
+class BazuuPackedReader {
+public:
+  bool open(const std::string &path);
+  void close() { this->file.close(); }
+  bool is_open() const { return this->file.is_open(); }
+  std::size_t size() const { return this->file.size() / BazuuPackedPosition::SIZE; }
+  void read(std::size_t index, BazuuPackedPosition &packed) const;
+
+private:
+  BazuuMappedFile file;
+};
+
+/*
+ * Writer of packed positions, records are gathered in a fixed buffer and written a block at a time.
+ */
+class BazuuPackedWriter {
+public:
+  static constexpr std::size_t BUFFER_POSITIONS = 2048;
+  BazuuPackedWriter() = default;
+  ~BazuuPackedWriter();
+  BazuuPackedWriter(const BazuuPackedWriter &) = delete;
+  BazuuPackedWriter &operator=(const BazuuPackedWriter &) = delete;
+  bool open(const std::string &path, bool append = false);
+  bool write(const BazuuPackedPosition &packed);
+  bool flush();
+  bool close();
+  bool is_open() const { return this->file.is_open(); }
+  U64 written() const { return this->count; }
+
+private:
+  std::ofstream file;
+  std::uint8_t buffer[BUFFER_POSITIONS * BazuuPackedPosition::SIZE];
+  std::size_t buffered = 0;
+  U64 count = 0;
+};
+#endif
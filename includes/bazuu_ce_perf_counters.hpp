@@ -0,0 +1,40 @@
+#ifndef BAZUU_CE_PERF_COUNTERS_H_
+#define BAZUU_CE_PERF_COUNTERS_H_
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+enum class BazuuPerfEvent : std::uint8_t {
+  Cycles = 0,
+  Instructions,
+  L1DMisses,
+  LLCMisses,
+  BranchMisses,
+  DTLBMisses,
+  Count
+};
+
+/*
+ * Hardware counters of the calling thread and the threads it starts while counting, read through Linux
+ * perf_event_open, user space only. Each event is opened on its own so the kernel can multiplex more events than the
+ * PMU has counters, the counts are scaled by the share of the time each one was running. Events the CPU, the kernel
+ * or perf_event_paranoid do not allow are left out, elsewhere than Linux none are available.
+ */
+class BazuuPerfCounters {
+public:
+  static constexpr std::uint8_t EVENTS = std::to_underlying(BazuuPerfEvent::Count);
+  BazuuPerfCounters();
+  ~BazuuPerfCounters();
+  BazuuPerfCounters(const BazuuPerfCounters &) = delete;
+  BazuuPerfCounters &operator=(const BazuuPerfCounters &) = delete;
+  static const char *event_name(BazuuPerfEvent event);
+  bool available(BazuuPerfEvent event) const { return this->fds[std::to_underlying(event)] >= 0; }
+  bool any_available() const;
+  void start();
+  void stop();
+  std::optional<double> count(BazuuPerfEvent event) const;
+
+private:
+  int fds[EVENTS];
+};
+#endif
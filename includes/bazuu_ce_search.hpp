@@ -0,0 +1,139 @@
+#ifndef BAZUU_CE_SEARCH_H_
+#define BAZUU_CE_SEARCH_H_
+#include <atomic>
+#include <bazuu_ce_board.hpp>
+#include <bazuu_ce_eval_cache.hpp>
+#include <bazuu_ce_move.hpp>
+#include <bazuu_ce_move_ordering.hpp>
+#include <bazuu_ce_nnue.hpp>
+#include <bazuu_ce_tablebase.hpp>
+#include <bazuu_ce_transposition.hpp>
+#include <chrono>
+#include <cstdint>
+#include <defs.hpp>
+#include <memory>
+#include <vector>
+
+/*
+ * Limits of a search, a zero value means no limit.
+ */
+struct BazuuSearchLimits {
+  std::uint8_t depth = 64;
+  U64 nodes = 0;
+  U64 movetime_ms = 0;
+};
+
+/*
+ * Selective search techniques and quiet move ordering heuristics, each one can be switched off to measure it on a
+ * fixed bench.
+ */
+struct BazuuSearchOptions {
+  bool null_move_pruning = true;
+  bool late_move_reductions = true;
+  bool reverse_futility_pruning = true;
+  bool futility_pruning = true;
+  bool late_move_pruning = true;
+  bool killer_moves = true;
+  bool history = true;
+  bool counter_moves = true;
+  bool continuation_history = true;
+};
+
+struct BazuuSearchStats {
+  U64 nodes = 0;
+  U64 qnodes = 0;
+  U64 null_move_cutoffs = 0;
+  U64 reduced_searches = 0;
+  U64 reduction_researches = 0;
+  U64 reverse_futility_cutoffs = 0;
+  U64 futility_prunes = 0;
+  U64 late_move_prunes = 0;
+  U64 tb_hits = 0;
+
+  BazuuSearchStats &operator+=(const BazuuSearchStats &other) {
+    this->nodes += other.nodes;
+    this->qnodes += other.qnodes;
+    this->null_move_cutoffs += other.null_move_cutoffs;
+    this->reduced_searches += other.reduced_searches;
+    this->reduction_researches += other.reduction_researches;
+    this->reverse_futility_cutoffs += other.reverse_futility_cutoffs;
+    this->futility_prunes += other.futility_prunes;
+    this->late_move_prunes += other.late_move_prunes;
+    this->tb_hits += other.tb_hits;
+    return *this;
+  }
+};
+
+// One of the best root moves of a MultiPV search with its own score and principal variation.
+struct BazuuRootLine {
+  BazuuMove move;
+  std::int32_t score = 0;
+  std::vector<BazuuMove> pv;
+};
+
+struct BazuuSearchResult {
+  BazuuMove best_move;
+  std::int32_t score = 0;
+  std::uint8_t depth = 0;
+  std::vector<BazuuMove> pv;
+  std::vector<BazuuRootLine> lines; // Best first, the first is best_move, score and pv.
+  BazuuSearchStats stats;
+  U64 elapsed_ms = 0;
+};
+
+/*
+ * Iterative deepening principal variation search with quiescence search.
+ * One instance per search thread, it owns the thread's move ordering and NNUE accumulator state. With multi_pv above
+ * one each iteration searches the root once per line, leaving out the moves of the lines found before; the slots of
+ * an iteration share the transposition table and move ordering, so the later ones mostly replay stored results.
+ */
+class BazuuSearch {
+public:
+  static constexpr std::int32_t INFINITE = 32000;
+  static constexpr std::int32_t MATE = 31000;
+  static constexpr std::int32_t MATE_BOUND = MATE - 256;
+  static constexpr std::uint16_t MAX_SEARCH_PLY = 128;
+  // Tablebase wins, below any mate score.
+  static constexpr std::int32_t TB_WIN = MATE_BOUND - MAX_SEARCH_PLY;
+
+  BazuuSearch(BazuuBoard &board, const BazuuNNUE *nnue = nullptr);
+  BazuuSearchResult search(const BazuuSearchLimits &limits);
+  void stop();
+  std::int32_t evaluate();
+  static std::uint8_t reduction(int depth, int move_number);
+  BazuuSearchOptions options;
+  BazuuTablebase *tablebase = nullptr;
+  BazuuTranspositionTable *tt = nullptr;
+  BazuuEvalCache *eval_cache = nullptr; // Static evaluations, may be shared with other searches.
+  std::uint8_t multi_pv = 1; // Number of best root moves searched, each with its own score and pv.
+
+private:
+  BazuuBoard &board;
+  const BazuuNNUE *nnue;
+  std::unique_ptr<BazuuMoveOrdering> ordering;
+  std::unique_ptr<BazuuAccumulatorStack> accumulators;
+  std::unique_ptr<BazuuAccumulatorCache> accumulator_cache;
+  std::atomic<bool> stopped = false;
+  BazuuSearchLimits limits;
+  BazuuSearchStats stats;
+  std::chrono::steady_clock::time_point start_time;
+  BazuuMove root_best_move;
+  std::vector<BazuuMove> root_moves; // Moves searched at the root, all of them when empty.
+  std::vector<BazuuMove> excluded_root_moves; // Best moves of the MultiPV lines already found this iteration.
+  BazuuMove played[MAX_SEARCH_PLY + 1];
+  BazuuMove pv_table[MAX_SEARCH_PLY][MAX_SEARCH_PLY];
+  std::uint8_t pv_length[MAX_SEARCH_PLY];
+
+  std::int32_t negamax(std::int32_t alpha, std::int32_t beta, int depth, std::uint16_t ply, bool null_allowed);
+  std::int32_t quiescence(std::int32_t alpha, std::int32_t beta, std::uint16_t ply);
+  bool make_move(BazuuMove move, std::uint16_t ply);
+  void unmake_move(BazuuMove move);
+  bool make_null_move(std::uint16_t ply);
+  void unmake_null_move();
+  void check_limits();
+  void update_pv(BazuuMove move, std::uint16_t ply);
+  bool can_probe_tablebase();
+  static std::int32_t score_to_tt(std::int32_t score, std::uint16_t ply);
+  static std::int32_t score_from_tt(std::int32_t score, std::uint16_t ply);
+};
+#endif
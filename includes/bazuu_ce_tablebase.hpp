@@ -0,0 +1,48 @@
+#ifndef BAZUU_CE_TABLEBASE_H_
+#define BAZUU_CE_TABLEBASE_H_
+#include <bazuu_ce_move.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <defs.hpp>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class BazuuBoard;
+
+// Win/draw/loss from the side to move's point of view, cursed wins and blessed losses are drawn by the fifty move rule.
+enum class WDLScore : std::int8_t { Loss = -2, BlessedLoss = -1, Draw = 0, CursedWin = 1, Win = 2 };
+// Fail: no table or a bad one. ChangeSideToMove: DTZ table stored for the other side. ZeroingBestMove: the best move
+// is a capture or a pawn move.
+enum class ProbeState : std::int8_t { Fail = 0, Ok = 1, ChangeSideToMove = -1, ZeroingBestMove = 2 };
+
+/*
+ * Syzygy endgame tablebases. init() only lists the directory, a table file is memory mapped the first time a position
+ * of its material is probed. After that probes are lock free and can be made from any search thread.
+ */
+class BazuuTablebase {
+public:
+  static constexpr std::uint8_t MAX_PIECES = 7;
+  static constexpr int MAX_DTZ = 1 << 18;
+  struct Table; // One table file, defined with the decoder.
+
+  BazuuTablebase();
+  ~BazuuTablebase();
+  std::size_t init(const std::string &directory);
+  std::uint8_t max_pieces() const { return this->cardinality; }
+  std::size_t mapped_tables() const;
+  WDLScore probe_wdl(BazuuBoard &board, ProbeState &state);
+  int probe_dtz(BazuuBoard &board, ProbeState &state);
+  bool root_probe(BazuuBoard &board, std::vector<BazuuMove> &root_moves);
+  static U64 material_key(const std::uint16_t pieces_on_board[13], bool mirror);
+
+private:
+  std::vector<std::unique_ptr<Table>> tables;
+  std::unordered_map<U64, Table *> wdl_tables;
+  std::unordered_map<U64, Table *> dtz_tables;
+  std::uint8_t cardinality = 0;
+  WDLScore search(BazuuBoard &board, ProbeState &state, bool check_zeroing_moves);
+  int probe_table(BazuuBoard &board, bool dtz, ProbeState &state, WDLScore wdl = WDLScore::Draw);
+};
+#endif
@@ -0,0 +1,62 @@
+#ifndef BAZUU_CE_TRACE_H_
+#define BAZUU_CE_TRACE_H_
+#include <cstdint>
+#include <ostream>
+
+// Set by the WITH_TRACING CMake option, without it the trace scopes compile to nothing.
+#ifndef BAZUU_TRACING
+#define BAZUU_TRACING 0
+#endif
+
+// Instrumented parts of the engine, a scope of a zone nested in a scope of the same zone counts as that one.
+enum class BazuuTraceZone : std::uint8_t {
+  Search = 0,
+  Quiescence,
+  MoveGen,
+  MakeMove,
+  UnmakeMove,
+  Eval,
+  EvalCacheProbe,
+  Attacks,
+  TTProbe,
+  Count
+};
+
+/*
+ * Scoped timers on the hot paths, for finding where the time goes without an external profiler. A scope reads the
+ * time stamp counter (clock_gettime nanoseconds off x86) when it starts and ends, and charges its time less that of
+ * the scopes nested in it to the stack of zones it runs in. Each thread adds to a buffer of its own with plain stores,
+ * so the scopes take no locks; write_folded() merges the buffers into folded stacks ("search;movegen 1234" lines) for
+ * flamegraph tools, and should only run while the traced threads are idle.
+ */
+class BazuuTrace {
+public:
+  static constexpr bool ENABLED = BAZUU_TRACING;
+  static constexpr std::uint8_t MAX_DEPTH = 15; // Deeper scopes are charged to the zone at this depth.
+  static const char *zone_name(BazuuTraceZone zone);
+  static std::uint64_t now();
+  static void write_folded(std::ostream &output);
+  static void reset();
+};
+
+class BazuuTraceScope {
+public:
+  explicit BazuuTraceScope(BazuuTraceZone zone);
+  ~BazuuTraceScope();
+  BazuuTraceScope(const BazuuTraceScope &) = delete;
+  BazuuTraceScope &operator=(const BazuuTraceScope &) = delete;
+
+private:
+  std::uint64_t start = 0; // 0 when the scope is merged into the one it is nested in.
+  std::uint64_t parent_path = 0;
+};
+
+#if BAZUU_TRACING
+#define BAZUU_TRACE_CONCAT_(a, b) a##b
+#define BAZUU_TRACE_CONCAT(a, b) BAZUU_TRACE_CONCAT_(a, b)
+#define BAZUU_TRACE_SCOPE(zone)                                                                                        \
+  const BazuuTraceScope BAZUU_TRACE_CONCAT(bazuu_trace_scope_, __LINE__) { BazuuTraceZone::zone }
+#else
+#define BAZUU_TRACE_SCOPE(zone) static_cast<void>(0)
+#endif
+#endif
@@ -0,0 +1,77 @@
+#ifndef BAZUU_CE_TRANSPOSITION_H_
+#define BAZUU_CE_TRANSPOSITION_H_
+#include <atomic>
+#include <bazuu_ce_move.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <defs.hpp>
+#include <memory>
+#include <string>
+
+enum class BazuuTTBound : std::uint8_t { None = 0, Upper = 1, Lower = 2, Exact = 3 };
+
+struct BazuuTTHit {
+  BazuuMove move;
+  std::int16_t score = 0; // Mate scores are relative to the node, see BazuuSearch.
+  std::uint8_t depth = 0;
+  BazuuTTBound bound = BazuuTTBound::None;
+};
+
+/*
+ * Transposition table of search results indexed by the zobrist key of the position, in buckets of four entries
+ * filling a cache line. An entry is two 64-bit words, the data and the key xor the data, so threads read and write it
+ * without locks: a torn entry fails the key check and reads as a miss.
+ *  data  0-27 move
+ *       28-43 score
+ *       44-51 depth
+ *       52-53 bound
+ *       54-59 generation of the search that stored it
+ * The table can be saved to a snapshot file and mapped back from it copy on write, so a later session starts from
+ * the results of the last one. The file header holds the zobrist key version and the geometry of the table.
+ * It can also live in a named POSIX shared memory segment with the same header, where engine processes on one host
+ * share it with the same lockless entries as threads; the segment stays until remove_shared().
+ */
+class BazuuTranspositionTable {
+public:
+  static constexpr std::size_t DEFAULT_SIZE_MB = 16;
+  static constexpr std::uint8_t BUCKET_ENTRIES = 4;
+  struct Entry {
+    std::atomic<std::uint64_t> key_xor_data{0};
+    std::atomic<std::uint64_t> data{0};
+  };
+  struct alignas(64) Bucket {
+    Entry entries[BUCKET_ENTRIES];
+  };
+
+  explicit BazuuTranspositionTable(std::size_t size_mb = DEFAULT_SIZE_MB);
+  ~BazuuTranspositionTable();
+  BazuuTranspositionTable(const BazuuTranspositionTable &) = delete;
+  BazuuTranspositionTable &operator=(const BazuuTranspositionTable &) = delete;
+  void resize(std::size_t size_mb);
+  bool save(const std::string &path) const;
+  bool load(const std::string &path);
+  bool open_shared(const std::string &name, std::size_t size_mb);
+  static bool remove_shared(const std::string &name);
+  bool is_mapped() const { return this->mapping != nullptr; }
+  bool is_shared() const { return this->shared; }
+  void clear();
+  void new_search();
+  bool probe(ZobristKey key, BazuuTTHit &hit) const;
+  void store(ZobristKey key, BazuuMove move, std::int32_t score, int depth, BazuuTTBound bound);
+  std::uint16_t hashfull() const;
+  std::size_t size() const { return this->bucket_count; }
+
+private:
+  Bucket *buckets = nullptr;
+  std::size_t bucket_count = 0;
+  std::uint8_t generation = 0;
+  std::unique_ptr<Bucket[]> allocation; // Holds the buckets unless they are mapped.
+  void *mapping = nullptr;              // Snapshot or shared segment the buckets are mapped from, after its header.
+  std::size_t mapping_length = 0;
+  bool shared = false; // Mapped from a shared memory segment, the generation is the one in its header.
+
+  void release();
+
+  Bucket &bucket(ZobristKey key) const { return this->buckets[key & (this->bucket_count - 1)]; }
+};
+#endif
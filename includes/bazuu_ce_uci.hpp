@@ -0,0 +1,54 @@
+#ifndef BAZUU_CE_UCI_H_
+#define BAZUU_CE_UCI_H_
+#include <atomic>
+#include <bazuu_ce_board.hpp>
+#include <bazuu_ce_book.hpp>
+#include <bazuu_ce_move.hpp>
+#include <bazuu_ce_search.hpp>
+#include <bazuu_ce_tablebase.hpp>
+#include <bazuu_ce_transposition.hpp>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <prng.hpp>
+#include <string_view>
+#include <thread>
+
+/*
+ * Universal Chess Interface loop. Commands are read on the calling thread, a search runs on its own thread so that
+ * isready and stop are answered while it is going on.
+ */
+class BazuuUci {
+public:
+  BazuuUci();
+  ~BazuuUci();
+  void run(std::istream &input, std::ostream &output);
+  bool handle(std::string_view command, std::ostream &output);
+  static BazuuMove parse_move(BazuuBoard &board, std::string_view uci_move);
+  static BazuuSearchLimits parse_go(std::string_view arguments, Colours side_to_move);
+
+private:
+  std::unique_ptr<BazuuBoard> board;
+  std::unique_ptr<BazuuSearch> search;
+  std::unique_ptr<BazuuTablebase> tablebase;
+  std::unique_ptr<BazuuTranspositionTable> tt;
+  std::unique_ptr<BazuuEvalCache> eval_cache;
+  std::string hash_file; // Snapshot of the table, loaded when set and saved on quit.
+  BazuuBook book;
+  bool own_book = false;
+  PRNG prng{0x9E3779B97F4A7C15ULL};
+  std::thread search_thread;
+  std::atomic<bool> searching = false;
+  bool limited_search = false; // The search ends by itself, it is not go infinite.
+  std::mutex output_mutex;
+
+  bool position(std::string_view arguments);
+  void go(std::string_view arguments, std::ostream &output);
+  void set_option(std::string_view arguments, std::ostream &output);
+  void stop_search();
+  void save_hash_file(std::ostream &output);
+  void write(std::ostream &output, std::string_view line);
+};
+#endif
@@ -1,22 +1,65 @@
 #ifndef BAZUU_CE_ZOBRIST_H_
 #define BAZUU_CE_ZOBRIST_H_
+#include <bazuu_polyglot_data.hpp>
+#include <bit>
+#include <cstdint>
 #include <defs.hpp>
+#include <prng.hpp>
 #include <utility>
 
+/*
+ * Zobrist keys, generated at compile time. Piece keys are indexed by the Pieces code less one and the square on the
+ * 64 square board, so the 64 keys of a piece share one dense row, and en passant keys by the file of the square.
+ */
 class BazuuZobrist {
 public:
-  BazuuZobrist();
-  void init();
-  U64 piece_hash(Colours colour, PieceType piece, BoardSquares square);
-  U64 side_hash(Colours colour);
-  U64 castling_hash(CastlePermissions permissions);
-  U64 enpassant_hash(BoardSquares square);
+  // Polyglot layout: 12 * 64 piece keys, 4 castling keys, 8 en passant file keys and the White to move key.
+  static constexpr std::uint16_t POLYGLOT_KEYS = Polyglot::RANDOM_KEYS;
+  static constexpr std::uint16_t POLYGLOT_CASTLING = 768;
+  static constexpr std::uint16_t POLYGLOT_ENPASSANT = 772;
+  static constexpr std::uint16_t POLYGLOT_TURN = 780;
 
-private:
-  U64 pieces_hash_key[std::to_underlying(Colours::Both)][std::to_underlying(PieceType::Empty)]
-                     [std::to_underlying(BoardSquares::NO_SQ)];
-  U64 side_to_move_hash_key[std::to_underlying(Colours::Both)];
-  U64 castling_hash_key[16];
-  U64 enpassant_hash_key[std::to_underlying(BoardSquares::NO_SQ)];
+  struct Keys {
+    U64 pieces[12][64];
+    U64 side_to_move[std::to_underlying(Colours::Both)];
+    U64 castling[16];
+    U64 enpassant[8];
+  };
+  static constexpr Keys KEYS = [] {
+    Keys keys{};
+    PRNG prng(1023310525ULL);
+    for (U64 &key : keys.side_to_move)
+      key = prng.rand64();
+    for (U64 &key : keys.castling)
+      key = prng.rand64();
+    for (auto &row : keys.pieces)
+      for (U64 &key : row)
+        key = prng.rand64();
+    for (U64 &key : keys.enpassant)
+      key = prng.rand64();
+    return keys;
+  }();
+  // Fingerprint of the keys, data keyed by them that outlives the process is only valid with the same keys.
+  static constexpr U64 KEYS_VERSION = [] {
+    U64 version = 0;
+    for (const auto &row : KEYS.pieces)
+      for (U64 key : row)
+        version = std::rotl(version, 7) ^ key;
+    for (U64 key : KEYS.side_to_move)
+      version = std::rotl(version, 7) ^ key;
+    for (U64 key : KEYS.castling)
+      version = std::rotl(version, 7) ^ key;
+    for (U64 key : KEYS.enpassant)
+      version = std::rotl(version, 7) ^ key;
+    return version;
+  }();
+
+  static constexpr U64 piece_hash(Colours colour, PieceType piece, std::uint8_t square_on_64_board) {
+    return KEYS.pieces[std::to_underlying(colour) * 6 + std::to_underlying(piece)][square_on_64_board];
+  }
+  static constexpr U64 side_hash(Colours colour) { return KEYS.side_to_move[std::to_underlying(colour)]; }
+  static constexpr U64 castling_hash(CastlePermissions permissions) { return KEYS.castling[permissions]; }
+  static constexpr U64 enpassant_hash(std::uint8_t file) { return KEYS.enpassant[file]; }
+  static constexpr U64 polyglot_hash(std::uint16_t index) { return Polyglot::RANDOM64[index]; }
 };
 #endif
@@ -9,6 +9,19 @@ using ZobristKey = U64;
 
 enum class Pieces : std::uint8_t { Empty = 0, wP, wN, wB, wR, wQ, wK, bP, bN, bB, bR, bQ, bK };
 enum class PieceType : std::uint8_t { P = 0, N, B, R, Q, K, Empty };
+enum class Colours : std::uint8_t { White, Black, Both };
+/*
+ * Conversions between a coloured piece and its (colour, piece type) pair.
+ */
+constexpr Pieces to_piece(Colours colour, PieceType piece) {
+  return static_cast<Pieces>(1 + std::to_underlying(colour) * 6 + std::to_underlying(piece));
+}
+constexpr PieceType piece_type(Pieces piece) {
+  return piece == Pieces::Empty ? PieceType::Empty : static_cast<PieceType>((std::to_underlying(piece) - 1) % 6);
+}
+constexpr Colours piece_colour(Pieces piece) {
+  return piece == Pieces::Empty ? Colours::Both : static_cast<Colours>((std::to_underlying(piece) - 1) / 6);
+}
 constexpr const char *PieceChars[2][std::to_underlying(PieceType::Empty)] = {{"♟", "♞", "♝", "♜", "♛", "♚"},
                                                                              {"♙", "♘", "♗", "♖", "♕", "♔"}};
 constexpr const char *AsciiPieceChars[2][std::to_underlying(PieceType::Empty)] = {{"P", "N", "B", "R", "Q", "K"},
@@ -25,7 +38,6 @@ constexpr const char *square_to_coordinates[] = {
 };
 enum class File : std::uint8_t { A = 0, B, C, D, E, F, G, H, NONE };
 enum class Rank : std::uint8_t { R1 = 0, R2, R3, R4, R5, R6, R7, R8, NONE };
-enum class Colours : std::uint8_t { White, Black, Both };
 constexpr char ActiveSideRep[4] = "wb-";
 enum class BoardSquares : std::uint8_t {
   A1 = 21,
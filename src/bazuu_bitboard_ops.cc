@@ -0,0 +1,72 @@
+#include "bazuu_bitboard_ops.hpp"
+#include "defs.hpp"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BAZUU_BITBOARD_X86 1
+#else
+#define BAZUU_BITBOARD_X86 0
+#endif
+
+namespace BazuuBitBoardOps {
+
+#if BAZUU_BITBOARD_X86
+template <bool Up> __attribute__((target("avx2"))) static inline __m256i shift_lanes(__m256i board, __m256i by) {
+  if constexpr (Up)
+    return _mm256_sllv_epi64(board, by);
+  else
+    return _mm256_srlv_epi64(board, by);
+}
+
+/*
+ * Kogge-Stone fill of the four directions shifting up (north, east, northeast, northwest) or down (south, west,
+ * southwest, southeast) at once, one 64 bit lane per direction.
+ * @return the attacks of each direction, in the order of slidingAttacks().
+ */
+template <bool Up>
+__attribute__((target("avx2"))) static inline __m256i fill_avx2(BitBoard straight, BitBoard diagonal, BitBoard empty) {
+  const __m256i one_step = _mm256_setr_epi64x(8, 1, 9, 7);
+  const __m256i two_steps = _mm256_slli_epi64(one_step, 1);
+  const __m256i four_steps = _mm256_slli_epi64(one_step, 2);
+  const __m256i wrap = Up ? _mm256_setr_epi64x(~0LL, NOT_A_FILE, NOT_A_FILE, NOT_H_FILE)
+                          : _mm256_setr_epi64x(~0LL, NOT_H_FILE, NOT_H_FILE, NOT_A_FILE);
+  __m256i gen = _mm256_setr_epi64x(straight, straight, diagonal, diagonal);
+  __m256i pro = _mm256_and_si256(_mm256_set1_epi64x(empty), wrap);
+  gen = _mm256_or_si256(gen, _mm256_and_si256(pro, shift_lanes<Up>(gen, one_step)));
+  pro = _mm256_and_si256(pro, shift_lanes<Up>(pro, one_step));
+  gen = _mm256_or_si256(gen, _mm256_and_si256(pro, shift_lanes<Up>(gen, two_steps)));
+  pro = _mm256_and_si256(pro, shift_lanes<Up>(pro, two_steps));
+  gen = _mm256_or_si256(gen, _mm256_and_si256(pro, shift_lanes<Up>(gen, four_steps)));
+  return _mm256_and_si256(shift_lanes<Up>(gen, one_step), wrap);
+}
+
+__attribute__((target("avx2"))) void slidingAttacksAvx2(BitBoard straight, BitBoard diagonal, BitBoard empty,
+                                                        BitBoard (&rays)[8]) {
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(rays), fill_avx2<true>(straight, diagonal, empty));
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(rays + 4), fill_avx2<false>(straight, diagonal, empty));
+}
+
+// The directions are merged without leaving the registers.
+__attribute__((target("avx2"))) BitBoard sliderAttacksAvx2(BitBoard straight, BitBoard diagonal, BitBoard empty) {
+  const __m256i rays =
+      _mm256_or_si256(fill_avx2<true>(straight, diagonal, empty), fill_avx2<false>(straight, diagonal, empty));
+  const __m128i half = _mm_or_si128(_mm256_castsi256_si128(rays), _mm256_extracti128_si256(rays, 1));
+  return _mm_cvtsi128_si64(half) | _mm_extract_epi64(half, 1);
+}
+
+bool hasAvx2() {
+  static const bool supported = [] {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+  }();
+  return supported;
+}
+#else
+void slidingAttacksAvx2(BitBoard straight, BitBoard diagonal, BitBoard empty, BitBoard (&rays)[8]) {
+  slidingAttacks(straight, diagonal, empty, rays);
+}
+BitBoard sliderAttacksAvx2(BitBoard straight, BitBoard diagonal, BitBoard empty) {
+  return sliderAttacks(straight, diagonal, empty);
+}
+bool hasAvx2() { return false; }
+#endif
+} // namespace BazuuBitBoardOps
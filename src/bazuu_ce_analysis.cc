@@ -0,0 +1,164 @@
+#include "bazuu_ce_analysis.hpp"
+#include "bazuu_ce_board.hpp"
+#include "bazuu_ce_search.hpp"
+#include "defs.hpp"
+#include <chrono>
+#include <cstddef>
+#include <format>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+BazuuAnalysis::BazuuAnalysis(const BazuuAnalysisOptions &options)
+    : options(options), eval_cache(std::make_unique<BazuuEvalCache>()) {
+  if (this->options.threads == 0)
+    this->options.threads = 1;
+  std::size_t queue_size = this->options.queue_size ? this->options.queue_size : this->options.threads * 4;
+  this->slots.resize(queue_size);
+}
+
+/*
+ * Analyse every EPD record of the input, blank lines are skipped.
+ * @param input - one EPD or FEN record per line.
+ * @param output - receives one result line per record, in input order.
+ * @return number of positions and nodes searched.
+ */
+BazuuAnalysisSummary BazuuAnalysis::run(std::istream &input, std::ostream &output) {
+  const auto start_time = std::chrono::steady_clock::now();
+  this->read_count = 0;
+  this->next_job = 0;
+  this->input_done = false;
+  this->summary = BazuuAnalysisSummary{};
+  std::vector<std::thread> workers;
+  for (std::uint16_t i = 0; i < this->options.threads; i++)
+    workers.emplace_back(&BazuuAnalysis::worker, this);
+
+  U64 written = 0;
+  // Write the results that follow the last written one, called with the mutex held.
+  auto write_done = [this, &output, &written]() {
+    while (written < this->read_count) {
+      Slot &slot = this->slots[written % this->slots.size()];
+      if (!slot.done)
+        break;
+      output << slot.result << '\n';
+      slot.done = false;
+      written++;
+    }
+  };
+
+  std::string line;
+  while (std::getline(input, line)) {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    if (line.find_first_not_of(' ') == std::string::npos)
+      continue;
+    std::unique_lock lock(this->mutex);
+    write_done();
+    // The queue is full until the oldest position in flight has been written.
+    while (this->read_count - written == this->slots.size()) {
+      this->result_ready.wait(lock);
+      write_done();
+    }
+    // Swapping keeps the buffers of the slots, nothing is allocated once they have grown to the longest record.
+    this->slots[this->read_count % this->slots.size()].line.swap(line);
+    this->read_count++;
+    lock.unlock();
+    this->work_ready.notify_one();
+  }
+
+  std::unique_lock lock(this->mutex);
+  this->input_done = true;
+  this->work_ready.notify_all();
+  write_done();
+  while (written < this->read_count) {
+    this->result_ready.wait(lock);
+    write_done();
+  }
+  lock.unlock();
+  for (std::thread &worker : workers)
+    worker.join();
+  output.flush();
+  this->summary.positions = written;
+  this->summary.elapsed_ms =
+      std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+  return this->summary;
+}
+
+/*
+ * Search queued positions until the input is exhausted.
+ */
+void BazuuAnalysis::worker() {
+  auto board = std::make_unique<BazuuBoard>();
+  std::string line;
+  std::string result;
+  for (;;) {
+    std::unique_lock lock(this->mutex);
+    this->work_ready.wait(lock, [this] { return this->next_job < this->read_count || this->input_done; });
+    if (this->next_job == this->read_count)
+      return;
+    Slot &slot = this->slots[this->next_job++ % this->slots.size()];
+    line.swap(slot.line);
+    lock.unlock();
+
+    U64 nodes = 0;
+    const bool valid = this->analyse(*board, line, result, nodes);
+    lock.lock();
+    slot.result.swap(result);
+    slot.done = true;
+    this->summary.nodes += nodes;
+    this->summary.invalid_positions += !valid;
+    lock.unlock();
+    this->result_ready.notify_one();
+  }
+}
+
+/*
+ * Search a position with a fresh search, results do not depend on which worker searched the positions before it.
+ * @param board - board of the worker.
+ * @param line - EPD record.
+ * @param result - set to the result line.
+ * @param nodes - set to the number of nodes searched.
+ * @return false if the record is not a valid position.
+ */
+bool BazuuAnalysis::analyse(BazuuBoard &board, std::string_view line, std::string &result, U64 &nodes) const {
+  if (board.setup_fen(line) != FenError::Ok) {
+    result = std::format("{} c0 \"invalid position\";", line);
+    return false;
+  }
+  auto search = std::make_unique<BazuuSearch>(board);
+  search->eval_cache = this->eval_cache.get();
+  BazuuSearchResult search_result = search->search(this->options.limits);
+  nodes = search_result.stats.nodes + search_result.stats.qnodes;
+  result = format_result(board.to_epd(), search_result);
+  return true;
+}
+
+/*
+ * Format a search result as EPD operations.
+ * @param epd - the four position fields.
+ * @param result - result of the search of the position.
+ * @return the EPD record of the result.
+ */
+std::string BazuuAnalysis::format_result(std::string_view epd, const BazuuSearchResult &result) {
+  std::string line(epd);
+  if (!result.best_move.is_null())
+    std::format_to(std::back_inserter(line), " bm {};", result.best_move.to_uci());
+  if (result.score >= BazuuSearch::MATE_BOUND)
+    std::format_to(std::back_inserter(line), " dm {};", (BazuuSearch::MATE - result.score + 1) / 2);
+  else if (result.score <= -BazuuSearch::MATE_BOUND)
+    std::format_to(std::back_inserter(line), " dm {};", -((BazuuSearch::MATE + result.score) / 2));
+  else
+    std::format_to(std::back_inserter(line), " ce {};", result.score);
+  std::format_to(std::back_inserter(line), " acd {}; acn {};", result.depth, result.stats.nodes + result.stats.qnodes);
+  if (!result.pv.empty()) {
+    line += " pv";
+    for (const BazuuMove move : result.pv)
+      std::format_to(std::back_inserter(line), " {}", move.to_uci());
+    line += ';';
+  }
+  return line;
+}
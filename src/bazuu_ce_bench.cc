@@ -0,0 +1,251 @@
+#include "bazuu_ce_bench.hpp"
+#include "bazuu_bitboard_ops.hpp"
+#include "bazuu_ce_board.hpp"
+#include "bazuu_ce_search.hpp"
+#include "bazuu_ce_transposition.hpp"
+#include "defs.hpp"
+#include <bit>
+#include <chrono>
+#include <format>
+#include <memory>
+
+// Openings, middlegames and endgames down to mate and stalemate, including the positions of defs.hpp. The killer
+// position has nine white pawns, the suite is set up without validation.
+const std::array<const char *, 50> BazuuBench::POSITIONS = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    TRICKY_BOARD_FEN,
+    KILLER_BOARD_FEN,
+    CMK_BOARD_FEN,
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+    "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+    "rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - - 7 14",
+    "r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 2 14",
+    "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+    "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+    "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 1 16",
+    "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
+    "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
+    "r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w - - 1 16",
+    "3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - - 6 22",
+    "r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w - - 2 18",
+    "4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b - - 3 22",
+    "3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - - 4 26",
+    "r3k2r/3nnpbp/q2pp1p1/p7/Pp1PPPP1/4BNN1/1P5P/R2Q1RK1 w kq - 0 16",
+    "4rrk1/1p1nq3/p7/2p1P1pp/3P2bp/3Q1Bn1/PPPB4/1K2R1NR w - - 40 21",
+    "5rk1/q6p/2p3bR/1pPp1rP1/1P1Pp3/P3B1Q1/1K3P2/R7 w - - 93 90",
+    "3Qb1k1/1r2ppb1/pN1n2q1/Pp1Pp1Pr/4P2p/4BP2/4B1R1/1R5K b - - 11 40",
+    "4k3/3q1r2/1N2r1b1/3ppN2/2nPP3/1B1R2n1/2R1Q3/3K4 w - - 5 1",
+    "1r3k2/4q3/2Pp3b/3Bp3/2Q2p2/1p1P2P1/1P2KP2/3N4 w - - 0 1",
+    "6k1/4pp1p/3p2p1/P1pPb3/R7/1r2P1PP/3B1P2/6K1 w - - 0 1",
+    "6k1/6p1/P6p/r1N5/5p2/7P/1b3PP1/4R1K1 w - - 0 1",
+    "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b - - 0 1",
+    "3b4/5kp1/1p1p1p1p/pP1PpP1P/P1P1P3/3KN3/8/8 w - - 0 1",
+    "2K5/p7/7P/5pR1/8/5k2/r7/8 w - - 0 1",
+    "8/6pk/1p6/8/PP3p1p/5P2/4KP1q/3Q4 w - - 0 1",
+    "7k/3p2pp/4q3/8/4Q3/5Kp1/P6b/8 w - - 0 1",
+    "8/2p5/8/2kPKp1p/2p4P/2P5/3P4/8 w - - 0 1",
+    "8/1p3pp1/7p/5P1P/2k3P1/8/2K2P2/8 w - - 0 1",
+    "8/pp2r1k1/2p1p3/3pP2p/1P1P1P1P/P5KR/8/8 w - - 0 1",
+    "8/3p4/p1bk3p/Pp6/1Kp1PpPp/2P2P1P/2P5/5B2 b - - 0 1",
+    "5k2/7R/4P2p/5K2/p1r2P1p/8/8/8 b - - 0 1",
+    "8/3p3B/5p2/5P2/p7/PP5b/k7/6K1 w - - 0 1",
+    "8/8/8/8/5kp1/P7/8/1K1N4 w - - 0 1",
+    "8/8/8/5N2/8/p7/8/2NK3k w - - 0 1",
+    "8/3k4/8/8/8/4B3/4KB2/2B5 w - - 0 1",
+    "8/8/1P6/5pr1/8/4R3/7k/2K5 w - - 0 1",
+    "8/2p4P/8/kr6/6R1/8/8/1K6 w - - 0 1",
+    "8/8/3P3k/8/1p6/8/1P6/1K3n2 b - - 0 1",
+    "8/R7/2q5/8/6k1/8/1P5p/K6R w - - 0 124",
+    "6k1/3b3r/1p1p4/p1n2p2/1PPNpP1q/P3Q1p1/1R1RB1P1/5K2 b - - 0 1",
+    "8/8/8/8/8/6k1/6p1/6K1 w - - 0 1",
+    "7k/7P/6K1/8/3B4/8/8/8 b - - 0 1",
+};
+
+/*
+ * Search every position of the suite.
+ * @param depth - depth of each search.
+ * @param multi_pv - number of best root moves searched.
+ * @param options - search techniques and ordering heuristics switched on.
+ * @return node count and time of each position and their totals.
+ */
+BazuuBenchSummary BazuuBench::run(std::uint8_t depth, std::uint8_t multi_pv, const BazuuSearchOptions &options) {
+  BazuuBenchSummary summary;
+  summary.depth = depth;
+  summary.multi_pv = multi_pv;
+  summary.positions.reserve(POSITIONS.size());
+  auto board = std::make_unique<BazuuBoard>();
+  BazuuTranspositionTable tt;
+  BazuuEvalCache eval_cache;
+  for (const char *fen : POSITIONS) {
+    board->setup_fen(fen, false);
+    tt.clear();
+    eval_cache.clear();
+    const auto start = std::chrono::steady_clock::now();
+    auto search = std::make_unique<BazuuSearch>(*board);
+    search->tt = &tt;
+    search->eval_cache = &eval_cache;
+    search->multi_pv = multi_pv;
+    search->options = options;
+    const BazuuSearchResult result = search->search({.depth = depth});
+    BazuuBenchPosition &position = summary.positions.emplace_back();
+    position.elapsed_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    position.fen = fen;
+    position.best_move = result.best_move;
+    position.nodes = result.stats.nodes + result.stats.qnodes;
+    summary.nodes += position.nodes;
+    summary.stats += result.stats;
+    summary.elapsed_us += position.elapsed_us;
+  }
+  return summary;
+}
+
+/*
+ * Write the results as a JSON object with the totals and a "positions" array of the positions in suite order.
+ * @param summary - results of run().
+ * @param output - receives the JSON document.
+ */
+void BazuuBench::write_json(const BazuuBenchSummary &summary, std::ostream &output) {
+  output << std::format("{{\n  \"depth\": {},\n  \"multipv\": {},\n  \"nodes\": {},\n  \"elapsed_us\": {},\n"
+                        "  \"nps\": {},\n  \"positions\": [\n",
+                        summary.depth, summary.multi_pv, summary.nodes, summary.elapsed_us, summary.nps());
+  for (std::size_t i = 0; i < summary.positions.size(); i++) {
+    const BazuuBenchPosition &position = summary.positions[i];
+    output << std::format("    {{\"fen\": \"{}\", \"best_move\": \"{}\", \"nodes\": {}, \"elapsed_us\": {}, "
+                          "\"nps\": {}}}{}\n",
+                          position.fen, position.best_move.is_null() ? "0000" : position.best_move.to_uci(),
+                          position.nodes, position.elapsed_us,
+                          position.nodes * 1000000 / (position.elapsed_us ? position.elapsed_us : 1),
+                          i + 1 < summary.positions.size() ? "," : "");
+  }
+  output << "  ]\n}\n";
+}
+
+/*
+ * Time the slider attacks of both sides on the positions of the suite, with a magic lookup per piece and with setwise
+ * fills of whole piece sets. Each method either fills the attacks by piece type and the squares attacked twice, as the
+ * attack maps of the board, or only the squares attacked by any slider.
+ * @param rounds - times each method goes through the suite.
+ * @return time per position and checksum of each method.
+ */
+std::vector<BazuuAttackBench> BazuuBench::run_attacks(U64 rounds) {
+  struct Sliders {
+    BitBoard sets[2][3]; // Bishops, rooks and queens of each side.
+    BitBoard occupancy;
+  };
+  auto board = std::make_unique<BazuuBoard>();
+  std::vector<Sliders> positions;
+  for (const char *fen : POSITIONS) {
+    board->setup_fen(fen, false);
+    Sliders &sliders = positions.emplace_back();
+    sliders.occupancy = board->occupancy();
+    for (Colours colour : {Colours::White, Colours::Black}) {
+      int index = 0;
+      for (PieceType piece : {PieceType::B, PieceType::R, PieceType::Q})
+        sliders.sets[std::to_underlying(colour)][index++] = board->get_bitboard_of_piece(piece, colour);
+    }
+  }
+
+  std::vector<BazuuAttackBench> results;
+  auto time = [&](const char *method, auto attacks) {
+    const auto start = std::chrono::steady_clock::now();
+    BitBoard checksum = 0ULL;
+    for (U64 round = 0; round < rounds; round++) {
+      for (const Sliders &sliders : positions)
+        checksum += attacks(sliders);
+    }
+    const auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    results.push_back({method, elapsed / static_cast<double>(rounds * positions.size()), checksum});
+  };
+
+  // Attacks of each piece type and squares attacked twice.
+  auto mix = [](BitBoard all, BitBoard twice, const BitBoard (&by_piece)[3]) {
+    return all ^ (twice * 3) ^ (by_piece[0] * 5) ^ (by_piece[1] * 7) ^ (by_piece[2] * 11);
+  };
+  time("magic by piece type", [&](const Sliders &sliders) {
+    BitBoard checksum = 0ULL;
+    for (const auto &sets : sliders.sets) {
+      BitBoard all = 0ULL, twice = 0ULL, by_piece[3] = {};
+      for (int set = 0; set < 3; set++) {
+        for (BitBoard bb = sets[set]; bb; bb &= bb - 1) {
+          const BoardSquares square = board->to_120_board_square(std::countr_zero(bb));
+          const BitBoard attacks = set == 0   ? board->get_bishop_attacks_lookup(square, sliders.occupancy)
+                                   : set == 1 ? board->get_rook_attacks_lookup(square, sliders.occupancy)
+                                              : board->get_queen_attacks_lookup(square, sliders.occupancy);
+          twice |= all & attacks;
+          all |= attacks;
+          by_piece[set] |= attacks;
+        }
+      }
+      checksum ^= mix(all, twice, by_piece);
+    }
+    return checksum;
+  });
+  auto setwise_by_piece = [&](auto sliding_attacks) {
+    return [&, sliding_attacks](const Sliders &sliders) {
+      BitBoard checksum = 0ULL;
+      for (const auto &sets : sliders.sets) {
+        BitBoard all = 0ULL, twice = 0ULL, by_piece[3] = {}, rays[8];
+        // Rooks along the ranks and files and bishops along the diagonals, then the queens along both.
+        sliding_attacks(sets[1], sets[0], ~sliders.occupancy, rays);
+        for (int ray = 0; ray < 8; ray++) {
+          twice |= all & rays[ray];
+          all |= rays[ray];
+          by_piece[ray % 4 < 2 ? 1 : 0] |= rays[ray];
+        }
+        sliding_attacks(sets[2], sets[2], ~sliders.occupancy, rays);
+        for (const BitBoard ray : rays) {
+          twice |= all & ray;
+          all |= ray;
+          by_piece[2] |= ray;
+        }
+        checksum ^= mix(all, twice, by_piece);
+      }
+      return checksum;
+    };
+  };
+  time("setwise by piece type",
+       setwise_by_piece([](BitBoard straight, BitBoard diagonal, BitBoard empty, BitBoard (&rays)[8]) {
+         BazuuBitBoardOps::slidingAttacks(straight, diagonal, empty, rays);
+       }));
+  if (BazuuBitBoardOps::hasAvx2()) {
+    time("setwise AVX2 by piece type",
+         setwise_by_piece([](BitBoard straight, BitBoard diagonal, BitBoard empty, BitBoard (&rays)[8]) {
+           BazuuBitBoardOps::slidingAttacksAvx2(straight, diagonal, empty, rays);
+         }));
+  }
+
+  // Squares attacked by any slider.
+  time("magic union", [&](const Sliders &sliders) {
+    BitBoard checksum = 0ULL;
+    for (const auto &sets : sliders.sets) {
+      BitBoard all = 0ULL;
+      for (BitBoard bb = sets[0] | sets[2]; bb; bb &= bb - 1)
+        all |= board->get_bishop_attacks_lookup(board->to_120_board_square(std::countr_zero(bb)), sliders.occupancy);
+      for (BitBoard bb = sets[1] | sets[2]; bb; bb &= bb - 1)
+        all |= board->get_rook_attacks_lookup(board->to_120_board_square(std::countr_zero(bb)), sliders.occupancy);
+      checksum = checksum * 3 + all;
+    }
+    return checksum;
+  });
+  time("setwise union", [&](const Sliders &sliders) {
+    BitBoard checksum = 0ULL;
+    for (const auto &sets : sliders.sets)
+      checksum =
+          checksum * 3 + BazuuBitBoardOps::sliderAttacks(sets[1] | sets[2], sets[0] | sets[2], ~sliders.occupancy);
+    return checksum;
+  });
+  if (BazuuBitBoardOps::hasAvx2()) {
+    time("setwise AVX2 union", [&](const Sliders &sliders) {
+      BitBoard checksum = 0ULL;
+      for (const auto &sets : sliders.sets)
+        checksum = checksum * 3 +
+                   BazuuBitBoardOps::sliderAttacksAvx2(sets[1] | sets[2], sets[0] | sets[2], ~sliders.occupancy);
+      return checksum;
+    });
+  }
+  return results;
+}
@@ -1,12 +1,18 @@
 #include "bazuu_ce_board.hpp"
 #include "bazuu_bitboard_ops.hpp"
+#include "bazuu_ce_cuckoo.hpp"
+#include "bazuu_ce_move.hpp"
+#include "bazuu_ce_packed_position.hpp"
+#include "bazuu_ce_trace.hpp"
 #include "bazuu_ce_zobrist.hpp"
 #include "bazuu_magic_data.hpp"
 #include "defs.hpp"
 #include <algorithm>
+#include <array>
 #include <bit>
 #include <cassert>
 #include <cctype>
+#include <charconv>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
@@ -18,20 +24,51 @@
 #include <prng.hpp>
 #include <set>
 #include <string>
+#include <string_view>
 #include <tuple>
+#include <type_traits>
 #include <utility>
 
 const std::string BazuuBoard::STARTING_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 
+// Boards hold no pointers, a copy for another thread is a plain memory copy.
+static_assert(std::is_trivially_copyable_v<BazuuBoard>);
+
+// The zobrist keys are constants, so every board shares one table of reversible moves.
+static const BazuuCuckoo cuckoo_table;
+
+// Whether slider_attacks() can fill the piece sets with AVX2, checked once.
+static const bool HAS_AVX2 = BazuuBitBoardOps::hasAvx2();
+
+// Castling permissions kept when a piece moves from or to a square, indexed by the square on the 64 square board.
+static constexpr CastlePermissions castling_rights_mask[64] = {
+    13, 15, 15, 15, 12, 15, 15, 14, //
+    15, 15, 15, 15, 15, 15, 15, 15, //
+    15, 15, 15, 15, 15, 15, 15, 15, //
+    15, 15, 15, 15, 15, 15, 15, 15, //
+    15, 15, 15, 15, 15, 15, 15, 15, //
+    15, 15, 15, 15, 15, 15, 15, 15, //
+    15, 15, 15, 15, 15, 15, 15, 15, //
+    7,  15, 15, 15, 3,  15, 15, 11, //
+};
+
+// FEN letter of each piece, indexed by Pieces.
+static constexpr const char *fen_piece_letters = ".PNBRQKpnbrqk";
+
+// Piece of each FEN letter, Pieces::Empty for any other character.
+static constexpr auto fen_pieces = [] {
+  std::array<Pieces, 256> pieces{};
+  for (std::uint8_t piece = std::to_underlying(Pieces::wP); piece <= std::to_underlying(Pieces::bK); piece++)
+    pieces[static_cast<unsigned char>(fen_piece_letters[piece])] = static_cast<Pieces>(piece);
+  return pieces;
+}();
+
 BazuuBoard::BazuuBoard() {
-  this->zobrist = std::make_shared<BazuuZobrist>();
-  this->game_state = std::make_shared<BazuuGameState>();
   this->init_board_squares();
-  this->game_state->zobrist_key = this->generate_hash_keys();
+  this->game_state.zobrist_key = this->generate_hash_keys();
   this->init_non_sliding_attacks();
   this->init_sliding_attacks(PieceType::B);
   this->init_sliding_attacks(PieceType::R);
-  this->prng = std::make_unique<PRNG>(Magic::seed);
 }
 
 /*
@@ -39,8 +76,8 @@ BazuuBoard::BazuuBoard() {
  * Creates the mapping between the two boards.
  */
 void BazuuBoard::init_board_squares() {
-  std::fill(std::begin(this->file_rank_to_board_mapper), std::end(this->file_rank_to_board_mapper),
-            std::make_pair(File::NONE, Rank::NONE));
+  std::fill(std::begin(this->square_files), std::end(this->square_files), File::NONE);
+  std::fill(std::begin(this->square_ranks), std::end(this->square_ranks), Rank::NONE);
   BoardSquares square_on_120_board = BoardSquares::A1;
   uint8_t square_on_64_board = 0;
   std::memset(this->sq_120_to_sq_64, this->INVALID_SQUARE_ON_64, sizeof(this->sq_120_to_sq_64));
@@ -48,8 +85,8 @@ void BazuuBoard::init_board_squares() {
   for (int rank = std::to_underlying(Rank::R1); rank <= std::to_underlying(Rank::R8); ++rank) {
     for (int file = std::to_underlying(File::A); file <= std::to_underlying(File::H); ++file) {
       square_on_120_board = this->file_rank_to_120_board(static_cast<File>(file), static_cast<Rank>(rank));
-      file_rank_to_board_mapper[std::to_underlying(square_on_120_board)] = {static_cast<File>(file),
-                                                                            static_cast<Rank>(rank)};
+      this->square_files[std::to_underlying(square_on_120_board)] = static_cast<File>(file);
+      this->square_ranks[std::to_underlying(square_on_120_board)] = static_cast<Rank>(rank);
       this->sq_64_to_sq_120[square_on_64_board] = square_on_120_board;
       this->sq_120_to_sq_64[std::to_underlying(square_on_120_board)] = square_on_64_board;
       square_on_64_board++;
@@ -106,15 +143,24 @@ void BazuuBoard::init_sliding_attacks(PieceType piece) {
 }
 
 /*
- * Clears and updates the board piece list.
+ * Clears and updates the board piece list and mailbox from the bitboards.
  */
 void BazuuBoard::update_piece_list() {
   // Let us clear the piece counts.
   std::memset(this->piece_list, std::to_underlying(BoardSquares::NO_SQ), sizeof(this->piece_list));
   std::memset(this->piece_count, 0, sizeof(this->piece_count));
+  std::memset(this->pieces_on_board, 0, sizeof(this->pieces_on_board));
+  std::memset(this->non_pawn_pieces, 0, sizeof(this->non_pawn_pieces));
+  std::memset(this->major_pieces, 0, sizeof(this->major_pieces));
+  std::memset(this->minor_pieces, 0, sizeof(this->minor_pieces));
+  std::fill(std::begin(this->mailbox), std::end(this->mailbox), Pieces::Empty);
+  this->current_attack_info().computed = 0;
   for (int color = std::to_underlying(Colours::White); color < std::to_underlying(Colours::Both); color++) {
     for (int piece = std::to_underlying(PieceType::P); piece < std::to_underlying(PieceType::Empty); piece++) {
       BitBoard bb = this->bitboards_for_pieces[color][piece];
+      if (!bb)
+        continue;
+      this->update_piece_counts(Colours(color), PieceType(piece), std::popcount(bb));
       while (bb) {
         // on the 120 square board the black side has lower index than white side.
         std::uint8_t square_on_64_board = std::countr_zero(bb);
@@ -122,11 +168,114 @@ void BazuuBoard::update_piece_list() {
         int idx = this->piece_count[color][piece]++;
         BoardSquares sq = this->to_120_board_square(square_on_64_board);
         this->piece_list[color][piece][idx] = sq;
+        this->mailbox[square_on_64_board] = to_piece(Colours(color), PieceType(piece));
+        if (PieceType(piece) == PieceType::K) {
+          this->current_king_square[color] = std::to_underlying(sq);
+        }
       }
     }
   }
 }
 
+/*
+ * Update the material counters of the board when a piece enters or leaves it.
+ * @param colour - colour of the piece.
+ * @param piece - type of the piece.
+ * @param delta - number of pieces added, negative when they are removed.
+ */
+void BazuuBoard::update_piece_counts(Colours colour, PieceType piece, int delta) {
+  std::uint8_t side = std::to_underlying(colour);
+  std::uint8_t both = std::to_underlying(Colours::Both);
+  this->pieces_on_board[std::to_underlying(to_piece(colour, piece))] += delta;
+  if (piece != PieceType::P && piece != PieceType::K) {
+    this->non_pawn_pieces[side] += delta;
+    this->non_pawn_pieces[both] += delta;
+  }
+  if (piece == PieceType::R || piece == PieceType::Q) {
+    this->major_pieces[side] += delta;
+    this->major_pieces[both] += delta;
+  } else if (piece == PieceType::N || piece == PieceType::B) {
+    this->minor_pieces[side] += delta;
+    this->minor_pieces[both] += delta;
+  }
+}
+
+/*
+ * Put a piece on an empty square, updating the bitboards, mailbox, piece list, counters and hash key.
+ * @param colour - colour of the piece.
+ * @param piece - type of the piece.
+ * @param square_on_64_board - the square to put the piece on.
+ */
+void BazuuBoard::add_piece(Colours colour, PieceType piece, std::uint8_t square_on_64_board) {
+  std::uint8_t side = std::to_underlying(colour);
+  std::uint8_t type = std::to_underlying(piece);
+  BoardSquares square = this->to_120_board_square(square_on_64_board);
+  this->bitboards_for_pieces[side][type] |= 1ULL << square_on_64_board;
+  this->bitboards_for_sides[side] |= 1ULL << square_on_64_board;
+  this->game_state.zobrist_key ^= BazuuZobrist::piece_hash(colour, piece, square_on_64_board);
+  this->mailbox[square_on_64_board] = to_piece(colour, piece);
+  this->piece_list[side][type][this->piece_count[side][type]++] = square;
+  this->update_piece_counts(colour, piece, 1);
+  if (piece == PieceType::K) {
+    this->current_king_square[side] = std::to_underlying(square);
+  }
+}
+
+/*
+ * Take a piece off its square, updating the bitboards, mailbox, piece list, counters and hash key.
+ * @param colour - colour of the piece.
+ * @param piece - type of the piece.
+ * @param square_on_64_board - the square the piece is on.
+ */
+void BazuuBoard::remove_piece(Colours colour, PieceType piece, std::uint8_t square_on_64_board) {
+  std::uint8_t side = std::to_underlying(colour);
+  std::uint8_t type = std::to_underlying(piece);
+  BoardSquares square = this->to_120_board_square(square_on_64_board);
+  this->bitboards_for_pieces[side][type] &= ~(1ULL << square_on_64_board);
+  this->bitboards_for_sides[side] &= ~(1ULL << square_on_64_board);
+  this->game_state.zobrist_key ^= BazuuZobrist::piece_hash(colour, piece, square_on_64_board);
+  this->mailbox[square_on_64_board] = Pieces::Empty;
+  std::uint8_t last = --this->piece_count[side][type];
+  for (std::uint8_t idx = 0; idx < last; idx++) {
+    if (this->piece_list[side][type][idx] == square) {
+      this->piece_list[side][type][idx] = this->piece_list[side][type][last];
+      break;
+    }
+  }
+  this->piece_list[side][type][last] = BoardSquares::NO_SQ;
+  this->update_piece_counts(colour, piece, -1);
+}
+
+/*
+ * Move a piece to an empty square, updating the bitboards, mailbox, piece list and hash key.
+ * @param colour - colour of the piece.
+ * @param piece - type of the piece.
+ * @param from_64 - the square the piece is on.
+ * @param to_64 - the square the piece moves to.
+ */
+void BazuuBoard::move_piece(Colours colour, PieceType piece, std::uint8_t from_64, std::uint8_t to_64) {
+  std::uint8_t side = std::to_underlying(colour);
+  std::uint8_t type = std::to_underlying(piece);
+  BoardSquares from = this->to_120_board_square(from_64);
+  BoardSquares to = this->to_120_board_square(to_64);
+  BitBoard from_to = (1ULL << from_64) | (1ULL << to_64);
+  this->bitboards_for_pieces[side][type] ^= from_to;
+  this->bitboards_for_sides[side] ^= from_to;
+  this->game_state.zobrist_key ^=
+      BazuuZobrist::piece_hash(colour, piece, from_64) ^ BazuuZobrist::piece_hash(colour, piece, to_64);
+  this->mailbox[to_64] = this->mailbox[from_64];
+  this->mailbox[from_64] = Pieces::Empty;
+  for (std::uint8_t idx = 0; idx < this->piece_count[side][type]; idx++) {
+    if (this->piece_list[side][type][idx] == from) {
+      this->piece_list[side][type][idx] = to;
+      break;
+    }
+  }
+  if (piece == PieceType::K) {
+    this->current_king_square[side] = std::to_underlying(to);
+  }
+}
+
 /*
  * Update the bitboards of each side i.e. White and Black;
  */
@@ -142,7 +291,7 @@ void BazuuBoard::update_sides_bitboards() {
 }
 
 /*
- * Generate hash keys using mersenne twister.
+ * Compute the zobrist key of the position from scratch.
  * @return zobrist hash key.
  */
 ZobristKey BazuuBoard::generate_hash_keys() {
@@ -153,25 +302,55 @@ ZobristKey BazuuBoard::generate_hash_keys() {
       while (bb) {
         std::uint8_t square_on_64_board = std::countr_zero(bb);
         bb &= bb - 1; // clear the rightmost set bit.
-        BoardSquares square = this->to_120_board_square(square_on_64_board);
-        key ^= zobrist->piece_hash(Colours(color), PieceType(piece), square);
+        key ^= BazuuZobrist::piece_hash(Colours(color), PieceType(piece), square_on_64_board);
       }
     }
   }
 
   // Update key with side_hash_key
-  key ^= zobrist->side_hash(this->game_state->active_side);
+  key ^= BazuuZobrist::side_hash(this->game_state.active_side);
   // Update key with enpassant_hash_key
-  if (this->game_state->en_passant_square != BoardSquares::NO_SQ) {
-    key ^= zobrist->enpassant_hash(this->game_state->en_passant_square);
+  if (this->game_state.en_passant_square != BoardSquares::NO_SQ) {
+    key ^= BazuuZobrist::enpassant_hash(this->to_64_board_square(this->game_state.en_passant_square) & 7);
   }
   // Update key with castling_hash_key
-  assert(this->game_state->castling < 16);
-  key ^= zobrist->castling_hash(this->game_state->castling);
+  assert(this->game_state.castling < 16);
+  key ^= BazuuZobrist::castling_hash(this->game_state.castling);
   return key;
 }
 
-U64 BazuuBoard::generate_magic_number() { return this->prng->sparse_rand(); }
+/*
+ * Generate the Polyglot book key of the position.
+ * @return polyglot hash key.
+ */
+ZobristKey BazuuBoard::polyglot_key() {
+  ZobristKey key = 0ULL;
+  for (int color = std::to_underlying(Colours::White); color < std::to_underlying(Colours::Both); color++) {
+    for (int piece = std::to_underlying(PieceType::P); piece < std::to_underlying(PieceType::Empty); piece++) {
+      // Polyglot orders the pieces black pawn, white pawn, black knight, ... white king.
+      std::uint16_t kind = piece * 2 + (color == std::to_underlying(Colours::White));
+      for (BitBoard bb = this->bitboards_for_pieces[color][piece]; bb; bb &= bb - 1)
+        key ^= BazuuZobrist::polyglot_hash(64 * kind + std::countr_zero(bb));
+    }
+  }
+  for (std::uint8_t right = 0; right < 4; right++)
+    if (this->game_state.castling & (1 << right))
+      key ^= BazuuZobrist::polyglot_hash(BazuuZobrist::POLYGLOT_CASTLING + right);
+  // The en passant file only counts if a pawn of the side to move stands next to the pawn that just moved.
+  if (this->game_state.en_passant_square != BoardSquares::NO_SQ) {
+    Colours us = this->game_state.active_side;
+    std::uint8_t target = this->to_64_board_square(this->game_state.en_passant_square);
+    BitBoard capturers = this->pawn_attacks[std::to_underlying(us == Colours::White ? Colours::Black : Colours::White)]
+                                           [std::to_underlying(this->game_state.en_passant_square)];
+    if (capturers & this->bitboards_for_pieces[std::to_underlying(us)][std::to_underlying(PieceType::P)])
+      key ^= BazuuZobrist::polyglot_hash(BazuuZobrist::POLYGLOT_ENPASSANT + (target & 7));
+  }
+  if (this->game_state.active_side == Colours::White)
+    key ^= BazuuZobrist::polyglot_hash(BazuuZobrist::POLYGLOT_TURN);
+  return key;
+}
+
+U64 BazuuBoard::generate_magic_number() { return this->prng.sparse_rand(); }
 
 /*
  * Generate the magic number that properly maps their attack bitboard maps of the sliding pieces.
@@ -255,156 +434,335 @@ void BazuuBoard::init_magic_numbers() {
 }
 
 /*
- * Set up chess board from FEN position provided.
- * @param fen_position FEN position of the board.
+ * Set up chess board from a FEN position, or from the first four fields of an EPD record whose operations are ignored.
+ * The halfmove clock and fullmove number are optional. Nothing is allocated and the board is only written once the
+ * whole position has been parsed and validated.
+ * @param fen_position - FEN or EPD position of the board.
+ * @param validate_position - reject positions that can not arise in a game: kings, pawns on the back ranks,
+ * castling rights and en passant square that do not match the pieces, or a side not to move in check.
+ * @return FenError::Ok, or the first error found.
  */
-void BazuuBoard::setup_fen(const std::string fen_position) {
-  std::memset(this->bitboards_for_pieces, 0, sizeof(this->bitboards_for_pieces));
+FenError BazuuBoard::setup_fen(std::string_view fen_position, bool validate_position) {
+  BitBoard pieces[std::to_underlying(Colours::Both)][std::to_underlying(PieceType::Empty)] = {};
   std::size_t pos = 0;
-  std::uint8_t rank = 7;
-  std::uint8_t file = 0;
-  char token;
-  std::uint8_t count;
-  PieceType piece = PieceType::Empty;
-  Colours active_side = Colours::Black;
-  BoardSquares square_on_120_board = BoardSquares::NO_SQ;
-  // handle position placement.
-  while (fen_position[pos] != ' ') {
-    token = fen_position[pos++];
-    count = 1;
+  int rank = 7;
+  int file = 0;
+  // handle position placement, from rank 8 down to rank 1.
+  while (pos < fen_position.size() && fen_position[pos] != ' ') {
+    const char token = fen_position[pos++];
     if (token == '/') {
+      if (file != 8 || rank == 0)
+        return FenError::BadPiecePlacement;
       rank -= 1;
       file = 0;
-      count = 0;
-      continue;
-    } else if (std::isdigit(token)) {
-      piece = PieceType::Empty;
-      count = token - '0';
+    } else if (token >= '1' && token <= '8') {
+      file += token - '0';
+      if (file > 8)
+        return FenError::BadPiecePlacement;
     } else {
-      switch (token) {
-      case 'p':
-        piece = PieceType::P;
-        active_side = Colours::Black;
-        break;
-      case 'r':
-        piece = PieceType::R;
-        active_side = Colours::Black;
-        break;
-      case 'n':
-        piece = PieceType::N;
-        active_side = Colours::Black;
-        break;
-      case 'b':
-        piece = PieceType::B;
-        active_side = Colours::Black;
-        break;
-      case 'q':
-        piece = PieceType::Q;
-        active_side = Colours::Black;
-        break;
-      case 'k':
-        piece = PieceType::K;
-        active_side = Colours::Black;
-        break;
-      case 'P':
-        piece = PieceType::P;
-        active_side = Colours::White;
-        break;
-      case 'R':
-        piece = PieceType::R;
-        active_side = Colours::White;
-        break;
-      case 'N':
-        piece = PieceType::N;
-        active_side = Colours::White;
-        break;
-      case 'B':
-        piece = PieceType::B;
-        active_side = Colours::White;
-        break;
-      case 'Q':
-        piece = PieceType::Q;
-        active_side = Colours::White;
-        break;
-      case 'K':
-        piece = PieceType::K;
-        active_side = Colours::White;
-        break;
-      default:
-        std::println("Issue encountered: {}", token);
-        // TODO: Better error handling.
-      }
+      const Pieces piece = fen_pieces[static_cast<unsigned char>(token)];
+      if (piece == Pieces::Empty || file > 7)
+        return FenError::BadPiecePlacement;
+      const int index = std::to_underlying(piece) - 1;
+      pieces[index / 6][index % 6] |= 1ULL << (rank * 8 + file++);
     }
-    while (count > 0) {
-      // If count is >0, then update the pieces according to the replacement number.
-      if (piece != PieceType::Empty) {
-        square_on_120_board = this->file_rank_to_120_board(static_cast<File>(file), static_cast<Rank>(rank));
-        this->bitboards_for_pieces[std::to_underlying(active_side)][std::to_underlying(piece)] |=
-            1ULL << this->to_64_board_square(square_on_120_board);
-      }
-      count--;
-      file += 1;
+  }
+  if (rank != 0 || file != 8)
+    return FenError::BadPiecePlacement;
+
+  auto next_field = [&fen_position, &pos]() {
+    while (pos < fen_position.size() && fen_position[pos] == ' ')
+      pos++;
+    const std::size_t field_start = pos;
+    while (pos < fen_position.size() && fen_position[pos] != ' ')
+      pos++;
+    return fen_position.substr(field_start, pos - field_start);
+  };
+  // A move counter is either absent, a number or the start of the EPD operations.
+  auto parse_counter = [](std::string_view field, std::uint16_t &counter) {
+    if (field.empty() || field.front() < '0' || field.front() > '9')
+      return true;
+    auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), counter);
+    return error == std::errc() && end == field.data() + field.size();
+  };
+
+  std::string_view field = next_field();
+  if (field != "w" && field != "b")
+    return FenError::BadSideToMove;
+  const Colours active_side = field == "w" ? Colours::White : Colours::Black;
+
+  CastlePermissions castling = 0;
+  field = next_field();
+  if (field != "-") {
+    if (field.empty())
+      return FenError::BadCastling;
+    for (const char token : field) {
+      const std::size_t right = std::string_view("KQkq").find(token);
+      if (right == std::string_view::npos || castling & (1 << right))
+        return FenError::BadCastling;
+      castling |= 1 << right;
     }
   }
 
-  this->game_state->active_side = fen_position[++pos] == 'w' ? Colours::White : Colours::Black;
-  pos += 2;
-  while (fen_position[pos] != ' ') {
-    token = fen_position[pos++];
-    switch (token) {
-    case '-':
-      this->game_state->castling |= 0;
-      break;
-    case 'K':
-      this->game_state->castling |= 1;
-      break;
-    case 'Q':
-      this->game_state->castling |= 2;
-      break;
-    case 'k':
-      this->game_state->castling |= 4;
-      break;
-    case 'q':
-      this->game_state->castling |= 8;
-      break;
-    default:
-      break;
+  int en_passant_64 = INVALID_SQUARE_ON_64;
+  field = next_field();
+  if (field != "-") {
+    if (field.size() != 2 || field[0] < 'a' || field[0] > 'h' || (field[1] != '3' && field[1] != '6'))
+      return FenError::BadEnPassant;
+    en_passant_64 = (field[1] - '1') * 8 + (field[0] - 'a');
+  }
+
+  std::uint16_t ply_since_pawn_move = 0;
+  std::uint16_t total_moves = 1;
+  field = next_field();
+  if (!parse_counter(field, ply_since_pawn_move))
+    return FenError::BadMoveCounters;
+  if (!field.empty() && field.front() >= '0' && field.front() <= '9' &&
+      !parse_counter(next_field(), total_moves))
+    return FenError::BadMoveCounters;
+
+  BazuuGameState state;
+  state.active_side = active_side;
+  state.castling = castling;
+  state.en_passant_square =
+      en_passant_64 == INVALID_SQUARE_ON_64 ? BoardSquares::NO_SQ : this->to_120_board_square(en_passant_64);
+  state.ply_since_pawn_move = ply_since_pawn_move;
+  state.total_moves = total_moves;
+  return this->set_position(pieces, state, validate_position);
+}
+
+/*
+ * Set up the board from piece bitboards and a game state, shared by setup_fen and setup_packed.
+ * @param pieces - piece bitboards indexed by colour and piece type.
+ * @param state - side to move, castling, en passant square and move counters.
+ * @param validate_position - reject positions that can not arise in a game.
+ * @return FenError::Ok, or the first error found, the board is untouched on errors.
+ */
+FenError BazuuBoard::set_position(
+    const BitBoard (&pieces)[std::to_underlying(Colours::Both)][std::to_underlying(PieceType::Empty)],
+    const BazuuGameState &state, bool validate_position) {
+  const Colours active_side = state.active_side;
+  const CastlePermissions castling = state.castling;
+  const int en_passant_64 = state.en_passant_square == BoardSquares::NO_SQ
+                                ? INVALID_SQUARE_ON_64
+                                : this->to_64_board_square(state.en_passant_square);
+
+  // Checked even without validation: the piece lists hold at most MAX_NUM_OF_PIECES_PER_TYPE pieces of a type and
+  // the king lookups need exactly one king per side.
+  for (const auto &side : pieces) {
+    for (const BitBoard bitboard : side) {
+      if (std::popcount(bitboard) > MAX_NUM_OF_PIECES_PER_TYPE)
+        return FenError::BadPieceCount;
     }
+    if (std::popcount(side[std::to_underlying(PieceType::K)]) != 1)
+      return FenError::BadKings;
   }
-  pos++;
-  while (fen_position[pos] != ' ' and pos < fen_position.length()) {
-    token = fen_position[pos++];
-    if (token == '-') {
-      this->game_state->en_passant_square = BoardSquares::NO_SQ;
-    } else if (token > 'a' and token < 'h') {
-      File file = static_cast<File>(token - 'a');
-      Rank rank = static_cast<Rank>(fen_position[pos++] - '1');
-      this->game_state->en_passant_square = this->file_rank_to_120_board(file, rank);
+  if (validate_position) {
+    const auto &white = pieces[std::to_underlying(Colours::White)];
+    const auto &black = pieces[std::to_underlying(Colours::Black)];
+    constexpr BitBoard BACK_RANKS = 0xFF000000000000FFULL;
+    // A side has at most 16 pieces and 8 pawns, and every piece beyond the initial ones is a promoted pawn.
+    constexpr int INITIAL_PIECES[] = {MAX_PAWNS_PER_SIDE, 2, 2, 2, 1};
+    for (const auto &side : pieces) {
+      int side_pieces = 0;
+      for (const BitBoard bitboard : side)
+        side_pieces += std::popcount(bitboard);
+      if (side_pieces > MAX_PIECES_PER_SIDE)
+        return FenError::BadPieceCount;
+      int promoted = 0;
+      for (const PieceType type : {PieceType::N, PieceType::B, PieceType::R, PieceType::Q}) {
+        const int count = std::popcount(side[std::to_underlying(type)]);
+        promoted += std::max(0, count - INITIAL_PIECES[std::to_underlying(type)]);
+      }
+      if (std::popcount(side[std::to_underlying(PieceType::P)]) + promoted > MAX_PAWNS_PER_SIDE)
+        return FenError::BadPieceCount;
+    }
+    if ((white[std::to_underlying(PieceType::P)] | black[std::to_underlying(PieceType::P)]) & BACK_RANKS)
+      return FenError::PawnOnBackRank;
+
+    // Each castling right needs its king and rook on their initial squares.
+    auto has_piece = [](BitBoard bitboard, int square_on_64_board) { return (bitboard >> square_on_64_board) & 1; };
+    const BitBoard white_rooks = white[std::to_underlying(PieceType::R)];
+    const BitBoard black_rooks = black[std::to_underlying(PieceType::R)];
+    const bool white_king_home = has_piece(white[std::to_underlying(PieceType::K)], 4);
+    const bool black_king_home = has_piece(black[std::to_underlying(PieceType::K)], 60);
+    if (((castling & std::to_underlying(Castling::WhiteShort)) && !(white_king_home && has_piece(white_rooks, 7))) ||
+        ((castling & std::to_underlying(Castling::WhiteLong)) && !(white_king_home && has_piece(white_rooks, 0))) ||
+        ((castling & std::to_underlying(Castling::BlackShort)) && !(black_king_home && has_piece(black_rooks, 63))) ||
+        ((castling & std::to_underlying(Castling::BlackLong)) && !(black_king_home && has_piece(black_rooks, 56))))
+      return FenError::BadCastling;
+
+    BitBoard occupancy = 0ULL;
+    for (const auto &side : pieces) {
+      for (const BitBoard bitboard : side)
+        occupancy |= bitboard;
     }
+    const Colours passive_side = active_side == Colours::White ? Colours::Black : Colours::White;
+    const auto &passive = pieces[std::to_underlying(passive_side)];
+    // The pawn that just made a double push stands in front of the en passant square, which it skipped.
+    if (en_passant_64 != INVALID_SQUARE_ON_64) {
+      const bool white_to_move = active_side == Colours::White;
+      const int pushed_pawn = white_to_move ? en_passant_64 - 8 : en_passant_64 + 8;
+      const int pawn_origin = white_to_move ? en_passant_64 + 8 : en_passant_64 - 8;
+      if ((en_passant_64 / 8 == 5) != white_to_move ||
+          !has_piece(passive[std::to_underlying(PieceType::P)], pushed_pawn) || has_piece(occupancy, en_passant_64) ||
+          has_piece(occupancy, pawn_origin))
+        return FenError::BadEnPassant;
+    }
+
+    const int passive_king = std::countr_zero(passive[std::to_underlying(PieceType::K)]);
+    if (this->is_square_attacked(this->to_120_board_square(passive_king), active_side, pieces, occupancy))
+      return FenError::OpponentInCheck;
+  }
+
+  std::memcpy(this->bitboards_for_pieces, pieces, sizeof(pieces));
+  this->game_state.reset();
+  this->history_ply = 0;
+  this->game_state.active_side = active_side;
+  this->game_state.castling = castling;
+  this->game_state.en_passant_square = state.en_passant_square;
+  this->game_state.ply_since_pawn_move = state.ply_since_pawn_move;
+  this->game_state.total_moves = state.total_moves;
+  this->update_piece_list();
+  this->update_sides_bitboards();
+  this->game_state.zobrist_key = this->generate_hash_keys();
+  return FenError::Ok;
+}
+
+/*
+ * Set up chess board from a packed position.
+ * @param packed - the position, its score and result are ignored.
+ * @param validate_position - reject positions that can not arise in a game, as setup_fen does.
+ * @return FenError::Ok, or the first error found, the board is untouched on errors.
+ */
+FenError BazuuBoard::setup_packed(const BazuuPackedPosition &packed, bool validate_position) {
+  BitBoard pieces[std::to_underlying(Colours::Both)][std::to_underlying(PieceType::Empty)] = {};
+  BitBoard occupancy = packed.occupancy();
+  if (std::popcount(occupancy) > BazuuPackedPosition::MAX_PIECES)
+    return FenError::BadPieceCount;
+  for (std::uint8_t index = 0; occupancy; index++) {
+    const int square_on_64_board = std::countr_zero(occupancy);
+    occupancy &= occupancy - 1;
+    const Pieces piece = packed.piece(index);
+    if (piece == Pieces::Empty)
+      return FenError::BadPiecePlacement;
+    const int piece_index = std::to_underlying(piece) - 1;
+    pieces[piece_index / 6][piece_index % 6] |= 1ULL << square_on_64_board;
+  }
+
+  const U64 packed_state = packed.state();
+  BazuuGameState state;
+  state.active_side = packed_state & 1 ? Colours::Black : Colours::White;
+  state.castling = packed_state >> 1 & 0xF;
+  const std::uint8_t en_passant_64 = packed_state >> 5 & 0x7F;
+  if (en_passant_64 != INVALID_SQUARE_ON_64) {
+    if (en_passant_64 > INVALID_SQUARE_ON_64 || (en_passant_64 / 8 != 2 && en_passant_64 / 8 != 5))
+      return FenError::BadEnPassant;
+    state.en_passant_square = this->to_120_board_square(en_passant_64);
   }
-  pos++;
-  std::string half_move = "";
-  while (pos < fen_position.length() and fen_position[pos] != ' ') {
-    token = fen_position[pos++];
-    half_move += token;
+  state.ply_since_pawn_move = packed_state >> 12 & BazuuPackedPosition::MAX_HALFMOVE_CLOCK;
+  state.total_moves = packed_state >> 22 & 0xFFFF;
+  return this->set_position(pieces, state, validate_position);
+}
+
+/*
+ * Pack the position straight from the piece bitboards and the game state, the score and result are cleared.
+ * @param packed - receives the position.
+ * @return false if the position has more than 32 pieces or a halfmove clock above 1023.
+ */
+bool BazuuBoard::pack(BazuuPackedPosition &packed) const {
+  const BitBoard occupancy = this->occupancy();
+  if (std::popcount(occupancy) > BazuuPackedPosition::MAX_PIECES ||
+      this->game_state.ply_since_pawn_move > BazuuPackedPosition::MAX_HALFMOVE_CLOCK)
+    return false;
+  packed = BazuuPackedPosition{};
+  packed.set_occupancy(occupancy);
+  for (int color = std::to_underlying(Colours::White); color < std::to_underlying(Colours::Both); color++) {
+    for (int piece = std::to_underlying(PieceType::P); piece < std::to_underlying(PieceType::Empty); piece++) {
+      for (BitBoard bb = this->bitboards_for_pieces[color][piece]; bb; bb &= bb - 1) {
+        // The index of a piece is the number of occupied squares below its own.
+        const BitBoard below = (1ULL << std::countr_zero(bb)) - 1;
+        packed.set_piece(std::popcount(occupancy & below), to_piece(Colours(color), PieceType(piece)));
+      }
+    }
   }
-  if (half_move.length()) {
-    this->game_state->ply_since_pawn_move = std::stoi(half_move);
+  const U64 en_passant_64 = this->game_state.en_passant_square == BoardSquares::NO_SQ
+                                ? INVALID_SQUARE_ON_64
+                                : this->to_64_board_square(this->game_state.en_passant_square);
+  packed.set_state(U64(this->game_state.active_side == Colours::Black) | U64(this->game_state.castling) << 1 |
+                   en_passant_64 << 5 | U64(this->game_state.ply_since_pawn_move) << 12 |
+                   U64(this->game_state.total_moves) << 22);
+  return true;
+}
+
+/*
+ * Write the piece placement, side to move, castling and en passant fields shared by FEN and EPD.
+ * @param buffer - receives the fields, at least 90 characters long.
+ * @return number of characters written.
+ */
+std::size_t BazuuBoard::write_epd_fields(char *buffer) const {
+  std::size_t length = 0;
+  for (int rank = 7; rank >= 0; rank--) {
+    int empty_squares = 0;
+    for (int file = 0; file < 8; file++) {
+      const Pieces piece = this->piece_on_square(rank * 8 + file);
+      if (piece == Pieces::Empty) {
+        empty_squares++;
+        continue;
+      }
+      if (empty_squares)
+        buffer[length++] = static_cast<char>('0' + empty_squares);
+      empty_squares = 0;
+      buffer[length++] = fen_piece_letters[std::to_underlying(piece)];
+    }
+    if (empty_squares)
+      buffer[length++] = static_cast<char>('0' + empty_squares);
+    if (rank)
+      buffer[length++] = '/';
   }
-  pos += 1;
-  std::string full_move = "";
-  while (pos < fen_position.length()) {
-    token = fen_position[pos++];
-    full_move += token;
+  buffer[length++] = ' ';
+  buffer[length++] = this->game_state.active_side == Colours::White ? 'w' : 'b';
+  buffer[length++] = ' ';
+  if (!this->game_state.castling)
+    buffer[length++] = '-';
+  for (int right = 0; right < 4; right++) {
+    if (this->game_state.castling & (1 << right))
+      buffer[length++] = "KQkq"[right];
   }
-  if (full_move.length()) {
-    this->game_state->total_moves = std::stoi(full_move);
+  buffer[length++] = ' ';
+  if (this->game_state.en_passant_square == BoardSquares::NO_SQ) {
+    buffer[length++] = '-';
+  } else {
+    const auto [file, rank] = this->get_file_and_rank(this->game_state.en_passant_square);
+    buffer[length++] = static_cast<char>('a' + std::to_underlying(file));
+    buffer[length++] = static_cast<char>('1' + std::to_underlying(rank));
   }
-  this->update_piece_list();
-  this->update_sides_bitboards();
-  this->game_state->zobrist_key = this->generate_hash_keys();
-  return;
+  return length;
 }
+
+/*
+ * Serialize the position as FEN, the inverse of setup_fen.
+ * @return FEN of the position.
+ */
+std::string BazuuBoard::to_fen() const {
+  char buffer[128];
+  char *end = buffer + this->write_epd_fields(buffer);
+  *end++ = ' ';
+  end = std::to_chars(end, end + 5, this->game_state.ply_since_pawn_move).ptr;
+  *end++ = ' ';
+  end = std::to_chars(end, end + 5, this->game_state.total_moves).ptr;
+  return std::string(buffer, end);
+}
+
+/*
+ * Serialize the position as an EPD record without operations.
+ * @return the four EPD position fields.
+ */
+std::string BazuuBoard::to_epd() const {
+  char buffer[128];
+  return std::string(buffer, this->write_epd_fields(buffer));
+}
+
 /*
  * Maps the (file, rank) to square on the 120 square board.
  * @param chess File
@@ -491,12 +849,14 @@ void BazuuBoard::print_bit_board(BitBoard bit_board) {
 
 void BazuuBoard::print_attacked_squares(Colours attacking_colour) {
   BoardSquares square_on_120_board = BoardSquares::A1;
+  const BitBoard attacked =
+      this->attack_info().attacked_by[std::to_underlying(attacking_colour)][std::to_underlying(PieceType::Empty)];
   std::println("\n");
   std::println("+---+---+---+---+---+---+---+---+");
   for (int rank = std::to_underlying(Rank::R8); rank >= std::to_underlying(Rank::R1); --rank) {
     for (int file = std::to_underlying(File::A); file <= std::to_underlying(File::H); ++file) {
       square_on_120_board = this->file_rank_to_120_board(static_cast<File>(file), static_cast<Rank>(rank));
-      if (this->is_square_attacked(square_on_120_board, attacking_colour)) {
+      if (attacked & (1ULL << this->to_64_board_square(square_on_120_board))) {
         std::cout << "| X ";
       } else {
         std::cout << "|   ";
@@ -551,12 +911,12 @@ void BazuuBoard::print_board() {
   }
   std::println("\x1b[0m\n");
   std::println("\x1B[0;32m Side to play\x1b[0m: \x1B[4;32m{}\x1b[0m:",
-               ActiveSideRep[std::to_underlying(this->game_state->active_side)]);
-  std::uint8_t en_passant_square_64 = this->to_64_board_square(this->game_state->en_passant_square);
+               ActiveSideRep[std::to_underlying(this->game_state.active_side)]);
+  std::uint8_t en_passant_square_64 = this->to_64_board_square(this->game_state.en_passant_square);
   const char *en_passant_square_value =
       en_passant_square_64 < 64 ? square_to_coordinates[en_passant_square_64] : "None";
   std::println("\x1B[0;32m En-Passant Target:\x1b[0m: \x1B[4;32m{}\x1b[0m:", en_passant_square_value);
-  std::println("\x1B[0;32m Hash Key of the position:\x1b[0m: \x1B[4;32m{}\x1b[0m:", this->game_state->zobrist_key);
+  std::println("\x1B[0;32m Hash Key of the position:\x1b[0m: \x1B[4;32m{}\x1b[0m:", this->game_state.zobrist_key);
 }
 
 /*
@@ -590,13 +950,88 @@ BoardSquares BazuuBoard::king_square(Colours colour) const {
   return this->to_120_board_square(square_on_64_board);
 }
 
+/*
+ * Get the side/colour to play in the current position.
+ */
+Colours BazuuBoard::side_to_move() const { return this->game_state.active_side; }
+
+/*
+ * Get the zobrist hash key of the current position.
+ */
+ZobristKey BazuuBoard::zobrist_key() const { return this->game_state.zobrist_key; }
+
+/*
+ * Get the number of plies since the last capture or pawn move, for the fifty move rule.
+ */
+std::uint16_t BazuuBoard::halfmove_clock() const { return this->game_state.ply_since_pawn_move; }
+CastlePermissions BazuuBoard::castling_rights() const { return this->game_state.castling; }
+
+/*
+ * Check if the position is a repetition, only the positions since the last capture, pawn move or null move are
+ * compared and only those with the same side to move.
+ * @param search_ply - distance from the search root, a single repetition inside the search tree is a draw.
+ * @return true if the position repeats one inside the search tree or occurred twice before.
+ */
+bool BazuuBoard::is_repetition(std::uint16_t search_ply) const {
+  const BazuuGameState &state = this->game_state;
+  std::uint16_t end = std::min({state.ply_since_pawn_move, state.plies_from_null, this->history_ply});
+  std::uint8_t count = 0;
+  for (std::uint16_t plies_ago = 4; plies_ago <= end; plies_ago += 2) {
+    if (this->history[this->history_ply - plies_ago].zobrist_key != state.zobrist_key)
+      continue;
+    if (plies_ago < search_ply || ++count == 2)
+      return true;
+  }
+  return false;
+}
+
+/*
+ * Check if neither side has the material left to mate: no pawns, rooks or queens and at most one minor piece.
+ * @return true if the position is a dead draw.
+ */
+bool BazuuBoard::has_insufficient_material() const {
+  return !this->pieces_on_board[std::to_underlying(Pieces::wP)] &&
+         !this->pieces_on_board[std::to_underlying(Pieces::bP)] &&
+         !this->major_pieces[std::to_underlying(Colours::Both)] &&
+         this->minor_pieces[std::to_underlying(Colours::Both)] <= 1;
+}
+
+/*
+ * Check if the side to move has a reversible move reaching a position repeated inside the search tree.
+ * @param search_ply - distance from the search root.
+ * @return true if a draw by repetition can be claimed with one move.
+ */
+bool BazuuBoard::has_upcoming_repetition(std::uint16_t search_ply) const {
+  const BazuuGameState &state = this->game_state;
+  std::uint16_t end = std::min({state.ply_since_pawn_move, state.plies_from_null, this->history_ply});
+  if (end < 3)
+    return false;
+  ZobristKey side_flip = BazuuZobrist::side_hash(Colours::White) ^ BazuuZobrist::side_hash(Colours::Black);
+  ZobristKey key = state.zobrist_key;
+  // The difference of the opponent's moves, zero when the opponent is back to the same squares.
+  ZobristKey other = key ^ this->history[this->history_ply - 1].zobrist_key ^ side_flip;
+  BitBoard occupied = this->occupancy();
+  for (std::uint16_t plies_ago = 3; plies_ago <= end; plies_ago += 2) {
+    other ^= this->history[this->history_ply - plies_ago + 1].zobrist_key ^
+             this->history[this->history_ply - plies_ago].zobrist_key ^ side_flip;
+    if (other != 0ULL)
+      continue;
+    const BazuuCuckoo::Entry *entry =
+        cuckoo_table.probe(key ^ this->history[this->history_ply - plies_ago].zobrist_key);
+    if (entry && !(entry->path & occupied) && plies_ago < search_ply)
+      return true;
+  }
+  return false;
+}
+
 /*
  * Get the file and rank of a give board square on a 120 square board.
  * @param square_on_120_board board square on the 120 square board.
  * @return the file and rank of board square provided.
  */
 std::pair<File, Rank> BazuuBoard::get_file_and_rank(BoardSquares square_on_120_board) const {
-  return this->file_rank_to_board_mapper[std::to_underlying(square_on_120_board)];
+  return {this->square_files[std::to_underlying(square_on_120_board)],
+          this->square_ranks[std::to_underlying(square_on_120_board)]};
 }
 
 /*
@@ -848,7 +1283,7 @@ BitBoard BazuuBoard::get_bishop_attacks(BoardSquares square_on_120_board) const
   return this->bishop_attacks[std::to_underlying(square_on_120_board)];
 }
 
-BitBoard BazuuBoard::get_bishop_attacks_lookup(BoardSquares square_on_120_board, BitBoard occupancy) {
+BitBoard BazuuBoard::get_bishop_attacks_lookup(BoardSquares square_on_120_board, BitBoard occupancy) const {
   // Get the location of the pieces that blocks the bishop on the square_on_120_board.
 
   std::uint8_t square_on_64_board = to_64_board_square(square_on_120_board);
@@ -857,18 +1292,41 @@ BitBoard BazuuBoard::get_bishop_attacks_lookup(BoardSquares square_on_120_board,
   occupancy >>= this->bishop_magic_data[square_on_64_board].shift;
   return this->bishop_attacks_realtime[square_on_64_board][occupancy];
 }
-BitBoard BazuuBoard::get_rook_attacks_lookup(BoardSquares square_on_120_board, BitBoard occupancy) {
+BitBoard BazuuBoard::get_rook_attacks_lookup(BoardSquares square_on_120_board, BitBoard occupancy) const {
   std::uint8_t square_on_64_board = to_64_board_square(square_on_120_board);
   occupancy &= this->rook_attacks[std::to_underlying(square_on_120_board)];
   occupancy *= this->rook_magic_data[square_on_64_board].magic;
   occupancy >>= this->rook_magic_data[square_on_64_board].shift;
   return this->rook_attacks_realtime[square_on_64_board][occupancy];
 }
-BitBoard BazuuBoard::get_queen_attacks_lookup(BoardSquares square_on_120_board, BitBoard occupancy) {
+BitBoard BazuuBoard::get_queen_attacks_lookup(BoardSquares square_on_120_board, BitBoard occupancy) const {
   return this->get_bishop_attacks_lookup(square_on_120_board, occupancy) |
          this->get_rook_attacks_lookup(square_on_120_board, occupancy);
 }
 
+/*
+ * Get the squares attacked by all the bishops, rooks and queens of a side. On cpus with AVX2 a setwise fill of the
+ * whole piece sets is about three times faster than a magic lookup per piece, the scalar fill is slower than the
+ * lookups (bazuu bench --attacks).
+ * @param colour - side of the sliders.
+ * @param occupancy - pieces blocking the sliders, may differ from the board to look through a piece.
+ * @return the attacked squares.
+ */
+BitBoard BazuuBoard::slider_attacks(Colours colour, BitBoard occupancy) const {
+  const auto &pieces = this->bitboards_for_pieces[std::to_underlying(colour)];
+  const BitBoard queens = pieces[std::to_underlying(PieceType::Q)];
+  const BitBoard straight = pieces[std::to_underlying(PieceType::R)] | queens;
+  const BitBoard diagonal = pieces[std::to_underlying(PieceType::B)] | queens;
+  if (HAS_AVX2)
+    return BazuuBitBoardOps::sliderAttacksAvx2(straight, diagonal, ~occupancy);
+  BitBoard attacks = 0ULL;
+  for (BitBoard bb = straight; bb; bb &= bb - 1)
+    attacks |= this->get_rook_attacks_lookup(this->to_120_board_square(std::countr_zero(bb)), occupancy);
+  for (BitBoard bb = diagonal; bb; bb &= bb - 1)
+    attacks |= this->get_bishop_attacks_lookup(this->to_120_board_square(std::countr_zero(bb)), occupancy);
+  return attacks;
+}
+
 /*
  * Get the rook attacks bit board for a given board square.
  * @param square_on_120_board board square on the 120 square board.
@@ -892,79 +1350,629 @@ BitBoard BazuuBoard::create_occupancy_board(std::uint16_t occupancy_index, std::
   return occupancy;
 }
 bool BazuuBoard::is_square_attacked(BoardSquares square_on_120_board, Colours attacking_colour) {
+  return attacking_colour == Colours::White
+             ? this->is_attacked_by<Colours::White>(square_on_120_board, this->occupancy())
+             : this->is_attacked_by<Colours::Black>(square_on_120_board, this->occupancy());
+}
+
+/*
+ * Whether a square is attacked by the pieces of a side on the board, instantiated for each side.
+ * @param square_on_120_board - attacked square.
+ * @param occupancy - all the pieces on the board.
+ * @return true when a piece of Attacker attacks the square.
+ */
+template <Colours Attacker>
+bool BazuuBoard::is_attacked_by(BoardSquares square_on_120_board, BitBoard occupancy) const {
+  BAZUU_TRACE_SCOPE(Attacks);
+  // Pawns attack from opposite color's perspective
+  constexpr Colours pawn_perspective = BazuuBitBoardOps::PawnTraits<Attacker>::THEM;
+  const auto &attackers = this->bitboards_for_pieces[std::to_underlying(Attacker)];
+  const BitBoard queens = attackers[std::to_underlying(PieceType::Q)];
+  const auto square = std::to_underlying(square_on_120_board);
+
+  if (this->pawn_attacks[std::to_underlying(pawn_perspective)][square] & attackers[std::to_underlying(PieceType::P)])
+    return true;
+  if (this->knight_attacks[square] & attackers[std::to_underlying(PieceType::N)])
+    return true;
+  if (this->get_bishop_attacks_lookup(square_on_120_board, occupancy) &
+      (attackers[std::to_underlying(PieceType::B)] | queens))
+    return true;
+  if (this->get_rook_attacks_lookup(square_on_120_board, occupancy) &
+      (attackers[std::to_underlying(PieceType::R)] | queens))
+    return true;
+  return this->king_attacks[square] & attackers[std::to_underlying(PieceType::K)];
+}
+
+/*
+ * Whether a square is attacked in a set of piece bitboards, lets setup_fen check a position before it is set up.
+ * @param square_on_120_board - attacked square.
+ * @param attacking_colour - colour of the attackers.
+ * @param pieces - piece bitboards indexed by colour and piece type.
+ * @param occupancy - all the pieces on the board.
+ * @return true when a piece of attacking_colour attacks the square.
+ */
+bool BazuuBoard::is_square_attacked(
+    BoardSquares square_on_120_board, Colours attacking_colour,
+    const BitBoard (&pieces)[std::to_underlying(Colours::Both)][std::to_underlying(PieceType::Empty)],
+    BitBoard occupancy) {
   // Pawns attack from opposite color's perspective
   Colours pawn_perspective = (attacking_colour == Colours::White) ? Colours::Black : Colours::White;
-  BitBoard occupancy = this->occupancy();
+  const auto &attackers = pieces[std::to_underlying(attacking_colour)];
 
   if (this->pawn_attacks[std::to_underlying(pawn_perspective)][std::to_underlying(square_on_120_board)] &
-      this->bitboards_for_pieces[std::to_underlying(attacking_colour)][std::to_underlying(PieceType::P)])
+      attackers[std::to_underlying(PieceType::P)])
     return true;
 
   // All other pieces are identical for both colors
-  if (knight_attacks[std::to_underlying(square_on_120_board)] &
-      this->bitboards_for_pieces[std::to_underlying(attacking_colour)][std::to_underlying(PieceType::N)])
+  if (knight_attacks[std::to_underlying(square_on_120_board)] & attackers[std::to_underlying(PieceType::N)])
     return true;
-  if (this->get_bishop_attacks_lookup(square_on_120_board, occupancy) &
-      this->bitboards_for_pieces[std::to_underlying(attacking_colour)][std::to_underlying(PieceType::B)])
+  if (this->get_bishop_attacks_lookup(square_on_120_board, occupancy) & attackers[std::to_underlying(PieceType::B)])
     return true;
-  if (this->get_rook_attacks_lookup(square_on_120_board, occupancy) &
-      this->bitboards_for_pieces[std::to_underlying(attacking_colour)][std::to_underlying(PieceType::R)])
+  if (this->get_rook_attacks_lookup(square_on_120_board, occupancy) & attackers[std::to_underlying(PieceType::R)])
     return true;
-  if (this->get_queen_attacks_lookup(square_on_120_board, occupancy) &
-      this->bitboards_for_pieces[std::to_underlying(attacking_colour)][std::to_underlying(PieceType::Q)])
+  if (this->get_queen_attacks_lookup(square_on_120_board, occupancy) & attackers[std::to_underlying(PieceType::Q)])
     return true;
-  if (king_attacks[std::to_underlying(square_on_120_board)] &
-      this->bitboards_for_pieces[std::to_underlying(attacking_colour)][std::to_underlying(PieceType::K)])
+  if (king_attacks[std::to_underlying(square_on_120_board)] & attackers[std::to_underlying(PieceType::K)])
     return true;
 
   return false;
 }
 
+/*
+ * Generate and print the pseudo-legal moves of the side to move.
+ */
 void BazuuBoard::generate_moves() {
-  if (this->game_state->active_side == Colours::White) {
-    // Get White Pawns Push Targets
-    BitBoard whitePawns = this->get_bitboard_of_piece(PieceType::P, Colours::White);
-    this->print_bit_board(BazuuBitBoardOps::WhiteSinglePushTargets(whitePawns, ~this->occupancy()));
-    this->print_bit_board(BazuuBitBoardOps::WhiteDoublePushTargets(whitePawns, ~this->occupancy()));
-    this->print_bit_board(BazuuBitBoardOps::WhitePromotionTargets(whitePawns, ~this->occupancy()));
-    // Get White Pawns Attack Targets
-    this->print_bit_board(BazuuBitBoardOps::WhitePawnAttacksTargets(whitePawns, this->side_occupancy(Colours::Black)));
-    this->print_bit_board(
-        BazuuBitBoardOps::WhitePawnAttacksWithPromotionTargets(whitePawns, this->side_occupancy(Colours::Black)));
-
-    if (this->game_state->en_passant_square != BoardSquares::NO_SQ) {
-      std::println("en_passant_square");
-      this->print_bit_board(BazuuBitBoardOps::WhitePawnPossibleAttacksTargets(whitePawns) &
-                            (1ULL << this->to_64_board_square(this->game_state->en_passant_square)));
+  BazuuMoveList list;
+  this->generate_moves(list);
+  for (std::uint16_t i = 0; i < list.count; i++) {
+    std::print("{} ", list.moves[i].to_uci());
+  }
+  std::println("\n{} pseudo-legal moves", list.count);
+}
+
+/*
+ * Generate all the pseudo-legal moves of the side to move.
+ * Moves leaving the own king in check are rejected by make_move.
+ * @param list - filled with the moves.
+ */
+void BazuuBoard::generate_moves(BazuuMoveList &list) {
+  BAZUU_TRACE_SCOPE(MoveGen);
+  list.clear();
+  if (this->game_state.active_side == Colours::White)
+    this->generate<Colours::White>(list, true);
+  else
+    this->generate<Colours::Black>(list, true);
+}
+
+/*
+ * Generate the pseudo-legal captures and queen promotions of the side to move, for quiescence search.
+ * @param list - filled with the moves.
+ */
+void BazuuBoard::generate_captures(BazuuMoveList &list) {
+  BAZUU_TRACE_SCOPE(MoveGen);
+  list.clear();
+  if (this->game_state.active_side == Colours::White)
+    this->generate<Colours::White>(list, false);
+  else
+    this->generate<Colours::Black>(list, false);
+}
+
+/*
+ * Get the piece on a given square.
+ * @param square_on_64_board - the square on the 64 square board.
+ * @return the piece on the square, Pieces::Empty if none.
+ */
+Pieces BazuuBoard::piece_on_square(std::uint8_t square_on_64_board) const {
+  return this->mailbox[square_on_64_board];
+}
+
+/*
+ * Check the mailbox and the bitboards of the sides against the bitboards of the pieces, for assertions in debug builds.
+ * @return true if they agree on every square.
+ */
+bool BazuuBoard::is_consistent() const {
+  BitBoard seen = 0ULL;
+  for (int color = std::to_underlying(Colours::White); color < std::to_underlying(Colours::Both); color++) {
+    BitBoard side = 0ULL;
+    for (int piece = std::to_underlying(PieceType::P); piece < std::to_underlying(PieceType::Empty); piece++) {
+      const BitBoard bitboard = this->bitboards_for_pieces[color][piece];
+      if (bitboard & seen)
+        return false;
+      seen |= bitboard;
+      side |= bitboard;
+      for (BitBoard bb = bitboard; bb; bb &= bb - 1)
+        if (this->mailbox[std::countr_zero(bb)] != to_piece(Colours(color), PieceType(piece)))
+          return false;
+    }
+    if (side != this->bitboards_for_sides[color])
+      return false;
+  }
+  for (BitBoard empty = ~seen; empty; empty &= empty - 1)
+    if (this->mailbox[std::countr_zero(empty)] != Pieces::Empty)
+      return false;
+  return true;
+}
+
+/*
+ * Generate the pseudo-legal moves of a side, instantiated for each colour so that its directions and ranks are
+ * constants. The side must be the side to move.
+ * @param list - the moves are appended to the list.
+ * @param include_quiets - false to only generate captures and queen promotions.
+ */
+template <Colours Us> void BazuuBoard::generate(BazuuMoveList &list, bool include_quiets) {
+  using Traits = BazuuBitBoardOps::PawnTraits<Us>;
+  constexpr Colours them = Traits::THEM;
+  constexpr std::uint8_t side = std::to_underlying(Us);
+  constexpr Pieces pawn = to_piece(Us, PieceType::P);
+  constexpr BitBoard promotion_rank = Traits::PROMOTION_RANK;
+  constexpr int push = Traits::PUSH;
+  BitBoard own = this->side_occupancy(Us);
+  BitBoard enemy = this->side_occupancy(them);
+  BitBoard empty = ~(own | enemy);
+  BitBoard pawns = this->bitboards_for_pieces[side][std::to_underlying(PieceType::P)];
+
+  auto add_pawn_move = [&](std::uint8_t from, std::uint8_t to, Pieces captured) {
+    if ((1ULL << to) & promotion_rank) {
+      list.add(BazuuMove::encode(from, to, pawn, captured, to_piece(Us, PieceType::Q)));
+      if (!include_quiets)
+        return;
+      for (PieceType promotion : {PieceType::R, PieceType::B, PieceType::N}) {
+        list.add(BazuuMove::encode(from, to, pawn, captured, to_piece(Us, promotion)));
+      }
+    } else {
+      list.add(BazuuMove::encode(from, to, pawn, captured));
+    }
+  };
+
+  // Pawn pushes, promotions are generated even without the quiet moves.
+  BitBoard single_pushes = BazuuBitBoardOps::singlePushTargets<Us>(pawns, empty);
+  if (!include_quiets)
+    single_pushes &= promotion_rank;
+  while (single_pushes) {
+    std::uint8_t to = std::countr_zero(single_pushes);
+    single_pushes &= single_pushes - 1;
+    add_pawn_move(to - push, to, Pieces::Empty);
+  }
+  if (include_quiets) {
+    BitBoard double_pushes = BazuuBitBoardOps::doublePushTargets<Us>(pawns, empty);
+    while (double_pushes) {
+      std::uint8_t to = std::countr_zero(double_pushes);
+      double_pushes &= double_pushes - 1;
+      list.add(BazuuMove::encode(to - 2 * push, to, pawn, Pieces::Empty, Pieces::Empty, MoveFlag::DoublePush));
     }
+  }
 
-  } else if (this->game_state->active_side == Colours::Black) {
-    // Get Black Pawns Push Targets
-    BitBoard blackPawns = this->get_bitboard_of_piece(PieceType::P, Colours::Black);
-    this->print_bit_board(BazuuBitBoardOps::BlackSinglePushTargets(blackPawns, ~this->occupancy()));
-    this->print_bit_board(BazuuBitBoardOps::BlackDoublePushTargets(blackPawns, ~this->occupancy()));
-    this->print_bit_board(BazuuBitBoardOps::BlackPromotionTargets(blackPawns, ~this->occupancy()));
-    // Get Black Attack Targets
-    this->print_bit_board(BazuuBitBoardOps::BlackPawnAttacksTargets(blackPawns, this->side_occupancy(Colours::White)));
-    this->print_bit_board(
-        BazuuBitBoardOps::BlackPawnAttacksWithPromotionTargets(blackPawns, this->side_occupancy(Colours::White)));
-
-    if (this->game_state->en_passant_square != BoardSquares::NO_SQ) {
-      this->print_bit_board(BazuuBitBoardOps::BlackPawnPossibleAttacksTargets(blackPawns) &
-                            (1ULL << this->to_64_board_square(this->game_state->en_passant_square)));
+  // Pawn captures and en passant.
+  BitBoard attackers = pawns;
+  while (attackers) {
+    std::uint8_t from = std::countr_zero(attackers);
+    attackers &= attackers - 1;
+    BitBoard targets = this->get_pawn_attacks(Us, this->to_120_board_square(from)) & enemy;
+    while (targets) {
+      std::uint8_t to = std::countr_zero(targets);
+      targets &= targets - 1;
+      add_pawn_move(from, to, this->piece_on_square(to));
+    }
+  }
+  if (this->game_state.en_passant_square != BoardSquares::NO_SQ) {
+    std::uint8_t to = this->to_64_board_square(this->game_state.en_passant_square);
+    BitBoard ep_attackers = this->get_pawn_attacks(them, this->game_state.en_passant_square) & pawns;
+    while (ep_attackers) {
+      std::uint8_t from = std::countr_zero(ep_attackers);
+      ep_attackers &= ep_attackers - 1;
+      list.add(BazuuMove::encode(from, to, pawn, to_piece(them, PieceType::P), Pieces::Empty, MoveFlag::EnPassant));
+    }
+  }
+
+  // Pieces.
+  BitBoard occupancy = own | enemy;
+  BitBoard allowed = include_quiets ? ~own : enemy;
+  for (PieceType piece : {PieceType::N, PieceType::B, PieceType::R, PieceType::Q, PieceType::K}) {
+    BitBoard pieces = this->bitboards_for_pieces[side][std::to_underlying(piece)];
+    Pieces moving = to_piece(Us, piece);
+    while (pieces) {
+      std::uint8_t from = std::countr_zero(pieces);
+      pieces &= pieces - 1;
+      BoardSquares from_120 = this->to_120_board_square(from);
+      BitBoard targets = 0ULL;
+      switch (piece) {
+      case PieceType::N:
+        targets = this->get_knight_attacks(from_120);
+        break;
+      case PieceType::B:
+        targets = this->get_bishop_attacks_lookup(from_120, occupancy);
+        break;
+      case PieceType::R:
+        targets = this->get_rook_attacks_lookup(from_120, occupancy);
+        break;
+      case PieceType::Q:
+        targets = this->get_queen_attacks_lookup(from_120, occupancy);
+        break;
+      default:
+        targets = this->get_king_attacks(from_120);
+        break;
+      }
+      targets &= allowed;
+      while (targets) {
+        std::uint8_t to = std::countr_zero(targets);
+        targets &= targets - 1;
+        list.add(BazuuMove::encode(from, to, moving, this->piece_on_square(to)));
+      }
+    }
+  }
+
+  // Castling, the king may not leave, cross or land on an attacked square.
+  if (!include_quiets)
+    return;
+  CastlePermissions castling = this->game_state.castling;
+  constexpr Pieces king = to_piece(Us, PieceType::K);
+  if constexpr (Us == Colours::White) {
+    castling &= std::to_underlying(Castling::WhiteShort) | std::to_underlying(Castling::WhiteLong);
+  } else {
+    castling &= std::to_underlying(Castling::BlackShort) | std::to_underlying(Castling::BlackLong);
+  }
+  if (!castling || this->checkers())
+    return;
+  const BitBoard attacked =
+      this->attack_info().attacked_by[std::to_underlying(them)][std::to_underlying(PieceType::Empty)];
+  if constexpr (Us == Colours::White) {
+    if ((castling & std::to_underlying(Castling::WhiteShort)) && !(occupancy & 0x60ULL) && !(attacked & 0x20ULL)) {
+      list.add(BazuuMove::encode(4, 6, king, Pieces::Empty, Pieces::Empty, MoveFlag::Castling));
+    }
+    if ((castling & std::to_underlying(Castling::WhiteLong)) && !(occupancy & 0x0EULL) && !(attacked & 0x08ULL)) {
+      list.add(BazuuMove::encode(4, 2, king, Pieces::Empty, Pieces::Empty, MoveFlag::Castling));
+    }
+  } else {
+    if ((castling & std::to_underlying(Castling::BlackShort)) && !(occupancy & 0x6000000000000000ULL) &&
+        !(attacked & 0x2000000000000000ULL)) {
+      list.add(BazuuMove::encode(60, 62, king, Pieces::Empty, Pieces::Empty, MoveFlag::Castling));
+    }
+    if ((castling & std::to_underlying(Castling::BlackLong)) && !(occupancy & 0x0E00000000000000ULL) &&
+        !(attacked & 0x0800000000000000ULL)) {
+      list.add(BazuuMove::encode(60, 58, king, Pieces::Empty, Pieces::Empty, MoveFlag::Castling));
     }
   }
 }
+
+/*
+ * Get the rook squares of a castling move from the king's destination square.
+ * @param king_to_64 - destination of the king on the 64 square board.
+ * @return the rook's from and to squares on the 64 square board.
+ */
+std::pair<std::uint8_t, std::uint8_t> BazuuBoard::castling_rook_squares(std::uint8_t king_to_64) {
+  switch (king_to_64) {
+  case 6:
+    return {7, 5};
+  case 2:
+    return {0, 3};
+  case 62:
+    return {63, 61};
+  default:
+    return {56, 59};
+  }
+}
+
+/*
+ * Play a move on the board, the previous state is saved in history for unmake_move.
+ * @param move - a pseudo-legal move of the side to move.
+ * @return false if the move leaves the own king in check or the undo history is full, the board is then left
+ * unchanged.
+ */
+bool BazuuBoard::make_move(BazuuMove move) {
+  BAZUU_TRACE_SCOPE(MakeMove);
+  return this->game_state.active_side == Colours::White ? this->make_move<Colours::White>(move)
+                                                        : this->make_move<Colours::Black>(move);
+}
+
+// make_move() for the side to move Us.
+template <Colours Us> bool BazuuBoard::make_move(BazuuMove move) {
+  constexpr Colours them = BazuuBitBoardOps::PawnTraits<Us>::THEM;
+  BazuuGameState &state = this->game_state;
+  std::uint8_t from = move.from_64();
+  std::uint8_t to = move.to_64();
+  PieceType piece = piece_type(move.piece());
+  // Out of check, only king moves, en passant and moves of pinned pieces can leave the own king attacked.
+  const bool may_expose_king = piece == PieceType::K || move.flag() == MoveFlag::EnPassant || this->checkers() ||
+                               ((this->pinned() >> from) & 1);
+  if (!this->push_undo())
+    return false;
+  this->current_attack_info().computed = 0;
+
+  if (state.en_passant_square != BoardSquares::NO_SQ) {
+    state.zobrist_key ^= BazuuZobrist::enpassant_hash(this->to_64_board_square(state.en_passant_square) & 7);
+    state.en_passant_square = BoardSquares::NO_SQ;
+  }
+  state.zobrist_key ^= BazuuZobrist::castling_hash(state.castling);
+  state.castling &= castling_rights_mask[from] & castling_rights_mask[to];
+  state.zobrist_key ^= BazuuZobrist::castling_hash(state.castling);
+  state.ply_since_pawn_move++;
+  state.plies_from_null++;
+
+  if (move.is_capture()) {
+    std::uint8_t captured_square =
+        move.flag() == MoveFlag::EnPassant ? to - BazuuBitBoardOps::PawnTraits<Us>::PUSH : to;
+    this->remove_piece(them, piece_type(move.captured()), captured_square);
+    state.ply_since_pawn_move = 0;
+  }
+  if (move.flag() == MoveFlag::Castling) {
+    auto [rook_from, rook_to] = castling_rook_squares(to);
+    this->move_piece(Us, PieceType::R, rook_from, rook_to);
+  }
+  this->move_piece(Us, piece, from, to);
+  if (piece == PieceType::P) {
+    state.ply_since_pawn_move = 0;
+    if (move.flag() == MoveFlag::DoublePush) {
+      state.en_passant_square = this->to_120_board_square((from + to) / 2);
+      state.zobrist_key ^= BazuuZobrist::enpassant_hash(from & 7);
+    }
+    if (move.is_promotion()) {
+      this->remove_piece(Us, PieceType::P, to);
+      this->add_piece(Us, piece_type(move.promotion()), to);
+    }
+  }
+
+  state.zobrist_key ^= BazuuZobrist::side_hash(Us) ^ BazuuZobrist::side_hash(them);
+  state.active_side = them;
+  if constexpr (Us == Colours::Black)
+    state.total_moves++;
+
+  if (may_expose_king && this->is_attacked_by<them>(this->king_square(Us), this->occupancy())) {
+    this->unmake_move(move);
+    return false;
+  }
+  assert(!this->is_attacked_by<them>(this->king_square(Us), this->occupancy()));
+  assert(this->is_consistent());
+  return true;
+}
+
+/*
+ * Take back the last move played with make_move.
+ * @param move - the move to take back.
+ */
+void BazuuBoard::unmake_move(BazuuMove move) {
+  BAZUU_TRACE_SCOPE(UnmakeMove);
+  Colours them = this->game_state.active_side;
+  Colours us = them == Colours::White ? Colours::Black : Colours::White;
+  std::uint8_t from = move.from_64();
+  std::uint8_t to = move.to_64();
+
+  if (move.is_promotion()) {
+    this->remove_piece(us, piece_type(move.promotion()), to);
+    this->add_piece(us, PieceType::P, to);
+  }
+  this->move_piece(us, piece_type(move.piece()), to, from);
+  if (move.flag() == MoveFlag::Castling) {
+    auto [rook_from, rook_to] = castling_rook_squares(to);
+    this->move_piece(us, PieceType::R, rook_to, rook_from);
+  }
+  if (move.is_capture()) {
+    std::uint8_t captured_square = move.flag() == MoveFlag::EnPassant ? (us == Colours::White ? to - 8 : to + 8) : to;
+    this->add_piece(them, piece_type(move.captured()), captured_square);
+  }
+  this->pop_undo();
+  this->game_state.active_side = us;
+  if (us == Colours::Black)
+    this->game_state.total_moves--;
+  assert(this->is_consistent());
+}
+
+/*
+ * Pass the turn to the opponent, used by null move pruning.
+ * @return false if the undo history is full, the board is then left unchanged.
+ */
+bool BazuuBoard::make_null_move() {
+  if (!this->push_undo())
+    return false;
+  this->current_attack_info().computed = 0;
+  BazuuGameState &state = this->game_state;
+  Colours us = state.active_side;
+  Colours them = us == Colours::White ? Colours::Black : Colours::White;
+  if (state.en_passant_square != BoardSquares::NO_SQ) {
+    state.zobrist_key ^= BazuuZobrist::enpassant_hash(this->to_64_board_square(state.en_passant_square) & 7);
+    state.en_passant_square = BoardSquares::NO_SQ;
+  }
+  state.zobrist_key ^= BazuuZobrist::side_hash(us) ^ BazuuZobrist::side_hash(them);
+  state.active_side = them;
+  state.ply_since_pawn_move++;
+  state.plies_from_null = 0;
+  return true;
+}
+
+void BazuuBoard::unmake_null_move() {
+  this->pop_undo();
+  this->game_state.active_side =
+      this->game_state.active_side == Colours::White ? Colours::Black : Colours::White;
+}
+
+// Save the state a move can not give back on the undo stack, false if the stack is full.
+bool BazuuBoard::push_undo() {
+  if (this->history_ply >= MAX_PLY)
+    return false;
+  const BazuuGameState &state = this->game_state;
+  this->history[this->history_ply++] = {state.zobrist_key, state.ply_since_pawn_move, state.plies_from_null,
+                                        state.castling, state.en_passant_square};
+  return true;
+}
+
+// Restore the state saved by the last push_undo().
+void BazuuBoard::pop_undo() {
+  const BazuuUndo &undo = this->history[--this->history_ply];
+  this->game_state.zobrist_key = undo.zobrist_key;
+  this->game_state.ply_since_pawn_move = undo.ply_since_pawn_move;
+  this->game_state.plies_from_null = undo.plies_from_null;
+  this->game_state.castling = undo.castling;
+  this->game_state.en_passant_square = undo.en_passant_square;
+}
+
+// Get the attack cache entry of the current ply, cleared if it still holds the info of a ply ATTACK_CACHE_SIZE away.
+BazuuAttackInfo &BazuuBoard::current_attack_info() const {
+  BazuuAttackInfo &info = this->attack_cache[this->history_ply % ATTACK_CACHE_SIZE];
+  if (info.history_ply != this->history_ply) {
+    info.history_ply = this->history_ply;
+    info.computed = 0;
+  }
+  return info;
+}
+
+/*
+ * Is the king of the side to move attacked?
+ */
+bool BazuuBoard::in_check() { return this->checkers() != 0ULL; }
+
+/*
+ * Get the pieces giving check to the king of the side to move, computed once per position.
+ * @return bitboard of the checking pieces.
+ */
+BitBoard BazuuBoard::checkers() const {
+  BazuuAttackInfo &info = this->current_attack_info();
+  if (!(info.computed & BazuuAttackInfo::KING_SAFETY))
+    this->compute_king_safety(info);
+  return info.checkers;
+}
+
+/*
+ * Get the pieces of the side to move pinned to their king, computed once per position.
+ * @return bitboard of the pinned pieces.
+ */
+BitBoard BazuuBoard::pinned() const {
+  BazuuAttackInfo &info = this->current_attack_info();
+  if (!(info.computed & BazuuAttackInfo::KING_SAFETY))
+    this->compute_king_safety(info);
+  return info.pinned;
+}
+
+/*
+ * Get the checkers, pins and attack maps of the position, computed on the first request after a move.
+ * @return the attack info, valid until the position changes.
+ */
+const BazuuAttackInfo &BazuuBoard::attack_info() const {
+  BazuuAttackInfo &info = this->current_attack_info();
+  if (!(info.computed & BazuuAttackInfo::KING_SAFETY))
+    this->compute_king_safety(info);
+  if (!(info.computed & BazuuAttackInfo::ATTACK_MAPS))
+    this->compute_attack_maps(info);
+  return info;
+}
+
+// Find the enemy pieces attacking the king of the side to move and the own pieces alone between it and an enemy slider.
+void BazuuBoard::compute_king_safety(BazuuAttackInfo &info) const {
+  BAZUU_TRACE_SCOPE(Attacks);
+  const Colours us = this->game_state.active_side;
+  const Colours them = us == Colours::White ? Colours::Black : Colours::White;
+  const auto &enemy = this->bitboards_for_pieces[std::to_underlying(them)];
+  const BoardSquares king = this->king_square(us);
+  const std::uint8_t king_64 = this->to_64_board_square(king);
+  const BitBoard occupancy = this->occupancy();
+  const BitBoard diagonal = enemy[std::to_underlying(PieceType::B)] | enemy[std::to_underlying(PieceType::Q)];
+  const BitBoard straight = enemy[std::to_underlying(PieceType::R)] | enemy[std::to_underlying(PieceType::Q)];
+
+  info.checkers = (this->get_pawn_attacks(us, king) & enemy[std::to_underlying(PieceType::P)]) |
+                  (this->get_knight_attacks(king) & enemy[std::to_underlying(PieceType::N)]) |
+                  (this->get_bishop_attacks_lookup(king, occupancy) & diagonal) |
+                  (this->get_rook_attacks_lookup(king, occupancy) & straight);
+
+  // Sliders that would attack the king through own pieces only, a single own piece between them is pinned.
+  info.pinned = 0ULL;
+  const BitBoard enemy_occupancy = this->side_occupancy(them);
+  BitBoard snipers = (this->get_bishop_attacks_lookup(king, enemy_occupancy) & diagonal) |
+                     (this->get_rook_attacks_lookup(king, enemy_occupancy) & straight);
+  while (snipers) {
+    const std::uint8_t sniper_64 = std::countr_zero(snipers);
+    snipers &= snipers - 1;
+    const BoardSquares sniper = this->to_120_board_square(sniper_64);
+    const bool on_diagonal = (king_64 & 7) != (sniper_64 & 7) && (king_64 >> 3) != (sniper_64 >> 3);
+    const BitBoard between =
+        on_diagonal ? this->get_bishop_attacks_lookup(king, 1ULL << sniper_64) &
+                          this->get_bishop_attacks_lookup(sniper, 1ULL << king_64)
+                    : this->get_rook_attacks_lookup(king, 1ULL << sniper_64) &
+                          this->get_rook_attacks_lookup(sniper, 1ULL << king_64);
+    const BitBoard blockers = between & occupancy;
+    if (std::has_single_bit(blockers))
+      info.pinned |= blockers;
+  }
+  info.computed |= BazuuAttackInfo::KING_SAFETY;
+}
+
+// Fill the squares attacked by each piece type of both sides, sliders stop at the first piece in their way.
+void BazuuBoard::compute_attack_maps(BazuuAttackInfo &info) const {
+  BAZUU_TRACE_SCOPE(Attacks);
+  const BitBoard occupancy = this->occupancy();
+  for (int colour = std::to_underlying(Colours::White); colour < std::to_underlying(Colours::Both); colour++) {
+    const auto &pieces = this->bitboards_for_pieces[colour];
+    const BitBoard pawns = pieces[std::to_underlying(PieceType::P)];
+    const BitBoard west = Colours(colour) == Colours::White ? BazuuBitBoardOps::shiftNorthWest(pawns)
+                                                            : BazuuBitBoardOps::shiftSouthWest(pawns);
+    const BitBoard east = Colours(colour) == Colours::White ? BazuuBitBoardOps::shiftNorthEast(pawns)
+                                                            : BazuuBitBoardOps::shiftSouthEast(pawns);
+    BitBoard all = west | east;
+    BitBoard twice = west & east;
+    info.attacked_by[colour][std::to_underlying(PieceType::P)] = all;
+    for (int piece = std::to_underlying(PieceType::N); piece < std::to_underlying(PieceType::Empty); piece++) {
+      BitBoard by_piece = 0ULL;
+      for (BitBoard bb = pieces[piece]; bb; bb &= bb - 1) {
+        const BoardSquares square = this->to_120_board_square(std::countr_zero(bb));
+        BitBoard attacks = 0ULL;
+        switch (PieceType(piece)) {
+        case PieceType::N:
+          attacks = this->get_knight_attacks(square);
+          break;
+        case PieceType::B:
+          attacks = this->get_bishop_attacks_lookup(square, occupancy);
+          break;
+        case PieceType::R:
+          attacks = this->get_rook_attacks_lookup(square, occupancy);
+          break;
+        case PieceType::Q:
+          attacks = this->get_queen_attacks_lookup(square, occupancy);
+          break;
+        default:
+          attacks = this->get_king_attacks(square);
+          break;
+        }
+        twice |= all & attacks;
+        all |= attacks;
+        by_piece |= attacks;
+      }
+      info.attacked_by[colour][piece] = by_piece;
+    }
+    info.attacked_by[colour][std::to_underlying(PieceType::Empty)] = all;
+    info.double_attacks[colour] = twice;
+  }
+  info.computed |= BazuuAttackInfo::ATTACK_MAPS;
+}
+
+/*
+ * Count the leaf nodes of the legal move tree to a given depth.
+ * @param depth - depth of the tree.
+ * @return number of leaf nodes.
+ */
+U64 BazuuBoard::perft(std::uint8_t depth) {
+  if (depth == 0)
+    return 1ULL;
+  BazuuMoveList list;
+  this->generate_moves(list);
+  U64 nodes = 0ULL;
+  for (std::uint16_t i = 0; i < list.count; i++) {
+    if (!this->make_move(list.moves[i]))
+      continue;
+    nodes += this->perft(depth - 1);
+    this->unmake_move(list.moves[i]);
+  }
+  return nodes;
+}
+
 /*
  * Reset the chess board.
  */
 void BazuuBoard::reset() {
   // Possibly in reverse order of setting up/initializing.
-  this->game_state->reset();
+  this->game_state.reset();
   std::memset(this->piece_list, std::to_underlying(BoardSquares::NO_SQ), sizeof(this->piece_list));
   std::memset(this->piece_count, 0, sizeof(this->piece_count));
   std::memset(this->bitboards_for_pieces, 0, sizeof(this->bitboards_for_pieces));
   std::memset(this->bitboards_for_sides, 0, sizeof(this->bitboards_for_sides));
+  std::fill(std::begin(this->mailbox), std::end(this->mailbox), Pieces::Empty);
+  this->current_attack_info().computed = 0;
   std::memset(this->sq_120_to_sq_64, this->INVALID_SQUARE_ON_64, sizeof(this->sq_120_to_sq_64));
   std::memset(this->sq_64_to_sq_120, std::to_underlying(BoardSquares::NO_SQ), sizeof(this->sq_64_to_sq_120));
 }
@@ -0,0 +1,148 @@
+#include "bazuu_ce_book.hpp"
+#include "bazuu_ce_board.hpp"
+#include "defs.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static U64 read_big_endian(const std::uint8_t *bytes, std::uint8_t count) {
+  U64 value = 0;
+  for (std::uint8_t i = 0; i < count; i++)
+    value = value << 8 | bytes[i];
+  return value;
+}
+
+/*
+ * Map a book file.
+ * @param path - path of the .bin file.
+ * @return false if the file can not be mapped or is not made of whole entries.
+ */
+bool BazuuBook::open(const std::string &path) {
+  if (!this->file.open(path))
+    return false;
+  if (this->file.size() % ENTRY_SIZE != 0) {
+    this->file.close();
+    return false;
+  }
+  return true;
+}
+
+void BazuuBook::close() { this->file.close(); }
+
+/*
+ * Get an entry of the book.
+ * @param index - index of the entry, below size().
+ */
+BazuuBookEntry BazuuBook::entry(std::size_t index) const {
+  const std::uint8_t *bytes = this->file.data() + index * ENTRY_SIZE;
+  return {read_big_endian(bytes, 8), static_cast<std::uint16_t>(read_big_endian(bytes + 8, 2)),
+          static_cast<std::uint16_t>(read_big_endian(bytes + 10, 2)),
+          static_cast<std::uint32_t>(read_big_endian(bytes + 12, 4))};
+}
+
+/*
+ * Binary search the first entry of a position.
+ * @param key - polyglot key of the position.
+ * @return index of the first entry with the key, or size() if the position is not in the book.
+ */
+std::size_t BazuuBook::find(ZobristKey key) const {
+  std::size_t low = 0;
+  std::size_t high = this->size();
+  while (low < high) {
+    std::size_t middle = low + (high - low) / 2;
+    if (read_big_endian(this->file.data() + middle * ENTRY_SIZE, 8) < key)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  if (low < this->size() && read_big_endian(this->file.data() + low * ENTRY_SIZE, 8) == key)
+    return low;
+  return this->size();
+}
+
+/*
+ * Pick a book move with a probability proportional to its weight.
+ * @param board - the position.
+ * @param random - a random number, the same number picks the same move.
+ * @return the move or a null move if the position is not in the book.
+ */
+BazuuMove BazuuBook::probe(BazuuBoard &board, U64 random) const {
+  if (!this->is_open())
+    return BazuuMove{};
+  ZobristKey key = board.polyglot_key();
+  std::size_t first = this->find(key);
+  U64 total_weight = 0;
+  std::size_t last = first;
+  for (; last < this->size() && this->entry(last).key == key; last++)
+    total_weight += this->entry(last).weight;
+  if (first == last)
+    return BazuuMove{};
+
+  // Entries of weight 0 are only played when every entry has weight 0.
+  U64 pick = total_weight ? random % total_weight : random % (last - first);
+  for (std::size_t i = first; i < last; i++) {
+    BazuuBookEntry entry = this->entry(i);
+    U64 weight = total_weight ? entry.weight : 1;
+    if (pick < weight)
+      return decode_move(board, entry.move);
+    pick -= weight;
+  }
+  return BazuuMove{};
+}
+
+/*
+ * Get the Polyglot encoding of a move.
+ */
+std::uint16_t BazuuBook::encode_move(BazuuMove move) {
+  std::uint8_t to = move.to_64();
+  if (move.flag() == MoveFlag::Castling)
+    to = to > move.from_64() ? to + 1 : to - 2;
+  std::uint16_t promotion = move.is_promotion() ? std::to_underlying(piece_type(move.promotion())) : 0;
+  return to | move.from_64() << 6 | promotion << 12;
+}
+
+/*
+ * Find the legal move of a position matching a Polyglot move.
+ * @return the move or a null move if there is no such legal move.
+ */
+BazuuMove BazuuBook::decode_move(BazuuBoard &board, std::uint16_t book_move) {
+  BazuuMoveList list;
+  board.generate_moves(list);
+  for (std::uint16_t i = 0; i < list.count; i++) {
+    BazuuMove move = list.moves[i];
+    if (encode_move(move) != book_move)
+      continue;
+    if (!board.make_move(move))
+      return BazuuMove{};
+    board.unmake_move(move);
+    return move;
+  }
+  return BazuuMove{};
+}
+
+/*
+ * Write a book file, the entries are sorted by key first.
+ * @param path - path of the .bin file.
+ * @param entries - the entries.
+ * @return false if the file can not be written.
+ */
+bool BazuuBook::write(const std::string &path, std::vector<BazuuBookEntry> entries) {
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const BazuuBookEntry &a, const BazuuBookEntry &b) { return a.key < b.key; });
+  std::ofstream out(path, std::ios::binary);
+  for (const BazuuBookEntry &entry : entries) {
+    char bytes[ENTRY_SIZE];
+    for (std::uint8_t i = 0; i < 8; i++)
+      bytes[i] = static_cast<char>(entry.key >> (56 - 8 * i));
+    bytes[8] = static_cast<char>(entry.move >> 8);
+    bytes[9] = static_cast<char>(entry.move);
+    bytes[10] = static_cast<char>(entry.weight >> 8);
+    bytes[11] = static_cast<char>(entry.weight);
+    for (std::uint8_t i = 0; i < 4; i++)
+      bytes[12 + i] = static_cast<char>(entry.learn >> (24 - 8 * i));
+    out.write(bytes, ENTRY_SIZE);
+  }
+  return static_cast<bool>(out);
+}
@@ -0,0 +1,91 @@
+#include "bazuu_ce_cuckoo.hpp"
+#include "bazuu_ce_zobrist.hpp"
+#include "defs.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+
+/*
+ * Get the squares strictly between two squares a piece moves between on an empty board.
+ * @param piece - the moving piece.
+ * @param from_64 - origin square.
+ * @param to_64 - destination square.
+ * @param path - the squares in between, empty for knights and kings.
+ * @return true if the piece can move from from_64 to to_64 on an empty board.
+ */
+static bool reversible_move(PieceType piece, int from_64, int to_64, BitBoard &path) {
+  int file_delta = (to_64 & 7) - (from_64 & 7);
+  int rank_delta = (to_64 >> 3) - (from_64 >> 3);
+  int distance = std::max(std::abs(file_delta), std::abs(rank_delta));
+  path = 0ULL;
+  switch (piece) {
+  case PieceType::N:
+    return std::abs(file_delta * rank_delta) == 2;
+  case PieceType::K:
+    return distance == 1;
+  default:
+    break;
+  }
+  bool straight = file_delta == 0 || rank_delta == 0;
+  bool diagonal = std::abs(file_delta) == std::abs(rank_delta);
+  if ((piece == PieceType::R && !straight) || (piece == PieceType::B && !diagonal) ||
+      (piece == PieceType::Q && !straight && !diagonal))
+    return false;
+  int step = (rank_delta / distance) * 8 + file_delta / distance;
+  for (int square = from_64 + step; square != to_64; square += step)
+    path |= 1ULL << square;
+  return true;
+}
+
+/*
+ * Builds the table from the zobrist keys.
+ */
+BazuuCuckoo::BazuuCuckoo() {
+  ZobristKey side_flip = BazuuZobrist::side_hash(Colours::White) ^ BazuuZobrist::side_hash(Colours::Black);
+  for (Colours colour : {Colours::White, Colours::Black}) {
+    for (PieceType piece : {PieceType::N, PieceType::B, PieceType::R, PieceType::Q, PieceType::K}) {
+      for (int from_64 = 0; from_64 < 64; from_64++) {
+        for (int to_64 = from_64 + 1; to_64 < 64; to_64++) {
+          BitBoard path;
+          if (!reversible_move(piece, from_64, to_64, path))
+            continue;
+          ZobristKey key = BazuuZobrist::piece_hash(colour, piece, from_64) ^
+                           BazuuZobrist::piece_hash(colour, piece, to_64) ^ side_flip;
+          this->insert({key, path, static_cast<std::uint8_t>(from_64), static_cast<std::uint8_t>(to_64)});
+        }
+      }
+    }
+  }
+}
+
+/*
+ * Cuckoo insertion, an occupied slot hands its entry over to that entry's other slot until an empty one is found.
+ */
+void BazuuCuckoo::insert(Entry entry) {
+  std::uint16_t slot = h1(entry.key);
+  while (true) {
+    std::swap(this->entries[slot], entry);
+    if (entry.key == 0ULL)
+      break;
+    slot = slot == h1(entry.key) ? h2(entry.key) : h1(entry.key);
+  }
+  this->entry_count++;
+}
+
+/*
+ * Find the reversible move with a given key change.
+ * @param move_key - xor of the two position keys.
+ * @return the move entry or nullptr if no single reversible move makes that change.
+ */
+const BazuuCuckoo::Entry *BazuuCuckoo::probe(ZobristKey move_key) const {
+  if (move_key == 0ULL)
+    return nullptr;
+  if (this->entries[h1(move_key)].key == move_key)
+    return &this->entries[h1(move_key)];
+  if (this->entries[h2(move_key)].key == move_key)
+    return &this->entries[h2(move_key)];
+  return nullptr;
+}
+
+std::uint16_t BazuuCuckoo::count() const { return this->entry_count; }
@@ -0,0 +1,157 @@
+#include "bazuu_ce_datagen.hpp"
+#include "bazuu_ce_board.hpp"
+#include "bazuu_ce_packed_position.hpp"
+#include "bazuu_ce_search.hpp"
+#include "defs.hpp"
+#include "prng.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Keep only the legal moves of a pseudo-legal move list.
+static void keep_legal_moves(BazuuBoard &board, BazuuMoveList &list) {
+  std::uint16_t legal = 0;
+  for (std::uint16_t i = 0; i < list.count; i++) {
+    if (board.make_move(list.moves[i])) {
+      board.unmake_move(list.moves[i]);
+      list.moves[legal++] = list.moves[i];
+    }
+  }
+  list.count = legal;
+}
+
+BazuuDatagen::BazuuDatagen(const BazuuDatagenOptions &options)
+    : options(options), eval_cache(std::make_unique<BazuuEvalCache>()) {
+  if (this->options.threads == 0)
+    this->options.threads = 1;
+}
+
+/*
+ * Play the games and write their positions.
+ * @param writer - receives the positions, flushed before returning.
+ * @return number of games played and positions written.
+ */
+BazuuDatagenSummary BazuuDatagen::run(BazuuPackedWriter &writer) {
+  this->writer = &writer;
+  this->next_game = 0;
+  this->games_played = 0;
+  this->positions_written = 0;
+  this->positions_filtered = 0;
+  this->start_time = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (std::uint16_t i = 0; i < this->options.threads; i++)
+    workers.emplace_back(&BazuuDatagen::worker, this, i);
+  for (std::thread &worker : workers)
+    worker.join();
+  writer.flush();
+  return this->progress();
+}
+
+/*
+ * Counters of the generation so far, safe to call from another thread while run() is going on.
+ */
+BazuuDatagenSummary BazuuDatagen::progress() const {
+  BazuuDatagenSummary summary;
+  summary.games = this->games_played.load(std::memory_order_relaxed);
+  summary.positions = this->positions_written.load(std::memory_order_relaxed);
+  summary.filtered_positions = this->positions_filtered.load(std::memory_order_relaxed);
+  summary.elapsed_ms =
+      std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - this->start_time.load())
+          .count();
+  return summary;
+}
+
+/*
+ * Play games until all of them have been handed out.
+ * @param thread_index - index of the thread, mixed into its random seed.
+ */
+void BazuuDatagen::worker(std::uint16_t thread_index) {
+  auto board = std::make_unique<BazuuBoard>();
+  auto search = std::make_unique<BazuuSearch>(*board);
+  search->eval_cache = this->eval_cache.get();
+  PRNG prng((this->options.seed + thread_index) * 0x9E3779B97F4A7C15ULL | 1);
+  std::vector<BazuuPackedPosition> block;
+  block.reserve(BazuuPackedWriter::BUFFER_POSITIONS);
+  std::vector<BazuuPackedPosition> game;
+  game.reserve(this->options.max_plies);
+  BazuuMoveList list;
+  BazuuPackedPosition packed;
+
+  while (this->next_game.fetch_add(1, std::memory_order_relaxed) < this->options.games) {
+    // Random opening, played again if it runs into a position without legal moves.
+    do {
+      board->setup_fen(BazuuBoard::STARTING_FEN);
+      for (std::uint8_t ply = 0; ply <= this->options.random_plies; ply++) {
+        board->generate_moves(list);
+        keep_legal_moves(*board, list);
+        if (list.count == 0 || ply == this->options.random_plies)
+          break;
+        board->make_move(list.moves[prng.rand64() % list.count]);
+      }
+    } while (list.count == 0);
+
+    game.clear();
+    GameResult result = GameResult::Draw;
+    std::uint8_t adjudication_plies = 0;
+    bool white_ahead = false;
+    for (std::uint16_t ply = 0; ply < this->options.max_plies; ply++) {
+      board->generate_moves(list);
+      keep_legal_moves(*board, list);
+      const bool in_check = board->in_check();
+      if (list.count == 0) {
+        if (in_check)
+          result = board->side_to_move() == Colours::White ? GameResult::BlackWins : GameResult::WhiteWins;
+        break;
+      }
+      if (board->halfmove_clock() >= 100 || board->is_repetition(0) || board->has_insufficient_material())
+        break;
+
+      BazuuSearchResult searched = search->search({.nodes = this->options.nodes});
+      // Positions in check or whose best move is a capture or promotion are left out as too tactical to learn from.
+      if (in_check || !searched.best_move.is_quiet() || std::abs(searched.score) >= BazuuSearch::MATE_BOUND ||
+          !board->pack(packed)) {
+        this->positions_filtered.fetch_add(1, std::memory_order_relaxed);
+      } else {
+        packed.set_score(static_cast<std::int16_t>(searched.score));
+        game.push_back(packed);
+      }
+
+      // The score has to stay large for the same side.
+      const std::int32_t white_score = board->side_to_move() == Colours::White ? searched.score : -searched.score;
+      if (std::abs(white_score) < this->options.adjudicate_score || (white_score > 0) != white_ahead)
+        adjudication_plies = 0;
+      white_ahead = white_score > 0;
+      if (std::abs(white_score) >= this->options.adjudicate_score &&
+          ++adjudication_plies >= this->options.adjudicate_plies) {
+        result = white_ahead ? GameResult::WhiteWins : GameResult::BlackWins;
+        break;
+      }
+      board->make_move(searched.best_move);
+    }
+
+    for (BazuuPackedPosition &position : game) {
+      position.set_result(result);
+      block.push_back(position);
+      if (block.size() == BazuuPackedWriter::BUFFER_POSITIONS)
+        this->write_block(block);
+    }
+    this->games_played.fetch_add(1, std::memory_order_relaxed);
+  }
+  this->write_block(block);
+}
+
+/*
+ * Hand a block of positions to the shared writer, the only time a thread takes the lock.
+ * @param block - positions of the thread, emptied.
+ */
+void BazuuDatagen::write_block(std::vector<BazuuPackedPosition> &block) {
+  std::lock_guard lock(this->writer_mutex);
+  for (const BazuuPackedPosition &position : block)
+    this->writer->write(position);
+  this->positions_written.fetch_add(block.size(), std::memory_order_relaxed);
+  block.clear();
+}
@@ -0,0 +1,93 @@
+#include "bazuu_ce_eval.hpp"
+#include "bazuu_ce_board.hpp"
+#include "defs.hpp"
+#include <bit>
+#include <cstdint>
+#include <utility>
+
+// Piece-square tables from White's point of view, rank 8 first so the tables read like a board.
+// Index with the square on the 64 square board xor 56 for White and as is for Black.
+static constexpr std::int8_t PIECE_SQUARE[std::to_underlying(PieceType::Empty)][64] = {
+    {
+        0,  0,  0,  0,   0,   0,  0,  0,  //
+        50, 50, 50, 50,  50,  50, 50, 50, //
+        10, 10, 20, 30,  30,  20, 10, 10, //
+        5,  5,  10, 25,  25,  10, 5,  5,  //
+        0,  0,  0,  20,  20,  0,  0,  0,  //
+        5,  -5, -10, 0,  0,   -10, -5, 5, //
+        5,  10, 10, -20, -20, 10, 10, 5,  //
+        0,  0,  0,  0,   0,   0,  0,  0,  //
+    },
+    {
+        -50, -40, -30, -30, -30, -30, -40, -50, //
+        -40, -20, 0,   0,   0,   0,   -20, -40, //
+        -30, 0,   10,  15,  15,  10,  0,   -30, //
+        -30, 5,   15,  20,  20,  15,  5,   -30, //
+        -30, 0,   15,  20,  20,  15,  0,   -30, //
+        -30, 5,   10,  15,  15,  10,  5,   -30, //
+        -40, -20, 0,   5,   5,   0,   -20, -40, //
+        -50, -40, -30, -30, -30, -30, -40, -50, //
+    },
+    {
+        -20, -10, -10, -10, -10, -10, -10, -20, //
+        -10, 0,   0,   0,   0,   0,   0,   -10, //
+        -10, 0,   5,   10,  10,  5,   0,   -10, //
+        -10, 5,   5,   10,  10,  5,   5,   -10, //
+        -10, 0,   10,  10,  10,  10,  0,   -10, //
+        -10, 10,  10,  10,  10,  10,  10,  -10, //
+        -10, 5,   0,   0,   0,   0,   5,   -10, //
+        -20, -10, -10, -10, -10, -10, -10, -20, //
+    },
+    {
+        0,  0,  0,  0,  0,  0,  0,  0,  //
+        5,  10, 10, 10, 10, 10, 10, 5,  //
+        -5, 0,  0,  0,  0,  0,  0,  -5, //
+        -5, 0,  0,  0,  0,  0,  0,  -5, //
+        -5, 0,  0,  0,  0,  0,  0,  -5, //
+        -5, 0,  0,  0,  0,  0,  0,  -5, //
+        -5, 0,  0,  0,  0,  0,  0,  -5, //
+        0,  0,  0,  5,  5,  0,  0,  0,  //
+    },
+    {
+        -20, -10, -10, -5, -5, -10, -10, -20, //
+        -10, 0,   0,   0,  0,  0,   0,   -10, //
+        -10, 0,   5,   5,  5,  5,   0,   -10, //
+        -5,  0,   5,   5,  5,  5,   0,   -5,  //
+        0,   0,   5,   5,  5,  5,   0,   -5,  //
+        -10, 5,   5,   5,  5,  5,   0,   -10, //
+        -10, 0,   5,   0,  0,  0,   0,   -10, //
+        -20, -10, -10, -5, -5, -10, -10, -20, //
+    },
+    {
+        -30, -40, -40, -50, -50, -40, -40, -30, //
+        -30, -40, -40, -50, -50, -40, -40, -30, //
+        -30, -40, -40, -50, -50, -40, -40, -30, //
+        -30, -40, -40, -50, -50, -40, -40, -30, //
+        -20, -30, -30, -40, -40, -30, -30, -20, //
+        -10, -20, -20, -20, -20, -20, -20, -10, //
+        20,  20,  0,   0,   0,   0,   20,  20,  //
+        20,  30,  10,  0,   0,   10,  30,  20,  //
+    },
+};
+
+/*
+ * Evaluate the position with material and piece-square tables.
+ * @param board - the board with the position.
+ * @return score in centipawns from the side to move's point of view.
+ */
+std::int32_t BazuuEval::evaluate(BazuuBoard &board) {
+  std::int32_t score = 0;
+  for (Colours colour : {Colours::White, Colours::Black}) {
+    std::int32_t sign = colour == Colours::White ? 1 : -1;
+    std::uint8_t flip = colour == Colours::White ? 56 : 0;
+    for (int piece = std::to_underlying(PieceType::P); piece < std::to_underlying(PieceType::Empty); piece++) {
+      BitBoard bb = board.get_bitboard_of_piece(PieceType(piece), colour);
+      while (bb) {
+        std::uint8_t square_on_64_board = std::countr_zero(bb);
+        bb &= bb - 1; // clear the rightmost set bit.
+        score += sign * (PIECE_VALUE[piece] + PIECE_SQUARE[piece][square_on_64_board ^ flip]);
+      }
+    }
+  }
+  return board.side_to_move() == Colours::White ? score : -score;
+}
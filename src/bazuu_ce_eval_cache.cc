@@ -0,0 +1,57 @@
+#include "bazuu_ce_eval_cache.hpp"
+#include "bazuu_ce_trace.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+// An entry of 0 is empty, a zero verification with a zero score is simply never a hit.
+static constexpr std::uint64_t pack(ZobristKey key, std::int16_t score) {
+  return (key & 0xFFFFFFFF00000000ULL) | static_cast<std::uint16_t>(score);
+}
+
+BazuuEvalCache::BazuuEvalCache(std::size_t size_mb) { this->resize(size_mb); }
+
+/*
+ * Resize the cache, the number of entries is rounded down to a power of two.
+ * @param size_mb - size of the cache in megabytes.
+ */
+void BazuuEvalCache::resize(std::size_t size_mb) {
+  std::size_t count = std::bit_floor(std::max<std::size_t>(size_mb * 1024 * 1024 / sizeof(std::uint64_t), 1));
+  this->entries = std::make_unique<std::atomic<std::uint64_t>[]>(count);
+  this->mask = count - 1;
+  this->clear();
+}
+
+/*
+ * Empty the cache.
+ */
+void BazuuEvalCache::clear() {
+  for (std::size_t i = 0; i <= this->mask; i++) {
+    this->entries[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+/*
+ * Look up the static evaluation of a position.
+ * @param key - zobrist key of the position.
+ * @param score - set to the cached score on a hit.
+ * @return true if the position was in the cache.
+ */
+bool BazuuEvalCache::probe(ZobristKey key, std::int16_t &score) const {
+  BAZUU_TRACE_SCOPE(EvalCacheProbe);
+  std::uint64_t entry = this->entries[key & this->mask].load(std::memory_order_relaxed);
+  if (entry == 0 || (entry & 0xFFFFFFFF00000000ULL) != (key & 0xFFFFFFFF00000000ULL))
+    return false;
+  score = static_cast<std::int16_t>(entry & 0xFFFF);
+  return true;
+}
+
+/*
+ * Store the static evaluation of a position, replacing whatever was in its slot.
+ * @param key - zobrist key of the position.
+ * @param score - static evaluation, clamped to 16 bits.
+ */
+void BazuuEvalCache::store(ZobristKey key, std::int32_t score) {
+  std::int16_t clamped = static_cast<std::int16_t>(std::clamp<std::int32_t>(score, INT16_MIN, INT16_MAX));
+  this->entries[key & this->mask].store(pack(key, clamped), std::memory_order_relaxed);
+}
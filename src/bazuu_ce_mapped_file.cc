@@ -0,0 +1,57 @@
+#include "bazuu_ce_mapped_file.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+BazuuMappedFile::~BazuuMappedFile() { this->close(); }
+
+BazuuMappedFile::BazuuMappedFile(BazuuMappedFile &&other) noexcept
+    : mapping(std::exchange(other.mapping, nullptr)), length(std::exchange(other.length, 0)) {}
+
+BazuuMappedFile &BazuuMappedFile::operator=(BazuuMappedFile &&other) noexcept {
+  if (this != &other) {
+    this->close();
+    this->mapping = std::exchange(other.mapping, nullptr);
+    this->length = std::exchange(other.length, 0);
+  }
+  return *this;
+}
+
+/*
+ * Map a file into memory, a mapping already held is released first.
+ * @param path - path of the file.
+ * @param sequential - the file is read front to back, otherwise pages are read on demand only.
+ * @return false if the file can not be opened, is empty or can not be mapped.
+ */
+bool BazuuMappedFile::open(const std::string &path, bool sequential) {
+  this->close();
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  struct stat status;
+  if (::fstat(fd, &status) != 0 || status.st_size <= 0) {
+    ::close(fd);
+    return false;
+  }
+  void *mapping = ::mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping keeps its own reference to the file.
+  ::close(fd);
+  if (mapping == MAP_FAILED)
+    return false;
+  ::madvise(mapping, status.st_size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+  this->mapping = static_cast<const std::uint8_t *>(mapping);
+  this->length = status.st_size;
+  return true;
+}
+
+/*
+ * Release the mapping.
+ */
+void BazuuMappedFile::close() {
+  if (this->mapping)
+    ::munmap(const_cast<std::uint8_t *>(this->mapping), this->length);
+  this->mapping = nullptr;
+  this->length = 0;
+}
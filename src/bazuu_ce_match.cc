@@ -0,0 +1,467 @@
+#include "bazuu_ce_match.hpp"
+#include "bazuu_ce_board.hpp"
+#include "bazuu_ce_move.hpp"
+#include "bazuu_ce_uci.hpp"
+#include "defs.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <fcntl.h>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <poll.h>
+#include <spawn.h>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Time an engine may overrun its clock by before losing, for the latency of the pipes.
+static constexpr std::int64_t TIME_MARGIN_MS = 100;
+static constexpr U64 HANDSHAKE_TIMEOUT_MS = 10000;
+
+BazuuEngineProcess::~BazuuEngineProcess() { this->stop(); }
+
+/*
+ * Launch an engine, stopping the one running before. The pipes are close-on-exec so that engines started by other
+ * threads at the same time do not inherit them.
+ * @param path - the engine binary, searched in PATH when it has no slash.
+ * @return false if the process could not be started.
+ */
+bool BazuuEngineProcess::start(const std::string &path) {
+  this->stop();
+  int input[2];
+  int output[2];
+  if (pipe2(input, O_CLOEXEC) != 0)
+    return false;
+  if (pipe2(output, O_CLOEXEC) != 0) {
+    close(input[0]);
+    close(input[1]);
+    return false;
+  }
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, input[0], STDIN_FILENO);
+  posix_spawn_file_actions_adddup2(&actions, output[1], STDOUT_FILENO);
+  char *argv[] = {const_cast<char *>(path.c_str()), nullptr};
+  const int error = posix_spawnp(&this->pid, path.c_str(), &actions, nullptr, argv, environ);
+  posix_spawn_file_actions_destroy(&actions);
+  close(input[0]);
+  close(output[1]);
+  if (error != 0) {
+    close(input[1]);
+    close(output[0]);
+    this->pid = -1;
+    return false;
+  }
+  this->to_engine = input[1];
+  this->from_engine = output[0];
+  return true;
+}
+
+/*
+ * Ask the engine to quit and wait for it, killing it if it does not exit within a second.
+ */
+void BazuuEngineProcess::stop() {
+  if (this->pid > 0) {
+    this->send("quit");
+    close(this->to_engine);
+    bool exited = false;
+    for (std::uint8_t i = 0; i < 100 && !exited; i++) {
+      exited = waitpid(this->pid, nullptr, WNOHANG) == this->pid;
+      if (!exited)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (!exited) {
+      kill(this->pid, SIGKILL);
+      waitpid(this->pid, nullptr, 0);
+    }
+  }
+  if (this->from_engine >= 0)
+    close(this->from_engine);
+  this->pid = -1;
+  this->to_engine = -1;
+  this->from_engine = -1;
+  this->buffer.clear();
+}
+
+/*
+ * Write a command to the engine.
+ * @param line - the command, without the newline.
+ * @return false if the engine is gone.
+ */
+bool BazuuEngineProcess::send(std::string_view line) {
+  if (this->to_engine < 0)
+    return false;
+  std::string data(line);
+  data += '\n';
+  for (std::size_t written = 0; written < data.size();) {
+    const ssize_t count = write(this->to_engine, data.data() + written, data.size() - written);
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count <= 0)
+      return false;
+    written += count;
+  }
+  return true;
+}
+
+/*
+ * Read the next line the engine writes.
+ * @param line - receives the line, without the newline.
+ * @param timeout_ms - time to wait for it.
+ * @return false on timeout or if the engine closed its output.
+ */
+bool BazuuEngineProcess::read_line(std::string &line, U64 timeout_ms) {
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  while (true) {
+    const std::size_t end = this->buffer.find('\n');
+    if (end != std::string::npos) {
+      line.assign(this->buffer, 0, end);
+      if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+      this->buffer.erase(0, end + 1);
+      return true;
+    }
+    if (this->from_engine < 0)
+      return false;
+    const auto remaining =
+        std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+    if (remaining <= 0)
+      return false;
+    pollfd descriptor{this->from_engine, POLLIN, 0};
+    const int ready = poll(&descriptor, 1, static_cast<int>(std::min<std::int64_t>(remaining, 1 << 30)));
+    if (ready < 0 && errno == EINTR)
+      continue;
+    if (ready <= 0)
+      return false;
+    char chunk[4096];
+    const ssize_t count = read(this->from_engine, chunk, sizeof(chunk));
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count <= 0)
+      return false;
+    this->buffer.append(chunk, count);
+  }
+}
+
+/*
+ * Skip the engine's output up to a line starting with a prefix.
+ * @param prefix - start of the awaited line, e.g. "bestmove".
+ * @param line - receives the line.
+ * @param timeout_ms - time to wait for it.
+ * @return false on timeout or if the engine closed its output.
+ */
+bool BazuuEngineProcess::wait_for(std::string_view prefix, std::string &line, U64 timeout_ms) {
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  while (true) {
+    const auto remaining =
+        std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+    if (remaining <= 0 || !this->read_line(line, remaining))
+      return false;
+    if (line.starts_with(prefix))
+      return true;
+  }
+}
+
+/*
+ * Fraction of the points won, a draw counting half.
+ */
+double BazuuMatchScore::score() const {
+  const U64 games = this->games();
+  return games ? (this->wins + 0.5 * this->draws) / games : 0.5;
+}
+
+/*
+ * Variance of the result of a single game.
+ */
+double BazuuMatchScore::variance() const {
+  const U64 games = this->games();
+  if (!games)
+    return 0;
+  const double score = this->score();
+  return (this->wins * (1 - score) * (1 - score) + this->draws * (0.5 - score) * (0.5 - score) +
+          this->losses * score * score) /
+         games;
+}
+
+double BazuuMatchScore::elo() const { return elo_of_score(this->score()); }
+
+/*
+ * Half the width of the 95% confidence interval of the Elo difference.
+ */
+double BazuuMatchScore::elo_error() const {
+  const U64 games = this->games();
+  if (!games)
+    return 0;
+  const double deviation = 1.959964 * std::sqrt(this->variance() / games);
+  return (elo_of_score(this->score() + deviation) - elo_of_score(this->score() - deviation)) / 2;
+}
+
+/*
+ * Likelihood of superiority, the probability that the first engine is the stronger one. Draws carry no information.
+ */
+double BazuuMatchScore::los() const {
+  if (!this->wins && !this->losses)
+    return 0.5;
+  return 0.5 * (1 + std::erf((static_cast<double>(this->wins) - static_cast<double>(this->losses)) /
+                             std::sqrt(2.0 * (this->wins + this->losses))));
+}
+
+/*
+ * Log-likelihood ratio of the generalized sequential probability ratio test of elo1 against elo0, with the game
+ * results approximated by a normal distribution.
+ * @param elo0 - Elo difference of the null hypothesis.
+ * @param elo1 - Elo difference of the alternative hypothesis.
+ * @return the ratio, positive when the results favour elo1.
+ */
+double BazuuMatchScore::llr(double elo0, double elo1) const {
+  const double variance = this->variance();
+  if (variance <= 0)
+    return 0;
+  const double score0 = expected_score(elo0);
+  const double score1 = expected_score(elo1);
+  return this->games() * (score1 - score0) * (2 * this->score() - score0 - score1) / (2 * variance);
+}
+
+double BazuuMatchScore::expected_score(double elo) { return 1 / (1 + std::pow(10.0, -elo / 400)); }
+
+/*
+ * Elo difference giving an expected score, scores of 0 and 1 are clamped to keep it finite.
+ */
+double BazuuMatchScore::elo_of_score(double score) {
+  score = std::clamp(score, 1e-6, 1 - 1e-6);
+  return 400 * std::log10(score / (1 - score));
+}
+
+BazuuMatch::BazuuMatch(const BazuuMatchOptions &options) : options(options) {
+  if (this->options.concurrency == 0)
+    this->options.concurrency = 1;
+}
+
+// Bound of the log-likelihood ratio below which the null hypothesis is accepted.
+double BazuuMatch::lower_bound() const { return std::log(this->options.beta / (1 - this->options.alpha)); }
+
+// Bound of the log-likelihood ratio above which the alternative hypothesis is accepted.
+double BazuuMatch::upper_bound() const { return std::log((1 - this->options.beta) / this->options.alpha); }
+
+SprtVerdict BazuuMatch::sprt_verdict(const BazuuMatchScore &score) const {
+  const double llr = score.llr(this->options.elo0, this->options.elo1);
+  if (llr >= this->upper_bound())
+    return SprtVerdict::AcceptH1;
+  if (llr <= this->lower_bound())
+    return SprtVerdict::AcceptH0;
+  return SprtVerdict::Continue;
+}
+
+/*
+ * Play the match. SIGPIPE is ignored from here on so that an engine crashing does not take the match down.
+ * @param log - receives the result of every game and the running statistics.
+ * @return the score of the first engine and the verdict of the test.
+ */
+BazuuMatchSummary BazuuMatch::run(std::ostream &log) {
+  std::signal(SIGPIPE, SIG_IGN);
+  this->log = &log;
+  this->summary = BazuuMatchSummary{};
+  this->next_game = 0;
+  this->finished = false;
+
+  // Openings are kept as plain FEN, EPD operations would confuse the engines.
+  this->openings.clear();
+  auto board = std::make_unique<BazuuBoard>();
+  if (this->options.openings.empty()) {
+    this->openings.emplace_back(BazuuBoard::STARTING_FEN);
+  } else {
+    std::ifstream input(this->options.openings);
+    std::string line;
+    while (std::getline(input, line))
+      if (board->setup_fen(line) == FenError::Ok)
+        this->openings.push_back(board->to_fen());
+    if (this->openings.empty()) {
+      log << std::format("no valid opening in {}", this->options.openings) << std::endl;
+      this->summary.failed = true;
+      return this->summary;
+    }
+  }
+
+  std::vector<std::thread> workers;
+  for (std::uint16_t i = 0; i < this->options.concurrency; i++)
+    workers.emplace_back(&BazuuMatch::worker, this);
+  for (std::thread &worker : workers)
+    worker.join();
+  return this->summary;
+}
+
+/*
+ * Play games until all of them have been handed out or the test is decided. Engines that crashed or overran their time
+ * are started again before the next game.
+ */
+void BazuuMatch::worker() {
+  auto board = std::make_unique<BazuuBoard>();
+  BazuuEngineProcess engines[2];
+  std::string line;
+  std::string reason;
+  while (!this->finished) {
+    const U64 game = this->next_game.fetch_add(1, std::memory_order_relaxed);
+    if (game >= this->options.games)
+      return;
+    for (std::uint8_t i = 0; i < 2; i++) {
+      if (engines[i].is_running())
+        continue;
+      if (!engines[i].start(this->options.engines[i]) || !engines[i].send("uci") ||
+          !engines[i].wait_for("uciok", line, HANDSHAKE_TIMEOUT_MS)) {
+        std::lock_guard lock(this->mutex);
+        *this->log << std::format("can not start engine {}", this->options.engines[i]) << std::endl;
+        this->summary.failed = true;
+        this->finished = true;
+        return;
+      }
+    }
+
+    const std::uint8_t white = game % 2;
+    const std::string &opening = this->openings[game / 2 % this->openings.size()];
+    const GameResult result = this->play_game(engines, *board, opening, white, reason);
+
+    std::lock_guard lock(this->mutex);
+    BazuuMatchScore &score = this->summary.score;
+    if (result == GameResult::Draw)
+      score.draws++;
+    else if ((result == GameResult::WhiteWins) == (white == 0))
+      score.wins++;
+    else
+      score.losses++;
+    *this->log << std::format("Game {} ({} vs {}): {} {{{}}}", game + 1, this->options.engines[white],
+                              this->options.engines[1 - white],
+                              result == GameResult::Draw        ? "1/2-1/2"
+                              : result == GameResult::WhiteWins ? "1-0"
+                                                                : "0-1",
+                              reason)
+               << '\n';
+    *this->log << std::format("Score {}-{}-{} (W-D-L) Elo {:.1f} +/- {:.1f} LOS {:.1f}%", score.wins, score.draws,
+                              score.losses, score.elo(), score.elo_error(), score.los() * 100);
+    if (this->options.sprt) {
+      this->summary.verdict = this->sprt_verdict(score);
+      *this->log << std::format(" LLR {:.2f} ({:.2f}, {:.2f}) {}", score.llr(this->options.elo0, this->options.elo1),
+                                this->lower_bound(), this->upper_bound(),
+                                this->summary.verdict == SprtVerdict::AcceptH1   ? "H1 accepted"
+                                : this->summary.verdict == SprtVerdict::AcceptH0 ? "H0 accepted"
+                                                                                 : "continue");
+      if (this->summary.verdict != SprtVerdict::Continue)
+        this->finished = true;
+    }
+    *this->log << std::endl;
+  }
+}
+
+/*
+ * Play one game from an opening.
+ * @param engines - the processes of the two engines, one that fails is stopped.
+ * @param board - board of the worker, checks every move.
+ * @param opening - FEN of the starting position.
+ * @param white - index of the engine playing white.
+ * @param reason - receives why the game ended.
+ * @return the result of the game.
+ */
+GameResult BazuuMatch::play_game(BazuuEngineProcess (&engines)[2], BazuuBoard &board, std::string_view opening,
+                                 std::uint8_t white, std::string &reason) {
+  std::string line;
+  board.setup_fen(opening);
+  for (std::uint8_t i = 0; i < 2; i++) {
+    if (!engines[i].send("ucinewgame") || !engines[i].send("isready") ||
+        !engines[i].wait_for("readyok", line, HANDSHAKE_TIMEOUT_MS)) {
+      engines[i].stop();
+      reason = "engine not ready";
+      return (i == white) ? GameResult::BlackWins : GameResult::WhiteWins;
+    }
+  }
+
+  const bool clocked = this->options.base_ms > 0;
+  std::int64_t clock[2] = {static_cast<std::int64_t>(this->options.base_ms),
+                           static_cast<std::int64_t>(this->options.base_ms)};
+  std::string position = std::format("position fen {} moves", opening);
+  BazuuMoveList list;
+  for (std::uint16_t ply = 0;; ply++) {
+    const Colours side = board.side_to_move();
+    const GameResult loss = side == Colours::White ? GameResult::BlackWins : GameResult::WhiteWins;
+    board.generate_moves(list);
+    bool has_legal_move = false;
+    for (std::uint16_t i = 0; i < list.count && !has_legal_move; i++) {
+      has_legal_move = board.make_move(list.moves[i]);
+      if (has_legal_move)
+        board.unmake_move(list.moves[i]);
+    }
+    if (!has_legal_move) {
+      reason = board.in_check() ? "checkmate" : "stalemate";
+      return board.in_check() ? loss : GameResult::Draw;
+    }
+    if (board.halfmove_clock() >= 100)
+      reason = "fifty move rule";
+    else if (board.is_repetition(0))
+      reason = "threefold repetition";
+    else if (board.has_insufficient_material())
+      reason = "insufficient material";
+    else if (ply >= this->options.max_plies)
+      reason = "maximum game length";
+    else
+      reason.clear();
+    if (!reason.empty())
+      return GameResult::Draw;
+
+    BazuuEngineProcess &engine = engines[(side == Colours::White) == (white == 0) ? 0 : 1];
+    const std::int64_t remaining = clock[std::to_underlying(side)];
+    const U64 timeout = clocked ? remaining + TIME_MARGIN_MS : this->options.timeout_ms;
+    const auto start = std::chrono::steady_clock::now();
+    if (!engine.send(position) || !engine.send(this->go_command(clock)) ||
+        !engine.wait_for("bestmove", line, timeout)) {
+      const bool timed_out = std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(timeout);
+      engine.stop();
+      reason = timed_out ? "time forfeit" : "engine stopped responding";
+      return loss;
+    }
+    if (clocked) {
+      clock[std::to_underlying(side)] -= std::chrono::duration_cast<std::chrono::milliseconds>(
+                                             std::chrono::steady_clock::now() - start)
+                                             .count();
+      if (clock[std::to_underlying(side)] < -TIME_MARGIN_MS) {
+        reason = "time forfeit";
+        return loss;
+      }
+      clock[std::to_underlying(side)] += this->options.increment_ms;
+    }
+
+    std::string_view reply = std::string_view(line).substr(8);
+    reply.remove_prefix(std::min(reply.find_first_not_of(' '), reply.size()));
+    const std::string_view uci_move = reply.substr(0, reply.find(' '));
+    const BazuuMove move = BazuuUci::parse_move(board, uci_move);
+    if (move.is_null()) {
+      reason = std::format("illegal move {}", uci_move);
+      return loss;
+    }
+    board.make_move(move);
+    position += ' ';
+    position += uci_move;
+  }
+}
+
+/*
+ * The go command of a move, the clocks of both sides or the fixed limits.
+ * @param clock - remaining time of white and black.
+ */
+std::string BazuuMatch::go_command(const std::int64_t (&clock)[2]) const {
+  if (this->options.base_ms)
+    return std::format("go wtime {} btime {} winc {} binc {}", std::max<std::int64_t>(clock[0], 1),
+                       std::max<std::int64_t>(clock[1], 1), this->options.increment_ms, this->options.increment_ms);
+  std::string command = "go";
+  if (this->options.depth)
+    command += std::format(" depth {}", this->options.depth);
+  if (this->options.nodes)
+    command += std::format(" nodes {}", this->options.nodes);
+  if (this->options.movetime_ms)
+    command += std::format(" movetime {}", this->options.movetime_ms);
+  return command;
+}
@@ -0,0 +1,199 @@
+#include "bazuu_ce_move_ordering.hpp"
+#include "bazuu_ce_move.hpp"
+#include "defs.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+// Victim values for MVV-LVA, indexed by PieceType.
+static constexpr std::int32_t MVV_LVA_VALUE[std::to_underlying(PieceType::Empty) + 1] = {1, 3, 3, 5, 9, 20, 0};
+
+BazuuMoveOrdering::BazuuMoveOrdering() { this->clear(); }
+
+/*
+ * Clear every heuristic table, done before a new game.
+ */
+void BazuuMoveOrdering::clear() {
+  std::memset(this->killers, 0, sizeof(this->killers));
+  std::memset(this->butterfly, 0, sizeof(this->butterfly));
+  std::memset(this->counter_moves, 0, sizeof(this->counter_moves));
+  std::memset(this->continuation, 0, sizeof(this->continuation));
+}
+
+/*
+ * History bonus for a cutoff at the given depth, deeper cutoffs weigh more.
+ * @param depth - remaining depth of the node.
+ * @return the bonus, the tried quiet moves get it as a malus.
+ */
+std::int32_t BazuuMoveOrdering::history_bonus(std::uint8_t depth) {
+  return std::min<std::int32_t>(16 * depth * depth + 32 * depth + 16, 1536);
+}
+
+/*
+ * Gravity update: entry += bonus - entry * |bonus| / HISTORY_MAX.
+ * The closer an entry is to the bound the smaller the step, so it never leaves [-HISTORY_MAX, HISTORY_MAX].
+ * @param entry - the history entry to update.
+ * @param bonus - signed bonus.
+ */
+void BazuuMoveOrdering::apply_gravity(std::int16_t &entry, std::int32_t bonus) {
+  bonus = std::clamp(bonus, -HISTORY_MAX, HISTORY_MAX);
+  entry += static_cast<std::int16_t>(bonus - entry * std::abs(bonus) / HISTORY_MAX);
+}
+
+/*
+ * Store a quiet move that caused a beta cutoff as killer of its ply.
+ * @param ply - the ply of the node.
+ * @param move - the quiet move.
+ */
+void BazuuMoveOrdering::update_killers(std::uint16_t ply, BazuuMove move) {
+  if (this->killers[ply][0] == move)
+    return;
+  this->killers[ply][1] = this->killers[ply][0];
+  this->killers[ply][0] = move;
+}
+
+BazuuMove BazuuMoveOrdering::killer(std::uint16_t ply, std::uint8_t slot) const { return this->killers[ply][slot]; }
+
+/*
+ * Get the move that last refuted the previous move.
+ * @param previous - move played to reach the node.
+ */
+BazuuMove BazuuMoveOrdering::counter_move(BazuuMove previous) const {
+  if (previous.is_null())
+    return BazuuMove{};
+  return this->counter_moves[piece_index(previous.piece())][previous.to_64()];
+}
+
+std::int16_t BazuuMoveOrdering::butterfly_history(Colours side, BazuuMove move) const {
+  return this->butterfly[std::to_underlying(side)][move.from_64()][move.to_64()];
+}
+
+/*
+ * Get the continuation history of a move following another one.
+ * @param plies_ago - 1 if previous was the last move, 2 if it was the one before.
+ * @param previous - the earlier move.
+ * @param move - the move being scored.
+ */
+std::int16_t BazuuMoveOrdering::continuation_history(std::uint8_t plies_ago, BazuuMove previous,
+                                                     BazuuMove move) const {
+  if (previous.is_null())
+    return 0;
+  return this->continuation[plies_ago - 1][piece_index(previous.piece())][previous.to_64()]
+                           [piece_index(move.piece())][move.to_64()];
+}
+
+/*
+ * Reward the quiet move that caused a beta cutoff and punish the quiet moves tried before it.
+ * @param side - side to move at the node.
+ * @param ply - the ply of the node.
+ * @param depth - remaining depth of the node.
+ * @param best_move - the quiet move that caused the cutoff.
+ * @param quiets_tried - the quiet moves searched before it.
+ * @param quiet_count - number of quiet moves in quiets_tried.
+ * @param previous_1 - the move played one ply ago, null at the root or after a null move.
+ * @param previous_2 - the move played two plies ago.
+ */
+void BazuuMoveOrdering::update_quiet_histories(Colours side, std::uint16_t ply, std::uint8_t depth,
+                                               BazuuMove best_move, const BazuuMove *quiets_tried,
+                                               std::uint16_t quiet_count, BazuuMove previous_1,
+                                               BazuuMove previous_2) {
+  std::int32_t bonus = history_bonus(depth);
+  auto (&butterfly_side)[64][64] = this->butterfly[std::to_underlying(side)];
+  const bool continuation_history = this->options.continuation_history;
+  PieceToHistory *cont_1 = !continuation_history || previous_1.is_null()
+                               ? nullptr
+                               : &this->continuation[0][piece_index(previous_1.piece())][previous_1.to_64()];
+  PieceToHistory *cont_2 = !continuation_history || previous_2.is_null()
+                               ? nullptr
+                               : &this->continuation[1][piece_index(previous_2.piece())][previous_2.to_64()];
+  auto update = [&](BazuuMove move, std::int32_t signed_bonus) {
+    if (this->options.history)
+      apply_gravity(butterfly_side[move.from_64()][move.to_64()], signed_bonus);
+    if (cont_1)
+      apply_gravity((*cont_1)[piece_index(move.piece())][move.to_64()], signed_bonus);
+    if (cont_2)
+      apply_gravity((*cont_2)[piece_index(move.piece())][move.to_64()], signed_bonus);
+  };
+
+  if (this->options.killer_moves)
+    this->update_killers(ply, best_move);
+  if (this->options.counter_moves && !previous_1.is_null())
+    this->counter_moves[piece_index(previous_1.piece())][previous_1.to_64()] = best_move;
+  update(best_move, bonus);
+  for (std::uint16_t i = 0; i < quiet_count; i++) {
+    if (quiets_tried[i] != best_move)
+      update(quiets_tried[i], -bonus);
+  }
+}
+
+/*
+ * Score every move of the list for ordering: TT move, captures and promotions by MVV-LVA, killers,
+ * counter move, then quiet moves by butterfly plus continuation history.
+ * The two continuation tables of the node are resolved once so the quiet pass only touches
+ * three small contiguous tables.
+ * @param list - moves to score.
+ * @param side - side to move.
+ * @param ply - the ply of the node.
+ * @param tt_move - best move from the transposition table, null if none.
+ * @param previous_1 - the move played one ply ago.
+ * @param previous_2 - the move played two plies ago.
+ */
+void BazuuMoveOrdering::score_moves(BazuuMoveList &list, Colours side, std::uint16_t ply, BazuuMove tt_move,
+                                    BazuuMove previous_1, BazuuMove previous_2) const {
+  const auto(&butterfly_side)[64][64] = this->butterfly[std::to_underlying(side)];
+  const bool continuation_history = this->options.continuation_history;
+  const PieceToHistory *cont_1 = !continuation_history || previous_1.is_null()
+                                     ? nullptr
+                                     : &this->continuation[0][piece_index(previous_1.piece())][previous_1.to_64()];
+  const PieceToHistory *cont_2 = !continuation_history || previous_2.is_null()
+                                     ? nullptr
+                                     : &this->continuation[1][piece_index(previous_2.piece())][previous_2.to_64()];
+  // A switched off heuristic leaves a null move, which matches no move of the list.
+  BazuuMove killer_1 = this->options.killer_moves ? this->killers[ply][0] : BazuuMove{};
+  BazuuMove killer_2 = this->options.killer_moves ? this->killers[ply][1] : BazuuMove{};
+  BazuuMove counter = this->options.counter_moves ? this->counter_move(previous_1) : BazuuMove{};
+
+  for (std::uint16_t i = 0; i < list.count; i++) {
+    BazuuMove move = list.moves[i];
+    std::int32_t &score = list.scores[i];
+    if (move == tt_move) {
+      score = TT_MOVE_SCORE;
+    } else if (!move.is_quiet()) {
+      std::int32_t victim = MVV_LVA_VALUE[std::to_underlying(piece_type(move.captured()))] +
+                            MVV_LVA_VALUE[std::to_underlying(piece_type(move.promotion()))];
+      score = CAPTURE_SCORE + victim * 64 - MVV_LVA_VALUE[std::to_underlying(piece_type(move.piece()))];
+    } else if (move == killer_1) {
+      score = KILLER_SCORE;
+    } else if (move == killer_2) {
+      score = KILLER_SCORE - 1;
+    } else if (move == counter) {
+      score = COUNTER_MOVE_SCORE;
+    } else {
+      std::uint8_t piece = piece_index(move.piece());
+      score = this->options.history ? butterfly_side[move.from_64()][move.to_64()] : 0;
+      if (cont_1)
+        score += (*cont_1)[piece][move.to_64()];
+      if (cont_2)
+        score += (*cont_2)[piece][move.to_64()];
+    }
+  }
+}
+
+/*
+ * Move the best scored move from [start, count) to start, a lazy selection sort.
+ * @param list - scored moves.
+ * @param start - index of the next move to search.
+ * @return the move now at start.
+ */
+BazuuMove BazuuMoveOrdering::pick_move(BazuuMoveList &list, std::uint16_t start) {
+  std::uint16_t best = start;
+  for (std::uint16_t i = start + 1; i < list.count; i++) {
+    if (list.scores[i] > list.scores[best])
+      best = i;
+  }
+  std::swap(list.moves[start], list.moves[best]);
+  std::swap(list.scores[start], list.scores[best]);
+  return list.moves[start];
+}
@@ -0,0 +1,623 @@
+#include "bazuu_ce_nnue.hpp"
+#include "bazuu_ce_board.hpp"
+#include "bazuu_ce_eval_cache.hpp"
+#include "defs.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <prng.hpp>
+#include <utility>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BAZUU_NNUE_X86 1
+#else
+#define BAZUU_NNUE_X86 0
+#endif
+
+using namespace BazuuNNUEArch;
+
+struct NNUEFileHeader {
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint32_t input_features;
+  std::uint32_t hidden_size;
+  std::uint32_t l1_size;
+};
+
+// Inputs of the hidden layer, the clipped accumulators of the side to move and of the other side.
+static constexpr std::uint32_t L1_INPUTS = 2 * HIDDEN_SIZE;
+
+// Scalar kernels, also the reference the SIMD kernels are tested against.
+static void add_column_scalar(std::int16_t *accumulator, const std::int16_t *column) {
+  for (std::uint32_t i = 0; i < HIDDEN_SIZE; i++)
+    accumulator[i] += column[i];
+}
+static void sub_column_scalar(std::int16_t *accumulator, const std::int16_t *column) {
+  for (std::uint32_t i = 0; i < HIDDEN_SIZE; i++)
+    accumulator[i] -= column[i];
+}
+static void crelu_pack_scalar(const std::int16_t *accumulator, std::uint8_t *output) {
+  for (std::uint32_t i = 0; i < HIDDEN_SIZE; i++)
+    output[i] = static_cast<std::uint8_t>(std::clamp<std::int32_t>(accumulator[i], 0, QA));
+}
+static void affine_int8_scalar(const std::uint8_t *input, const std::int8_t *weights, const std::int32_t *bias,
+                               std::int32_t *output) {
+  for (std::uint32_t j = 0; j < L1_SIZE; j++) {
+    std::int32_t sum = bias[j];
+    for (std::uint32_t i = 0; i < L1_INPUTS; i++)
+      sum += input[i] * weights[j * L1_INPUTS + i];
+    output[j] = sum;
+  }
+}
+static constexpr BazuuNNUEKernels SCALAR_KERNELS = {SimdLevel::Scalar, add_column_scalar, sub_column_scalar,
+                                                    crelu_pack_scalar, affine_int8_scalar};
+
+#if BAZUU_NNUE_X86
+__attribute__((target("sse4.1"))) static void add_column_sse41(std::int16_t *accumulator,
+                                                                const std::int16_t *column) {
+  for (std::uint32_t i = 0; i < HIDDEN_SIZE; i += 8) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(accumulator + i));
+    __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(column + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(accumulator + i), _mm_add_epi16(a, c));
+  }
+}
+__attribute__((target("sse4.1"))) static void sub_column_sse41(std::int16_t *accumulator,
+                                                                const std::int16_t *column) {
+  for (std::uint32_t i = 0; i < HIDDEN_SIZE; i += 8) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(accumulator + i));
+    __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(column + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(accumulator + i), _mm_sub_epi16(a, c));
+  }
+}
+// The unsigned saturation of the pack clips the negative values to zero.
+__attribute__((target("sse4.1"))) static void crelu_pack_sse41(const std::int16_t *accumulator,
+                                                                std::uint8_t *output) {
+  const __m128i qa = _mm_set1_epi16(QA);
+  for (std::uint32_t i = 0; i < HIDDEN_SIZE; i += 16) {
+    __m128i lo = _mm_min_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(accumulator + i)), qa);
+    __m128i hi = _mm_min_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(accumulator + i + 8)), qa);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(output + i), _mm_packus_epi16(lo, hi));
+  }
+}
+__attribute__((target("sse4.1"))) static void affine_int8_sse41(const std::uint8_t *input, const std::int8_t *weights,
+                                                                 const std::int32_t *bias, std::int32_t *output) {
+  const __m128i ones = _mm_set1_epi16(1);
+  for (std::uint32_t j = 0; j < L1_SIZE; j++) {
+    const std::int8_t *row = weights + j * L1_INPUTS;
+    __m128i sum = _mm_setzero_si128();
+    for (std::uint32_t i = 0; i < L1_INPUTS; i += 16) {
+      __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + i));
+      __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + i));
+      sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(x, w), ones));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    output[j] = bias[j] + _mm_cvtsi128_si32(sum);
+  }
+}
+
+__attribute__((target("avx2"))) static void add_column_avx2(std::int16_t *accumulator, const std::int16_t *column) {
+  for (std::uint32_t i = 0; i < HIDDEN_SIZE; i += 16) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(accumulator + i));
+    __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(column + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(accumulator + i), _mm256_add_epi16(a, c));
+  }
+}
+__attribute__((target("avx2"))) static void sub_column_avx2(std::int16_t *accumulator, const std::int16_t *column) {
+  for (std::uint32_t i = 0; i < HIDDEN_SIZE; i += 16) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(accumulator + i));
+    __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(column + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(accumulator + i), _mm256_sub_epi16(a, c));
+  }
+}
+// The pack works per 128 bit lane, the permute puts the 64 bit quarters back in order.
+__attribute__((target("avx2"))) static void crelu_pack_avx2(const std::int16_t *accumulator, std::uint8_t *output) {
+  const __m256i qa = _mm256_set1_epi16(QA);
+  for (std::uint32_t i = 0; i < HIDDEN_SIZE; i += 32) {
+    __m256i lo = _mm256_min_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(accumulator + i)), qa);
+    __m256i hi = _mm256_min_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(accumulator + i + 16)), qa);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i),
+                        _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8));
+  }
+}
+__attribute__((target("avx2"))) static void affine_int8_avx2(const std::uint8_t *input, const std::int8_t *weights,
+                                                              const std::int32_t *bias, std::int32_t *output) {
+  const __m256i ones = _mm256_set1_epi16(1);
+  for (std::uint32_t j = 0; j < L1_SIZE; j++) {
+    const std::int8_t *row = weights + j * L1_INPUTS;
+    __m256i sum = _mm256_setzero_si256();
+    for (std::uint32_t i = 0; i < L1_INPUTS; i += 32) {
+      __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + i));
+      __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + i));
+      sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(x, w), ones));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+    output[j] = bias[j] + _mm_cvtsi128_si32(half);
+  }
+}
+
+__attribute__((target("avx512f,avx512bw"))) static void add_column_avx512(std::int16_t *accumulator,
+                                                                           const std::int16_t *column) {
+  for (std::uint32_t i = 0; i < HIDDEN_SIZE; i += 32) {
+    __m512i a = _mm512_loadu_si512(accumulator + i);
+    __m512i c = _mm512_loadu_si512(column + i);
+    _mm512_storeu_si512(accumulator + i, _mm512_add_epi16(a, c));
+  }
+}
+__attribute__((target("avx512f,avx512bw"))) static void sub_column_avx512(std::int16_t *accumulator,
+                                                                           const std::int16_t *column) {
+  for (std::uint32_t i = 0; i < HIDDEN_SIZE; i += 32) {
+    __m512i a = _mm512_loadu_si512(accumulator + i);
+    __m512i c = _mm512_loadu_si512(column + i);
+    _mm512_storeu_si512(accumulator + i, _mm512_sub_epi16(a, c));
+  }
+}
+__attribute__((target("avx512f,avx512bw"))) static void crelu_pack_avx512(const std::int16_t *accumulator,
+                                                                           std::uint8_t *output) {
+  const __m512i zero = _mm512_setzero_si512();
+  const __m512i qa = _mm512_set1_epi16(QA);
+  for (std::uint32_t i = 0; i < HIDDEN_SIZE; i += 32) {
+    __m512i a = _mm512_min_epi16(_mm512_max_epi16(_mm512_loadu_si512(accumulator + i), zero), qa);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i), _mm512_cvtepi16_epi8(a));
+  }
+}
+__attribute__((target("avx512f,avx512bw"))) static void affine_int8_avx512(const std::uint8_t *input,
+                                                                            const std::int8_t *weights,
+                                                                            const std::int32_t *bias,
+                                                                            std::int32_t *output) {
+  const __m512i ones = _mm512_set1_epi16(1);
+  for (std::uint32_t j = 0; j < L1_SIZE; j++) {
+    const std::int8_t *row = weights + j * L1_INPUTS;
+    __m512i sum = _mm512_setzero_si512();
+    for (std::uint32_t i = 0; i < L1_INPUTS; i += 64) {
+      __m512i x = _mm512_loadu_si512(input + i);
+      __m512i w = _mm512_loadu_si512(row + i);
+      sum = _mm512_add_epi32(sum, _mm512_madd_epi16(_mm512_maddubs_epi16(x, w), ones));
+    }
+    output[j] = bias[j] + _mm512_reduce_add_epi32(sum);
+  }
+}
+
+static constexpr BazuuNNUEKernels SSE41_KERNELS = {SimdLevel::SSE41, add_column_sse41, sub_column_sse41,
+                                                   crelu_pack_sse41, affine_int8_sse41};
+static constexpr BazuuNNUEKernels AVX2_KERNELS = {SimdLevel::AVX2, add_column_avx2, sub_column_avx2, crelu_pack_avx2,
+                                                  affine_int8_avx2};
+static constexpr BazuuNNUEKernels AVX512_KERNELS = {SimdLevel::AVX512, add_column_avx512, sub_column_avx512,
+                                                    crelu_pack_avx512, affine_int8_avx512};
+#endif
+
+/*
+ * Get the kernel table of a given instruction set.
+ * @param level - the instruction set, must be supported by the cpu.
+ * @return the kernel table.
+ */
+static const BazuuNNUEKernels *kernels_for(SimdLevel level) {
+#if BAZUU_NNUE_X86
+  switch (level) {
+  case SimdLevel::AVX512:
+    return &AVX512_KERNELS;
+  case SimdLevel::AVX2:
+    return &AVX2_KERNELS;
+  case SimdLevel::SSE41:
+    return &SSE41_KERNELS;
+  default:
+    break;
+  }
+#endif
+  (void)level;
+  return &SCALAR_KERNELS;
+}
+
+BazuuNNUE::BazuuNNUE() : weights(std::make_unique<Weights>()) {
+  std::memset(this->weights.get(), 0, sizeof(Weights));
+  this->kernels = kernels_for(detect_simd_level());
+}
+
+/*
+ * Detect the best instruction set the running cpu supports.
+ * Order of preference: AVX-512 -> AVX2 -> SSE4.1 -> scalar.
+ * @return the best supported SIMD level.
+ */
+SimdLevel BazuuNNUE::detect_simd_level() {
+#if BAZUU_NNUE_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+    return SimdLevel::AVX512;
+  if (__builtin_cpu_supports("avx2"))
+    return SimdLevel::AVX2;
+  if (__builtin_cpu_supports("sse4.1"))
+    return SimdLevel::SSE41;
+#endif
+  return SimdLevel::Scalar;
+}
+
+SimdLevel BazuuNNUE::simd_level() const { return this->kernels->level; }
+
+/*
+ * Force the kernels of a given instruction set, capped at what the cpu supports.
+ * @param level - requested SIMD level.
+ * @return the SIMD level actually in use.
+ */
+SimdLevel BazuuNNUE::set_simd_level(SimdLevel level) {
+  SimdLevel supported = detect_simd_level();
+  this->kernels = kernels_for(std::to_underlying(level) > std::to_underlying(supported) ? supported : level);
+  return this->kernels->level;
+}
+
+/*
+ * Get the input feature of a piece on a square as seen from the given perspective.
+ * The board is flipped vertically for Black so both sides share the same weights.
+ * @param perspective - the side whose accumulator the feature belongs to.
+ * @param king_square_64 - square of the perspective's king on the 64 square board.
+ * @param colour - colour of the piece.
+ * @param piece - type of the piece.
+ * @param square_on_64_board - square of the piece on the 64 square board.
+ * @return index of the feature.
+ */
+std::uint32_t BazuuNNUE::feature_index(Colours perspective, std::uint8_t king_square_64, Colours colour,
+                                       PieceType piece, std::uint8_t square_on_64_board) {
+  std::uint8_t flip = perspective == Colours::White ? 0 : 56;
+  std::uint32_t relative_colour = colour == perspective ? 0 : 1;
+  return KING_BUCKET[king_square_64 ^ flip] * FEATURES_PER_BUCKET +
+         (relative_colour * std::to_underlying(PieceType::Empty) + std::to_underlying(piece)) * 64 +
+         (square_on_64_board ^ flip);
+}
+
+/*
+ * Rebuild the accumulator of one perspective from the pieces on the board.
+ * @param accumulator - accumulator to rebuild.
+ * @param board - the board with the current position.
+ * @param perspective - the side to rebuild.
+ */
+void BazuuNNUE::refresh(BazuuAccumulator &accumulator, BazuuBoard &board, Colours perspective) const {
+  std::int16_t *values = accumulator.values[std::to_underlying(perspective)];
+  std::memcpy(values, this->weights->feature_bias, sizeof(this->weights->feature_bias));
+  std::uint8_t king_square_64 = board.to_64_board_square(board.king_square(perspective));
+  for (int colour = std::to_underlying(Colours::White); colour < std::to_underlying(Colours::Both); colour++) {
+    for (int piece = std::to_underlying(PieceType::P); piece < std::to_underlying(PieceType::Empty); piece++) {
+      BitBoard bb = board.get_bitboard_of_piece(PieceType(piece), Colours(colour));
+      while (bb) {
+        std::uint8_t square_on_64_board = std::countr_zero(bb);
+        bb &= bb - 1; // clear the rightmost set bit.
+        std::uint32_t feature =
+            feature_index(perspective, king_square_64, Colours(colour), PieceType(piece), square_on_64_board);
+        this->kernels->add_column(values, this->weights->feature_weights[feature]);
+      }
+    }
+  }
+  accumulator.king_squares[std::to_underlying(perspective)] = king_square_64;
+  accumulator.computed[std::to_underlying(perspective)] = true;
+}
+
+/*
+ * Rebuild the accumulator of both perspectives from the pieces on the board.
+ */
+void BazuuNNUE::refresh(BazuuAccumulator &accumulator, BazuuBoard &board) const {
+  this->refresh(accumulator, board, Colours::White);
+  this->refresh(accumulator, board, Colours::Black);
+}
+
+/*
+ * Reset every entry of the accumulator cache to an empty board.
+ * @param cache - the cache to reset, must be reset again after loading another network.
+ */
+void BazuuNNUE::reset_cache(BazuuAccumulatorCache &cache) const {
+  for (auto &king_square : cache.entries) {
+    for (auto &entry : king_square) {
+      std::memcpy(entry.values, this->weights->feature_bias, sizeof(entry.values));
+      std::memset(entry.pieces, 0, sizeof(entry.pieces));
+    }
+  }
+}
+
+/*
+ * Rebuild the accumulator of one perspective through the accumulator cache.
+ * Only the pieces that differ from the cached position of the same king square are added or removed.
+ * @param accumulator - accumulator to rebuild.
+ * @param board - the board with the current position.
+ * @param perspective - the side to rebuild.
+ * @param cache - accumulator cache of the calling thread.
+ */
+void BazuuNNUE::refresh(BazuuAccumulator &accumulator, BazuuBoard &board, Colours perspective,
+                        BazuuAccumulatorCache &cache) const {
+  std::uint8_t king_square_64 = board.to_64_board_square(board.king_square(perspective));
+  BazuuAccumulatorCache::Entry &entry = cache.entries[king_square_64][std::to_underlying(perspective)];
+  for (int colour = std::to_underlying(Colours::White); colour < std::to_underlying(Colours::Both); colour++) {
+    for (int piece = std::to_underlying(PieceType::P); piece < std::to_underlying(PieceType::Empty); piece++) {
+      BitBoard current = board.get_bitboard_of_piece(PieceType(piece), Colours(colour));
+      BitBoard removed = entry.pieces[colour][piece] & ~current;
+      BitBoard added = current & ~entry.pieces[colour][piece];
+      entry.pieces[colour][piece] = current;
+      while (removed) {
+        std::uint8_t square_on_64_board = std::countr_zero(removed);
+        removed &= removed - 1;
+        this->kernels->sub_column(entry.values,
+                                  this->weights->feature_weights[feature_index(perspective, king_square_64,
+                                                                               Colours(colour), PieceType(piece),
+                                                                               square_on_64_board)]);
+      }
+      while (added) {
+        std::uint8_t square_on_64_board = std::countr_zero(added);
+        added &= added - 1;
+        this->kernels->add_column(entry.values,
+                                  this->weights->feature_weights[feature_index(perspective, king_square_64,
+                                                                               Colours(colour), PieceType(piece),
+                                                                               square_on_64_board)]);
+      }
+    }
+  }
+  std::memcpy(accumulator.values[std::to_underlying(perspective)], entry.values, sizeof(entry.values));
+  accumulator.king_squares[std::to_underlying(perspective)] = king_square_64;
+  accumulator.computed[std::to_underlying(perspective)] = true;
+}
+
+/*
+ * Apply the dirty pieces of an accumulator on top of the one below it for one perspective.
+ * @param previous - computed accumulator one ply below.
+ * @param next - accumulator holding the dirty pieces.
+ * @param perspective - the side to update.
+ */
+void BazuuNNUE::apply_dirty_pieces(const BazuuAccumulator &previous, BazuuAccumulator &next,
+                                   Colours perspective) const {
+  std::int16_t *values = next.values[std::to_underlying(perspective)];
+  std::uint8_t king_square_64 = next.king_squares[std::to_underlying(perspective)];
+  std::memcpy(values, previous.values[std::to_underlying(perspective)], sizeof(next.values[0]));
+  for (std::uint8_t i = 0; i < next.dirty_count; i++) {
+    const BazuuDirtyPiece &dirty = next.dirty[i];
+    if (dirty.from_64 < 64)
+      this->kernels->sub_column(
+          values, this->weights->feature_weights[feature_index(perspective, king_square_64, dirty.colour, dirty.piece,
+                                                               dirty.from_64)]);
+    if (dirty.to_64 < 64)
+      this->kernels->add_column(
+          values, this->weights->feature_weights[feature_index(perspective, king_square_64, dirty.colour, dirty.piece,
+                                                               dirty.to_64)]);
+  }
+  next.computed[std::to_underlying(perspective)] = true;
+}
+
+/*
+ * Bring the top accumulator of the stack up to date, only called when an evaluation is needed.
+ * Walks down to the closest computed accumulator and replays the dirty pieces from there, unless the
+ * perspective's king changed bucket on the way, in which case the top is refreshed through the cache.
+ * @param stack - accumulator stack of the calling thread.
+ * @param board - the board with the current position.
+ * @param cache - accumulator cache of the calling thread.
+ */
+void BazuuNNUE::update(BazuuAccumulatorStack &stack, BazuuBoard &board, BazuuAccumulatorCache &cache) const {
+  for (Colours perspective : {Colours::White, Colours::Black}) {
+    std::uint8_t side = std::to_underlying(perspective);
+    std::uint8_t flip = perspective == Colours::White ? 0 : 56;
+    std::uint16_t ply = stack.ply;
+    bool needs_refresh = false;
+    while (!stack.accumulators[ply].computed[side]) {
+      const BazuuAccumulator &accumulator = stack.accumulators[ply];
+      if (ply == 0 || KING_BUCKET[accumulator.king_squares[side] ^ flip] !=
+                          KING_BUCKET[stack.accumulators[ply - 1].king_squares[side] ^ flip]) {
+        needs_refresh = true;
+        break;
+      }
+      ply--;
+    }
+    if (needs_refresh) {
+      this->refresh(stack.current(), board, perspective, cache);
+      continue;
+    }
+    for (ply = ply + 1; ply <= stack.ply; ply++) {
+      this->apply_dirty_pieces(stack.accumulators[ply - 1], stack.accumulators[ply], perspective);
+    }
+  }
+}
+
+void BazuuNNUE::add_feature(BazuuAccumulator &accumulator, Colours perspective, std::uint32_t feature) const {
+  this->kernels->add_column(accumulator.values[std::to_underlying(perspective)],
+                            this->weights->feature_weights[feature]);
+}
+
+void BazuuNNUE::remove_feature(BazuuAccumulator &accumulator, Colours perspective, std::uint32_t feature) const {
+  this->kernels->sub_column(accumulator.values[std::to_underlying(perspective)],
+                            this->weights->feature_weights[feature]);
+}
+
+/*
+ * Incrementally add a piece to both perspectives of the accumulator.
+ * @param accumulator - accumulator to update.
+ * @param king_squares - the White and Black king squares on the 64 square board.
+ * @param colour - colour of the piece.
+ * @param piece - type of the piece.
+ * @param square_on_64_board - square the piece is placed on.
+ */
+void BazuuNNUE::add_piece(BazuuAccumulator &accumulator, const std::uint8_t king_squares[2], Colours colour,
+                          PieceType piece, std::uint8_t square_on_64_board) const {
+  for (Colours perspective : {Colours::White, Colours::Black}) {
+    this->add_feature(accumulator, perspective,
+                      feature_index(perspective, king_squares[std::to_underlying(perspective)], colour, piece,
+                                    square_on_64_board));
+  }
+}
+
+/*
+ * Incrementally remove a piece from both perspectives of the accumulator.
+ */
+void BazuuNNUE::remove_piece(BazuuAccumulator &accumulator, const std::uint8_t king_squares[2], Colours colour,
+                             PieceType piece, std::uint8_t square_on_64_board) const {
+  for (Colours perspective : {Colours::White, Colours::Black}) {
+    this->remove_feature(accumulator, perspective,
+                         feature_index(perspective, king_squares[std::to_underlying(perspective)], colour, piece,
+                                       square_on_64_board));
+  }
+}
+
+/*
+ * Incrementally move a piece in both perspectives of the accumulator.
+ * A king move that changes its bucket invalidates that perspective, refresh it instead.
+ */
+void BazuuNNUE::move_piece(BazuuAccumulator &accumulator, const std::uint8_t king_squares[2], Colours colour,
+                           PieceType piece, std::uint8_t from_64, std::uint8_t to_64) const {
+  this->remove_piece(accumulator, king_squares, colour, piece, from_64);
+  this->add_piece(accumulator, king_squares, colour, piece, to_64);
+}
+
+/*
+ * Run the layers of the network on top of the accumulator.
+ * The hidden layer is an int8 affine of the clipped accumulators, its outputs are scaled back by L1_SHIFT and
+ * clipped again before the int16 output layer, small enough to stay scalar.
+ * @param accumulator - a computed accumulator.
+ * @param side_to_move - side the score is relative to.
+ * @param kernels - the kernels to run the clipped ReLU and the hidden layer with.
+ * @return score in centipawns from the side to move's point of view.
+ */
+std::int32_t BazuuNNUE::forward(const BazuuAccumulator &accumulator, Colours side_to_move,
+                                const BazuuNNUEKernels &kernels) const {
+  Colours them = side_to_move == Colours::White ? Colours::Black : Colours::White;
+  alignas(64) std::uint8_t input[L1_INPUTS];
+  alignas(64) std::int32_t hidden[L1_SIZE];
+  kernels.crelu_pack(accumulator.values[std::to_underlying(side_to_move)], input);
+  kernels.crelu_pack(accumulator.values[std::to_underlying(them)], input + HIDDEN_SIZE);
+  kernels.affine_int8(input, this->weights->hidden_weights[0], this->weights->hidden_bias, hidden);
+  std::int32_t sum = this->weights->output_bias;
+  for (std::uint32_t j = 0; j < L1_SIZE; j++)
+    sum += std::clamp<std::int32_t>(hidden[j] >> L1_SHIFT, 0, QA) * this->weights->output_weights[j];
+  return static_cast<std::int32_t>(static_cast<std::int64_t>(sum) * OUTPUT_SCALE / (QA * QB));
+}
+
+/*
+ * Evaluate the position held by the accumulator.
+ * @param accumulator - a computed accumulator.
+ * @param side_to_move - side the score is relative to.
+ * @return score in centipawns from the side to move's point of view.
+ */
+std::int32_t BazuuNNUE::evaluate(const BazuuAccumulator &accumulator, Colours side_to_move) const {
+  return this->forward(accumulator, side_to_move, *this->kernels);
+}
+
+/*
+ * Evaluate the position on top of the accumulator stack, updating it lazily first.
+ * @param stack - accumulator stack of the calling thread.
+ * @param board - the board with the current position.
+ * @param cache - accumulator cache of the calling thread.
+ * @param side_to_move - side the score is relative to.
+ * @return score in centipawns from the side to move's point of view.
+ */
+std::int32_t BazuuNNUE::evaluate(BazuuAccumulatorStack &stack, BazuuBoard &board, BazuuAccumulatorCache &cache,
+                                 Colours side_to_move) const {
+  this->update(stack, board, cache);
+  return this->evaluate(stack.current(), side_to_move);
+}
+
+/*
+ * Evaluate the current position of the board through the evaluation cache.
+ * On a hit the accumulator stack is left untouched, its dirty pieces are replayed by a later evaluation.
+ * @param stack - accumulator stack of the calling thread.
+ * @param board - the board with the current position.
+ * @param cache - accumulator cache of the calling thread.
+ * @param eval_cache - evaluation cache, may be shared between threads.
+ * @return score in centipawns from the side to move's point of view, clamped to the 16 bits the cache keeps so a hit
+ * and a miss give the same score.
+ */
+std::int32_t BazuuNNUE::evaluate(BazuuAccumulatorStack &stack, BazuuBoard &board, BazuuAccumulatorCache &cache,
+                                 BazuuEvalCache &eval_cache) const {
+  std::int16_t cached_score;
+  if (eval_cache.probe(board.zobrist_key(), cached_score))
+    return cached_score;
+  const std::int32_t score =
+      std::clamp<std::int32_t>(this->evaluate(stack, board, cache, board.side_to_move()), INT16_MIN, INT16_MAX);
+  eval_cache.store(board.zobrist_key(), score);
+  return score;
+}
+
+/*
+ * Reference evaluation using only the scalar kernels.
+ */
+std::int32_t BazuuNNUE::evaluate_scalar(const BazuuAccumulator &accumulator, Colours side_to_move) const {
+  return this->forward(accumulator, side_to_move, SCALAR_KERNELS);
+}
+
+/*
+ * Fill the network with small pseudo random weights, for tests and benchmarks.
+ * Hidden units come in pairs of opposite weights over the two accumulators, so that as with a trained network a
+ * position scores the opposite for the other side; a random network otherwise leaves the quiescence search without
+ * stand pat cutoffs.
+ * @param seed - seed of the PRNG.
+ */
+void BazuuNNUE::init_random(U64 seed) {
+  PRNG prng(seed);
+  for (auto &column : this->weights->feature_weights) {
+    for (auto &weight : column) {
+      weight = static_cast<std::int16_t>(static_cast<std::int32_t>(prng.rand64() % 65) - 32);
+    }
+  }
+  for (auto &bias : this->weights->feature_bias) {
+    bias = static_cast<std::int16_t>(static_cast<std::int32_t>(prng.rand64() % 129) - 64);
+  }
+  for (std::uint32_t j = 0; j < L1_SIZE; j += 2) {
+    for (std::uint32_t i = 0; i < HIDDEN_SIZE; i++) {
+      const auto weight = static_cast<std::int8_t>(static_cast<std::int32_t>(prng.rand64() % 9) - 4);
+      this->weights->hidden_weights[j][i] = this->weights->hidden_weights[j + 1][HIDDEN_SIZE + i] = weight;
+      this->weights->hidden_weights[j][HIDDEN_SIZE + i] = this->weights->hidden_weights[j + 1][i] = -weight;
+    }
+    this->weights->hidden_bias[j] = this->weights->hidden_bias[j + 1] = 0;
+    this->weights->output_weights[j] = static_cast<std::int16_t>(static_cast<std::int32_t>(prng.rand64() % 129) - 64);
+    this->weights->output_weights[j + 1] = -this->weights->output_weights[j];
+  }
+  this->weights->output_bias = 0;
+}
+
+/*
+ * Load the network from a file.
+ * The file holds a header (magic, version, input features, hidden size, L1 size) followed by the little-endian
+ * feature weights, feature bias, hidden weights, hidden bias, output weights and output bias.
+ * @param path - path of the network file.
+ * @return status of the load, the current network is kept on failure.
+ */
+NNUELoadStatus BazuuNNUE::load(const std::string &path) {
+  static_assert(std::endian::native == std::endian::little, "Network files are little-endian");
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return NNUELoadStatus::FileNotFound;
+  NNUEFileHeader header{};
+  if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)))
+    return NNUELoadStatus::Truncated;
+  if (header.magic != FILE_MAGIC)
+    return NNUELoadStatus::BadMagic;
+  if (header.version != FILE_VERSION)
+    return NNUELoadStatus::VersionMismatch;
+  if (header.input_features != INPUT_FEATURES || header.hidden_size != HIDDEN_SIZE || header.l1_size != L1_SIZE)
+    return NNUELoadStatus::ArchMismatch;
+
+  auto loaded = std::make_unique<Weights>();
+  file.read(reinterpret_cast<char *>(loaded->feature_weights), sizeof(loaded->feature_weights));
+  file.read(reinterpret_cast<char *>(loaded->feature_bias), sizeof(loaded->feature_bias));
+  file.read(reinterpret_cast<char *>(loaded->hidden_weights), sizeof(loaded->hidden_weights));
+  file.read(reinterpret_cast<char *>(loaded->hidden_bias), sizeof(loaded->hidden_bias));
+  file.read(reinterpret_cast<char *>(loaded->output_weights), sizeof(loaded->output_weights));
+  file.read(reinterpret_cast<char *>(&loaded->output_bias), sizeof(loaded->output_bias));
+  if (!file)
+    return NNUELoadStatus::Truncated;
+  this->weights = std::move(loaded);
+  return NNUELoadStatus::Ok;
+}
+
+/*
+ * Save the network in the format read by load().
+ * @param path - path of the network file.
+ * @return true if the whole network was written.
+ */
+bool BazuuNNUE::save(const std::string &path) const {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file)
+    return false;
+  NNUEFileHeader header{FILE_MAGIC, FILE_VERSION, INPUT_FEATURES, HIDDEN_SIZE, L1_SIZE};
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(this->weights->feature_weights), sizeof(this->weights->feature_weights));
+  file.write(reinterpret_cast<const char *>(this->weights->feature_bias), sizeof(this->weights->feature_bias));
+  file.write(reinterpret_cast<const char *>(this->weights->hidden_weights), sizeof(this->weights->hidden_weights));
+  file.write(reinterpret_cast<const char *>(this->weights->hidden_bias), sizeof(this->weights->hidden_bias));
+  file.write(reinterpret_cast<const char *>(this->weights->output_weights), sizeof(this->weights->output_weights));
+  file.write(reinterpret_cast<const char *>(&this->weights->output_bias), sizeof(this->weights->output_bias));
+  return static_cast<bool>(file);
+}
@@ -0,0 +1,139 @@
+#include "bazuu_ce_packed_position.hpp"
+#include "defs.hpp"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+
+static constexpr std::size_t STATE_OFFSET = 24;
+static constexpr int SCORE_SHIFT = 38;
+static constexpr int RESULT_SHIFT = 54;
+
+static U64 load_little_endian(const std::uint8_t *bytes) {
+  U64 value = 0;
+  for (int i = 7; i >= 0; i--)
+    value = value << 8 | bytes[i];
+  return value;
+}
+
+static void store_little_endian(std::uint8_t *bytes, U64 value) {
+  for (int i = 0; i < 8; i++, value >>= 8)
+    bytes[i] = value & 0xFF;
+}
+
+BitBoard BazuuPackedPosition::occupancy() const { return load_little_endian(this->bytes); }
+
+/*
+ * Get the piece on an occupied square.
+ * @param index - rank of the square among the occupied squares, from a1 to h8.
+ * @return the piece, Pieces::Empty for a code out of range.
+ */
+Pieces BazuuPackedPosition::piece(std::uint8_t index) const {
+  std::uint8_t code = this->bytes[8 + index / 2] >> (index % 2 * 4) & 0xF;
+  return code <= std::to_underlying(Pieces::bK) ? static_cast<Pieces>(code) : Pieces::Empty;
+}
+
+void BazuuPackedPosition::set_occupancy(BitBoard occupancy) { store_little_endian(this->bytes, occupancy); }
+
+void BazuuPackedPosition::set_piece(std::uint8_t index, Pieces piece) {
+  std::uint8_t &byte = this->bytes[8 + index / 2];
+  byte = (byte & (0xF0 >> (index % 2 * 4))) | std::to_underlying(piece) << (index % 2 * 4);
+}
+
+U64 BazuuPackedPosition::state() const { return load_little_endian(this->bytes + STATE_OFFSET); }
+
+void BazuuPackedPosition::set_state(U64 state) { store_little_endian(this->bytes + STATE_OFFSET, state); }
+
+std::int16_t BazuuPackedPosition::score() const {
+  return static_cast<std::int16_t>(this->state() >> SCORE_SHIFT & 0xFFFF);
+}
+
+GameResult BazuuPackedPosition::result() const { return static_cast<GameResult>(this->state() >> RESULT_SHIFT & 3); }
+
+void BazuuPackedPosition::set_score(std::int16_t score) {
+  U64 state = this->state() & ~(0xFFFFULL << SCORE_SHIFT);
+  this->set_state(state | U64(static_cast<std::uint16_t>(score)) << SCORE_SHIFT);
+}
+
+void BazuuPackedPosition::set_result(GameResult result) {
+  U64 state = this->state() & ~(3ULL << RESULT_SHIFT);
+  this->set_state(state | U64(std::to_underlying(result)) << RESULT_SHIFT);
+}
+
+/*
+ * Map a file of packed positions.
+ * @param path - path of the file.
+ * @return false if the file can not be mapped or is not made of whole positions.
+ */
+bool BazuuPackedReader::open(const std::string &path) {
+  if (!this->file.open(path, true))
+    return false;
+  if (this->file.size() % BazuuPackedPosition::SIZE != 0) {
+    this->file.close();
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Copy a position out of the file.
+ * @param index - index of the position, below size().
+ * @param packed - receives the position.
+ */
+void BazuuPackedReader::read(std::size_t index, BazuuPackedPosition &packed) const {
+  std::memcpy(packed.bytes, this->file.data() + index * BazuuPackedPosition::SIZE, BazuuPackedPosition::SIZE);
+}
+
+BazuuPackedWriter::~BazuuPackedWriter() { this->close(); }
+
+/*
+ * Open a file for writing, a file already open is closed first.
+ * @param path - path of the file.
+ * @param append - keep the positions already in the file.
+ * @return false if the file can not be opened.
+ */
+bool BazuuPackedWriter::open(const std::string &path, bool append) {
+  this->close();
+  this->file.open(path, std::ios::binary | (append ? std::ios::app : std::ios::trunc));
+  this->count = 0;
+  return this->file.is_open();
+}
+
+/*
+ * Queue a position, the buffer is written out when it is full.
+ * @param packed - the position.
+ * @return false if writing the buffer failed.
+ */
+bool BazuuPackedWriter::write(const BazuuPackedPosition &packed) {
+  std::memcpy(this->buffer + this->buffered * BazuuPackedPosition::SIZE, packed.bytes, BazuuPackedPosition::SIZE);
+  this->count++;
+  if (++this->buffered == BUFFER_POSITIONS)
+    return this->flush();
+  return true;
+}
+
+/*
+ * Write the buffered positions to the file.
+ * @return false if the write failed.
+ */
+bool BazuuPackedWriter::flush() {
+  if (!this->file.is_open())
+    return false;
+  this->file.write(reinterpret_cast<const char *>(this->buffer), this->buffered * BazuuPackedPosition::SIZE);
+  this->buffered = 0;
+  this->file.flush();
+  return this->file.good();
+}
+
+/*
+ * Write the buffered positions and close the file.
+ * @return false if the last write failed.
+ */
+bool BazuuPackedWriter::close() {
+  if (!this->file.is_open())
+    return true;
+  bool flushed = this->flush();
+  this->file.close();
+  return flushed;
+}
@@ -0,0 +1,109 @@
+#include "bazuu_ce_perf_counters.hpp"
+#include <cstdint>
+#include <utility>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static constexpr const char *EVENT_NAMES[BazuuPerfCounters::EVENTS] = {
+    "cycles", "instructions", "L1D misses", "LLC misses", "branch misses", "dTLB misses"};
+
+#if defined(__linux__)
+// Type and config of each event, the cache events count read misses.
+static constexpr std::pair<std::uint32_t, std::uint64_t> EVENT_CONFIGS[BazuuPerfCounters::EVENTS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE,
+     PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HW_CACHE,
+     PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE,
+     PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+};
+#endif
+
+/*
+ * Open the counters, disabled until start().
+ */
+BazuuPerfCounters::BazuuPerfCounters() {
+  for (int &fd : this->fds)
+    fd = -1;
+#if defined(__linux__)
+  for (std::uint8_t event = 0; event < EVENTS; event++) {
+    perf_event_attr attributes{};
+    attributes.size = sizeof(attributes);
+    attributes.type = EVENT_CONFIGS[event].first;
+    attributes.config = EVENT_CONFIGS[event].second;
+    attributes.disabled = 1;
+    attributes.inherit = 1;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    this->fds[event] = static_cast<int>(::syscall(SYS_perf_event_open, &attributes, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+  }
+#endif
+}
+
+BazuuPerfCounters::~BazuuPerfCounters() {
+#if defined(__linux__)
+  for (int fd : this->fds)
+    if (fd >= 0)
+      ::close(fd);
+#endif
+}
+
+const char *BazuuPerfCounters::event_name(BazuuPerfEvent event) { return EVENT_NAMES[std::to_underlying(event)]; }
+
+bool BazuuPerfCounters::any_available() const {
+  for (int fd : this->fds)
+    if (fd >= 0)
+      return true;
+  return false;
+}
+
+/*
+ * Zero the counters and start counting.
+ */
+void BazuuPerfCounters::start() {
+#if defined(__linux__)
+  for (int fd : this->fds) {
+    if (fd < 0)
+      continue;
+    ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+#endif
+}
+
+/*
+ * Stop counting, the counts stay readable.
+ */
+void BazuuPerfCounters::stop() {
+#if defined(__linux__)
+  for (int fd : this->fds)
+    if (fd >= 0)
+      ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+}
+
+/*
+ * Count of an event between start() and stop(), scaled up if the event was multiplexed with others.
+ * @param event - the event to read.
+ * @return the count, none if the event is not available or never got a counter.
+ */
+std::optional<double> BazuuPerfCounters::count(BazuuPerfEvent event) const {
+#if defined(__linux__)
+  const int fd = this->fds[std::to_underlying(event)];
+  std::uint64_t values[3]; // Value, time enabled, time running.
+  if (fd < 0 || ::read(fd, values, sizeof(values)) != static_cast<ssize_t>(sizeof(values)) || values[2] == 0)
+    return std::nullopt;
+  return static_cast<double>(values[0]) * static_cast<double>(values[1]) / static_cast<double>(values[2]);
+#else
+  static_cast<void>(event);
+  return std::nullopt;
+#endif
+}
@@ -0,0 +1,513 @@
+#include "bazuu_ce_search.hpp"
+#include "bazuu_ce_eval.hpp"
+#include "bazuu_ce_trace.hpp"
+#include "defs.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+// Late move reductions indexed by [depth][move number], 0.75 + ln(depth) * ln(move number) / 2.25.
+static const auto REDUCTIONS = [] {
+  std::array<std::array<std::uint8_t, 64>, 64> table{};
+  for (int depth = 1; depth < 64; depth++) {
+    for (int move_number = 1; move_number < 64; move_number++) {
+      table[depth][move_number] =
+          static_cast<std::uint8_t>(0.75 + std::log(depth) * std::log(move_number) / 2.25);
+    }
+  }
+  return table;
+}();
+
+// Pruning margins and bounds, in centipawns and plies.
+static constexpr int REVERSE_FUTILITY_DEPTH = 8;
+static constexpr std::int32_t REVERSE_FUTILITY_MARGIN = 80;
+static constexpr int FUTILITY_DEPTH = 3;
+static constexpr std::int32_t FUTILITY_MARGIN = 100;
+static constexpr int LATE_MOVE_PRUNING_DEPTH = 8;
+static constexpr int NULL_MOVE_DEPTH = 3;
+static constexpr int LMR_DEPTH = 3;
+
+BazuuSearch::BazuuSearch(BazuuBoard &board, const BazuuNNUE *nnue)
+    : board(board), nnue(nnue), ordering(std::make_unique<BazuuMoveOrdering>()) {
+  if (this->nnue) {
+    this->accumulators = std::make_unique<BazuuAccumulatorStack>();
+    this->accumulator_cache = std::make_unique<BazuuAccumulatorCache>();
+    this->nnue->reset_cache(*this->accumulator_cache);
+  }
+}
+
+/*
+ * Get the late move reduction of a move.
+ * @param depth - remaining depth of the node.
+ * @param move_number - 1 based index of the move in the node.
+ * @return the reduction in plies.
+ */
+std::uint8_t BazuuSearch::reduction(int depth, int move_number) {
+  return REDUCTIONS[std::min(depth, 63)][std::min(move_number, 63)];
+}
+
+/*
+ * Ask a running search to stop, safe to call from another thread.
+ */
+void BazuuSearch::stop() { this->stopped.store(true, std::memory_order_relaxed); }
+
+/*
+ * Static evaluation of the current position, NNUE when a network is given, else the classical evaluation. Only NNUE
+ * goes through the evaluation cache when there is one, the classical evaluation is cheaper than a cache miss.
+ * @return score in centipawns from the side to move's point of view.
+ */
+std::int32_t BazuuSearch::evaluate() {
+  BAZUU_TRACE_SCOPE(Eval);
+  if (this->nnue && this->eval_cache)
+    return this->nnue->evaluate(*this->accumulators, this->board, *this->accumulator_cache, *this->eval_cache);
+  if (this->nnue)
+    return this->nnue->evaluate(*this->accumulators, this->board, *this->accumulator_cache,
+                                this->board.side_to_move());
+  return BazuuEval::evaluate(this->board);
+}
+
+/*
+ * Play a move on the board and record it for the accumulators and continuation history.
+ * @return false if the move is illegal, nothing is recorded then.
+ */
+bool BazuuSearch::make_move(BazuuMove move, std::uint16_t ply) {
+  if (!this->board.make_move(move))
+    return false;
+  this->played[ply] = move;
+  if (this->nnue) {
+    Colours us = piece_colour(move.piece());
+    Colours them = us == Colours::White ? Colours::Black : Colours::White;
+    BazuuDirtyPiece dirty[3];
+    std::uint8_t count = 0;
+    if (move.is_promotion()) {
+      dirty[count++] = {us, PieceType::P, move.from_64(), 64};
+      dirty[count++] = {us, piece_type(move.promotion()), 64, move.to_64()};
+    } else {
+      dirty[count++] = {us, piece_type(move.piece()), move.from_64(), move.to_64()};
+    }
+    if (move.is_capture()) {
+      std::uint8_t captured_square = move.to_64();
+      if (move.flag() == MoveFlag::EnPassant)
+        captured_square = us == Colours::White ? captured_square - 8 : captured_square + 8;
+      dirty[count++] = {them, piece_type(move.captured()), captured_square, 64};
+    }
+    if (move.flag() == MoveFlag::Castling) {
+      auto [rook_from, rook_to] = BazuuBoard::castling_rook_squares(move.to_64());
+      dirty[count++] = {us, PieceType::R, rook_from, rook_to};
+    }
+    std::uint8_t kings[2] = {this->board.to_64_board_square(this->board.king_square(Colours::White)),
+                             this->board.to_64_board_square(this->board.king_square(Colours::Black))};
+    this->accumulators->push(dirty, count, kings);
+  }
+  return true;
+}
+
+void BazuuSearch::unmake_move(BazuuMove move) {
+  this->board.unmake_move(move);
+  if (this->nnue)
+    this->accumulators->pop();
+}
+
+bool BazuuSearch::make_null_move(std::uint16_t ply) {
+  if (!this->board.make_null_move())
+    return false;
+  this->played[ply] = BazuuMove{};
+  if (this->nnue)
+    this->accumulators->push(nullptr, 0, this->accumulators->current().king_squares);
+  return true;
+}
+
+void BazuuSearch::unmake_null_move() {
+  this->board.unmake_null_move();
+  if (this->nnue)
+    this->accumulators->pop();
+}
+
+/*
+ * Stop the search once the node or time limit is reached, checked every 2048 nodes.
+ */
+void BazuuSearch::check_limits() {
+  if ((this->stats.nodes + this->stats.qnodes) & 2047)
+    return;
+  if (this->limits.nodes && this->stats.nodes + this->stats.qnodes >= this->limits.nodes)
+    this->stop();
+  if (this->limits.movetime_ms) {
+    auto elapsed = std::chrono::steady_clock::now() - this->start_time;
+    if (std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() >=
+        static_cast<std::int64_t>(this->limits.movetime_ms))
+      this->stop();
+  }
+}
+
+void BazuuSearch::update_pv(BazuuMove move, std::uint16_t ply) {
+  this->pv_table[ply][0] = move;
+  std::uint8_t child_length = ply + 1 < MAX_SEARCH_PLY ? this->pv_length[ply + 1] : 0;
+  for (std::uint8_t i = 0; i < child_length; i++)
+    this->pv_table[ply][i + 1] = this->pv_table[ply + 1][i];
+  this->pv_length[ply] = child_length + 1;
+}
+
+/*
+ * Check if the tablebases cover the current position.
+ */
+bool BazuuSearch::can_probe_tablebase() {
+  return this->tablebase && this->tablebase->max_pieces() && !this->board.castling_rights() &&
+         std::popcount(this->board.occupancy()) <= this->tablebase->max_pieces();
+}
+
+/*
+ * Make a mate or tablebase score relative to the node before storing it, the table is shared by every path to it.
+ * @param score - score relative to the root.
+ * @param ply - distance of the node from the root.
+ * @return score relative to the node.
+ */
+std::int32_t BazuuSearch::score_to_tt(std::int32_t score, std::uint16_t ply) {
+  if (score >= TB_WIN - MAX_SEARCH_PLY)
+    return score + ply;
+  if (score <= -TB_WIN + MAX_SEARCH_PLY)
+    return score - ply;
+  return score;
+}
+
+/*
+ * Turn a stored score relative to its node back into one relative to the root.
+ * @param score - score relative to the node.
+ * @param ply - distance of the node from the root.
+ * @return score relative to the root.
+ */
+std::int32_t BazuuSearch::score_from_tt(std::int32_t score, std::uint16_t ply) {
+  if (score >= TB_WIN - MAX_SEARCH_PLY)
+    return score - ply;
+  if (score <= -TB_WIN + MAX_SEARCH_PLY)
+    return score + ply;
+  return score;
+}
+
+/*
+ * Search the position to increasing depths until a limit is reached.
+ * @param limits - depth, node and time limits.
+ * @return best moves, scores and principal variations of the last completed iteration.
+ */
+BazuuSearchResult BazuuSearch::search(const BazuuSearchLimits &limits) {
+  this->limits = limits;
+  this->stats = BazuuSearchStats{};
+  this->stopped.store(false, std::memory_order_relaxed);
+  this->start_time = std::chrono::steady_clock::now();
+  this->root_best_move = BazuuMove{};
+  this->ordering->options = {.killer_moves = this->options.killer_moves,
+                             .history = this->options.history,
+                             .counter_moves = this->options.counter_moves,
+                             .continuation_history = this->options.continuation_history};
+  if (this->nnue) {
+    std::uint8_t kings[2] = {this->board.to_64_board_square(this->board.king_square(Colours::White)),
+                             this->board.to_64_board_square(this->board.king_square(Colours::Black))};
+    this->accumulators->reset(kings);
+  }
+  if (this->tt)
+    this->tt->new_search();
+
+  // With the position in the tablebases only the moves keeping the best DTZ result are searched.
+  this->root_moves.clear();
+  std::vector<BazuuMove> legal_moves;
+  BazuuMoveList list;
+  this->board.generate_moves(list);
+  for (std::uint16_t i = 0; i < list.count; i++) {
+    if (this->board.make_move(list.moves[i])) {
+      this->board.unmake_move(list.moves[i]);
+      legal_moves.push_back(list.moves[i]);
+    }
+  }
+  if (this->can_probe_tablebase()) {
+    this->root_moves = legal_moves;
+    if (!this->tablebase->root_probe(this->board, this->root_moves))
+      this->root_moves.clear();
+  }
+  // No more lines than moves to search, a root without moves still gets its mate or stalemate score.
+  const std::size_t searchable = this->root_moves.empty() ? legal_moves.size() : this->root_moves.size();
+  const std::size_t line_count = std::clamp<std::size_t>(this->multi_pv, 1, std::max<std::size_t>(searchable, 1));
+
+  BazuuSearchResult result;
+  std::uint8_t max_depth = std::min<std::uint8_t>(limits.depth ? limits.depth : 64, MAX_SEARCH_PLY - 1);
+  for (std::uint8_t depth = 1; depth <= max_depth; depth++) {
+    std::vector<BazuuRootLine> lines;
+    this->excluded_root_moves.clear();
+    for (std::size_t slot = 0; slot < line_count; slot++) {
+      // Each line starts from the move it had in the previous iteration.
+      this->root_best_move = slot < result.lines.size() ? result.lines[slot].move : BazuuMove{};
+      this->pv_length[0] = 0;
+      std::int32_t score = this->negamax(-INFINITE, INFINITE, depth, 0, false);
+      if (this->stopped.load(std::memory_order_relaxed) && (depth > 1 || slot > 0))
+        break;
+      BazuuRootLine &line = lines.emplace_back();
+      line.score = score;
+      line.pv.assign(this->pv_table[0], this->pv_table[0] + this->pv_length[0]);
+      if (!line.pv.empty()) {
+        line.move = line.pv.front();
+        this->excluded_root_moves.push_back(line.move);
+      }
+    }
+    // An iteration cut short keeps the lines of the previous one, only the first iteration is taken in any case.
+    if (lines.empty() || (lines.size() < line_count && depth > 1))
+      break;
+    std::stable_sort(lines.begin(), lines.end(),
+                     [](const BazuuRootLine &a, const BazuuRootLine &b) { return a.score > b.score; });
+    result.score = lines.front().score;
+    result.depth = depth;
+    result.pv = lines.front().pv;
+    if (!lines.front().move.is_null())
+      result.best_move = lines.front().move;
+    result.lines = std::move(lines);
+    if (this->stopped.load(std::memory_order_relaxed))
+      break;
+  }
+  this->excluded_root_moves.clear();
+  result.stats = this->stats;
+  result.elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                                                            this->start_time)
+                          .count();
+  return result;
+}
+
+/*
+ * Principal variation search with null move pruning, reverse futility pruning, futility pruning,
+ * late move pruning and late move reductions.
+ * @param alpha - lower bound of the window.
+ * @param beta - upper bound of the window.
+ * @param depth - remaining depth in plies.
+ * @param ply - distance from the root.
+ * @param null_allowed - false right after a null move.
+ * @return score of the node from the side to move's point of view.
+ */
+std::int32_t BazuuSearch::negamax(std::int32_t alpha, std::int32_t beta, int depth, std::uint16_t ply,
+                                  bool null_allowed) {
+  BAZUU_TRACE_SCOPE(Search);
+  this->pv_length[ply] = 0;
+  if (ply > 0) {
+    if (this->board.halfmove_clock() >= 100 || this->board.is_repetition(ply))
+      return 0;
+    // A reversible move reaches a repetition, the node is worth at least a draw.
+    if (alpha < 0 && this->board.has_upcoming_repetition(ply)) {
+      alpha = 0;
+      if (alpha >= beta)
+        return alpha;
+    }
+    // Tablebase scores are exact for draws and bounds for wins and losses, probed right after a capture or pawn move.
+    if (this->board.halfmove_clock() == 0 && this->can_probe_tablebase()) {
+      ProbeState state;
+      WDLScore wdl = this->tablebase->probe_wdl(this->board, state);
+      if (state != ProbeState::Fail) {
+        this->stats.tb_hits++;
+        if (wdl == WDLScore::Win && TB_WIN - ply >= beta)
+          return TB_WIN - ply;
+        if (wdl == WDLScore::Loss && -TB_WIN + ply <= alpha)
+          return -TB_WIN + ply;
+        if (wdl != WDLScore::Win && wdl != WDLScore::Loss)
+          return 0;
+      }
+    }
+  }
+  if (ply >= MAX_SEARCH_PLY - 1)
+    return this->evaluate();
+
+  bool in_check = this->board.in_check();
+  if (in_check)
+    depth++;
+  if (depth <= 0)
+    return this->quiescence(alpha, beta, ply);
+
+  this->stats.nodes++;
+  this->check_limits();
+  if (this->stopped.load(std::memory_order_relaxed))
+    return 0;
+
+  Colours us = this->board.side_to_move();
+  bool pv_node = beta - alpha > 1;
+  const ZobristKey key = this->board.zobrist_key();
+  BazuuTTHit hit;
+  const bool tt_hit = this->tt && this->tt->probe(key, hit);
+  if (tt_hit && !pv_node && hit.depth >= depth) {
+    const std::int32_t tt_score = score_from_tt(hit.score, ply);
+    if (hit.bound == BazuuTTBound::Exact || (hit.bound == BazuuTTBound::Lower && tt_score >= beta) ||
+        (hit.bound == BazuuTTBound::Upper && tt_score <= alpha))
+      return tt_score;
+  }
+  const std::int32_t original_alpha = alpha;
+  std::int32_t static_eval = in_check ? -INFINITE : this->evaluate();
+
+  if (!pv_node && !in_check && std::abs(beta) < MATE_BOUND) {
+    // Reverse futility pruning: far enough above beta that a shallow search will not fall below it.
+    if (this->options.reverse_futility_pruning && depth <= REVERSE_FUTILITY_DEPTH &&
+        static_eval - REVERSE_FUTILITY_MARGIN * depth >= beta) {
+      this->stats.reverse_futility_cutoffs++;
+      return static_eval;
+    }
+    // Null move pruning, skipped with only pawns left where zugzwang is likely.
+    if (this->options.null_move_pruning && null_allowed && depth >= NULL_MOVE_DEPTH && static_eval >= beta &&
+        this->board.non_pawn_pieces[std::to_underlying(us)] > 0 && this->make_null_move(ply)) {
+      int r = 3 + depth / 4 + std::min<int>((static_eval - beta) / 200, 3);
+      std::int32_t score = -this->negamax(-beta, -beta + 1, depth - 1 - r, ply + 1, false);
+      this->unmake_null_move();
+      if (this->stopped.load(std::memory_order_relaxed))
+        return 0;
+      if (score >= beta) {
+        this->stats.null_move_cutoffs++;
+        return score >= MATE_BOUND ? beta : score;
+      }
+    }
+  }
+
+  BazuuMoveList list;
+  this->board.generate_moves(list);
+  BazuuMove previous_1 = ply >= 1 ? this->played[ply - 1] : BazuuMove{};
+  BazuuMove previous_2 = ply >= 2 ? this->played[ply - 2] : BazuuMove{};
+  const BazuuMove tt_move = tt_hit ? hit.move : BazuuMove{};
+  this->ordering->score_moves(list, us, ply, ply == 0 ? this->root_best_move : tt_move, previous_1, previous_2);
+
+  BazuuMove quiets_tried[BazuuMoveList::MAX_MOVES];
+  std::uint16_t quiet_count = 0;
+  std::uint16_t quiets_seen = 0; // Pruned ones included, quiets_tried only has the searched ones.
+  std::uint16_t legal_moves = 0;
+  std::int32_t best_score = -INFINITE;
+  BazuuMove best_move;
+  for (std::uint16_t i = 0; i < list.count; i++) {
+    BazuuMove move = BazuuMoveOrdering::pick_move(list, i);
+    bool quiet = move.is_quiet();
+    if (ply == 0 && !this->root_moves.empty() &&
+        std::find(this->root_moves.begin(), this->root_moves.end(), move) == this->root_moves.end())
+      continue;
+    if (ply == 0 && std::find(this->excluded_root_moves.begin(), this->excluded_root_moves.end(), move) !=
+                        this->excluded_root_moves.end())
+      continue;
+
+    if (quiet)
+      quiets_seen++;
+    if (!pv_node && !in_check && quiet && best_score > -MATE_BOUND) {
+      // Late move pruning: enough quiet moves came before this one at a shallow depth.
+      if (this->options.late_move_pruning && depth <= LATE_MOVE_PRUNING_DEPTH &&
+          quiets_seen > 3 + depth * depth) {
+        this->stats.late_move_prunes++;
+        continue;
+      }
+      // Futility pruning: a quiet move is unlikely to raise a hopeless static evaluation above alpha.
+      if (this->options.futility_pruning && depth <= FUTILITY_DEPTH &&
+          static_eval + FUTILITY_MARGIN * (depth + 1) <= alpha) {
+        this->stats.futility_prunes++;
+        continue;
+      }
+    }
+
+    if (!this->make_move(move, ply))
+      continue;
+    legal_moves++;
+
+    std::int32_t score;
+    if (legal_moves == 1) {
+      score = -this->negamax(-beta, -alpha, depth - 1, ply + 1, true);
+    } else {
+      int r = 0;
+      if (this->options.late_move_reductions && depth >= LMR_DEPTH && quiet && !in_check) {
+        r = reduction(depth, legal_moves) - pv_node;
+        r = std::clamp(r, 0, depth - 2);
+      }
+      if (r > 0)
+        this->stats.reduced_searches++;
+      score = -this->negamax(-alpha - 1, -alpha, depth - 1 - r, ply + 1, true);
+      if (r > 0 && score > alpha) {
+        this->stats.reduction_researches++;
+        score = -this->negamax(-alpha - 1, -alpha, depth - 1, ply + 1, true);
+      }
+      if (score > alpha && score < beta)
+        score = -this->negamax(-beta, -alpha, depth - 1, ply + 1, true);
+    }
+    this->unmake_move(move);
+    if (this->stopped.load(std::memory_order_relaxed))
+      return 0;
+
+    if (score > best_score) {
+      best_score = score;
+      if (score > alpha) {
+        alpha = score;
+        best_move = move;
+        this->update_pv(move, ply);
+        if (score >= beta) {
+          if (quiet)
+            this->ordering->update_quiet_histories(us, ply, std::min(depth, 255), move, quiets_tried, quiet_count,
+                                                   previous_1, previous_2);
+          break;
+        }
+      }
+    }
+    if (quiet)
+      quiets_tried[quiet_count++] = move;
+  }
+
+  if (legal_moves == 0)
+    return in_check ? -MATE + ply : 0;
+  // The root result is only for the whole position when no root move was left out.
+  if (this->tt && (ply > 0 || (this->root_moves.empty() && this->excluded_root_moves.empty()))) {
+    const BazuuTTBound bound = best_score >= beta             ? BazuuTTBound::Lower
+                               : best_score > original_alpha ? BazuuTTBound::Exact
+                                                             : BazuuTTBound::Upper;
+    this->tt->store(key, best_move, score_to_tt(best_score, ply), depth, bound);
+  }
+  return best_score;
+}
+
+/*
+ * Search captures and promotions until the position is quiet, all evasions when in check.
+ * @param alpha - lower bound of the window.
+ * @param beta - upper bound of the window.
+ * @param ply - distance from the root.
+ * @return score of the node from the side to move's point of view.
+ */
+std::int32_t BazuuSearch::quiescence(std::int32_t alpha, std::int32_t beta, std::uint16_t ply) {
+  BAZUU_TRACE_SCOPE(Quiescence);
+  this->stats.qnodes++;
+  this->check_limits();
+  if (this->stopped.load(std::memory_order_relaxed))
+    return 0;
+  if (ply >= MAX_SEARCH_PLY - 1)
+    return this->evaluate();
+
+  bool in_check = this->board.in_check();
+  std::int32_t best_score = -INFINITE;
+  if (!in_check) {
+    best_score = this->evaluate();
+    if (best_score >= beta)
+      return best_score;
+    alpha = std::max(alpha, best_score);
+  }
+
+  BazuuMoveList list;
+  if (in_check)
+    this->board.generate_moves(list);
+  else
+    this->board.generate_captures(list);
+  this->ordering->score_moves(list, this->board.side_to_move(), ply, BazuuMove{}, BazuuMove{}, BazuuMove{});
+
+  std::uint16_t legal_moves = 0;
+  for (std::uint16_t i = 0; i < list.count; i++) {
+    BazuuMove move = BazuuMoveOrdering::pick_move(list, i);
+    if (!this->make_move(move, ply))
+      continue;
+    legal_moves++;
+    std::int32_t score = -this->quiescence(-beta, -alpha, ply + 1);
+    this->unmake_move(move);
+    if (this->stopped.load(std::memory_order_relaxed))
+      return 0;
+    if (score > best_score) {
+      best_score = score;
+      if (score > alpha) {
+        alpha = score;
+        if (score >= beta)
+          break;
+      }
+    }
+  }
+  if (in_check && legal_moves == 0)
+    return -MATE + ply;
+  return best_score;
+}
@@ -0,0 +1,856 @@
+#include "bazuu_ce_tablebase.hpp"
+#include "bazuu_ce_board.hpp"
+#include "bazuu_ce_mapped_file.hpp"
+#include "defs.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The probing code follows the layout of the Syzygy files by Ronald de Man: each table is split by side to move and,
+// with pawns, by the file of the leading pawn. A position is turned into an index by placing pieces group by group
+// and the value at that index is decompressed from Huffman coded blocks of recursively paired symbols.
+
+static constexpr std::uint8_t WDL_MAGIC[4] = {0x71, 0xE8, 0x23, 0x5D};
+static constexpr std::uint8_t DTZ_MAGIC[4] = {0xD7, 0x66, 0x0C, 0xA5};
+static constexpr std::uint16_t NO_SYMBOL = 0xFFF;
+
+enum TableFlag : std::uint8_t { STM = 1, Mapped = 2, WinPlies = 4, LossPlies = 8, Wide = 16, SingleValue = 128 };
+
+template <typename T> static T read_le(const std::uint8_t *address) {
+  T value;
+  std::memcpy(&value, address, sizeof(T));
+  if constexpr (std::endian::native == std::endian::big)
+    value = std::byteswap(value);
+  return value;
+}
+
+template <typename T> static T read_be(const std::uint8_t *address) {
+  T value;
+  std::memcpy(&value, address, sizeof(T));
+  if constexpr (std::endian::native == std::endian::little)
+    value = std::byteswap(value);
+  return value;
+}
+
+static int rank_of(int square) { return square >> 3; }
+static int file_of(int square) { return square & 7; }
+static int off_a1h8(int square) { return rank_of(square) - file_of(square); }
+static int sign_of(int value) { return (value > 0) - (value < 0); }
+
+// Index tables of the position encoding, see the Syzygy generator for their derivation.
+struct Encoding {
+  int map_pawns[64] = {};
+  int map_b1h1h7[64] = {};
+  int map_a1d1d4[64] = {};
+  int map_kk[10][64] = {};
+  U64 binomial[6][64] = {};
+  int lead_pawn_idx[6][64] = {};
+  int lead_pawns_size[6][4] = {};
+};
+
+static const auto ENCODING = [] {
+  auto encoding = std::make_unique<Encoding>();
+  Encoding &e = *encoding;
+  // Squares below the a1-h8 diagonal to 0..27.
+  int code = 0;
+  for (int square = 0; square < 64; square++)
+    if (off_a1h8(square) < 0)
+      e.map_b1h1h7[square] = code++;
+
+  // Squares of the a1-d1-d4 triangle to 0..9, the diagonal ones last.
+  std::vector<int> diagonal;
+  code = 0;
+  for (int square = 0; square <= 27; square++) {
+    if (off_a1h8(square) < 0 && file_of(square) <= 3)
+      e.map_a1d1d4[square] = code++;
+    else if (!off_a1h8(square) && file_of(square) <= 3)
+      diagonal.push_back(square);
+  }
+  for (int square : diagonal)
+    e.map_a1d1d4[square] = code++;
+
+  // The 462 legal placements of two kings with the first one in the a1-d1-d4 triangle, with the first king on the
+  // diagonal the second is not above it. Both kings on the diagonal are encoded last.
+  std::vector<std::pair<int, int>> both_on_diagonal;
+  code = 0;
+  for (int idx = 0; idx < 10; idx++) {
+    for (int s1 = 0; s1 <= 27; s1++) {
+      if (e.map_a1d1d4[s1] != idx || (idx == 0 && s1 != 1))
+        continue;
+      for (int s2 = 0; s2 < 64; s2++) {
+        if (std::max(std::abs(file_of(s1) - file_of(s2)), std::abs(rank_of(s1) - rank_of(s2))) <= 1)
+          continue;
+        if (!off_a1h8(s1) && off_a1h8(s2) > 0)
+          continue;
+        if (!off_a1h8(s1) && !off_a1h8(s2))
+          both_on_diagonal.emplace_back(idx, s2);
+        else
+          e.map_kk[idx][s2] = code++;
+      }
+    }
+  }
+  for (auto [idx, s2] : both_on_diagonal)
+    e.map_kk[idx][s2] = code++;
+
+  e.binomial[0][0] = 1;
+  for (int n = 1; n < 64; n++)
+    for (int k = 0; k < 6 && k <= n; k++)
+      e.binomial[k][n] = (k > 0 ? e.binomial[k - 1][n - 1] : 0) + (k < n ? e.binomial[k][n - 1] : 0);
+
+  // map_pawns numbers a2-h7 so that the leading pawn, nearest to the edge and lowest, has the highest value.
+  int available_squares = 47;
+  for (int lead_pawns = 1; lead_pawns <= 5; lead_pawns++) {
+    for (int file = 0; file <= 3; file++) {
+      int idx = 0;
+      for (int rank = 1; rank <= 6; rank++) {
+        int square = rank * 8 + file;
+        if (lead_pawns == 1) {
+          e.map_pawns[square] = available_squares--;
+          e.map_pawns[square ^ 7] = available_squares--;
+        }
+        e.lead_pawn_idx[lead_pawns][square] = idx;
+        idx += e.binomial[lead_pawns - 1][e.map_pawns[square]];
+      }
+      e.lead_pawns_size[lead_pawns][file] = idx;
+    }
+  }
+  return encoding;
+}();
+
+/*
+ * Decoding data of one (side to move, leading file) part of a table, pointing into the mapped file.
+ */
+struct PairsData {
+  std::uint8_t flags = 0;
+  std::uint8_t max_symbol_length = 0;
+  std::uint8_t min_symbol_length = 0; // The stored value of single value tables.
+  std::uint32_t block_count = 0;
+  U64 block_size = 0;
+  U64 span = 0; // A sparse index entry about every span values.
+  // Little-endian 16-bit, lowest symbol of each code length.
+  const std::uint8_t *lowest_symbol = nullptr;
+  // 3 bytes per symbol: the 12-bit left and right symbols it expands to.
+  const std::uint8_t *btree = nullptr;
+  // Little-endian 16-bit, number of values minus one of each block.
+  const std::uint8_t *block_length = nullptr;
+  std::uint32_t block_length_size = 0;
+  // 6 bytes per entry: 32-bit block, 16-bit offset in it.
+  const std::uint8_t *sparse_index = nullptr;
+  U64 sparse_index_size = 0;
+  const std::uint8_t *data = nullptr;
+  std::vector<U64> base64;                 // Lowest code of each length, left aligned on 64 bits.
+  std::vector<std::uint8_t> symbol_length; // Number of values minus one a symbol expands to.
+  std::uint8_t pieces[BazuuTablebase::MAX_PIECES] = {};
+  U64 group_idx[BazuuTablebase::MAX_PIECES + 1] = {};
+  int group_length[BazuuTablebase::MAX_PIECES + 1] = {};
+  std::uint16_t map_idx[4] = {}; // Win, loss, cursed win, blessed loss offsets into the DTZ value map.
+
+  std::uint16_t left(std::uint16_t symbol) const {
+    const std::uint8_t *lr = this->btree + 3 * symbol;
+    return ((lr[1] & 0xF) << 8) | lr[0];
+  }
+  std::uint16_t right(std::uint16_t symbol) const {
+    const std::uint8_t *lr = this->btree + 3 * symbol;
+    return (lr[2] << 4) | (lr[1] >> 4);
+  }
+};
+
+struct BazuuTablebase::Table {
+  std::string path;
+  bool dtz = false;
+  U64 key = 0;  // Material key with the first side of the file name as White.
+  U64 key2 = 0; // Material key with the first side of the file name as Black.
+  std::uint8_t piece_count = 0;
+  bool has_pawns = false;
+  bool has_unique_pieces = false;
+  std::uint8_t pawn_count[2] = {}; // Leading colour first.
+  std::atomic<bool> ready = false;
+  std::mutex mutex;
+  BazuuMappedFile file;
+  PairsData items[2][4];
+  const std::uint8_t *map = nullptr;
+
+  int sides() const { return this->dtz ? 1 : 2; }
+  PairsData *get(int stm, int file) { return &this->items[stm % this->sides()][this->has_pawns ? file : 0]; }
+};
+
+static std::uint8_t tb_piece(Pieces piece) {
+  return std::to_underlying(piece_colour(piece)) * 8 + std::to_underlying(piece_type(piece)) + 1;
+}
+
+static std::uint8_t set_symbol_length(PairsData &d, std::uint16_t symbol, std::vector<bool> &visited) {
+  visited[symbol] = true;
+  std::uint16_t right = d.right(symbol);
+  if (right == NO_SYMBOL)
+    return 0;
+  std::uint16_t left = d.left(symbol);
+  if (!visited[left])
+    d.symbol_length[left] = set_symbol_length(d, left, visited);
+  if (!visited[right])
+    d.symbol_length[right] = set_symbol_length(d, right, visited);
+  return d.symbol_length[left] + d.symbol_length[right] + 1;
+}
+
+static const std::uint8_t *set_sizes(PairsData &d, const std::uint8_t *data) {
+  d.flags = *data++;
+  if (d.flags & TableFlag::SingleValue) {
+    d.min_symbol_length = *data++;
+    return data;
+  }
+  U64 table_size = d.group_idx[std::find(d.group_length, d.group_length + BazuuTablebase::MAX_PIECES, 0) -
+                               d.group_length];
+  d.block_size = 1ULL << *data++;
+  d.span = 1ULL << *data++;
+  d.sparse_index_size = (table_size + d.span - 1) / d.span;
+  std::uint8_t padding = *data++;
+  d.block_count = read_le<std::uint32_t>(data);
+  data += sizeof(std::uint32_t);
+  // Padded so a sparse index entry never points past the end.
+  d.block_length_size = d.block_count + padding;
+  d.max_symbol_length = *data++;
+  d.min_symbol_length = *data++;
+  d.lowest_symbol = data;
+  d.base64.assign(d.max_symbol_length - d.min_symbol_length + 1, 0);
+
+  // Canonical Huffman code: longer codes have lower values, base64[i] is the lowest code of length
+  // min_symbol_length + i, padded on the right to 64 bits.
+  for (int i = static_cast<int>(d.base64.size()) - 2; i >= 0; i--)
+    d.base64[i] = (d.base64[i + 1] + read_le<std::uint16_t>(d.lowest_symbol + 2 * i) -
+                   read_le<std::uint16_t>(d.lowest_symbol + 2 * (i + 1))) /
+                  2;
+  for (std::size_t i = 0; i < d.base64.size(); i++)
+    d.base64[i] <<= 64 - i - d.min_symbol_length;
+
+  data += d.base64.size() * sizeof(std::uint16_t);
+  d.symbol_length.assign(read_le<std::uint16_t>(data), 0);
+  data += sizeof(std::uint16_t);
+  d.btree = data;
+
+  std::vector<bool> visited(d.symbol_length.size());
+  for (std::uint16_t symbol = 0; symbol < d.symbol_length.size(); symbol++)
+    if (!visited[symbol])
+      d.symbol_length[symbol] = set_symbol_length(d, symbol, visited);
+  return data + d.symbol_length.size() * 3 + (d.symbol_length.size() & 1);
+}
+
+/*
+ * Split the pieces into groups and compute the index multiplier of each group.
+ */
+static void set_groups(BazuuTablebase::Table &table, PairsData &d, const int order[2], int file) {
+  int n = 0;
+  int first_length = table.has_pawns ? 0 : table.has_unique_pieces ? 3 : 2;
+  d.group_length[n] = 1;
+  // Pieces of the same kind are one group, the leading group is the leading pawns or the first 2 or 3 pieces.
+  for (int i = 1; i < table.piece_count; i++) {
+    if (--first_length > 0 || d.pieces[i] == d.pieces[i - 1])
+      d.group_length[n]++;
+    else
+      d.group_length[++n] = 1;
+  }
+  d.group_length[++n] = 0;
+
+  // The index is g1 * N(g2) * N(g3) + g2 * N(g3) + g3 where the order of the groups is given by the table.
+  bool both_have_pawns = table.has_pawns && table.pawn_count[1];
+  int next = both_have_pawns ? 2 : 1;
+  int free_squares = 64 - d.group_length[0] - (both_have_pawns ? d.group_length[1] : 0);
+  U64 idx = 1;
+  for (int k = 0; next < n || k == order[0] || k == order[1]; k++) {
+    if (k == order[0]) {
+      d.group_idx[0] = idx;
+      idx *= table.has_pawns           ? ENCODING->lead_pawns_size[d.group_length[0]][file]
+             : table.has_unique_pieces ? 31332
+                                       : 462;
+    } else if (k == order[1]) {
+      d.group_idx[1] = idx;
+      idx *= ENCODING->binomial[d.group_length[1]][48 - d.group_length[0]];
+    } else {
+      d.group_idx[next] = idx;
+      idx *= ENCODING->binomial[d.group_length[next]][free_squares];
+      free_squares -= d.group_length[next++];
+    }
+  }
+  d.group_idx[n] = idx;
+}
+
+static const std::uint8_t *set_dtz_map(BazuuTablebase::Table &table, const std::uint8_t *data, int max_file) {
+  table.map = data;
+  for (int file = 0; file <= max_file; file++) {
+    PairsData &d = *table.get(0, file);
+    if (!(d.flags & TableFlag::Mapped))
+      continue;
+    if (d.flags & TableFlag::Wide) {
+      data += reinterpret_cast<std::uintptr_t>(data) & 1;
+      for (int i = 0; i < 4; i++) {
+        d.map_idx[i] = static_cast<std::uint16_t>((data - table.map) / 2 + 1);
+        data += 2 * read_le<std::uint16_t>(data) + 2;
+      }
+    } else {
+      for (int i = 0; i < 4; i++) {
+        d.map_idx[i] = static_cast<std::uint16_t>(data - table.map + 1);
+        data += *data + 1;
+      }
+    }
+  }
+  return data + (reinterpret_cast<std::uintptr_t>(data) & 1);
+}
+
+/*
+ * Point the decoding data of a table into its just mapped file.
+ * @return false if the file is shorter than its header says.
+ */
+static bool set_table(BazuuTablebase::Table &table) {
+  const std::uint8_t *data = table.file.data() + 4;
+  data++; // Split and pawn flags, already known from the file name.
+  int sides = table.dtz ? 1 : (table.key != table.key2 ? 2 : 1);
+  int max_file = table.has_pawns ? 3 : 0;
+  bool both_have_pawns = table.has_pawns && table.pawn_count[1];
+
+  for (int file = 0; file <= max_file; file++) {
+    for (int i = 0; i < sides; i++)
+      *table.get(i, file) = PairsData{};
+    int order[2][2] = {{*data & 0xF, both_have_pawns ? *(data + 1) & 0xF : 0xF},
+                       {*data >> 4, both_have_pawns ? *(data + 1) >> 4 : 0xF}};
+    data += 1 + both_have_pawns;
+    for (int k = 0; k < table.piece_count; k++, data++)
+      for (int i = 0; i < sides; i++)
+        table.get(i, file)->pieces[k] = i ? *data >> 4 : *data & 0xF;
+    for (int i = 0; i < sides; i++)
+      set_groups(table, *table.get(i, file), order[i], file);
+  }
+  data += reinterpret_cast<std::uintptr_t>(data) & 1;
+
+  for (int file = 0; file <= max_file; file++)
+    for (int i = 0; i < sides; i++)
+      data = set_sizes(*table.get(i, file), data);
+  if (table.dtz)
+    data = set_dtz_map(table, data, max_file);
+  for (int file = 0; file <= max_file; file++)
+    for (int i = 0; i < sides; i++) {
+      table.get(i, file)->sparse_index = data;
+      data += table.get(i, file)->sparse_index_size * 6;
+    }
+  for (int file = 0; file <= max_file; file++)
+    for (int i = 0; i < sides; i++) {
+      table.get(i, file)->block_length = data;
+      data += table.get(i, file)->block_length_size * sizeof(std::uint16_t);
+    }
+  for (int file = 0; file <= max_file; file++)
+    for (int i = 0; i < sides; i++) {
+      data = reinterpret_cast<const std::uint8_t *>((reinterpret_cast<std::uintptr_t>(data) + 0x3F) & ~0x3FULL);
+      table.get(i, file)->data = data;
+      data += table.get(i, file)->block_count * table.get(i, file)->block_size;
+    }
+  return data <= table.file.data() + table.file.size();
+}
+
+/*
+ * Map the file of a table on first use, the lock is only taken until the table is ready.
+ * @return true if the table can be probed.
+ */
+static bool mapped(BazuuTablebase::Table &table) {
+  if (table.ready.load(std::memory_order_acquire))
+    return table.file.is_open();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  if (table.ready.load(std::memory_order_relaxed))
+    return table.file.is_open();
+  const std::uint8_t *magic = table.dtz ? DTZ_MAGIC : WDL_MAGIC;
+  if (table.file.open(table.path) &&
+      (table.file.size() < 16 || std::memcmp(table.file.data(), magic, 4) != 0 || !set_table(table)))
+    table.file.close();
+  table.ready.store(true, std::memory_order_release);
+  return table.file.is_open();
+}
+
+/*
+ * Get the value stored at the index of a part of a table.
+ */
+static int decompress_pairs(const PairsData &d, U64 idx) {
+  if (d.flags & TableFlag::SingleValue)
+    return d.min_symbol_length;
+
+  // The sparse index points near the block of idx, the block lengths find the exact block.
+  std::uint32_t k = static_cast<std::uint32_t>(idx / d.span);
+  std::uint32_t block = read_le<std::uint32_t>(d.sparse_index + 6 * k);
+  int offset = read_le<std::uint16_t>(d.sparse_index + 6 * k + 4);
+  offset += static_cast<int>(idx % d.span) - static_cast<int>(d.span / 2);
+  while (offset < 0)
+    offset += read_le<std::uint16_t>(d.block_length + 2 * --block) + 1;
+  while (offset > read_le<std::uint16_t>(d.block_length + 2 * block))
+    offset -= read_le<std::uint16_t>(d.block_length + 2 * block++) + 1;
+
+  const std::uint8_t *ptr = d.data + static_cast<U64>(block) * d.block_size;
+  U64 buf64 = read_be<U64>(ptr);
+  ptr += 8;
+  int buf64_size = 64;
+  std::uint16_t symbol;
+  while (true) {
+    int length = 0;
+    while (buf64 < d.base64[length])
+      length++;
+    symbol = static_cast<std::uint16_t>((buf64 - d.base64[length]) >> (64 - length - d.min_symbol_length));
+    symbol += read_le<std::uint16_t>(d.lowest_symbol + 2 * length);
+    if (offset < d.symbol_length[symbol] + 1)
+      break;
+    offset -= d.symbol_length[symbol] + 1;
+    length += d.min_symbol_length;
+    buf64 <<= length;
+    buf64_size -= length;
+    if (buf64_size <= 32) {
+      buf64_size += 32;
+      buf64 |= static_cast<U64>(read_be<std::uint32_t>(ptr)) << (64 - buf64_size);
+      ptr += 4;
+    }
+  }
+  // Expand the pairs down to the value at offset.
+  while (d.symbol_length[symbol]) {
+    std::uint16_t left = d.left(symbol);
+    if (offset < d.symbol_length[left] + 1) {
+      symbol = left;
+    } else {
+      offset -= d.symbol_length[left] + 1;
+      symbol = d.right(symbol);
+    }
+  }
+  return d.left(symbol);
+}
+
+/*
+ * Convert a stored DTZ value to plies.
+ */
+static int map_dtz(BazuuTablebase::Table &table, int file, int value, WDLScore wdl) {
+  static constexpr int WDL_MAP[] = {1, 3, 0, 2, 0};
+  const PairsData &d = *table.get(0, file);
+  if (d.flags & TableFlag::Mapped) {
+    std::uint16_t idx = d.map_idx[WDL_MAP[std::to_underlying(wdl) + 2]];
+    if (d.flags & TableFlag::Wide)
+      value = read_le<std::uint16_t>(table.map + 2 * (idx + value));
+    else
+      value = table.map[idx + value];
+  }
+  if ((wdl == WDLScore::Win && !(d.flags & TableFlag::WinPlies)) ||
+      (wdl == WDLScore::Loss && !(d.flags & TableFlag::LossPlies)) || wdl == WDLScore::CursedWin ||
+      wdl == WDLScore::BlessedLoss)
+    value *= 2;
+  return value + 1;
+}
+
+/*
+ * The DTZ of the move before a capture or pawn move, DTZ tables do not store those.
+ */
+static int dtz_before_zeroing(WDLScore wdl) {
+  switch (wdl) {
+  case WDLScore::Win:
+    return 1;
+  case WDLScore::CursedWin:
+    return 101;
+  case WDLScore::BlessedLoss:
+    return -101;
+  case WDLScore::Loss:
+    return -1;
+  default:
+    return 0;
+  }
+}
+
+static WDLScore negate(WDLScore wdl) { return static_cast<WDLScore>(-std::to_underlying(wdl)); }
+
+static bool has_legal_move(BazuuBoard &board) {
+  BazuuMoveList list;
+  board.generate_moves(list);
+  for (std::uint16_t i = 0; i < list.count; i++) {
+    if (board.make_move(list.moves[i])) {
+      board.unmake_move(list.moves[i]);
+      return true;
+    }
+  }
+  return false;
+}
+
+BazuuTablebase::BazuuTablebase() = default;
+BazuuTablebase::~BazuuTablebase() = default;
+
+/*
+ * Get the material key of a position, the count of every non king piece.
+ * @param pieces_on_board - number of pieces of each kind indexed by Pieces.
+ * @param mirror - swap the colours.
+ * @return the material key.
+ */
+U64 BazuuTablebase::material_key(const std::uint16_t pieces_on_board[13], bool mirror) {
+  U64 key = 0;
+  for (Colours colour : {Colours::White, Colours::Black}) {
+    int side = std::to_underlying(colour) ^ mirror;
+    for (int piece = std::to_underlying(PieceType::P); piece < std::to_underlying(PieceType::K); piece++) {
+      U64 count = pieces_on_board[std::to_underlying(to_piece(colour, static_cast<PieceType>(piece)))];
+      key |= count << ((side * 5 + piece) * 4);
+    }
+  }
+  return key;
+}
+
+/*
+ * List the tables of a directory, files named like KRPvKR.rtbw and KRPvKR.rtbz. Nothing is mapped yet.
+ * @param directory - directory of the table files.
+ * @return number of WDL tables found.
+ */
+std::size_t BazuuTablebase::init(const std::string &directory) {
+  this->tables.clear();
+  this->wdl_tables.clear();
+  this->dtz_tables.clear();
+  this->cardinality = 0;
+  std::error_code error;
+  std::size_t wdl_count = 0;
+  for (const auto &entry : std::filesystem::directory_iterator(directory, error)) {
+    std::string extension = entry.path().extension().string();
+    if (extension != ".rtbw" && extension != ".rtbz")
+      continue;
+    std::string code = entry.path().stem().string();
+    std::size_t separator = code.find('v');
+    if (separator == std::string::npos || code.size() > MAX_PIECES + 1)
+      continue;
+
+    std::uint16_t counts[13] = {};
+    bool valid = code.front() == 'K' && code[separator + 1] == 'K';
+    for (std::size_t i = 0; i < code.size() && valid; i++) {
+      if (i == separator)
+        continue;
+      Colours colour = i < separator ? Colours::White : Colours::Black;
+      const char *letter = std::strchr("PNBRQK", code[i]);
+      valid = letter && *letter;
+      if (valid)
+        counts[std::to_underlying(to_piece(colour, static_cast<PieceType>(letter - "PNBRQK")))]++;
+    }
+    if (!valid)
+      continue;
+
+    auto table = std::make_unique<Table>();
+    table->path = entry.path().string();
+    table->dtz = extension == ".rtbz";
+    table->key = material_key(counts, false);
+    table->key2 = material_key(counts, true);
+    table->piece_count = code.size() - 1;
+    std::uint16_t pawns[2] = {counts[std::to_underlying(Pieces::wP)], counts[std::to_underlying(Pieces::bP)]};
+    table->has_pawns = pawns[0] + pawns[1] > 0;
+    for (int piece = std::to_underlying(Pieces::wP); piece <= std::to_underlying(Pieces::bK); piece++)
+      if (piece_type(static_cast<Pieces>(piece)) != PieceType::K && counts[piece] == 1)
+        table->has_unique_pieces = true;
+    // The leading colour is the one with fewer pawns, when both have some.
+    bool white_leads = !pawns[1] || (pawns[0] && pawns[1] >= pawns[0]);
+    table->pawn_count[0] = white_leads ? pawns[0] : pawns[1];
+    table->pawn_count[1] = white_leads ? pawns[1] : pawns[0];
+
+    auto &registry = table->dtz ? this->dtz_tables : this->wdl_tables;
+    registry[table->key] = table.get();
+    registry[table->key2] = table.get();
+    if (!table->dtz) {
+      wdl_count++;
+      this->cardinality = std::max(this->cardinality, table->piece_count);
+    }
+    this->tables.push_back(std::move(table));
+  }
+  return wdl_count;
+}
+
+/*
+ * Get the number of table files mapped so far.
+ */
+std::size_t BazuuTablebase::mapped_tables() const {
+  return std::count_if(this->tables.begin(), this->tables.end(), [](const std::unique_ptr<Table> &table) {
+    return table->ready.load(std::memory_order_acquire) && table->file.is_open();
+  });
+}
+
+/*
+ * Look up the position in its WDL or DTZ table, without resolving captures.
+ * @param board - the position, castling rights are not supported.
+ * @param dtz - probe the DTZ table.
+ * @param state - set to Fail if there is no usable table, ChangeSideToMove if the DTZ table is for the other side.
+ * @param wdl - WDL score of the position, needed to decode DTZ values.
+ * @return the WDL score as an int or the DTZ in plies.
+ */
+int BazuuTablebase::probe_table(BazuuBoard &board, bool dtz, ProbeState &state, WDLScore wdl) {
+  BitBoard occupied = board.occupancy();
+  if (std::popcount(occupied) == 2)
+    return 0;
+  U64 key = material_key(board.pieces_on_board, false);
+  auto &registry = dtz ? this->dtz_tables : this->wdl_tables;
+  auto found = registry.find(key);
+  if (found == registry.end() || !mapped(*found->second)) {
+    state = ProbeState::Fail;
+    return 0;
+  }
+  Table &table = *found->second;
+
+  int squares[MAX_PIECES];
+  std::uint8_t pieces[MAX_PIECES];
+  int size = 0;
+  int lead_pawns_count = 0;
+  BitBoard lead_pawns = 0;
+  int tb_file = 0;
+  U64 idx;
+
+  // Tables store the stronger side as White and symmetric tables only White to move, other positions are looked up
+  // with the colours swapped and the board flipped.
+  bool black_to_move = board.side_to_move() == Colours::Black;
+  bool flip = (table.key == table.key2 && black_to_move) || key != table.key;
+  int flip_colour = flip * 8;
+  int flip_squares = flip * 56;
+  int stm = flip ^ black_to_move;
+
+  auto pawns_compare = [](int a, int b) { return ENCODING->map_pawns[a] < ENCODING->map_pawns[b]; };
+  if (table.has_pawns) {
+    // The leading pawns are the first pieces of every part, the one with the highest map_pawns selects the part.
+    std::uint8_t lead_piece = table.get(0, 0)->pieces[0] ^ flip_colour;
+    Colours lead_colour = lead_piece >= 8 ? Colours::Black : Colours::White;
+    lead_pawns = board.get_bitboard_of_piece(PieceType::P, lead_colour);
+    for (BitBoard b = lead_pawns; b; b &= b - 1)
+      squares[size++] = std::countr_zero(b) ^ flip_squares;
+    lead_pawns_count = size;
+    std::swap(squares[0], *std::max_element(squares, squares + lead_pawns_count, pawns_compare));
+    tb_file = std::min(file_of(squares[0]), 7 - file_of(squares[0]));
+  }
+
+  if (dtz && !((table.get(stm, tb_file)->flags & TableFlag::STM) == stm ||
+               (table.key == table.key2 && !table.has_pawns))) {
+    state = ProbeState::ChangeSideToMove;
+    return 0;
+  }
+
+  for (BitBoard b = occupied ^ lead_pawns; b; b &= b - 1) {
+    int square = std::countr_zero(b);
+    squares[size] = square ^ flip_squares;
+    pieces[size++] = tb_piece(board.piece_on_square(square)) ^ flip_colour;
+  }
+  PairsData &d = *table.get(stm, tb_file);
+
+  // Order the pieces like the table does.
+  for (int i = lead_pawns_count; i < size - 1; i++)
+    for (int j = i + 1; j < size; j++)
+      if (d.pieces[i] == pieces[j]) {
+        std::swap(pieces[i], pieces[j]);
+        std::swap(squares[i], squares[j]);
+        break;
+      }
+
+  // The leading piece goes to the queen side.
+  if (file_of(squares[0]) > 3)
+    for (int i = 0; i < size; i++)
+      squares[i] ^= 7;
+
+  if (table.has_pawns) {
+    idx = ENCODING->lead_pawn_idx[lead_pawns_count][squares[0]];
+    std::stable_sort(squares + 1, squares + lead_pawns_count, pawns_compare);
+    for (int i = 1; i < lead_pawns_count; i++)
+      idx += ENCODING->binomial[i][ENCODING->map_pawns[squares[i]]];
+  } else {
+    // Without pawns the leading piece also goes below rank 5 and below the a1-h8 diagonal.
+    if (rank_of(squares[0]) > 3)
+      for (int i = 0; i < size; i++)
+        squares[i] ^= 56;
+    for (int i = 0; i < d.group_length[0]; i++) {
+      if (!off_a1h8(squares[i]))
+        continue;
+      if (off_a1h8(squares[i]) > 0)
+        for (int j = i; j < size; j++)
+          squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+      break;
+    }
+
+    if (table.has_unique_pieces) {
+      // The first three pieces together: 10 squares for the first one in the triangle, then 63 and 62.
+      int adjust1 = squares[1] > squares[0];
+      int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+      if (off_a1h8(squares[0]))
+        idx = (ENCODING->map_a1d1d4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] - adjust2;
+      else if (off_a1h8(squares[1]))
+        idx = (6 * 63 + rank_of(squares[0]) * 28 + ENCODING->map_b1h1h7[squares[1]]) * 62 + squares[2] - adjust2;
+      else if (off_a1h8(squares[2]))
+        idx = 6 * 63 * 62 + 4 * 28 * 62 + rank_of(squares[0]) * 7 * 28 + (rank_of(squares[1]) - adjust1) * 28 +
+              ENCODING->map_b1h1h7[squares[2]];
+      else
+        idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + rank_of(squares[0]) * 7 * 6 +
+              (rank_of(squares[1]) - adjust1) * 6 + (rank_of(squares[2]) - adjust2);
+    } else {
+      idx = ENCODING->map_kk[ENCODING->map_a1d1d4[squares[0]]][squares[1]];
+    }
+  }
+
+  // The remaining groups, each one placed on the squares left by the groups before it.
+  idx *= d.group_idx[0];
+  int *group_squares = squares + d.group_length[0];
+  bool remaining_pawns = table.has_pawns && table.pawn_count[1];
+  for (int next = 1; d.group_length[next]; next++) {
+    std::stable_sort(group_squares, group_squares + d.group_length[next]);
+    U64 n = 0;
+    for (int i = 0; i < d.group_length[next]; i++) {
+      int adjust = std::count_if(squares, group_squares, [&](int square) { return group_squares[i] > square; });
+      n += ENCODING->binomial[i + 1][group_squares[i] - adjust - 8 * remaining_pawns];
+    }
+    remaining_pawns = false;
+    idx += n * d.group_idx[next];
+    group_squares += d.group_length[next];
+  }
+
+  int value = decompress_pairs(d, idx);
+  return dtz ? map_dtz(table, tb_file, value, wdl) : value - 2;
+}
+
+/*
+ * Resolve the captures (and pawn moves for DTZ) the tables treat as "don't care" and probe the position.
+ * @param check_zeroing_moves - also search pawn moves.
+ */
+WDLScore BazuuTablebase::search(BazuuBoard &board, ProbeState &state, bool check_zeroing_moves) {
+  WDLScore best = WDLScore::Loss;
+  std::uint16_t move_count = 0;
+  bool has_other_move = false;
+  BazuuMoveList list;
+  board.generate_moves(list);
+  for (std::uint16_t i = 0; i < list.count; i++) {
+    BazuuMove move = list.moves[i];
+    if (!move.is_capture() && (!check_zeroing_moves || piece_type(move.piece()) != PieceType::P)) {
+      // Only needed to know whether every legal move was searched.
+      if (!has_other_move && board.make_move(move)) {
+        board.unmake_move(move);
+        has_other_move = true;
+      }
+      continue;
+    }
+    if (!board.make_move(move))
+      continue;
+    move_count++;
+    WDLScore value = negate(this->search(board, state, false));
+    board.unmake_move(move);
+    if (state == ProbeState::Fail)
+      return WDLScore::Draw;
+    if (value > best) {
+      best = value;
+      if (value >= WDLScore::Win) {
+        state = ProbeState::ZeroingBestMove;
+        return value;
+      }
+    }
+  }
+
+  // With only captures searched there is nothing to probe, the stored value could be wrong (e.g. en passant).
+  bool no_more_moves = move_count && !has_other_move;
+  WDLScore value = best;
+  if (!no_more_moves) {
+    value = static_cast<WDLScore>(this->probe_table(board, false, state));
+    if (state == ProbeState::Fail)
+      return WDLScore::Draw;
+  }
+  if (best >= value) {
+    state = best > WDLScore::Draw || no_more_moves ? ProbeState::ZeroingBestMove : ProbeState::Ok;
+    return best;
+  }
+  state = ProbeState::Ok;
+  return value;
+}
+
+/*
+ * Probe the WDL tables.
+ * @param board - the position, castling rights are not supported.
+ * @param state - set to Fail if the result can not be trusted.
+ * @return the WDL score of the side to move.
+ */
+WDLScore BazuuTablebase::probe_wdl(BazuuBoard &board, ProbeState &state) {
+  state = ProbeState::Ok;
+  return this->search(board, state, false);
+}
+
+/*
+ * Probe the DTZ tables.
+ * @param board - the position, castling rights are not supported.
+ * @param state - set to Fail if the result can not be trusted.
+ * @return plies to the next capture or pawn move on the optimal path, positive when winning, 0 for a draw.
+ */
+int BazuuTablebase::probe_dtz(BazuuBoard &board, ProbeState &state) {
+  state = ProbeState::Ok;
+  WDLScore wdl = this->search(board, state, true);
+  if (state == ProbeState::Fail || wdl == WDLScore::Draw)
+    return 0;
+  if (state == ProbeState::ZeroingBestMove)
+    return dtz_before_zeroing(wdl);
+
+  int dtz = this->probe_table(board, true, state, wdl);
+  if (state == ProbeState::Fail)
+    return 0;
+  if (state != ProbeState::ChangeSideToMove)
+    return (dtz + 100 * (wdl == WDLScore::BlessedLoss || wdl == WDLScore::CursedWin)) *
+           sign_of(std::to_underlying(wdl));
+
+  // The table is stored for the other side: a one ply search for the winning move with the lowest DTZ.
+  int min_dtz = 0xFFFF;
+  BazuuMoveList list;
+  board.generate_moves(list);
+  for (std::uint16_t i = 0; i < list.count; i++) {
+    BazuuMove move = list.moves[i];
+    bool zeroing = move.is_capture() || piece_type(move.piece()) == PieceType::P;
+    if (!board.make_move(move))
+      continue;
+    dtz = zeroing ? -dtz_before_zeroing(this->search(board, state, false)) : -this->probe_dtz(board, state);
+    if (dtz == 1 && board.in_check() && !has_legal_move(board))
+      min_dtz = 1;
+    if (!zeroing)
+      dtz += sign_of(dtz);
+    if (dtz < min_dtz && sign_of(dtz) == sign_of(std::to_underlying(wdl)))
+      min_dtz = dtz;
+    board.unmake_move(move);
+    if (state == ProbeState::Fail)
+      return 0;
+  }
+  return min_dtz == 0xFFFF ? -1 : min_dtz;
+}
+
+/*
+ * Keep only the root moves that preserve the best DTZ result, certain wins are ranked equally.
+ * @param board - the root position.
+ * @param root_moves - the legal root moves, filtered in place.
+ * @return false if a table is missing, root_moves is then unchanged.
+ */
+bool BazuuTablebase::root_probe(BazuuBoard &board, std::vector<BazuuMove> &root_moves) {
+  ProbeState state = ProbeState::Ok;
+  int rule50 = board.halfmove_clock();
+  bool repeated = board.is_repetition(std::numeric_limits<std::uint16_t>::max());
+  std::vector<int> ranks;
+  ranks.reserve(root_moves.size());
+  for (BazuuMove move : root_moves) {
+    board.make_move(move);
+    int dtz;
+    if (board.halfmove_clock() == 0) {
+      dtz = dtz_before_zeroing(negate(this->probe_wdl(board, state)));
+    } else if (board.is_repetition(1) || board.halfmove_clock() >= 100) {
+      dtz = 0;
+    } else {
+      dtz = -this->probe_dtz(board, state);
+      dtz = dtz > 0 ? dtz + 1 : dtz < 0 ? dtz - 1 : dtz;
+    }
+    if (dtz == 2 && board.in_check() && !has_legal_move(board))
+      dtz = 1;
+    board.unmake_move(move);
+    if (state == ProbeState::Fail)
+      return false;
+    // Wins that are safe from the fifty move rule rank equally, losses hold out as long as possible.
+    int rank = dtz > 0   ? (dtz + rule50 <= 99 && !repeated ? MAX_DTZ : MAX_DTZ - (dtz + rule50))
+               : dtz < 0 ? (-dtz * 2 + rule50 < 100 ? -MAX_DTZ : -MAX_DTZ + (-dtz + rule50))
+                         : 0;
+    ranks.push_back(rank);
+  }
+  if (ranks.empty())
+    return false;
+  int best = *std::max_element(ranks.begin(), ranks.end());
+  std::size_t kept = 0;
+  for (std::size_t i = 0; i < root_moves.size(); i++)
+    if (ranks[i] == best)
+      root_moves[kept++] = root_moves[i];
+  root_moves.resize(kept);
+  return true;
+}
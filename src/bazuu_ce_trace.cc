@@ -0,0 +1,155 @@
+#include "bazuu_ce_trace.hpp"
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <format>
+#include <map>
+#include <string>
+#include <utility>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BAZUU_TRACE_X86 1
+#else
+#define BAZUU_TRACE_X86 0
+#endif
+
+static constexpr const char *ZONE_NAMES[std::to_underlying(BazuuTraceZone::Count)] = {
+    "search", "quiescence", "movegen", "make_move", "unmake_move", "eval", "eval_cache_probe", "attacks", "tt_probe"};
+
+/*
+ * Time of each stack of zones seen by a thread. A stack is a path of 4 bit zone numbers plus one, the outermost zone
+ * in the highest bits. Only the owning thread writes, the relaxed atomics let write_folded() read without tearing.
+ */
+struct BazuuTraceBuffer {
+  static constexpr std::size_t SIZE = 1024; // Power of two, far more than the distinct stacks of the engine.
+  struct Entry {
+    std::atomic<std::uint64_t> path{0};
+    std::atomic<std::uint64_t> ticks{0};
+  };
+  Entry entries[SIZE];
+  std::atomic<std::uint64_t> dropped{0}; // Ticks of stacks that found the buffer full.
+  BazuuTraceBuffer *next = nullptr;
+  // Stack of the running scopes of the thread.
+  std::uint64_t path = 0;
+  std::uint8_t depth = 0;
+  std::uint64_t child_ticks[BazuuTrace::MAX_DEPTH + 1] = {};
+
+  void add(std::uint64_t stack, std::uint64_t ticks) {
+    std::size_t i = (stack * 0x9E3779B97F4A7C15ULL) >> (64 - std::countr_zero(SIZE));
+    for (std::size_t probes = 0; probes < SIZE; probes++, i = (i + 1) & (SIZE - 1)) {
+      const std::uint64_t entry_path = this->entries[i].path.load(std::memory_order_relaxed);
+      if (entry_path == 0)
+        this->entries[i].path.store(stack, std::memory_order_relaxed);
+      if (entry_path == 0 || entry_path == stack) {
+        this->entries[i].ticks.store(this->entries[i].ticks.load(std::memory_order_relaxed) + ticks,
+                                     std::memory_order_relaxed);
+        return;
+      }
+    }
+    this->dropped.store(this->dropped.load(std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+  }
+};
+
+// Buffers of every thread that opened a scope. They are never freed, the times of a thread outlive it.
+static std::atomic<BazuuTraceBuffer *> buffers{nullptr};
+
+static BazuuTraceBuffer &thread_buffer() {
+  thread_local BazuuTraceBuffer *buffer = [] {
+    auto *created = new BazuuTraceBuffer();
+    created->next = buffers.load(std::memory_order_relaxed);
+    while (!buffers.compare_exchange_weak(created->next, created, std::memory_order_release,
+                                          std::memory_order_relaxed)) {
+    }
+    return created;
+  }();
+  return *buffer;
+}
+
+const char *BazuuTrace::zone_name(BazuuTraceZone zone) { return ZONE_NAMES[std::to_underlying(zone)]; }
+
+/*
+ * Read the clock of the scopes.
+ * @return time stamp counter ticks on x86, nanoseconds of the monotonic clock elsewhere.
+ */
+std::uint64_t BazuuTrace::now() {
+#if BAZUU_TRACE_X86
+  return __rdtsc();
+#else
+  timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return static_cast<std::uint64_t>(time.tv_sec) * 1000000000ULL + time.tv_nsec;
+#endif
+}
+
+/*
+ * Write the time of each stack of zones of all the threads, one "outer;inner ticks" line per stack.
+ * @param output - receives the folded stacks.
+ */
+void BazuuTrace::write_folded(std::ostream &output) {
+  std::map<std::string, std::uint64_t> stacks;
+  std::uint64_t dropped = 0;
+  for (BazuuTraceBuffer *buffer = buffers.load(std::memory_order_acquire); buffer; buffer = buffer->next) {
+    for (const BazuuTraceBuffer::Entry &entry : buffer->entries) {
+      const std::uint64_t path = entry.path.load(std::memory_order_relaxed);
+      const std::uint64_t ticks = entry.ticks.load(std::memory_order_relaxed);
+      if (path == 0 || ticks == 0)
+        continue;
+      std::string stack;
+      for (int shift = 60; shift >= 0; shift -= 4) {
+        const std::uint64_t zone = (path >> shift) & 0xF;
+        if (zone == 0)
+          continue;
+        if (!stack.empty())
+          stack += ';';
+        stack += ZONE_NAMES[zone - 1];
+      }
+      stacks[stack] += ticks;
+    }
+    dropped += buffer->dropped.load(std::memory_order_relaxed);
+  }
+  for (const auto &[stack, ticks] : stacks)
+    output << std::format("{} {}\n", stack, ticks);
+  if (dropped)
+    output << std::format("dropped {}\n", dropped);
+}
+
+/*
+ * Forget the times recorded so far, while the traced threads are idle.
+ */
+void BazuuTrace::reset() {
+  for (BazuuTraceBuffer *buffer = buffers.load(std::memory_order_acquire); buffer; buffer = buffer->next) {
+    for (BazuuTraceBuffer::Entry &entry : buffer->entries) {
+      entry.path.store(0, std::memory_order_relaxed);
+      entry.ticks.store(0, std::memory_order_relaxed);
+    }
+    buffer->dropped.store(0, std::memory_order_relaxed);
+  }
+}
+
+/*
+ * Start timing a zone, nested in the scopes the thread is running.
+ * @param zone - the instrumented zone.
+ */
+BazuuTraceScope::BazuuTraceScope(BazuuTraceZone zone) {
+  BazuuTraceBuffer &buffer = thread_buffer();
+  const std::uint64_t zone_bits = std::to_underlying(zone) + 1;
+  // Recursion stays in one frame, and stacks too deep for the path are charged to their deepest zone.
+  if ((buffer.path & 0xF) == zone_bits || buffer.depth == BazuuTrace::MAX_DEPTH)
+    return;
+  this->parent_path = buffer.path;
+  buffer.path = (buffer.path << 4) | zone_bits;
+  buffer.child_ticks[++buffer.depth] = 0;
+  this->start = BazuuTrace::now();
+}
+
+BazuuTraceScope::~BazuuTraceScope() {
+  if (this->start == 0)
+    return;
+  const std::uint64_t elapsed = BazuuTrace::now() - this->start;
+  BazuuTraceBuffer &buffer = thread_buffer();
+  buffer.add(buffer.path, elapsed - buffer.child_ticks[buffer.depth]);
+  buffer.path = this->parent_path;
+  buffer.child_ticks[--buffer.depth] += elapsed;
+}
@@ -0,0 +1,323 @@
+#include "bazuu_ce_transposition.hpp"
+#include "bazuu_ce_trace.hpp"
+#include "bazuu_ce_zobrist.hpp"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+static constexpr std::uint64_t MOVE_MASK = (1ULL << 28) - 1;
+
+// Entries are plain words in memory, so a snapshot file can be mapped as the table.
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+static_assert(sizeof(BazuuTranspositionTable::Bucket) == 64);
+
+// Header of a snapshot file, the buckets follow it. Its size keeps them on cache line boundaries.
+struct alignas(64) BazuuTTFileHeader {
+  char magic[8];
+  std::uint32_t format;
+  std::uint32_t bucket_size;
+  U64 keys_version;
+  U64 bucket_count;
+  std::uint8_t generation;
+};
+static constexpr char FILE_MAGIC[8] = "BAZUUTT";
+static constexpr std::uint32_t FILE_FORMAT = 1;
+
+/*
+ * Check that a snapshot or shared segment was made by a build with the same keys and table layout.
+ * @param header - header of the mapping.
+ * @param length - size of the mapping in bytes.
+ */
+static bool valid_header(const BazuuTTFileHeader &header, std::size_t length) {
+  using Bucket = BazuuTranspositionTable::Bucket;
+  return length > sizeof(header) && std::memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) == 0 &&
+         header.format == FILE_FORMAT && header.bucket_size == sizeof(Bucket) &&
+         header.keys_version == BazuuZobrist::KEYS_VERSION && std::has_single_bit(header.bucket_count) &&
+         header.bucket_count == (length - sizeof(header)) / sizeof(Bucket) &&
+         (length - sizeof(header)) % sizeof(Bucket) == 0;
+}
+
+static constexpr std::uint64_t pack(BazuuMove move, std::int16_t score, std::uint8_t depth, BazuuTTBound bound,
+                                    std::uint8_t generation) {
+  return (move.data & MOVE_MASK) | static_cast<std::uint64_t>(static_cast<std::uint16_t>(score)) << 28 |
+         static_cast<std::uint64_t>(depth) << 44 | static_cast<std::uint64_t>(std::to_underlying(bound)) << 52 |
+         static_cast<std::uint64_t>(generation) << 54;
+}
+
+static constexpr std::uint8_t depth_of(std::uint64_t data) { return (data >> 44) & 0xFF; }
+static constexpr BazuuTTBound bound_of(std::uint64_t data) { return static_cast<BazuuTTBound>((data >> 52) & 0x3); }
+static constexpr std::uint8_t generation_of(std::uint64_t data) { return (data >> 54) & 0x3F; }
+
+BazuuTranspositionTable::BazuuTranspositionTable(std::size_t size_mb) { this->resize(size_mb); }
+
+BazuuTranspositionTable::~BazuuTranspositionTable() { this->release(); }
+
+/*
+ * Free the buckets or unmap the snapshot they are mapped from.
+ */
+void BazuuTranspositionTable::release() {
+  if (this->mapping)
+    ::munmap(this->mapping, this->mapping_length);
+  this->mapping = nullptr;
+  this->mapping_length = 0;
+  this->allocation.reset();
+  this->buckets = nullptr;
+  this->bucket_count = 0;
+  this->shared = false;
+}
+
+/*
+ * Resize the table, the number of buckets is rounded down to a power of two. The table is emptied.
+ * @param size_mb - size of the table in megabytes.
+ */
+void BazuuTranspositionTable::resize(std::size_t size_mb) {
+  this->release();
+  this->bucket_count = std::bit_floor(std::max<std::size_t>(size_mb * 1024 * 1024 / sizeof(Bucket), 1));
+  this->allocation = std::make_unique<Bucket[]>(this->bucket_count);
+  this->buckets = this->allocation.get();
+  this->generation = 0;
+}
+
+/*
+ * Write the table to a snapshot file, through a temporary file renamed over it so that a table mapped from the
+ * previous snapshot stays intact. Searches must not be running.
+ * @param path - path of the snapshot.
+ * @return false if the file can not be written.
+ */
+bool BazuuTranspositionTable::save(const std::string &path) const {
+  BazuuTTFileHeader header{};
+  std::memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+  header.format = FILE_FORMAT;
+  header.bucket_size = sizeof(Bucket);
+  header.keys_version = BazuuZobrist::KEYS_VERSION;
+  header.bucket_count = this->bucket_count;
+  header.generation = this->generation;
+  const std::string temporary = path + ".tmp";
+  std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(this->buckets), this->bucket_count * sizeof(Bucket));
+  file.close();
+  std::error_code error;
+  if (!file.fail())
+    std::filesystem::rename(temporary, path, error);
+  if (file.fail() || error) {
+    std::filesystem::remove(temporary, error);
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Map a snapshot file as the table, copy on write: the search updates the table without touching the file. The size
+ * of the table becomes the one of the snapshot.
+ * @param path - path of the snapshot.
+ * @return false if the file is missing, was written with other zobrist keys or another table layout, or is truncated,
+ * the table is unchanged then.
+ */
+bool BazuuTranspositionTable::load(const std::string &path) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  BazuuTTFileHeader header;
+  struct stat status;
+  const bool valid = ::fstat(fd, &status) == 0 && static_cast<std::size_t>(status.st_size) > sizeof(header) &&
+                     ::pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+                     valid_header(header, status.st_size);
+  void *mapping = valid ? ::mmap(nullptr, status.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+  // The mapping keeps its own reference to the file.
+  ::close(fd);
+  if (mapping == MAP_FAILED)
+    return false;
+  ::madvise(mapping, status.st_size, MADV_WILLNEED);
+  this->release();
+  this->mapping = mapping;
+  this->mapping_length = status.st_size;
+  this->buckets = reinterpret_cast<Bucket *>(static_cast<std::uint8_t *>(mapping) + sizeof(header));
+  this->bucket_count = header.bucket_count;
+  this->generation = header.generation & 0x3F;
+  return true;
+}
+
+/*
+ * Map the table from a named POSIX shared memory segment, created with the given size when it does not exist yet,
+ * else joined with the size it was created with. Entries are read and written in place, so every process mapping the
+ * segment sees the results of the others as soon as they are stored.
+ * @param name - name of the segment, e.g. "/bazuu".
+ * @param size_mb - size of the table in megabytes if the segment is created.
+ * @return false if the segment can not be created or mapped, or was made by another build. The table is unchanged
+ * then.
+ */
+bool BazuuTranspositionTable::open_shared(const std::string &name, std::size_t size_mb) {
+  int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  const bool created = fd >= 0;
+  if (!created)
+    fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+  if (fd < 0)
+    return false;
+  std::size_t length = 0;
+  if (created) {
+    const std::size_t count = std::bit_floor(std::max<std::size_t>(size_mb * 1024 * 1024 / sizeof(Bucket), 1));
+    length = sizeof(BazuuTTFileHeader) + count * sizeof(Bucket);
+    if (::ftruncate(fd, length) != 0)
+      length = 0;
+  } else {
+    // The process creating the segment may not have sized it yet.
+    struct stat status;
+    for (int tries = 0; ::fstat(fd, &status) == 0 && tries < 1000; tries++) {
+      if ((length = status.st_size) > 0)
+        break;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  void *mapping = length > sizeof(BazuuTTFileHeader)
+                      ? ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                      : MAP_FAILED;
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    if (created)
+      ::shm_unlink(name.c_str());
+    return false;
+  }
+
+  // The creator publishes the header by storing its format last, the segment is zero filled until then.
+  auto *header = static_cast<BazuuTTFileHeader *>(mapping);
+  std::atomic_ref format(header->format);
+  if (created) {
+    std::memcpy(header->magic, FILE_MAGIC, sizeof(header->magic));
+    header->bucket_size = sizeof(Bucket);
+    header->keys_version = BazuuZobrist::KEYS_VERSION;
+    header->bucket_count = (length - sizeof(BazuuTTFileHeader)) / sizeof(Bucket);
+    format.store(FILE_FORMAT, std::memory_order_release);
+  } else {
+    for (int tries = 0; format.load(std::memory_order_acquire) == 0 && tries < 1000; tries++)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  if (!valid_header(*header, length)) {
+    ::munmap(mapping, length);
+    return false;
+  }
+  this->release();
+  this->mapping = mapping;
+  this->mapping_length = length;
+  this->shared = true;
+  this->buckets = reinterpret_cast<Bucket *>(static_cast<std::uint8_t *>(mapping) + sizeof(BazuuTTFileHeader));
+  this->bucket_count = header->bucket_count;
+  this->generation = std::atomic_ref(header->generation).load(std::memory_order_relaxed) & 0x3F;
+  return true;
+}
+
+/*
+ * Remove a shared memory segment, processes still mapping it keep it until they let it go.
+ * @param name - name of the segment.
+ * @return false if there is no such segment.
+ */
+bool BazuuTranspositionTable::remove_shared(const std::string &name) { return ::shm_unlink(name.c_str()) == 0; }
+
+/*
+ * Empty the table.
+ */
+void BazuuTranspositionTable::clear() {
+  for (std::size_t i = 0; i < this->bucket_count; i++) {
+    for (Entry &entry : this->buckets[i].entries) {
+      entry.key_xor_data.store(0, std::memory_order_relaxed);
+      entry.data.store(0, std::memory_order_relaxed);
+    }
+  }
+  this->generation = 0;
+}
+
+/*
+ * Start a new search, the entries of the previous ones become the first to be replaced.
+ */
+void BazuuTranspositionTable::new_search() {
+  if (this->shared)
+    this->generation =
+        (std::atomic_ref(static_cast<BazuuTTFileHeader *>(this->mapping)->generation).fetch_add(1) + 1) & 0x3F;
+  else
+    this->generation = (this->generation + 1) & 0x3F;
+}
+
+/*
+ * Look up the result of a search of a position.
+ * @param key - zobrist key of the position.
+ * @param hit - set to the stored result on a hit.
+ * @return true if the position was in the table.
+ */
+bool BazuuTranspositionTable::probe(ZobristKey key, BazuuTTHit &hit) const {
+  BAZUU_TRACE_SCOPE(TTProbe);
+  for (const Entry &entry : this->bucket(key).entries) {
+    const std::uint64_t data = entry.data.load(std::memory_order_relaxed);
+    if ((entry.key_xor_data.load(std::memory_order_relaxed) ^ data) != key || bound_of(data) == BazuuTTBound::None)
+      continue;
+    hit.move = BazuuMove{static_cast<std::uint32_t>(data & MOVE_MASK)};
+    hit.score = static_cast<std::int16_t>((data >> 28) & 0xFFFF);
+    hit.depth = depth_of(data);
+    hit.bound = bound_of(data);
+    return true;
+  }
+  return false;
+}
+
+/*
+ * Store the result of a search. An entry of the same position is updated unless it holds a deeper bound of this
+ * search, otherwise the entry replaced is the shallowest, entries of older searches counting as 8 plies shallower
+ * per search.
+ * @param key - zobrist key of the position.
+ * @param move - best move, or a null move to keep the one already stored.
+ * @param score - score of the search, mate scores relative to the node.
+ * @param depth - remaining depth of the search, clamped to 0-255.
+ * @param bound - kind of bound the score is.
+ */
+void BazuuTranspositionTable::store(ZobristKey key, BazuuMove move, std::int32_t score, int depth,
+                                    BazuuTTBound bound) {
+  Bucket &bucket = this->bucket(key);
+  Entry *replaced = &bucket.entries[0];
+  int replaced_worth = INT32_MAX;
+  for (Entry &entry : bucket.entries) {
+    const std::uint64_t data = entry.data.load(std::memory_order_relaxed);
+    if ((entry.key_xor_data.load(std::memory_order_relaxed) ^ data) == key) {
+      if (bound != BazuuTTBound::Exact && generation_of(data) == this->generation && depth + 4 < depth_of(data))
+        return;
+      if (move.is_null())
+        move = BazuuMove{static_cast<std::uint32_t>(data & MOVE_MASK)};
+      replaced = &entry;
+      break;
+    }
+    const int age = (this->generation - generation_of(data)) & 0x3F;
+    const int worth = bound_of(data) == BazuuTTBound::None ? INT32_MIN : depth_of(data) - 8 * age;
+    if (worth < replaced_worth) {
+      replaced = &entry;
+      replaced_worth = worth;
+    }
+  }
+  const std::int16_t clamped = static_cast<std::int16_t>(std::clamp<std::int32_t>(score, INT16_MIN, INT16_MAX));
+  const std::uint64_t data =
+      pack(move, clamped, static_cast<std::uint8_t>(std::clamp(depth, 0, 255)), bound, this->generation);
+  replaced->key_xor_data.store(key ^ data, std::memory_order_relaxed);
+  replaced->data.store(data, std::memory_order_relaxed);
+}
+
+/*
+ * Estimate how full the table is with entries of the current search, from its first thousand entries.
+ * @return permille of the sampled entries in use, as in the UCI hashfull info.
+ */
+std::uint16_t BazuuTranspositionTable::hashfull() const {
+  const std::size_t sampled = std::min<std::size_t>(this->bucket_count, 1000 / BUCKET_ENTRIES);
+  std::size_t used = 0;
+  for (std::size_t i = 0; i < sampled; i++) {
+    for (const Entry &entry : this->buckets[i].entries) {
+      const std::uint64_t data = entry.data.load(std::memory_order_relaxed);
+      used += bound_of(data) != BazuuTTBound::None && generation_of(data) == this->generation;
+    }
+  }
+  return static_cast<std::uint16_t>(used * 1000 / (sampled * BUCKET_ENTRIES));
+}
@@ -0,0 +1,325 @@
+#include "bazuu_ce_uci.hpp"
+#include "bazuu_ce_board.hpp"
+#include "bazuu_ce_move.hpp"
+#include "bazuu_ce_search.hpp"
+#include "defs.hpp"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+static constexpr std::int64_t MAX_HASH_MB = 65536;
+static constexpr std::int64_t MAX_MULTI_PV = 64;
+
+// Split the first space separated token off a command.
+static std::string_view next_token(std::string_view &command) {
+  const std::size_t start = std::min(command.find_first_not_of(' '), command.size());
+  const std::size_t end = std::min(command.find(' ', start), command.size());
+  std::string_view token = command.substr(start, end - start);
+  command.remove_prefix(end);
+  return token;
+}
+
+// Parse a signed number, 0 when the token is not one.
+static std::int64_t to_number(std::string_view token) {
+  std::int64_t value = 0;
+  std::from_chars(token.data(), token.data() + token.size(), value);
+  return value;
+}
+
+BazuuUci::BazuuUci() {
+  this->board = std::make_unique<BazuuBoard>();
+  this->board->setup_fen(BazuuBoard::STARTING_FEN);
+  this->search = std::make_unique<BazuuSearch>(*this->board);
+  this->tablebase = std::make_unique<BazuuTablebase>();
+  this->tt = std::make_unique<BazuuTranspositionTable>();
+  this->eval_cache = std::make_unique<BazuuEvalCache>();
+  this->search->tt = this->tt.get();
+  this->search->eval_cache = this->eval_cache.get();
+}
+
+BazuuUci::~BazuuUci() { this->stop_search(); }
+
+/*
+ * Answer commands until quit or the end of the input.
+ * @param input - GUI commands, one per line.
+ * @param output - engine replies.
+ */
+void BazuuUci::run(std::istream &input, std::ostream &output) {
+  std::string line;
+  while (std::getline(input, line)) {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    if (!this->handle(line, output))
+      return;
+  }
+  // Commands piped in get the bestmove of their last search, only an infinite one is stopped.
+  if (this->limited_search && this->search_thread.joinable())
+    this->search_thread.join();
+  this->stop_search();
+  this->save_hash_file(output);
+}
+
+/*
+ * Answer a single command, unknown commands are ignored.
+ * @param command - the command line.
+ * @param output - engine replies.
+ * @return false on quit.
+ */
+bool BazuuUci::handle(std::string_view command, std::ostream &output) {
+  const std::string_view name = next_token(command);
+  if (name == "uci") {
+    this->write(output, std::format("id name {} {}", BazuuBoard::NAME, BazuuBoard::VERSION));
+    this->write(output, "id author the Bazuu developers");
+    this->write(output, "option name OwnBook type check default false");
+    this->write(output, "option name BookFile type string default <empty>");
+    this->write(output, "option name SyzygyPath type string default <empty>");
+    this->write(output, std::format("option name Hash type spin default {} min 1 max {}",
+                                    BazuuTranspositionTable::DEFAULT_SIZE_MB, MAX_HASH_MB));
+    this->write(output, std::format("option name MultiPV type spin default 1 min 1 max {}", MAX_MULTI_PV));
+    this->write(output, "option name HashFile type string default <empty>");
+    this->write(output, "option name SharedHash type string default <empty>");
+    this->write(output, "uciok");
+  } else if (name == "isready") {
+    this->write(output, "readyok");
+  } else if (name == "ucinewgame") {
+    this->stop_search();
+    BazuuTablebase *tablebase = this->search->tablebase;
+    const std::uint8_t multi_pv = this->search->multi_pv;
+    this->search = std::make_unique<BazuuSearch>(*this->board);
+    this->search->tablebase = tablebase;
+    this->search->tt = this->tt.get();
+    this->search->eval_cache = this->eval_cache.get();
+    this->search->multi_pv = multi_pv;
+    // The table loaded from a hash file is what the session asked to start from, a shared one is not only ours.
+    if (this->hash_file.empty() && !this->tt->is_shared())
+      this->tt->clear();
+  } else if (name == "position") {
+    this->stop_search();
+    if (!this->position(command))
+      this->write(output, "info string invalid position");
+  } else if (name == "go") {
+    this->stop_search();
+    this->go(command, output);
+  } else if (name == "stop") {
+    this->stop_search();
+  } else if (name == "setoption") {
+    this->stop_search();
+    this->set_option(command, output);
+  } else if (name == "quit") {
+    this->stop_search();
+    this->save_hash_file(output);
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Find the legal move of the position written in UCI notation.
+ * @param board - the position.
+ * @param uci_move - the move, e.g. e2e4 or e7e8q.
+ * @return the move, a null move if it is not legal.
+ */
+BazuuMove BazuuUci::parse_move(BazuuBoard &board, std::string_view uci_move) {
+  BazuuMoveList list;
+  board.generate_moves(list);
+  for (std::uint16_t i = 0; i < list.count; i++) {
+    if (list.moves[i].to_uci() != uci_move || !board.make_move(list.moves[i]))
+      continue;
+    board.unmake_move(list.moves[i]);
+    return list.moves[i];
+  }
+  return BazuuMove{};
+}
+
+/*
+ * Turn the arguments of go into search limits. Without a fixed move time the move gets a share of the clock:
+ * the remaining time over the moves to go, or 30 moves, plus most of the increment.
+ * @param arguments - arguments of the go command.
+ * @param side_to_move - side whose clock is used.
+ * @return the limits, no limit for go infinite.
+ */
+BazuuSearchLimits BazuuUci::parse_go(std::string_view arguments, Colours side_to_move) {
+  BazuuSearchLimits limits;
+  std::int64_t time[2] = {-1, -1};
+  std::int64_t increment[2] = {0, 0};
+  std::int64_t moves_to_go = 0;
+  for (std::string_view token = next_token(arguments); !token.empty(); token = next_token(arguments)) {
+    if (token == "depth")
+      limits.depth = static_cast<std::uint8_t>(std::clamp<std::int64_t>(to_number(next_token(arguments)), 1, 255));
+    else if (token == "nodes")
+      limits.nodes = std::max<std::int64_t>(to_number(next_token(arguments)), 1);
+    else if (token == "movetime")
+      limits.movetime_ms = std::max<std::int64_t>(to_number(next_token(arguments)), 1);
+    else if (token == "wtime")
+      time[std::to_underlying(Colours::White)] = to_number(next_token(arguments));
+    else if (token == "btime")
+      time[std::to_underlying(Colours::Black)] = to_number(next_token(arguments));
+    else if (token == "winc")
+      increment[std::to_underlying(Colours::White)] = to_number(next_token(arguments));
+    else if (token == "binc")
+      increment[std::to_underlying(Colours::Black)] = to_number(next_token(arguments));
+    else if (token == "movestogo")
+      moves_to_go = to_number(next_token(arguments));
+  }
+  const std::uint8_t side = std::to_underlying(side_to_move);
+  if (!limits.movetime_ms && time[side] >= 0) {
+    // Keep a margin for the communication with the GUI.
+    const std::int64_t available = std::max<std::int64_t>(time[side] - 50, 1);
+    const std::int64_t share = available / (moves_to_go > 0 ? moves_to_go : 30) + increment[side] * 3 / 4;
+    limits.movetime_ms = std::clamp<std::int64_t>(share, 1, available);
+  }
+  return limits;
+}
+
+/*
+ * Set up the position of a position command.
+ * @param arguments - "startpos" or "fen <fen>", optionally followed by "moves <moves>".
+ * @return false if the position or one of the moves is not valid, the moves before it are played.
+ */
+bool BazuuUci::position(std::string_view arguments) {
+  const std::size_t moves_at = arguments.find(" moves");
+  std::string_view setup = arguments.substr(0, moves_at);
+  std::string_view moves = moves_at == std::string_view::npos ? std::string_view() : arguments.substr(moves_at + 6);
+  const std::string_view kind = next_token(setup);
+  setup.remove_prefix(std::min(setup.find_first_not_of(' '), setup.size()));
+  if (kind == "startpos")
+    this->board->setup_fen(BazuuBoard::STARTING_FEN);
+  else if (kind != "fen" || this->board->setup_fen(setup) != FenError::Ok)
+    return false;
+  for (std::string_view token = next_token(moves); !token.empty(); token = next_token(moves)) {
+    BazuuMove move = parse_move(*this->board, token);
+    if (move.is_null())
+      return false;
+    this->board->make_move(move);
+  }
+  return true;
+}
+
+/*
+ * Start a search of the current position, the book move is played at once when there is one.
+ * @param arguments - arguments of the go command.
+ * @param output - receives the info and bestmove lines.
+ */
+void BazuuUci::go(std::string_view arguments, std::ostream &output) {
+  const BazuuSearchLimits limits = parse_go(arguments, this->board->side_to_move());
+  if (this->own_book) {
+    BazuuMove book_move = this->book.probe(*this->board, this->prng.rand64());
+    if (!book_move.is_null()) {
+      this->write(output, std::format("bestmove {}", book_move.to_uci()));
+      return;
+    }
+  }
+  this->limited_search = limits.depth < BazuuSearchLimits{}.depth || limits.nodes || limits.movetime_ms;
+  this->searching = true;
+  this->search_thread = std::thread([this, limits, &output] {
+    BazuuSearchResult result = this->search->search(limits);
+    const U64 nodes = result.stats.nodes + result.stats.qnodes;
+    for (std::size_t i = 0; i < result.lines.size(); i++) {
+      const BazuuRootLine &line = result.lines[i];
+      std::string info = std::format("info depth {} multipv {} score ", result.depth, i + 1);
+      if (std::abs(line.score) >= BazuuSearch::MATE_BOUND)
+        std::format_to(std::back_inserter(info), "mate {}",
+                       line.score > 0 ? (BazuuSearch::MATE - line.score + 1) / 2
+                                      : -((BazuuSearch::MATE + line.score) / 2));
+      else
+        std::format_to(std::back_inserter(info), "cp {}", line.score);
+      std::format_to(std::back_inserter(info), " nodes {} time {} nps {} hashfull {}", nodes, result.elapsed_ms,
+                     nodes * 1000 / (result.elapsed_ms ? result.elapsed_ms : 1), this->tt->hashfull());
+      if (!line.pv.empty()) {
+        info += " pv";
+        for (const BazuuMove move : line.pv)
+          std::format_to(std::back_inserter(info), " {}", move.to_uci());
+      }
+      this->write(output, info);
+    }
+    this->write(output,
+                std::format("bestmove {}", result.best_move.is_null() ? "0000" : result.best_move.to_uci()));
+    this->searching = false;
+  });
+}
+
+/*
+ * Handle "setoption name <id> [value <x>]".
+ * @param arguments - arguments of the setoption command.
+ * @param output - receives info strings about the option.
+ */
+void BazuuUci::set_option(std::string_view arguments, std::ostream &output) {
+  const std::size_t name_at = arguments.find("name ");
+  if (name_at == std::string_view::npos)
+    return;
+  const std::size_t value_at = arguments.find(" value ");
+  std::string_view name = arguments.substr(name_at + 5, value_at == std::string_view::npos ? value_at
+                                                                                            : value_at - name_at - 5);
+  std::string_view value = value_at == std::string_view::npos ? std::string_view() : arguments.substr(value_at + 7);
+  if (name == "OwnBook") {
+    this->own_book = value == "true";
+  } else if (name == "BookFile") {
+    if (value.empty() || value == "<empty>")
+      this->book.close();
+    else if (!this->book.open(std::string(value)))
+      this->write(output, std::format("info string can not open book {}", value));
+  } else if (name == "SyzygyPath") {
+    const std::size_t tables = value.empty() || value == "<empty>" ? 0 : this->tablebase->init(std::string(value));
+    this->search->tablebase = tables ? this->tablebase.get() : nullptr;
+    this->write(output, std::format("info string found {} tablebases", tables));
+  } else if (name == "Hash") {
+    this->tt->resize(std::clamp<std::int64_t>(to_number(value), 1, MAX_HASH_MB));
+  } else if (name == "HashFile") {
+    this->hash_file = value.empty() || value == "<empty>" ? std::string() : std::string(value);
+    if (!this->hash_file.empty() && this->tt->load(this->hash_file))
+      this->write(output, std::format("info string loaded hash file {} of {} MB", this->hash_file,
+                                      this->tt->size() * sizeof(BazuuTranspositionTable::Bucket) >> 20));
+    else if (!this->hash_file.empty())
+      this->write(output, std::format("info string no valid hash file {}, it is written on quit", this->hash_file));
+  } else if (name == "SharedHash") {
+    const std::size_t size_mb = this->tt->size() * sizeof(BazuuTranspositionTable::Bucket) >> 20;
+    if (value.empty() || value == "<empty>") {
+      if (this->tt->is_shared())
+        this->tt->resize(size_mb);
+    } else if (this->tt->open_shared(std::string(value), size_mb)) {
+      this->write(output, std::format("info string shared hash {} of {} MB", value,
+                                      this->tt->size() * sizeof(BazuuTranspositionTable::Bucket) >> 20));
+    } else {
+      this->write(output, std::format("info string can not open shared hash {}", value));
+    }
+  } else if (name == "MultiPV") {
+    this->search->multi_pv = static_cast<std::uint8_t>(std::clamp<std::int64_t>(to_number(value), 1, MAX_MULTI_PV));
+  }
+}
+
+/*
+ * Stop the search going on and wait for its bestmove. The stop is repeated until the search thread is done, a
+ * search that has not started yet would clear it.
+ */
+void BazuuUci::stop_search() {
+  if (!this->search_thread.joinable())
+    return;
+  while (this->searching) {
+    this->search->stop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  this->search_thread.join();
+}
+
+/*
+ * Save the transposition table to the hash file, if one is set.
+ * @param output - receives an info string if the file can not be written.
+ */
+void BazuuUci::save_hash_file(std::ostream &output) {
+  if (!this->hash_file.empty() && !this->tt->save(this->hash_file))
+    this->write(output, std::format("info string can not write hash file {}", this->hash_file));
+}
+
+// Write a line, lines of the search thread and of the command loop do not interleave.
+void BazuuUci::write(std::ostream &output, std::string_view line) {
+  std::lock_guard lock(this->output_mutex);
+  output << line << std::endl;
+}
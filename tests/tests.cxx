@@ -1,13 +1,45 @@
 #include "bazuu_bitboard_ops.hpp"
+#include "bazuu_ce_analysis.hpp"
+#include "bazuu_ce_bench.hpp"
 #include "bazuu_ce_board.hpp"
+#include "bazuu_ce_book.hpp"
+#include "bazuu_ce_cuckoo.hpp"
+#include "bazuu_ce_datagen.hpp"
+#include "bazuu_ce_eval_cache.hpp"
+#include "bazuu_ce_match.hpp"
+#include "bazuu_ce_move.hpp"
+#include "bazuu_ce_move_ordering.hpp"
+#include "bazuu_ce_nnue.hpp"
+#include "bazuu_ce_packed_position.hpp"
+#include "bazuu_ce_perf_counters.hpp"
+#include "bazuu_ce_search.hpp"
+#include "bazuu_ce_tablebase.hpp"
+#include "bazuu_ce_trace.hpp"
+#include "bazuu_ce_transposition.hpp"
+#include "bazuu_ce_uci.hpp"
 #include "bazuu_ce_zobrist.hpp"
 #include "defs.hpp"
 #include "prng.hpp"
+#include <algorithm>
 #include <bit>
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
 #include <catch2/matchers/catch_matchers_string.hpp>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <numeric>
+#include <optional>
 #include <print>
+#include <queue>
 #include <set>
+#include <sstream>
+#include <string_view>
+#include <unistd.h>
 
 // ============================================================================
 // BOARD SQUARE MAPPING TESTS
@@ -166,7 +198,7 @@ TEST_CASE("FEN parsing - custom positions", "[board][fen]") {
   }
 
   SECTION("Killer position FEN parsing") {
-    board.setup_fen(KILLER_BOARD_FEN);
+    board.setup_fen(KILLER_BOARD_FEN, false);
     BitBoard white_pawns = board.get_bitboard_of_piece(PieceType::P, Colours::White);
     REQUIRE(std::popcount(white_pawns) == 9);
     BitBoard black_pawns = board.get_bitboard_of_piece(PieceType::P, Colours::Black);
@@ -174,6 +206,96 @@ TEST_CASE("FEN parsing - custom positions", "[board][fen]") {
   }
 }
 
+TEST_CASE("FEN parsing - errors", "[board][fen]") {
+  BazuuBoard board;
+  board.setup_fen(TRICKY_BOARD_FEN);
+  const ZobristKey key = board.zobrist_key();
+
+  SECTION("Malformed fields") {
+    REQUIRE(board.setup_fen("") == FenError::BadPiecePlacement);
+    REQUIRE(board.setup_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP w KQkq -") == FenError::BadPiecePlacement);
+    REQUIRE(board.setup_fen("rnbqkbnr/pppppppp/9/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -") == FenError::BadPiecePlacement);
+    REQUIRE(board.setup_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNX w KQkq -") == FenError::BadPiecePlacement);
+    REQUIRE(board.setup_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR") == FenError::BadSideToMove);
+    REQUIRE(board.setup_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq -") == FenError::BadSideToMove);
+    REQUIRE(board.setup_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkK -") == FenError::BadCastling);
+    REQUIRE(board.setup_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq") == FenError::BadEnPassant);
+    REQUIRE(board.setup_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq e9") == FenError::BadEnPassant);
+    REQUIRE(board.setup_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0x 1") == FenError::BadMoveCounters);
+    REQUIRE(board.setup_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 99999") ==
+            FenError::BadMoveCounters);
+    // The board is left untouched by a rejected FEN.
+    REQUIRE(board.zobrist_key() == key);
+    REQUIRE(board.to_fen() == TRICKY_BOARD_FEN);
+  }
+
+  SECTION("Positions that can not arise in a game") {
+    REQUIRE(board.setup_fen("8/8/8/8/8/8/8/4K3 w - -") == FenError::BadKings);
+    REQUIRE(board.setup_fen("4k3/8/8/8/8/8/8/3KK3 w - -") == FenError::BadKings);
+    REQUIRE(board.setup_fen("4k3/8/8/8/8/8/8/4K2P w - -") == FenError::PawnOnBackRank);
+    REQUIRE(board.setup_fen("4k3/8/8/8/8/8/8/QQQQQQKQ w - -") == FenError::OpponentInCheck);
+    REQUIRE(board.setup_fen("r3k2r/8/8/8/8/8/8/R3K3 w KQkq -") == FenError::BadCastling);
+    REQUIRE(board.setup_fen("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq d3") == FenError::BadEnPassant);
+    REQUIRE(board.setup_fen("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR w KQkq e3") == FenError::BadEnPassant);
+    REQUIRE(board.setup_fen("4k3/8/8/8/8/8/8/4K3 w - -", false) == FenError::Ok);
+    REQUIRE(board.setup_fen("4k3/8/NNNNNNNN/NNNNNNNN/8/8/8/4K3 w - -", false) == FenError::BadPieceCount);
+    // Missing kings are rejected even without validation.
+    REQUIRE(board.setup_fen("8/8/8/8/8/8/8/8 w - -", false) == FenError::BadKings);
+    REQUIRE(board.setup_fen("4k3/8/8/8/8/8/8/8 w - -", false) == FenError::BadKings);
+    REQUIRE(board.setup_fen("4k3/8/8/8/8/P7/PPPPPPPP/4K3 w - -") == FenError::BadPieceCount);
+    REQUIRE(board.setup_fen("4k3/8/8/8/8/N7/PPPPPPPP/RNBQKBNR w - -") == FenError::BadPieceCount);
+    REQUIRE(board.setup_fen("4k3/8/8/8/8/8/PPPPPPP1/RNBQKBNR w - -") == FenError::Ok);
+    REQUIRE(board.setup_fen("4k3/8/8/8/8/P7/PPPPPPPP/4K3 w - -", false) == FenError::Ok);
+    // A piece beyond the initial ones needs a pawn that promoted.
+    REQUIRE(board.setup_fen("4k3/8/8/8/8/Q7/PPPPPPPP/3QK3 w - -") == FenError::BadPieceCount);
+    REQUIRE(board.setup_fen("4k3/8/8/8/8/Q7/PPPPPPP1/3QK3 w - -") == FenError::Ok);
+    REQUIRE(board.setup_fen("4k3/8/8/8/8/Q7/PPPPPPPP/3QK3 w - -", false) == FenError::Ok);
+  }
+}
+
+TEST_CASE("FEN serialization - round trip", "[board][fen]") {
+  BazuuBoard board;
+
+  SECTION("FEN positions") {
+    for (const std::string fen :
+         {BazuuBoard::STARTING_FEN, std::string(TRICKY_BOARD_FEN), std::string(KILLER_BOARD_FEN),
+          std::string(CMK_BOARD_FEN), std::string("rnbqkbnr/1ppppppp/8/8/pP6/8/P1PPPPPP/RNBQKBNR b KQkq b3 0 3"),
+          std::string("rnbqkbnr/ppppppp1/8/6Pp/8/8/PPPPPP1P/RNBQKBNR w Kq h6 0 3"),
+          std::string("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 41 57")}) {
+      REQUIRE(board.setup_fen(fen, false) == FenError::Ok);
+      REQUIRE(board.to_fen() == fen);
+    }
+  }
+
+  SECTION("Missing move counters") {
+    REQUIRE(board.setup_fen("4k3/8/8/8/8/8/8/4K3 b - -") == FenError::Ok);
+    REQUIRE(board.halfmove_clock() == 0);
+    REQUIRE(board.to_fen() == "4k3/8/8/8/8/8/8/4K3 b - - 0 1");
+  }
+
+  SECTION("EPD records") {
+    REQUIRE(board.setup_fen("r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - bm Bb5; id \"ruy\";") ==
+            FenError::Ok);
+    REQUIRE(board.to_epd() == "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq -");
+    REQUIRE(board.setup_fen("4k3/8/8/8/8/8/8/4K3 w - - 12 40 bm Kd2;") == FenError::Ok);
+    REQUIRE(board.to_fen() == "4k3/8/8/8/8/8/8/4K3 w - - 12 40");
+  }
+
+  SECTION("After moves") {
+    board.setup_fen(BazuuBoard::STARTING_FEN);
+    BazuuMoveList list;
+    board.generate_moves(list);
+    for (std::uint16_t i = 0; i < list.count; i++) {
+      if (!board.make_move(list.moves[i]))
+        continue;
+      auto copy = std::make_unique<BazuuBoard>();
+      REQUIRE(copy->setup_fen(board.to_fen()) == FenError::Ok);
+      REQUIRE(copy->zobrist_key() == board.zobrist_key());
+      board.unmake_move(list.moves[i]);
+    }
+  }
+}
+
 // ============================================================================
 // ATTACK GENERATION TESTS - KNIGHT
 // ============================================================================
@@ -356,7 +478,7 @@ TEST_CASE("Bishop magic bitboard lookups", "[board][attacks][bishop][magic]") {
   BazuuBoard board;
 
   SECTION("Bishop on E4 with empty board") {
-    board.setup_fen("8/8/8/8/4B3/8/8/8 w - - 0 1");
+    board.setup_fen("8/k7/8/8/4B3/8/7K/8 w - - 0 1", false);
     BitBoard occ = board.occupancy();
     BitBoard attacks = board.get_bishop_attacks_lookup(BoardSquares::E4, occ);
 
@@ -365,7 +487,7 @@ TEST_CASE("Bishop magic bitboard lookups", "[board][attacks][bishop][magic]") {
   }
 
   SECTION("Bishop on E4 with blockers") {
-    board.setup_fen("8/8/6p1/8/4B3/8/2p5/8 w - - 0 1");
+    board.setup_fen("8/k7/6p1/8/4B3/8/2p4K/8 w - - 0 1", false);
     BitBoard occ = board.occupancy();
     BitBoard attacks = board.get_bishop_attacks_lookup(BoardSquares::E4, occ);
 
@@ -427,7 +549,7 @@ TEST_CASE("Rook magic bitboard lookups", "[board][attacks][rook][magic]") {
   BazuuBoard board;
 
   SECTION("Rook on E4 with empty board") {
-    board.setup_fen("8/8/8/8/4R3/8/8/8 w - - 0 1");
+    board.setup_fen("8/k7/8/8/4R3/8/7K/8 w - - 0 1", false);
     BitBoard occ = board.occupancy();
     BitBoard attacks = board.get_rook_attacks_lookup(BoardSquares::E4, occ);
 
@@ -436,7 +558,7 @@ TEST_CASE("Rook magic bitboard lookups", "[board][attacks][rook][magic]") {
   }
 
   SECTION("Rook on E4 with blockers") {
-    board.setup_fen("8/8/4p3/8/2p1R1p1/8/8/8 w - - 0 1");
+    board.setup_fen("8/k7/4p3/8/2p1R1p1/8/7K/8 w - - 0 1", false);
     BitBoard occ = board.occupancy();
     BitBoard attacks = board.get_rook_attacks_lookup(BoardSquares::E4, occ);
 
@@ -465,7 +587,7 @@ TEST_CASE("Queen magic bitboard lookups", "[board][attacks][queen][magic]") {
   BazuuBoard board;
 
   SECTION("Queen on E4 with empty board") {
-    board.setup_fen("8/8/8/8/4Q3/8/8/8 w - - 0 1");
+    board.setup_fen("8/k7/8/8/4Q3/8/7K/8 w - - 0 1", false);
     BitBoard occ = board.occupancy();
     BitBoard attacks = board.get_queen_attacks_lookup(BoardSquares::E4, occ);
 
@@ -474,7 +596,7 @@ TEST_CASE("Queen magic bitboard lookups", "[board][attacks][queen][magic]") {
   }
 
   SECTION("Queen on E4 with blockers") {
-    board.setup_fen("8/8/4p3/8/2p1Q1p1/8/2p5/8 w - - 0 1");
+    board.setup_fen("8/k7/4p3/8/2p1Q1p1/8/2p4K/8 w - - 0 1", false);
     BitBoard occ = board.occupancy();
     BitBoard attacks = board.get_queen_attacks_lookup(BoardSquares::E4, occ);
 
@@ -489,6 +611,61 @@ TEST_CASE("Queen magic bitboard lookups", "[board][attacks][queen][magic]") {
   }
 }
 
+// ============================================================================
+// ATTACK GENERATION TESTS - SETWISE SLIDERS
+// ============================================================================
+
+// A rook in the corner of an empty board sees its file and rank, a bishop in the centre stops on its blocker.
+static_assert(BazuuBitBoardOps::sliderAttacks(1ULL, 0ULL, ~1ULL) ==
+              ((BazuuBitBoardOps::A_FILE | BazuuBitBoardOps::RANK_1) & ~1ULL));
+static_assert(BazuuBitBoardOps::slidingAttacks<9, BazuuBitBoardOps::NOT_A_FILE>(1ULL << 27,
+                                                                               ~((1ULL << 27) | (1ULL << 45))) ==
+              ((1ULL << 36) | (1ULL << 45)));
+
+TEST_CASE("Setwise slider attacks", "[board][attacks][setwise]") {
+  auto board = std::make_unique<BazuuBoard>();
+
+  SECTION("Fills of whole piece sets match the magic lookups of each piece") {
+    for (const char *fen : BazuuBench::POSITIONS) {
+      board->setup_fen(fen);
+      const BitBoard occupancy = board->occupancy();
+      for (Colours colour : {Colours::White, Colours::Black}) {
+        const BitBoard bishops = board->get_bitboard_of_piece(PieceType::B, colour);
+        const BitBoard rooks = board->get_bitboard_of_piece(PieceType::R, colour);
+        const BitBoard queens = board->get_bitboard_of_piece(PieceType::Q, colour);
+        BitBoard straight = 0ULL, diagonal = 0ULL;
+        for (BitBoard bb = rooks | queens; bb; bb &= bb - 1)
+          straight |= board->get_rook_attacks_lookup(board->to_120_board_square(std::countr_zero(bb)), occupancy);
+        for (BitBoard bb = bishops | queens; bb; bb &= bb - 1)
+          diagonal |= board->get_bishop_attacks_lookup(board->to_120_board_square(std::countr_zero(bb)), occupancy);
+
+        BitBoard rays[8];
+        BazuuBitBoardOps::slidingAttacks(rooks | queens, bishops | queens, ~occupancy, rays);
+        REQUIRE((rays[0] | rays[1] | rays[4] | rays[5]) == straight);
+        REQUIRE((rays[2] | rays[3] | rays[6] | rays[7]) == diagonal);
+        REQUIRE(board->slider_attacks(colour, occupancy) == (straight | diagonal));
+        if (BazuuBitBoardOps::hasAvx2()) {
+          BitBoard vector_rays[8];
+          BazuuBitBoardOps::slidingAttacksAvx2(rooks | queens, bishops | queens, ~occupancy, vector_rays);
+          REQUIRE(std::equal(std::begin(rays), std::end(rays), std::begin(vector_rays)));
+          REQUIRE(BazuuBitBoardOps::sliderAttacksAvx2(rooks | queens, bishops | queens, ~occupancy) ==
+                  (straight | diagonal));
+        }
+      }
+    }
+  }
+
+  SECTION("Occupancy can look through a piece") {
+    // The rook on e8 stops on the king on e4, without the king it reaches down to e1.
+    board->setup_fen("4r1k1/8/8/8/4K3/8/8/8 w - - 0 1");
+    const BitBoard king = 1ULL << 28;
+    const BitBoard behind_king = (1ULL << 20) | (1ULL << 12) | (1ULL << 4);
+    REQUIRE(board->slider_attacks(Colours::Black, board->occupancy()) & king);
+    REQUIRE_FALSE(board->slider_attacks(Colours::Black, board->occupancy()) & behind_king);
+    REQUIRE((board->slider_attacks(Colours::Black, board->occupancy() & ~king) & behind_king) == behind_king);
+  }
+}
+
 // ============================================================================
 // BITBOARD OPERATION TESTS
 // ============================================================================
@@ -657,8 +834,9 @@ TEST_CASE("Edge cases", "[board][edge]") {
   BazuuBoard board;
 
   SECTION("Position with promoted pieces") {
-    // 9 queens scenario (original + 8 promoted pawns)
-    board.setup_fen("4k3/8/8/8/8/8/8/QQQQQQQKQ w - - 0 1");
+    // A rank of nine squares is rejected, seven queens and a king fill the first rank.
+    REQUIRE(board.setup_fen("4k3/8/8/8/8/8/8/QQQQQQQKQ w - - 0 1") == FenError::BadPiecePlacement);
+    REQUIRE(board.setup_fen("4k3/8/8/8/8/8/8/QQQQQQKQ b - - 0 1") == FenError::Ok);
     BitBoard white_queens = board.get_bitboard_of_piece(PieceType::Q, Colours::White);
     REQUIRE(std::popcount(white_queens) == 7);
   }
@@ -737,57 +915,62 @@ TEST_CASE("BazuuGameState reset", "[gamestate][reset]") {
 // ============================================================================
 
 TEST_CASE("BazuuZobrist initialization", "[zobrist][init]") {
-  BazuuZobrist zobrist;
-
   SECTION("Piece hashes are non-zero") {
-    U64 hash = zobrist.piece_hash(Colours::White, PieceType::P, BoardSquares::E4);
+    U64 hash = BazuuZobrist::piece_hash(Colours::White, PieceType::P, 28);
     REQUIRE(hash != 0);
   }
 
   SECTION("Different pieces have different hashes") {
-    U64 white_pawn = zobrist.piece_hash(Colours::White, PieceType::P, BoardSquares::E4);
-    U64 white_knight = zobrist.piece_hash(Colours::White, PieceType::N, BoardSquares::E4);
+    U64 white_pawn = BazuuZobrist::piece_hash(Colours::White, PieceType::P, 28);
+    U64 white_knight = BazuuZobrist::piece_hash(Colours::White, PieceType::N, 28);
     REQUIRE(white_pawn != white_knight);
   }
 
   SECTION("Different colors have different hashes") {
-    U64 white_pawn = zobrist.piece_hash(Colours::White, PieceType::P, BoardSquares::E4);
-    U64 black_pawn = zobrist.piece_hash(Colours::Black, PieceType::P, BoardSquares::E4);
+    U64 white_pawn = BazuuZobrist::piece_hash(Colours::White, PieceType::P, 28);
+    U64 black_pawn = BazuuZobrist::piece_hash(Colours::Black, PieceType::P, 28);
     REQUIRE(white_pawn != black_pawn);
   }
 
   SECTION("Different squares have different hashes") {
-    U64 e4_pawn = zobrist.piece_hash(Colours::White, PieceType::P, BoardSquares::E4);
-    U64 e5_pawn = zobrist.piece_hash(Colours::White, PieceType::P, BoardSquares::E5);
+    U64 e4_pawn = BazuuZobrist::piece_hash(Colours::White, PieceType::P, 28);
+    U64 e5_pawn = BazuuZobrist::piece_hash(Colours::White, PieceType::P, 36);
     REQUIRE(e4_pawn != e5_pawn);
   }
+
+  SECTION("Keys are compile time constants and all distinct") {
+    static_assert(BazuuZobrist::piece_hash(Colours::Black, PieceType::K, 63) != 0);
+    std::set<U64> keys;
+    for (const auto &row : BazuuZobrist::KEYS.pieces)
+      keys.insert(std::begin(row), std::end(row));
+    keys.insert(std::begin(BazuuZobrist::KEYS.side_to_move), std::end(BazuuZobrist::KEYS.side_to_move));
+    keys.insert(std::begin(BazuuZobrist::KEYS.castling), std::end(BazuuZobrist::KEYS.castling));
+    keys.insert(std::begin(BazuuZobrist::KEYS.enpassant), std::end(BazuuZobrist::KEYS.enpassant));
+    REQUIRE(keys.size() == 12 * 64 + 2 + 16 + 8);
+  }
 }
 
 TEST_CASE("BazuuZobrist side hash", "[zobrist][side]") {
-  BazuuZobrist zobrist;
-
   SECTION("Side hashes are non-zero") {
-    U64 white_hash = zobrist.side_hash(Colours::White);
-    U64 black_hash = zobrist.side_hash(Colours::Black);
+    U64 white_hash = BazuuZobrist::side_hash(Colours::White);
+    U64 black_hash = BazuuZobrist::side_hash(Colours::Black);
     REQUIRE(white_hash != 0);
     REQUIRE(black_hash != 0);
   }
 
   SECTION("Different sides have different hashes") {
-    U64 white_hash = zobrist.side_hash(Colours::White);
-    U64 black_hash = zobrist.side_hash(Colours::Black);
+    U64 white_hash = BazuuZobrist::side_hash(Colours::White);
+    U64 black_hash = BazuuZobrist::side_hash(Colours::Black);
     REQUIRE(white_hash != black_hash);
   }
 }
 
 TEST_CASE("BazuuZobrist castling hash", "[zobrist][castling]") {
-  BazuuZobrist zobrist;
-
   SECTION("Different castling rights have different hashes") {
-    U64 no_castling = zobrist.castling_hash(0);
-    U64 white_short = zobrist.castling_hash(1);
-    U64 white_long = zobrist.castling_hash(2);
-    U64 all_castling = zobrist.castling_hash(15);
+    U64 no_castling = BazuuZobrist::castling_hash(0);
+    U64 white_short = BazuuZobrist::castling_hash(1);
+    U64 white_long = BazuuZobrist::castling_hash(2);
+    U64 all_castling = BazuuZobrist::castling_hash(15);
 
     REQUIRE(no_castling != white_short);
     REQUIRE(white_short != white_long);
@@ -797,26 +980,24 @@ TEST_CASE("BazuuZobrist castling hash", "[zobrist][castling]") {
   SECTION("All 16 castling permissions have unique hashes") {
     std::set<U64> hashes;
     for (uint8_t perm = 0; perm < 16; ++perm) {
-      hashes.insert(zobrist.castling_hash(perm));
+      hashes.insert(BazuuZobrist::castling_hash(perm));
     }
     REQUIRE(hashes.size() == 16);
   }
 }
 
 TEST_CASE("BazuuZobrist en passant hash", "[zobrist][enpassant]") {
-  BazuuZobrist zobrist;
-
   SECTION("En passant hashes are non-zero for valid files") {
-    U64 a_file = zobrist.enpassant_hash(BoardSquares::A3);
-    U64 e_file = zobrist.enpassant_hash(BoardSquares::E3);
+    U64 a_file = BazuuZobrist::enpassant_hash(std::to_underlying(File::A));
+    U64 e_file = BazuuZobrist::enpassant_hash(std::to_underlying(File::E));
     REQUIRE(a_file != 0);
     REQUIRE(e_file != 0);
   }
 
   SECTION("Different en passant files have different hashes") {
-    U64 a_file = zobrist.enpassant_hash(BoardSquares::A3);
-    U64 b_file = zobrist.enpassant_hash(BoardSquares::B3);
-    U64 e_file = zobrist.enpassant_hash(BoardSquares::E3);
+    U64 a_file = BazuuZobrist::enpassant_hash(std::to_underlying(File::A));
+    U64 b_file = BazuuZobrist::enpassant_hash(std::to_underlying(File::B));
+    U64 e_file = BazuuZobrist::enpassant_hash(std::to_underlying(File::E));
 
     REQUIRE(a_file != b_file);
     REQUIRE(b_file != e_file);
@@ -1245,6 +1426,21 @@ TEST_CASE("Black pawn promotion captures", "[bitboard][pawn][black][promotion][c
   }
 }
 
+// ============================================================================
+// BITBOARD OPERATIONS TESTS - PAWN TRAITS
+// ============================================================================
+
+// The pawn helpers of both colours are one template, each side's ranks and directions mirror the other's.
+static_assert(BazuuBitBoardOps::PawnTraits<Colours::White>::PUSH ==
+              -BazuuBitBoardOps::PawnTraits<Colours::Black>::PUSH);
+static_assert(BazuuBitBoardOps::doublePushTargets<Colours::White>(0x000000000000FF00ULL, ~0ULL) ==
+              BazuuBitBoardOps::PawnTraits<Colours::White>::DOUBLE_PUSH_RANK);
+static_assert(BazuuBitBoardOps::doublePushTargets<Colours::Black>(0x00FF000000000000ULL, ~0ULL) ==
+              BazuuBitBoardOps::PawnTraits<Colours::Black>::DOUBLE_PUSH_RANK);
+static_assert(BazuuBitBoardOps::pawnPossibleAttacksTargets<Colours::Black>(1ULL << 36) ==
+              ((1ULL << 27) | (1ULL << 29)));
+static_assert(BazuuBitBoardOps::WhitePawnPossibleAttacksTargets(1ULL << 8) == (1ULL << 17));
+
 // ============================================================================
 // SQUARE ATTACKED TESTS
 // ============================================================================
@@ -1313,7 +1509,7 @@ TEST_CASE("is_square_attacked by rooks", "[board][attacked][rook]") {
   BazuuBoard board;
 
   SECTION("White rook attacks files and ranks") {
-    board.setup_fen("4k3/8/8/8/4R3/8/8/4K3 w - - 0 1");
+    board.setup_fen("4k3/8/8/8/4R3/8/8/4K3 b - - 0 1");
     // Rook on E4 attacks E-file and 4th rank
     REQUIRE(board.is_square_attacked(BoardSquares::E1, Colours::White) == true);
     REQUIRE(board.is_square_attacked(BoardSquares::E8, Colours::White) == true);
@@ -1335,7 +1531,7 @@ TEST_CASE("is_square_attacked by queens", "[board][attacked][queen]") {
   BazuuBoard board;
 
   SECTION("White queen attacks all directions") {
-    board.setup_fen("4k3/8/8/8/4Q3/8/8/4K3 w - - 0 1");
+    board.setup_fen("4k3/8/8/8/4Q3/8/8/4K3 b - - 0 1");
     // Queen on E4 attacks like rook + bishop
     REQUIRE(board.is_square_attacked(BoardSquares::E8, Colours::White) == true); // Vertical
     REQUIRE(board.is_square_attacked(BoardSquares::A4, Colours::White) == true); // Horizontal
@@ -1373,7 +1569,7 @@ TEST_CASE("is_square_attacked complex positions", "[board][attacked][complex]")
   }
 
   SECTION("King in check detection") {
-    board.setup_fen("4k3/8/8/8/4R3/8/8/4K3 w - - 0 1");
+    board.setup_fen("4k3/8/8/8/4R3/8/8/4K3 b - - 0 1");
     // White rook on E4 attacks black king on E8
     REQUIRE(board.is_square_attacked(BoardSquares::E8, Colours::White) == true);
   }
@@ -1420,7 +1616,7 @@ TEST_CASE("Board initialization consistency", "[board][init]") {
   }
 
   SECTION("Magic bitboard tables work after init") {
-    board.setup_fen("8/8/8/8/4B3/8/8/8 w - - 0 1");
+    board.setup_fen("8/k7/8/8/4B3/8/7K/8 w - - 0 1", false);
     BitBoard occ = board.occupancy();
 
     // Bishop magic lookup should work
@@ -1429,7 +1625,7 @@ TEST_CASE("Board initialization consistency", "[board][init]") {
     REQUIRE(std::popcount(bishop_attacks) == 13); // Bishop on empty board from E4
 
     // Rook magic lookup should work
-    board.setup_fen("8/8/8/8/4R3/8/8/8 w - - 0 1");
+    board.setup_fen("8/k7/8/8/4R3/8/7K/8 w - - 0 1", false);
     occ = board.occupancy();
     BitBoard rook_attacks = board.get_rook_attacks_lookup(BoardSquares::E4, occ);
     REQUIRE(rook_attacks != 0);
@@ -1513,3 +1709,2155 @@ TEST_CASE("side_occupancy correctness", "[board][bitboard][sides]") {
     REQUIRE(white_calc == white_actual);
   }
 }
+
+// ============================================================================
+// NNUE EVALUATION TESTS
+// ============================================================================
+
+TEST_CASE("NNUE feature indices", "[nnue][features]") {
+  SECTION("Black perspective mirrors the board vertically") {
+    // White pawn on e2 seen by White matches black pawn on e7 seen by Black, both kings on their home square.
+    std::uint32_t white_view = BazuuNNUE::feature_index(Colours::White, 4, Colours::White, PieceType::P, 12);
+    std::uint32_t black_view = BazuuNNUE::feature_index(Colours::Black, 60, Colours::Black, PieceType::P, 52);
+    REQUIRE(white_view == black_view);
+  }
+
+  SECTION("Features are in range") {
+    for (std::uint8_t king = 0; king < 64; king++) {
+      for (std::uint8_t sq = 0; sq < 64; sq++) {
+        REQUIRE(BazuuNNUE::feature_index(Colours::Black, king, Colours::White, PieceType::K, sq) <
+                BazuuNNUEArch::INPUT_FEATURES);
+      }
+    }
+  }
+}
+
+TEST_CASE("NNUE incremental updates match refresh", "[nnue][accumulator]") {
+  BazuuBoard board;
+  BazuuNNUE nnue;
+  nnue.init_random(7);
+
+  board.setup_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+  BazuuAccumulator incremental;
+  nnue.refresh(incremental, board);
+  std::uint8_t kings[2] = {4, 60};
+  // 1. e4, played on the accumulator only.
+  nnue.move_piece(incremental, kings, Colours::White, PieceType::P, 12, 28);
+
+  board.setup_fen("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1");
+  BazuuAccumulator refreshed;
+  nnue.refresh(refreshed, board);
+
+  for (int side = 0; side < 2; side++) {
+    for (std::uint32_t i = 0; i < BazuuNNUEArch::HIDDEN_SIZE; i++) {
+      REQUIRE(incremental.values[side][i] == refreshed.values[side][i]);
+    }
+  }
+  REQUIRE(nnue.evaluate(incremental, Colours::Black) == nnue.evaluate(refreshed, Colours::Black));
+}
+
+TEST_CASE("NNUE SIMD kernels match the scalar reference", "[nnue][simd]") {
+  BazuuBoard board;
+  BazuuNNUE nnue;
+  nnue.init_random(11);
+  SimdLevel best = BazuuNNUE::detect_simd_level();
+
+  for (const char *fen : {TRICKY_BOARD_FEN, KILLER_BOARD_FEN, CMK_BOARD_FEN}) {
+    board.setup_fen(fen, false);
+    BazuuAccumulator reference;
+    nnue.set_simd_level(SimdLevel::Scalar);
+    nnue.refresh(reference, board);
+    std::int32_t expected = nnue.evaluate_scalar(reference, Colours::White);
+
+    for (std::uint8_t level = 0; level <= std::to_underlying(best); level++) {
+      REQUIRE(nnue.set_simd_level(SimdLevel(level)) == SimdLevel(level));
+      BazuuAccumulator accumulator;
+      nnue.refresh(accumulator, board);
+      REQUIRE(std::memcmp(accumulator.values, reference.values, sizeof(reference.values)) == 0);
+      REQUIRE(nnue.evaluate(accumulator, Colours::White) == expected);
+    }
+  }
+}
+
+TEST_CASE("NNUE hidden layer at the int8 extremes", "[nnue][simd]") {
+  using namespace BazuuNNUEArch;
+  std::filesystem::path path = std::filesystem::temp_directory_path() / "bazuu_test_extremes.nnue";
+  // Every accumulator at QA and hidden weights at both int8 ends: pairs of inputs add up to the largest and the
+  // smallest sums an int16 lane of the SIMD kernels has to hold. The biases bring hidden unit j back to j + 1.
+  std::vector<std::int16_t> feature_weights(std::size_t{INPUT_FEATURES} * HIDDEN_SIZE, 0);
+  std::vector<std::int16_t> feature_bias(HIDDEN_SIZE, QA);
+  std::vector<std::int8_t> hidden_weights(std::size_t{L1_SIZE} * 2 * HIDDEN_SIZE);
+  std::vector<std::int32_t> hidden_bias(L1_SIZE);
+  std::vector<std::int16_t> output_weights(L1_SIZE, 64);
+  const std::int32_t output_bias = 0;
+  for (std::uint32_t j = 0; j < L1_SIZE; j++) {
+    std::int32_t row_sum = 0;
+    for (std::uint32_t i = 0; i < 2 * HIDDEN_SIZE; i++) {
+      const std::int8_t weight = (i / 2) % 4 == 3 ? INT8_MIN : INT8_MAX;
+      hidden_weights[j * 2 * HIDDEN_SIZE + i] = weight;
+      row_sum += QA * weight;
+    }
+    hidden_bias[j] = -row_sum + static_cast<std::int32_t>(j + 1) * (1 << L1_SHIFT);
+  }
+  {
+    std::ofstream file(path, std::ios::binary);
+    const std::uint32_t header[5] = {FILE_MAGIC, FILE_VERSION, INPUT_FEATURES, HIDDEN_SIZE, L1_SIZE};
+    auto write = [&file](const auto &values) {
+      file.write(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(values[0]));
+    };
+    file.write(reinterpret_cast<const char *>(header), sizeof(header));
+    write(feature_weights);
+    write(feature_bias);
+    write(hidden_weights);
+    write(hidden_bias);
+    write(output_weights);
+    file.write(reinterpret_cast<const char *>(&output_bias), sizeof(output_bias));
+  }
+  auto nnue = std::make_unique<BazuuNNUE>();
+  REQUIRE(nnue->load(path.string()) == NNUELoadStatus::Ok);
+  std::filesystem::remove(path);
+
+  BazuuBoard board;
+  board.setup_fen(BazuuBoard::STARTING_FEN);
+  BazuuAccumulator accumulator;
+  nnue->refresh(accumulator, board);
+  // Hidden units 1 to L1_SIZE, each times 64, scaled to centipawns.
+  const std::int32_t expected = L1_SIZE * (L1_SIZE + 1) / 2 * 64 * OUTPUT_SCALE / (QA * QB);
+  REQUIRE(nnue->evaluate_scalar(accumulator, Colours::White) == expected);
+  for (std::uint8_t level = 0; level <= std::to_underlying(BazuuNNUE::detect_simd_level()); level++) {
+    REQUIRE(nnue->set_simd_level(SimdLevel(level)) == SimdLevel(level));
+    REQUIRE(nnue->evaluate(accumulator, Colours::White) == expected);
+  }
+}
+
+TEST_CASE("NNUE evaluation is colour symmetric", "[nnue][eval]") {
+  BazuuBoard board;
+  BazuuNNUE nnue;
+  nnue.init_random(3);
+  BazuuAccumulator accumulator;
+
+  board.setup_fen(BazuuBoard::STARTING_FEN);
+  nnue.refresh(accumulator, board);
+  REQUIRE(nnue.evaluate(accumulator, Colours::White) == nnue.evaluate(accumulator, Colours::Black));
+}
+
+TEST_CASE("NNUE network files", "[nnue][file]") {
+  std::filesystem::path path = std::filesystem::temp_directory_path() / "bazuu_test.nnue";
+  BazuuBoard board;
+  board.setup_fen(TRICKY_BOARD_FEN);
+
+  SECTION("Save and load roundtrip") {
+    BazuuNNUE saved;
+    saved.init_random(5);
+    REQUIRE(saved.save(path.string()));
+    BazuuNNUE loaded;
+    REQUIRE(loaded.load(path.string()) == NNUELoadStatus::Ok);
+
+    BazuuAccumulator a, b;
+    saved.refresh(a, board);
+    loaded.refresh(b, board);
+    REQUIRE(saved.evaluate(a, Colours::White) == loaded.evaluate(b, Colours::White));
+  }
+
+  SECTION("Missing file") {
+    BazuuNNUE nnue;
+    REQUIRE(nnue.load((path.parent_path() / "does_not_exist.nnue").string()) == NNUELoadStatus::FileNotFound);
+  }
+
+  SECTION("Bad header is rejected") {
+    std::uint32_t header[5] = {BazuuNNUEArch::FILE_MAGIC, BazuuNNUEArch::FILE_VERSION + 1,
+                               BazuuNNUEArch::INPUT_FEATURES, BazuuNNUEArch::HIDDEN_SIZE, BazuuNNUEArch::L1_SIZE};
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char *>(header), sizeof(header));
+    BazuuNNUE nnue;
+    REQUIRE(nnue.load(path.string()) == NNUELoadStatus::VersionMismatch);
+
+    header[0] = 0xDEADBEEF;
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char *>(header), sizeof(header));
+    REQUIRE(nnue.load(path.string()) == NNUELoadStatus::BadMagic);
+
+    header[0] = BazuuNNUEArch::FILE_MAGIC;
+    header[1] = BazuuNNUEArch::FILE_VERSION;
+    header[4] = BazuuNNUEArch::L1_SIZE * 2;
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char *>(header), sizeof(header));
+    REQUIRE(nnue.load(path.string()) == NNUELoadStatus::ArchMismatch);
+  }
+
+  SECTION("Truncated file is rejected") {
+    std::uint32_t header[5] = {BazuuNNUEArch::FILE_MAGIC, BazuuNNUEArch::FILE_VERSION, BazuuNNUEArch::INPUT_FEATURES,
+                               BazuuNNUEArch::HIDDEN_SIZE, BazuuNNUEArch::L1_SIZE};
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char *>(header), sizeof(header));
+    BazuuNNUE nnue;
+    REQUIRE(nnue.load(path.string()) == NNUELoadStatus::Truncated);
+  }
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("NNUE accumulator cache refresh", "[nnue][cache]") {
+  BazuuBoard board;
+  BazuuNNUE nnue;
+  nnue.init_random(13);
+  auto cache = std::make_unique<BazuuAccumulatorCache>();
+  nnue.reset_cache(*cache);
+
+  // Same king squares, different pieces: the second refresh only applies the diff.
+  for (const char *fen : {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+                          "r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1", "4k3/pppppppp/8/8/8/8/PPPPPPPP/4K3 w - - 0 1"}) {
+    board.setup_fen(fen);
+    BazuuAccumulator cached, full;
+    nnue.refresh(cached, board, Colours::White, *cache);
+    nnue.refresh(cached, board, Colours::Black, *cache);
+    nnue.refresh(full, board);
+    REQUIRE(std::memcmp(cached.values, full.values, sizeof(full.values)) == 0);
+  }
+}
+
+TEST_CASE("NNUE lazy accumulator stack", "[nnue][cache][lazy]") {
+  BazuuBoard board;
+  BazuuNNUE nnue;
+  nnue.init_random(17);
+  auto cache = std::make_unique<BazuuAccumulatorCache>();
+  auto stack = std::make_unique<BazuuAccumulatorStack>();
+  nnue.reset_cache(*cache);
+  std::uint8_t kings[2] = {4, 60};
+
+  SECTION("Dirty pieces are replayed only when evaluated") {
+    board.setup_fen(BazuuBoard::STARTING_FEN);
+    stack->reset(kings);
+    nnue.evaluate(*stack, board, *cache, Colours::White);
+    BazuuDirtyPiece e4[] = {{Colours::White, PieceType::P, 12, 28}};
+    stack->push(e4, 1, kings);
+    BazuuDirtyPiece d5[] = {{Colours::Black, PieceType::P, 51, 35}};
+    stack->push(d5, 1, kings);
+    BazuuDirtyPiece exd5[] = {{Colours::White, PieceType::P, 28, 35}, {Colours::Black, PieceType::P, 35, 64}};
+    stack->push(exd5, 2, kings);
+    REQUIRE_FALSE(stack->accumulators[1].computed[0]);
+    REQUIRE_FALSE(stack->current().computed[0]);
+
+    board.setup_fen("rnbqkbnr/ppp1pppp/8/3P4/8/8/PPPP1PPP/RNBQKBNR b KQkq - 0 2");
+    std::int32_t lazy = nnue.evaluate(*stack, board, *cache, Colours::Black);
+    BazuuAccumulator full;
+    nnue.refresh(full, board);
+    REQUIRE(std::memcmp(stack->current().values, full.values, sizeof(full.values)) == 0);
+    REQUIRE(lazy == nnue.evaluate(full, Colours::Black));
+  }
+
+  SECTION("King bucket change refreshes through the cache") {
+    board.setup_fen("4k3/8/8/8/8/8/4P3/4K3 w - - 0 1");
+    stack->reset(kings);
+    nnue.evaluate(*stack, board, *cache, Colours::White);
+    // Ke1-d2 moves the white king from the back rank bucket to the second rank bucket.
+    std::uint8_t moved_kings[2] = {11, 60};
+    BazuuDirtyPiece kd2[] = {{Colours::White, PieceType::K, 4, 11}};
+    stack->push(kd2, 1, moved_kings);
+
+    board.setup_fen("4k3/8/8/8/8/8/3KP3/8 b - - 1 1");
+    nnue.update(*stack, board, *cache);
+    BazuuAccumulator full;
+    nnue.refresh(full, board);
+    REQUIRE(std::memcmp(stack->current().values, full.values, sizeof(full.values)) == 0);
+  }
+}
+
+// ============================================================================
+// EVALUATION CACHE TESTS
+// ============================================================================
+
+TEST_CASE("Evaluation cache probe and store", "[evalcache]") {
+  BazuuEvalCache cache(1);
+
+  SECTION("Size is a power of two") {
+    REQUIRE(std::has_single_bit(cache.size()));
+    REQUIRE(cache.size() == 1024 * 1024 / sizeof(std::uint64_t));
+  }
+
+  SECTION("Stored scores are found") {
+    std::int16_t score = 0;
+    REQUIRE_FALSE(cache.probe(0x123456789ABCDEF0ULL, score));
+    cache.store(0x123456789ABCDEF0ULL, -42);
+    REQUIRE(cache.probe(0x123456789ABCDEF0ULL, score));
+    REQUIRE(score == -42);
+  }
+
+  SECTION("Same slot with another key is a miss") {
+    std::int16_t score = 0;
+    cache.store(0x123456789ABCDEF0ULL, 17);
+    REQUIRE_FALSE(cache.probe(0x923456789ABCDEF0ULL, score));
+  }
+
+  SECTION("Scores are clamped to 16 bits") {
+    std::int16_t score = 0;
+    cache.store(0xFEDCBA9876543210ULL, 100000);
+    REQUIRE(cache.probe(0xFEDCBA9876543210ULL, score));
+    REQUIRE(score == INT16_MAX);
+  }
+
+  SECTION("Clear empties the cache") {
+    std::int16_t score = 0;
+    cache.store(0x123456789ABCDEF0ULL, 5);
+    cache.clear();
+    REQUIRE_FALSE(cache.probe(0x123456789ABCDEF0ULL, score));
+  }
+}
+
+TEST_CASE("Evaluation cache in front of NNUE", "[evalcache][nnue]") {
+  BazuuBoard board;
+  BazuuNNUE nnue;
+  nnue.init_random(19);
+  BazuuEvalCache eval_cache(1);
+  auto cache = std::make_unique<BazuuAccumulatorCache>();
+  auto stack = std::make_unique<BazuuAccumulatorStack>();
+  nnue.reset_cache(*cache);
+
+  board.setup_fen(TRICKY_BOARD_FEN);
+  std::uint8_t kings[2] = {board.to_64_board_square(board.king_square(Colours::White)),
+                           board.to_64_board_square(board.king_square(Colours::Black))};
+  stack->reset(kings);
+  std::int32_t first = nnue.evaluate(*stack, board, *cache, eval_cache);
+
+  std::int16_t cached = 0;
+  REQUIRE(eval_cache.probe(board.zobrist_key(), cached));
+  REQUIRE(cached == first);
+  stack->reset(kings);
+  REQUIRE(nnue.evaluate(*stack, board, *cache, eval_cache) == first);
+  REQUIRE_FALSE(stack->current().computed[0]);
+}
+
+TEST_CASE("Evaluation cache in the search", "[evalcache][search]") {
+  auto board = std::make_unique<BazuuBoard>();
+  auto nnue = std::make_unique<BazuuNNUE>();
+  nnue->init_random(42);
+  board->setup_fen(TRICKY_BOARD_FEN);
+  BazuuSearchLimits limits;
+  limits.depth = 3;
+  BazuuSearchResult uncached = BazuuSearch(*board, nnue.get()).search(limits);
+
+  BazuuEvalCache eval_cache(1);
+  BazuuSearch search(*board, nnue.get());
+  search.eval_cache = &eval_cache;
+  BazuuSearchResult cached = search.search(limits);
+  REQUIRE(cached.best_move == uncached.best_move);
+  REQUIRE(cached.score == uncached.score);
+  REQUIRE(cached.stats.nodes == uncached.stats.nodes);
+
+  // The positions after the root moves were evaluated through the cache, a miss returns the score a hit would.
+  auto accumulator = std::make_unique<BazuuAccumulator>();
+  BazuuMoveList list;
+  board->generate_moves(list);
+  std::uint16_t hits = 0;
+  for (std::uint16_t i = 0; i < list.count; i++) {
+    if (!board->make_move(list.moves[i]))
+      continue;
+    std::int16_t score = 0;
+    if (eval_cache.probe(board->zobrist_key(), score)) {
+      nnue->refresh(*accumulator, *board);
+      REQUIRE(score == std::clamp<std::int32_t>(nnue->evaluate(*accumulator, board->side_to_move()), INT16_MIN,
+                                                INT16_MAX));
+      hits++;
+    }
+    board->unmake_move(list.moves[i]);
+  }
+  REQUIRE(hits > 0);
+
+  // The classical evaluation is cheaper than the cache and does not go through it.
+  eval_cache.clear();
+  BazuuSearch classical(*board);
+  classical.eval_cache = &eval_cache;
+  classical.search(limits);
+  std::int16_t score = 0;
+  REQUIRE_FALSE(eval_cache.probe(board->zobrist_key(), score));
+}
+
+// ============================================================================
+// MOVE ENCODING AND ORDERING TESTS
+// ============================================================================
+
+TEST_CASE("Move encoding", "[move]") {
+  SECTION("Fields roundtrip") {
+    BazuuMove move = BazuuMove::encode(52, 61, Pieces::wP, Pieces::bR, Pieces::wQ);
+    REQUIRE(move.from_64() == 52);
+    REQUIRE(move.to_64() == 61);
+    REQUIRE(move.piece() == Pieces::wP);
+    REQUIRE(move.captured() == Pieces::bR);
+    REQUIRE(move.promotion() == Pieces::wQ);
+    REQUIRE(move.flag() == MoveFlag::None);
+    REQUIRE(move.is_capture());
+    REQUIRE_FALSE(move.is_quiet());
+    REQUIRE(move.to_uci() == "e7f8q");
+  }
+
+  SECTION("Piece helpers") {
+    REQUIRE(to_piece(Colours::Black, PieceType::K) == Pieces::bK);
+    REQUIRE(piece_type(Pieces::bN) == PieceType::N);
+    REQUIRE(piece_colour(Pieces::wK) == Colours::White);
+    REQUIRE(piece_type(Pieces::Empty) == PieceType::Empty);
+  }
+}
+
+TEST_CASE("History gravity stays bounded", "[ordering][history]") {
+  std::int16_t entry = 0;
+  for (int i = 0; i < 1000; i++) {
+    BazuuMoveOrdering::apply_gravity(entry, BazuuMoveOrdering::history_bonus(20));
+    REQUIRE(entry <= BazuuMoveOrdering::HISTORY_MAX);
+  }
+  REQUIRE(entry > BazuuMoveOrdering::HISTORY_MAX * 9 / 10);
+  for (int i = 0; i < 1000; i++) {
+    BazuuMoveOrdering::apply_gravity(entry, -BazuuMoveOrdering::history_bonus(20));
+    REQUIRE(entry >= -BazuuMoveOrdering::HISTORY_MAX);
+  }
+  REQUIRE(entry < -BazuuMoveOrdering::HISTORY_MAX * 9 / 10);
+}
+
+TEST_CASE("Move ordering heuristics", "[ordering]") {
+  auto ordering = std::make_unique<BazuuMoveOrdering>();
+  BazuuMove e2e4 = BazuuMove::encode(12, 28, Pieces::wP, Pieces::Empty, Pieces::Empty, MoveFlag::DoublePush);
+  BazuuMove g1f3 = BazuuMove::encode(6, 21, Pieces::wN);
+  BazuuMove b1c3 = BazuuMove::encode(1, 18, Pieces::wN);
+  BazuuMove d2d3 = BazuuMove::encode(11, 19, Pieces::wP);
+  BazuuMove nxe5 = BazuuMove::encode(21, 36, Pieces::wN, Pieces::bP);
+  BazuuMove bxe5 = BazuuMove::encode(21, 36, Pieces::wB, Pieces::bQ);
+  BazuuMove e7e5 = BazuuMove::encode(52, 36, Pieces::bP, Pieces::Empty, Pieces::Empty, MoveFlag::DoublePush);
+
+  SECTION("Cutoff updates killers, counter move and histories") {
+    BazuuMove tried[] = {b1c3, d2d3};
+    ordering->update_quiet_histories(Colours::White, 3, 6, g1f3, tried, 2, e7e5, e2e4);
+    REQUIRE(ordering->killer(3, 0) == g1f3);
+    REQUIRE(ordering->counter_move(e7e5) == g1f3);
+    REQUIRE(ordering->butterfly_history(Colours::White, g1f3) > 0);
+    REQUIRE(ordering->butterfly_history(Colours::White, b1c3) < 0);
+    REQUIRE(ordering->butterfly_history(Colours::Black, g1f3) == 0);
+    REQUIRE(ordering->continuation_history(1, e7e5, g1f3) > 0);
+    REQUIRE(ordering->continuation_history(2, e2e4, d2d3) < 0);
+  }
+
+  SECTION("Killers keep the two most recent distinct moves") {
+    ordering->update_killers(5, g1f3);
+    ordering->update_killers(5, g1f3);
+    ordering->update_killers(5, b1c3);
+    REQUIRE(ordering->killer(5, 0) == b1c3);
+    REQUIRE(ordering->killer(5, 1) == g1f3);
+  }
+
+  SECTION("Scored moves come out in band order") {
+    BazuuMove tried[] = {d2d3};
+    ordering->update_quiet_histories(Colours::White, 2, 4, g1f3, tried, 1, e7e5, BazuuMove{});
+    BazuuMoveList list;
+    for (BazuuMove move : {d2d3, b1c3, nxe5, g1f3, bxe5, e2e4})
+      list.add(move);
+    ordering->score_moves(list, Colours::White, 2, e2e4, e7e5, BazuuMove{});
+    BazuuMove expected[] = {e2e4, bxe5, nxe5, g1f3, b1c3, d2d3};
+    for (std::uint16_t i = 0; i < list.count; i++) {
+      REQUIRE(BazuuMoveOrdering::pick_move(list, i) == expected[i]);
+    }
+  }
+
+  SECTION("Switched off heuristics are neither updated nor used") {
+    BazuuMove tried[] = {b1c3};
+    ordering->update_quiet_histories(Colours::White, 3, 6, g1f3, tried, 1, e7e5, e2e4);
+    ordering->options = {.killer_moves = false, .history = true, .counter_moves = false, .continuation_history = false};
+    BazuuMoveList list;
+    list.add(g1f3);
+    ordering->score_moves(list, Colours::White, 3, BazuuMove{}, e7e5, e2e4);
+    REQUIRE(list.scores[0] == ordering->butterfly_history(Colours::White, g1f3));
+
+    ordering->options = {
+        .killer_moves = false, .history = false, .counter_moves = false, .continuation_history = false};
+    ordering->score_moves(list, Colours::White, 3, BazuuMove{}, e7e5, e2e4);
+    REQUIRE(list.scores[0] == 0);
+    ordering->clear();
+    ordering->update_quiet_histories(Colours::White, 3, 6, g1f3, tried, 1, e7e5, e2e4);
+    REQUIRE(ordering->killer(3, 0).is_null());
+    REQUIRE(ordering->counter_move(e7e5).is_null());
+    REQUIRE(ordering->butterfly_history(Colours::White, g1f3) == 0);
+    REQUIRE(ordering->continuation_history(1, e7e5, g1f3) == 0);
+  }
+}
+
+// ============================================================================
+// MOVE GENERATION AND MAKE/UNMAKE TESTS
+// ============================================================================
+
+TEST_CASE("Perft - starting position", "[board][perft]") {
+  BazuuBoard board;
+  board.setup_fen(BazuuBoard::STARTING_FEN);
+  REQUIRE(board.perft(1) == 20);
+  REQUIRE(board.perft(2) == 400);
+  REQUIRE(board.perft(3) == 8902);
+  REQUIRE(board.perft(4) == 197281);
+}
+
+TEST_CASE("Perft - tricky positions", "[board][perft]") {
+  BazuuBoard board;
+
+  SECTION("Kiwipete") {
+    board.setup_fen(TRICKY_BOARD_FEN);
+    REQUIRE(board.perft(1) == 48);
+    REQUIRE(board.perft(2) == 2039);
+    REQUIRE(board.perft(3) == 97862);
+  }
+
+  SECTION("Rook and pawns endgame with en passant pins") {
+    board.setup_fen("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1");
+    REQUIRE(board.perft(1) == 14);
+    REQUIRE(board.perft(2) == 191);
+    REQUIRE(board.perft(3) == 2812);
+    REQUIRE(board.perft(4) == 43238);
+  }
+
+  SECTION("Promotions and castling rights") {
+    board.setup_fen("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1");
+    REQUIRE(board.perft(1) == 6);
+    REQUIRE(board.perft(2) == 264);
+    REQUIRE(board.perft(3) == 9467);
+  }
+
+  SECTION("Discovered checks and promotions") {
+    board.setup_fen("rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8");
+    REQUIRE(board.perft(1) == 44);
+    REQUIRE(board.perft(2) == 1486);
+    REQUIRE(board.perft(3) == 62379);
+  }
+}
+
+TEST_CASE("Make and unmake move", "[board][makemove]") {
+  BazuuBoard board;
+  board.setup_fen(TRICKY_BOARD_FEN);
+  ZobristKey key = board.zobrist_key();
+  BitBoard occupancy = board.occupancy();
+
+  SECTION("Incremental hash matches a full recompute and unmake restores the position") {
+    BazuuMoveList list;
+    board.generate_moves(list);
+    for (std::uint16_t i = 0; i < list.count; i++) {
+      if (!board.make_move(list.moves[i]))
+        continue;
+      REQUIRE(board.zobrist_key() == board.generate_hash_keys());
+      board.unmake_move(list.moves[i]);
+      REQUIRE(board.zobrist_key() == key);
+      REQUIRE(board.occupancy() == occupancy);
+      REQUIRE(board.history_ply == 0);
+    }
+  }
+
+  SECTION("Captures update the material counters") {
+    REQUIRE(board.non_pawn_pieces[std::to_underlying(Colours::Black)] == 7);
+    // Bishop e2 takes the bishop on a6.
+    BazuuMove bxa6 = BazuuMove::encode(12, 40, Pieces::wB, Pieces::bB);
+    REQUIRE(board.piece_on_square(40) == Pieces::bB);
+    REQUIRE(board.make_move(bxa6));
+    REQUIRE(board.non_pawn_pieces[std::to_underlying(Colours::Black)] == 6);
+    REQUIRE(board.minor_pieces[std::to_underlying(Colours::Both)] == 7);
+    REQUIRE(board.piece_on_square(40) == Pieces::wB);
+    REQUIRE(board.side_to_move() == Colours::Black);
+    board.unmake_move(bxa6);
+    REQUIRE(board.non_pawn_pieces[std::to_underlying(Colours::Black)] == 7);
+    REQUIRE(board.piece_on_square(40) == Pieces::bB);
+  }
+
+  SECTION("The mailbox follows every move") {
+    REQUIRE(board.is_consistent());
+    BazuuMoveList list;
+    board.generate_moves(list);
+    for (std::uint16_t i = 0; i < list.count; i++) {
+      const BazuuMove move = list.moves[i];
+      REQUIRE(board.piece_on_square(move.from_64()) == move.piece());
+      if (!board.make_move(move))
+        continue;
+      REQUIRE(board.is_consistent());
+      REQUIRE(board.piece_on_square(move.from_64()) == Pieces::Empty);
+      REQUIRE(board.piece_on_square(move.to_64()) == (move.is_promotion() ? move.promotion() : move.piece()));
+      board.unmake_move(move);
+      REQUIRE(board.is_consistent());
+      if (move.flag() != MoveFlag::EnPassant)
+        REQUIRE(board.piece_on_square(move.to_64()) == move.captured());
+    }
+  }
+
+  SECTION("Unmake restores the whole state and board copies are independent") {
+    BazuuMoveList list;
+    board.generate_moves(list);
+    std::uint16_t first = 0;
+    while (!board.make_move(list.moves[first]))
+      first++;
+    // Black to move, so unmaking its moves also takes back the move number.
+    const std::string fen = board.to_fen();
+    auto copy = std::make_unique<BazuuBoard>(board);
+    board.generate_moves(list);
+    for (std::uint16_t i = 0; i < list.count; i++) {
+      if (!board.make_move(list.moves[i]))
+        continue;
+      board.unmake_move(list.moves[i]);
+      REQUIRE(board.to_fen() == fen);
+    }
+    REQUIRE(copy->to_fen() == fen);
+    for (std::uint16_t i = 0; i < list.count; i++) {
+      if (!copy->make_move(list.moves[i]))
+        continue;
+      REQUIRE(copy->zobrist_key() == copy->generate_hash_keys());
+      REQUIRE(board.to_fen() == fen);
+      break;
+    }
+  }
+
+  SECTION("Null move only passes the turn") {
+    board.make_null_move();
+    REQUIRE(board.side_to_move() == Colours::Black);
+    REQUIRE(board.zobrist_key() == board.generate_hash_keys());
+    board.unmake_null_move();
+    REQUIRE(board.zobrist_key() == key);
+  }
+
+  SECTION("A full undo history refuses moves and leaves the board unchanged") {
+    for (std::uint16_t ply = 0; ply < BazuuBoard::MAX_PLY; ply++)
+      REQUIRE(board.make_null_move());
+    const std::string fen = board.to_fen();
+    REQUIRE_FALSE(board.make_null_move());
+    BazuuMoveList list;
+    board.generate_moves(list);
+    for (std::uint16_t i = 0; i < list.count; i++)
+      REQUIRE_FALSE(board.make_move(list.moves[i]));
+    REQUIRE(board.to_fen() == fen);
+    for (std::uint16_t ply = 0; ply < BazuuBoard::MAX_PLY; ply++)
+      board.unmake_null_move();
+    REQUIRE(board.zobrist_key() == key);
+  }
+}
+
+TEST_CASE("Attack info", "[board][attacks]") {
+  auto board = std::make_unique<BazuuBoard>();
+  board->setup_fen(TRICKY_BOARD_FEN);
+
+  // Every square of a side's attack map is attacked, and only those.
+  auto matches_square_attacks = [](BazuuBoard &position) {
+    const BazuuAttackInfo &info = position.attack_info();
+    for (std::uint8_t square = 0; square < 64; square++) {
+      for (Colours colour : {Colours::White, Colours::Black}) {
+        const bool in_map =
+            (info.attacked_by[std::to_underlying(colour)][std::to_underlying(PieceType::Empty)] >> square) & 1;
+        if (in_map != position.is_square_attacked(position.to_120_board_square(square), colour))
+          return false;
+      }
+    }
+    return true;
+  };
+
+  SECTION("Attack maps agree with is_square_attacked before and after every move") {
+    REQUIRE(matches_square_attacks(*board));
+    const BazuuAttackInfo before = board->attack_info();
+    BazuuMoveList list;
+    board->generate_moves(list);
+    for (std::uint16_t i = 0; i < list.count; i++) {
+      if (!board->make_move(list.moves[i]))
+        continue;
+      REQUIRE(matches_square_attacks(*board));
+      REQUIRE(board->in_check() == board->is_square_attacked(board->king_square(board->side_to_move()),
+                                                             board->side_to_move() == Colours::White
+                                                                 ? Colours::Black
+                                                                 : Colours::White));
+      board->unmake_move(list.moves[i]);
+      const BazuuAttackInfo &after = board->attack_info();
+      REQUIRE(std::memcmp(after.attacked_by, before.attacked_by, sizeof(before.attacked_by)) == 0);
+      REQUIRE(after.checkers == before.checkers);
+      REQUIRE(after.pinned == before.pinned);
+    }
+  }
+
+  SECTION("Pawn and double attacks") {
+    // Both pawns cover d4, which the knight also attacks, and the knight and the king both cover d2.
+    board->setup_fen("4k3/8/8/8/8/2P1PN2/8/4K3 w - - 0 1");
+    const BazuuAttackInfo &info = board->attack_info();
+    const auto &white = info.attacked_by[std::to_underlying(Colours::White)];
+    REQUIRE(white[std::to_underlying(PieceType::P)] == ((1ULL << 25) | (1ULL << 27) | (1ULL << 29)));
+    REQUIRE(info.double_attacks[std::to_underlying(Colours::White)] == ((1ULL << 27) | (1ULL << 11)));
+  }
+
+  SECTION("Checkers and pinned pieces") {
+    // The bishop on b4 pins the pawn on d2 and the rook on e7 pins the knight on e4.
+    board->setup_fen("4k3/4r3/8/8/1b2N3/8/3P4/4K3 w - - 0 1");
+    REQUIRE(board->pinned() == ((1ULL << 11) | (1ULL << 28)));
+    REQUIRE(board->checkers() == 0ULL);
+    REQUIRE_FALSE(board->in_check());
+    board->setup_fen("4k3/4r3/8/8/1b2N3/5n2/3P4/4K3 w - - 0 1");
+    REQUIRE(board->checkers() == (1ULL << 21));
+    REQUIRE(board->in_check());
+    // Two own pieces on the line are not pinned, nor is an enemy piece.
+    board->setup_fen("4k3/4r3/4p3/8/4N3/8/4P3/4K3 w - - 0 1");
+    REQUIRE(board->pinned() == 0ULL);
+  }
+
+  SECTION("Unmaking moves deeper than the cache recomputes the reused entries") {
+    // The white king walks the triangle e1-d1-d2 against null moves, six plies a lap, which does not divide the cache
+    // size: the positions that share an entry differ.
+    board->setup_fen("4k3/8/8/8/8/8/8/4K3 w - - 0 1");
+    const BazuuMove triangle[3] = {BazuuMove::encode(4, 3, Pieces::wK), BazuuMove::encode(3, 11, Pieces::wK),
+                                   BazuuMove::encode(11, 4, Pieces::wK)};
+    const std::uint16_t plies = BazuuBoard::ATTACK_CACHE_SIZE + 8;
+    std::vector<BazuuAttackInfo> seen;
+    for (std::uint16_t ply = 0; ply < plies; ply++) {
+      seen.push_back(board->attack_info());
+      REQUIRE((ply % 2 ? board->make_null_move() : board->make_move(triangle[ply / 2 % 3])));
+    }
+    for (std::uint16_t ply = plies; ply-- > 0;) {
+      if (ply % 2)
+        board->unmake_null_move();
+      else
+        board->unmake_move(triangle[ply / 2 % 3]);
+      const BazuuAttackInfo &info = board->attack_info();
+      REQUIRE(std::memcmp(info.attacked_by, seen[ply].attacked_by, sizeof(info.attacked_by)) == 0);
+    }
+  }
+}
+
+TEST_CASE("Repetition detection", "[board][repetition]") {
+  BazuuBoard board;
+  board.setup_fen(BazuuBoard::STARTING_FEN);
+  BazuuMove shuffle[4] = {BazuuMove::encode(6, 21, Pieces::wN), BazuuMove::encode(62, 45, Pieces::bN),
+                          BazuuMove::encode(21, 6, Pieces::wN), BazuuMove::encode(45, 62, Pieces::bN)};
+
+  SECTION("Reversible moves fill the cuckoo table") {
+    auto cuckoo = std::make_unique<BazuuCuckoo>();
+    REQUIRE(cuckoo->count() == BazuuCuckoo::REVERSIBLE_MOVES);
+  }
+
+  SECTION("Repetitions before the root need a third occurrence") {
+    for (BazuuMove move : shuffle)
+      REQUIRE(board.make_move(move));
+    REQUIRE_FALSE(board.is_repetition(0));
+    REQUIRE(board.is_repetition(5));
+    for (BazuuMove move : shuffle)
+      REQUIRE(board.make_move(move));
+    REQUIRE(board.is_repetition(0));
+  }
+
+  SECTION("A pawn move or a null move ends the scan") {
+    for (BazuuMove move : shuffle)
+      REQUIRE(board.make_move(move));
+    board.make_null_move();
+    board.make_null_move();
+    REQUIRE_FALSE(board.is_repetition(8));
+    board.unmake_null_move();
+    board.unmake_null_move();
+    REQUIRE(board.make_move(BazuuMove::encode(12, 28, Pieces::wP, Pieces::Empty, Pieces::Empty, MoveFlag::DoublePush)));
+    REQUIRE_FALSE(board.is_repetition(8));
+  }
+
+  SECTION("Upcoming repetition is found with one reversible move") {
+    for (std::uint8_t i = 0; i < 3; i++)
+      REQUIRE(board.make_move(shuffle[i]));
+    REQUIRE(board.has_upcoming_repetition(4));
+    REQUIRE_FALSE(board.has_upcoming_repetition(0));
+    REQUIRE(board.make_move(shuffle[3]));
+    REQUIRE(board.has_upcoming_repetition(4));
+    REQUIRE_FALSE(board.has_upcoming_repetition(3));
+  }
+
+  SECTION("The path of a slider must be empty") {
+    // The king walks a closed tour while the rook goes a8-b8-b3-a3, Ra3-a8 would repeat the start position.
+    BazuuMove moves[7] = {BazuuMove::encode(4, 3, Pieces::wK),   BazuuMove::encode(56, 57, Pieces::bR),
+                          BazuuMove::encode(3, 11, Pieces::wK),  BazuuMove::encode(57, 17, Pieces::bR),
+                          BazuuMove::encode(11, 12, Pieces::wK), BazuuMove::encode(17, 16, Pieces::bR),
+                          BazuuMove::encode(12, 4, Pieces::wK)};
+    board.setup_fen("r3k3/8/8/8/8/8/8/4K3 w - - 0 1");
+    for (BazuuMove move : moves)
+      REQUIRE(board.make_move(move));
+    REQUIRE(board.has_upcoming_repetition(8));
+    board.setup_fen("r3k3/8/8/P7/8/8/8/4K3 w - - 0 1");
+    for (BazuuMove move : moves)
+      REQUIRE(board.make_move(move));
+    REQUIRE_FALSE(board.has_upcoming_repetition(8));
+  }
+}
+
+// ============================================================================
+// TABLEBASE TESTS
+// ============================================================================
+
+// A table whose every position has the same value: header, one (K, X, k) part per side, single value records.
+static void write_single_value_table(const std::filesystem::path &path, bool dtz, std::uint8_t piece,
+                                     std::initializer_list<std::uint8_t> values) {
+  std::vector<std::uint8_t> bytes = dtz ? std::vector<std::uint8_t>{0xD7, 0x66, 0x0C, 0xA5}
+                                        : std::vector<std::uint8_t>{0x71, 0xE8, 0x23, 0x5D};
+  bytes.insert(bytes.end(), {0x01, 0x00, 0x66, static_cast<std::uint8_t>(piece << 4 | piece), 0xEE, 0x00});
+  for (std::uint8_t value : values)
+    bytes.insert(bytes.end(), {0x80, value});
+  bytes.resize(64);
+  std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+}
+
+TEST_CASE("Syzygy tablebase probing", "[tablebase]") {
+  std::filesystem::path directory = std::filesystem::temp_directory_path() / "bazuu_syzygy_test";
+  std::filesystem::create_directories(directory);
+  // KQvK won for the side with the queen, KBvK drawn, DTZ of KQvK stored for White to move only.
+  write_single_value_table(directory / "KQvK.rtbw", false, 5, {4, 0});
+  write_single_value_table(directory / "KBvK.rtbw", false, 3, {2, 2});
+  write_single_value_table(directory / "KQvK.rtbz", true, 5, {5});
+  std::ofstream(directory / "KNvK.rtbw") << "not a tablebase file, just some text to fill 64 bytes................";
+
+  auto tablebase = std::make_unique<BazuuTablebase>();
+  REQUIRE(tablebase->init(directory.string()) == 3);
+  REQUIRE(tablebase->max_pieces() == 3);
+  REQUIRE(tablebase->mapped_tables() == 0);
+
+  BazuuBoard board;
+  ProbeState state;
+
+  SECTION("WDL probes map the table lazily and flip colours") {
+    board.setup_fen("8/8/8/8/8/8/1Q6/K6k w - - 0 1");
+    REQUIRE(tablebase->probe_wdl(board, state) == WDLScore::Win);
+    REQUIRE(state != ProbeState::Fail);
+    REQUIRE(tablebase->mapped_tables() == 1);
+    board.setup_fen("8/8/8/8/8/8/1Q6/K6k b - - 0 1");
+    REQUIRE(tablebase->probe_wdl(board, state) == WDLScore::Loss);
+    board.setup_fen("k6K/1q6/8/8/8/8/8/8 w - - 0 1");
+    REQUIRE(tablebase->probe_wdl(board, state) == WDLScore::Loss);
+    board.setup_fen("k6K/1q6/8/8/8/8/8/8 b - - 0 1");
+    REQUIRE(tablebase->probe_wdl(board, state) == WDLScore::Win);
+    board.setup_fen("8/8/8/8/8/8/1B6/K6k w - - 0 1");
+    REQUIRE(tablebase->probe_wdl(board, state) == WDLScore::Draw);
+    REQUIRE(tablebase->mapped_tables() == 2);
+  }
+
+  SECTION("Captures are resolved before the table is trusted") {
+    // The only legal move takes the queen.
+    board.setup_fen("8/8/8/8/8/8/6Q1/K6k b - - 0 1");
+    REQUIRE(tablebase->probe_wdl(board, state) == WDLScore::Draw);
+    REQUIRE(state == ProbeState::ZeroingBestMove);
+  }
+
+  SECTION("Missing and broken tables fail") {
+    board.setup_fen("8/8/8/8/8/8/1R6/K6k w - - 0 1");
+    tablebase->probe_wdl(board, state);
+    REQUIRE(state == ProbeState::Fail);
+    board.setup_fen("8/8/8/8/8/8/1N6/K6k w - - 0 1");
+    tablebase->probe_wdl(board, state);
+    REQUIRE(state == ProbeState::Fail);
+  }
+
+  SECTION("DTZ filters the root moves") {
+    board.setup_fen("8/8/8/8/8/8/1Q6/K6k w - - 0 1");
+    REQUIRE(tablebase->probe_dtz(board, state) == 11);
+    std::vector<BazuuMove> root_moves;
+    BazuuMoveList list;
+    board.generate_moves(list);
+    for (std::uint16_t i = 0; i < list.count; i++) {
+      if (board.make_move(list.moves[i])) {
+        board.unmake_move(list.moves[i]);
+        root_moves.push_back(list.moves[i]);
+      }
+    }
+    std::size_t legal_moves = root_moves.size();
+    REQUIRE(tablebase->root_probe(board, root_moves));
+    REQUIRE(!root_moves.empty());
+    REQUIRE(root_moves.size() < legal_moves);
+    // Qg2 and Qh2 give the queen away.
+    for (BazuuMove move : root_moves) {
+      REQUIRE(move.to_uci() != "b2g2");
+      REQUIRE(move.to_uci() != "b2h2");
+    }
+
+    auto search = std::make_unique<BazuuSearch>(board);
+    search->tablebase = tablebase.get();
+    BazuuSearchResult result = search->search({.depth = 3});
+    REQUIRE(std::find(root_moves.begin(), root_moves.end(), result.best_move) != root_moves.end());
+    REQUIRE(result.stats.tb_hits > 0);
+  }
+  std::filesystem::remove_all(directory);
+}
+
+// Attacks of a White piece ('K', 'Q', 'R', 'B', 'N' or 'P') on an 8x8 board, sliders stop on the occupied squares.
+static U64 endgame_attacks(char piece, int from, U64 occupied) {
+  static constexpr int STEPS[16][2] = {{1, 0}, {0, 1}, {-1, 0},  {0, -1},  {1, 1},   {1, -1},  {-1, 1}, {-1, -1},
+                                       {1, 2}, {2, 1}, {2, -1},  {1, -2},  {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+  if (piece == 'P')
+    return ((from & 7) > 0 ? 1ULL << (from + 7) : 0) | ((from & 7) < 7 ? 1ULL << (from + 9) : 0);
+  int first = piece == 'B' ? 4 : piece == 'N' ? 8 : 0;
+  int last = piece == 'R' ? 4 : piece == 'N' ? 16 : 8;
+  bool slides = piece == 'Q' || piece == 'R' || piece == 'B';
+  U64 attacks = 0;
+  for (int i = first; i < last; i++) {
+    for (int file = (from & 7) + STEPS[i][0], rank = (from >> 3) + STEPS[i][1];
+         file >= 0 && file < 8 && rank >= 0 && rank < 8; file += STEPS[i][0], rank += STEPS[i][1]) {
+      attacks |= 1ULL << (rank * 8 + file);
+      if (!slides || (occupied >> (rank * 8 + file) & 1))
+        break;
+    }
+  }
+  return attacks;
+}
+
+// Retrograde analysis of the ending of two kings and one White piece. For White (0) and Black (1) to move: whether
+// the position is legal, the WDL of the side to move (-2, 0 or 2) and the DTZ probe_dtz() returns for it.
+struct EndgameSolution {
+  char piece;
+  std::vector<bool> legal = std::vector<bool>(2 << 18);
+  std::vector<std::int8_t> wdl = std::vector<std::int8_t>(2 << 18);
+  std::vector<std::int16_t> dtz = std::vector<std::int16_t>(2 << 18);
+
+  static std::size_t at(int stm, int wk, int bk, int square) { return stm << 18 | wk << 12 | bk << 6 | square; }
+};
+
+/*
+ * Solve an ending from the mates backwards. With a pawn the squares are solved from the 7th rank down, the pawn
+ * moves leave the ending and win when they reach a lost position of the ending they lead to.
+ * @param solution - the ending, its piece set.
+ * @param queen - the solved KQvK ending, for the promotions.
+ * @param rook - the solved KRvK ending, for the promotions.
+ */
+static void solve_endgame(EndgameSolution &solution, const EndgameSolution *queen = nullptr,
+                          const EndgameSolution *rook = nullptr) {
+  const char piece = solution.piece;
+  auto bit = [](int square) { return 1ULL << square; };
+  std::vector<std::uint8_t> moves_left(1 << 18);
+  std::vector<std::size_t> queue;
+
+  // A promotion wins if the queen or the rook wins, the minor pieces only draw.
+  auto pawn_move_wins = [&](int wk, int bk, int square) {
+    U64 occupied = bit(wk) | bit(bk);
+    if (occupied >> (square + 8) & 1)
+      return false;
+    if (square + 8 >= 56)
+      return queen->wdl[EndgameSolution::at(1, wk, bk, square + 8)] < 0 ||
+             rook->wdl[EndgameSolution::at(1, wk, bk, square + 8)] < 0;
+    return solution.wdl[EndgameSolution::at(1, wk, bk, square + 8)] < 0 ||
+           (square < 16 && !(occupied >> (square + 16) & 1) &&
+            solution.wdl[EndgameSolution::at(1, wk, bk, square + 16)] < 0);
+  };
+  auto won = [&](std::size_t state, int plies) {
+    if (solution.legal[state] && !solution.wdl[state]) {
+      solution.wdl[state] = 2;
+      solution.dtz[state] = static_cast<std::int16_t>(plies);
+      queue.push_back(state);
+    }
+  };
+
+  auto solve = [&](U64 squares) {
+    queue.clear();
+    for (U64 b = squares; b; b &= b - 1) {
+      int square = std::countr_zero(b);
+      for (int wk = 0; wk < 64; wk++) {
+        for (int bk = 0; bk < 64; bk++) {
+          std::size_t white = EndgameSolution::at(0, wk, bk, square);
+          std::size_t black = EndgameSolution::at(1, wk, bk, square);
+          if (wk == bk || wk == square || bk == square || (endgame_attacks('K', wk, 0) >> bk & 1))
+            continue;
+          bool checked = endgame_attacks(piece, square, bit(wk) | bit(bk)) >> bk & 1;
+          solution.legal[white] = !checked;
+          solution.legal[black] = true;
+          // Black may take the piece unless the king defends it, the x-rays of the piece go through its own king.
+          U64 targets = endgame_attacks('K', bk, 0) & ~endgame_attacks('K', wk, 0);
+          moves_left[black & 0x3FFFF] = static_cast<std::uint8_t>(
+              std::popcount(targets & ~bit(square) & ~endgame_attacks(piece, square, bit(wk))) +
+              (targets >> square & 1));
+          if (!moves_left[black & 0x3FFFF] && checked) {
+            solution.wdl[black] = -2;
+            solution.dtz[black] = -1;
+            queue.push_back(black);
+          }
+        }
+      }
+    }
+    if (piece == 'P')
+      for (int wk = 0; wk < 64; wk++)
+        for (int bk = 0; bk < 64; bk++)
+          if (solution.legal[EndgameSolution::at(0, wk, bk, std::countr_zero(squares))] &&
+              pawn_move_wins(wk, bk, std::countr_zero(squares)))
+            won(EndgameSolution::at(0, wk, bk, std::countr_zero(squares)), 1);
+
+    // Breadth first, the DTZ of the positions found later is never shorter.
+    for (std::size_t head = 0; head < queue.size(); head++) {
+      std::size_t state = queue[head];
+      int wk = state >> 12 & 63, bk = state >> 6 & 63, square = state & 63;
+      if (state >> 18) {
+        int plies = solution.dtz[state] == -1 ? 1 : 1 - solution.dtz[state];
+        for (U64 b = endgame_attacks('K', wk, 0) & ~endgame_attacks('K', bk, 0) & ~bit(square); b; b &= b - 1)
+          won(EndgameSolution::at(0, std::countr_zero(b), bk, square), plies);
+        if (piece != 'P')
+          for (U64 b = endgame_attacks(piece, square, bit(wk) | bit(bk)) & ~bit(wk) & ~bit(bk); b; b &= b - 1)
+            won(EndgameSolution::at(0, wk, bk, std::countr_zero(b)), plies);
+      } else {
+        for (U64 b = endgame_attacks('K', bk, 0) & ~endgame_attacks('K', wk, 0) & ~bit(square); b; b &= b - 1) {
+          std::size_t before = EndgameSolution::at(1, wk, std::countr_zero(b), square);
+          if (solution.wdl[before] || --moves_left[before & 0x3FFFF])
+            continue;
+          solution.wdl[before] = -2;
+          solution.dtz[before] = static_cast<std::int16_t>(-1 - solution.dtz[state]);
+          queue.push_back(before);
+        }
+      }
+    }
+  };
+
+  if (piece != 'P') {
+    solve(~0ULL);
+    return;
+  }
+  for (int square = 55; square >= 8; square--)
+    solve(1ULL << square);
+}
+
+// Index of three unique pieces, see probe_table(): the first one in the a1-d1-d4 triangle, then 63 and 62 squares.
+static std::size_t unique_pieces_index(std::array<int, 3> squares) {
+  auto off_diagonal = [](int square) { return (square >> 3) - (square & 7); };
+  if ((squares[0] & 7) > 3)
+    for (int &square : squares)
+      square ^= 7;
+  if ((squares[0] >> 3) > 3)
+    for (int &square : squares)
+      square ^= 56;
+  for (int i = 0; i < 3; i++) {
+    if (!off_diagonal(squares[i]))
+      continue;
+    if (off_diagonal(squares[i]) > 0)
+      for (int j = i; j < 3; j++)
+        squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+    break;
+  }
+  auto below_diagonal = [&](int square, bool triangle) {
+    int code = 0;
+    for (int other = 0; other < square; other++)
+      code += off_diagonal(other) < 0 && (!triangle || (other & 7) <= 3);
+    return code;
+  };
+  std::size_t adjust1 = squares[1] > squares[0];
+  std::size_t adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+  std::size_t rank0 = squares[0] >> 3, rank1 = (squares[1] >> 3) - adjust1, rank2 = (squares[2] >> 3) - adjust2;
+  if (off_diagonal(squares[0]))
+    return (below_diagonal(squares[0], true) * 63 + squares[1] - adjust1) * 62 + squares[2] - adjust2;
+  if (off_diagonal(squares[1]))
+    return (6 * 63 + rank0 * 28 + below_diagonal(squares[1], false)) * 62 + squares[2] - adjust2;
+  if (off_diagonal(squares[2]))
+    return 6 * 63 * 62 + 4 * 28 * 62 + rank0 * 7 * 28 + rank1 * 28 + below_diagonal(squares[2], false);
+  return 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + rank0 * 7 * 6 + rank1 * 6 + rank2;
+}
+
+// Index of a pawn and two pieces, the groups in the given order: the pawn rank on a queen side file, then 63 and 62.
+static std::size_t pawn_index(std::array<int, 3> squares, std::uint8_t order) {
+  static constexpr std::size_t GROUP_IDX[3][3] = {{1, 6, 378}, {63, 1, 378}, {3906, 1, 63}};
+  if ((squares[0] & 7) > 3)
+    for (int &square : squares)
+      square ^= 7;
+  std::size_t second = squares[1] - (squares[1] > squares[0]);
+  std::size_t third = squares[2] - (squares[2] > squares[0]) - (squares[2] > squares[1]);
+  return ((squares[0] >> 3) - 1) * GROUP_IDX[order][0] + second * GROUP_IDX[order][1] + third * GROUP_IDX[order][2];
+}
+
+// One (side to move, leading file) part of a table before compression, UNSET values are don't care.
+struct TablePart {
+  static constexpr std::uint16_t UNSET = 0xFFFF;
+  std::uint8_t order = 0;
+  std::array<std::uint8_t, 3> pieces{};
+  std::uint8_t flags = 0;
+  std::vector<std::uint16_t> values;
+  std::array<std::vector<std::uint16_t>, 4> map; // DTZ values of the wins, losses, cursed wins and blessed losses.
+};
+
+template <typename T> static void put_le(std::vector<std::uint8_t> &bytes, T value) {
+  for (std::size_t i = 0; i < sizeof(T); i++)
+    bytes.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+}
+
+/*
+ * Compress a part like the Syzygy generator: Re-Pair symbols of up to 256 values, a canonical Huffman code of the
+ * symbols in 64 byte blocks, the length of every block and a sparse index into them.
+ * @param part - the part, UNSET values are given the most frequent value.
+ * @return the sizes record, the sparse index, the block lengths and the blocks.
+ */
+static std::array<std::vector<std::uint8_t>, 4> compress_part(TablePart &part) {
+  static constexpr std::uint8_t LOG2_BLOCK_SIZE = 6;
+  static constexpr std::uint8_t LOG2_SPAN = 8;
+  std::map<std::uint16_t, std::size_t> frequencies;
+  for (std::uint16_t value : part.values)
+    if (value != TablePart::UNSET)
+      frequencies[value]++;
+  std::uint16_t filler =
+      std::ranges::max_element(frequencies, {}, [](const auto &frequency) { return frequency.second; })->first;
+  std::ranges::replace(part.values, TablePart::UNSET, filler);
+  std::array<std::vector<std::uint8_t>, 4> result;
+  std::vector<std::uint8_t> &sizes = result[0];
+  if (frequencies.size() == 1) {
+    sizes = {static_cast<std::uint8_t>(part.flags | 0x80), static_cast<std::uint8_t>(filler)};
+    return result;
+  }
+
+  // Symbols: the values, then pairs of symbols, each one the most frequent adjacent pair of the sequence so far.
+  std::vector<std::array<int, 2>> symbols;
+  std::vector<int> lengths; // Values a symbol expands to.
+  std::map<std::uint16_t, int> leaves;
+  for (auto [value, count] : frequencies) {
+    leaves[value] = static_cast<int>(symbols.size());
+    symbols.push_back({value, -1});
+    lengths.push_back(1);
+  }
+  std::vector<int> sequence;
+  for (std::uint16_t value : part.values)
+    sequence.push_back(leaves[value]);
+  while (symbols.size() < 250) {
+    std::size_t n = symbols.size();
+    std::vector<std::size_t> pairs(n * n);
+    for (std::size_t i = 0; i + 1 < sequence.size(); i++) {
+      pairs[sequence[i] * n + sequence[i + 1]]++;
+      if (sequence[i] == sequence[i + 1] && i + 2 < sequence.size() && sequence[i + 2] == sequence[i])
+        i++;
+    }
+    std::size_t best = 0;
+    for (std::size_t pair = 0; pair < pairs.size(); pair++)
+      if (pairs[pair] > pairs[best] && lengths[pair / n] + lengths[pair % n] <= 256)
+        best = pair;
+    if (pairs[best] < 8 || lengths[best / n] + lengths[best % n] > 256)
+      break;
+    std::vector<int> merged;
+    for (std::size_t i = 0; i < sequence.size(); i++) {
+      if (i + 1 < sequence.size() && sequence[i] * n + sequence[i + 1] == best) {
+        merged.push_back(static_cast<int>(n));
+        i++;
+      } else {
+        merged.push_back(sequence[i]);
+      }
+    }
+    symbols.push_back({static_cast<int>(best / n), static_cast<int>(best % n)});
+    lengths.push_back(lengths[best / n] + lengths[best % n]);
+    sequence = std::move(merged);
+  }
+
+  // Huffman code lengths, every symbol gets a code.
+  std::size_t n = symbols.size();
+  std::vector<std::size_t> weights(n, 1);
+  for (int symbol : sequence)
+    weights[symbol]++;
+  std::vector<int> parents(2 * n - 1, -1);
+  std::priority_queue<std::pair<std::size_t, int>, std::vector<std::pair<std::size_t, int>>, std::greater<>> heap;
+  for (std::size_t symbol = 0; symbol < n; symbol++)
+    heap.emplace(weights[symbol], static_cast<int>(symbol));
+  for (int node = static_cast<int>(n); heap.size() > 1; node++) {
+    auto [weight1, node1] = heap.top();
+    heap.pop();
+    auto [weight2, node2] = heap.top();
+    heap.pop();
+    parents[node1] = parents[node2] = node;
+    heap.emplace(weight1 + weight2, node);
+  }
+  std::vector<int> code_lengths(n);
+  for (std::size_t symbol = 0; symbol < n; symbol++)
+    for (int node = static_cast<int>(symbol); parents[node] >= 0; node = parents[node])
+      code_lengths[symbol]++;
+  int min_length = *std::ranges::min_element(code_lengths);
+  int max_length = *std::ranges::max_element(code_lengths);
+  REQUIRE(max_length <= 32);
+
+  // Canonical code: the symbols are renumbered from the longest codes, which have the lowest values.
+  std::vector<int> renumbered(n);
+  std::vector<int> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::ranges::stable_sort(order, std::greater<>{}, [&](int symbol) { return code_lengths[symbol]; });
+  for (std::size_t i = 0; i < n; i++)
+    renumbered[order[i]] = static_cast<int>(i);
+  std::size_t levels = max_length - min_length + 1;
+  std::vector<std::uint64_t> counts(levels), lowest(levels), base(levels);
+  for (int length : code_lengths)
+    counts[length - min_length]++;
+  for (int i = static_cast<int>(levels) - 2; i >= 0; i--) {
+    lowest[i] = lowest[i + 1] + counts[i + 1];
+    REQUIRE((base[i + 1] + counts[i + 1]) % 2 == 0);
+    base[i] = (base[i + 1] + counts[i + 1]) / 2;
+  }
+  REQUIRE(base[0] + counts[0] == 1ULL << min_length);
+
+  sizes = {part.flags, LOG2_BLOCK_SIZE, LOG2_SPAN, 0};
+  std::vector<std::uint8_t> blocks;
+  std::vector<std::size_t> block_values;
+  std::size_t bits = 1ULL << (LOG2_BLOCK_SIZE + 3);
+  for (int symbol : sequence) {
+    int length = code_lengths[symbol];
+    if (bits + length > 1ULL << (LOG2_BLOCK_SIZE + 3) || block_values.back() + lengths[symbol] > 16384) {
+      blocks.resize(blocks.size() + (1ULL << LOG2_BLOCK_SIZE));
+      block_values.push_back(0);
+      bits = 0;
+    }
+    std::uint64_t code = base[length - min_length] + renumbered[symbol] - lowest[length - min_length];
+    for (int i = length - 1; i >= 0; i--, bits++)
+      blocks[blocks.size() - (1ULL << LOG2_BLOCK_SIZE) + bits / 8] |= (code >> i & 1) << (7 - bits % 8);
+    block_values.back() += lengths[symbol];
+  }
+  put_le<std::uint32_t>(sizes, static_cast<std::uint32_t>(block_values.size()));
+  sizes.push_back(static_cast<std::uint8_t>(max_length));
+  sizes.push_back(static_cast<std::uint8_t>(min_length));
+  for (std::uint64_t symbol : lowest)
+    put_le<std::uint16_t>(sizes, static_cast<std::uint16_t>(symbol));
+  put_le<std::uint16_t>(sizes, static_cast<std::uint16_t>(n));
+  for (int symbol : order) {
+    auto [left, right] = symbols[symbol];
+    if (right < 0)
+      right = 0xFFF;
+    else
+      left = renumbered[left], right = renumbered[right];
+    sizes.insert(sizes.end(), {static_cast<std::uint8_t>(left), static_cast<std::uint8_t>(left >> 8 | right << 4),
+                               static_cast<std::uint8_t>(right >> 4)});
+  }
+  if (n & 1)
+    sizes.push_back(0);
+
+  // An entry every span values, for the value in the middle of the span: its block and offset in the block.
+  std::vector<std::size_t> starts{0};
+  for (std::size_t values : block_values) {
+    put_le<std::uint16_t>(result[2], static_cast<std::uint16_t>(values - 1));
+    starts.push_back(starts.back() + values);
+  }
+  for (std::size_t middle = (1ULL << LOG2_SPAN) / 2; middle - (1ULL << LOG2_SPAN) / 2 < part.values.size();
+       middle += 1ULL << LOG2_SPAN) {
+    std::size_t block = std::min<std::size_t>(std::ranges::upper_bound(starts, middle) - starts.begin() - 1,
+                                              block_values.size() - 1);
+    put_le<std::uint32_t>(result[1], static_cast<std::uint32_t>(block));
+    put_le<std::uint16_t>(result[1], static_cast<std::uint16_t>(middle - starts[block]));
+  }
+  result[3] = std::move(blocks);
+  return result;
+}
+
+/*
+ * Write a table in the Syzygy layout: the pieces and group order of every part, the sizes records, the DTZ maps,
+ * the sparse indexes, the block lengths and the blocks of every part aligned to 64 bytes.
+ * @param parts - [leading file][side] parts, one file without pawns, one side for DTZ.
+ */
+static void write_compressed_table(const std::filesystem::path &path, bool dtz,
+                                   std::vector<std::vector<TablePart>> parts) {
+  std::vector<std::uint8_t> bytes = dtz ? std::vector<std::uint8_t>{0xD7, 0x66, 0x0C, 0xA5}
+                                        : std::vector<std::uint8_t>{0x71, 0xE8, 0x23, 0x5D};
+  bytes.push_back(static_cast<std::uint8_t>((parts[0].size() == 2) | (parts.size() == 4) << 1));
+  for (std::vector<TablePart> &file : parts) {
+    const TablePart &other = file.back();
+    bytes.push_back(static_cast<std::uint8_t>(other.order << 4 | file[0].order));
+    for (std::size_t k = 0; k < 3; k++)
+      bytes.push_back(static_cast<std::uint8_t>(other.pieces[k] << 4 | file[0].pieces[k]));
+  }
+  bytes.resize(bytes.size() + (bytes.size() & 1));
+
+  std::vector<std::array<std::vector<std::uint8_t>, 4>> compressed;
+  for (std::vector<TablePart> &file : parts)
+    for (TablePart &part : file)
+      compressed.push_back(compress_part(part));
+  for (auto &part : compressed)
+    bytes.insert(bytes.end(), part[0].begin(), part[0].end());
+  for (std::vector<TablePart> &file : parts) {
+    if (!dtz || !(file[0].flags & 2))
+      continue;
+    bool wide = file[0].flags & 16;
+    bytes.resize(bytes.size() + (wide && (bytes.size() & 1)));
+    for (const std::vector<std::uint16_t> &values : file[0].map) {
+      wide ? put_le<std::uint16_t>(bytes, static_cast<std::uint16_t>(values.size()))
+           : put_le<std::uint8_t>(bytes, static_cast<std::uint8_t>(values.size()));
+      for (std::uint16_t value : values)
+        wide ? put_le<std::uint16_t>(bytes, value) : put_le<std::uint8_t>(bytes, static_cast<std::uint8_t>(value));
+    }
+  }
+  bytes.resize(bytes.size() + (bytes.size() & 1));
+  for (std::size_t i = 1; i < 4; i++)
+    for (auto &part : compressed) {
+      if (i == 3)
+        bytes.resize((bytes.size() + 63) & ~std::size_t{63});
+      bytes.insert(bytes.end(), part[i].begin(), part[i].end());
+    }
+  bytes.resize(bytes.size() + 64);
+  std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+}
+
+// KXvK parts of the WDL table and, if asked, of the DTZ table for White to move. The DTZ of a win is odd, the table
+// stores half of it.
+static void write_piece_tables(const EndgameSolution &solution, const std::filesystem::path &wdl_path,
+                               const std::filesystem::path &dtz_path) {
+  auto piece = static_cast<std::uint8_t>(std::string_view("PNBRQ").find(solution.piece) + 1);
+  std::vector<TablePart> wdl = {{.order = 0, .pieces = {6, piece, 14}}, {.order = 0, .pieces = {14, piece, 6}}};
+  TablePart dtz{.order = 0, .pieces = {piece, 6, 14}, .flags = 2};
+  std::set<std::uint16_t> wins;
+  for (TablePart *part : {&wdl[0], &wdl[1], &dtz})
+    part->values.assign(31332, TablePart::UNSET);
+  for (std::size_t state = 0; state < solution.legal.size(); state++) {
+    if (!solution.legal[state])
+      continue;
+    int stm = static_cast<int>(state >> 18), wk = state >> 12 & 63, bk = state >> 6 & 63, square = state & 63;
+    std::array<int, 3> squares = stm ? std::array{bk, square, wk} : std::array{wk, square, bk};
+    wdl[stm].values[unique_pieces_index(squares)] = static_cast<std::uint16_t>(solution.wdl[state] + 2);
+    if (!stm && solution.wdl[state] > 0)
+      wins.insert(static_cast<std::uint16_t>((solution.dtz[state] - 1) / 2));
+  }
+  dtz.map[0].assign(wins.begin(), wins.end());
+  for (std::size_t state = 0; state < solution.legal.size() / 2; state++)
+    if (solution.legal[state] && solution.wdl[state] > 0)
+      dtz.values[unique_pieces_index({static_cast<int>(state & 63), static_cast<int>(state >> 12 & 63),
+                                      static_cast<int>(state >> 6 & 63)})] =
+          static_cast<std::uint16_t>(std::ranges::lower_bound(dtz.map[0], (solution.dtz[state] - 1) / 2) -
+                                     dtz.map[0].begin());
+  write_compressed_table(wdl_path, false, {wdl});
+  if (!dtz_path.empty())
+    write_compressed_table(dtz_path, true, {{dtz}});
+}
+
+// KPvK tables. DTZ stores White to move on the a and b files, Black to move on the c and d files, in plies.
+static void write_pawn_tables(const EndgameSolution &solution, const std::filesystem::path &wdl_path,
+                              const std::filesystem::path &dtz_path) {
+  std::vector<std::vector<TablePart>> wdl(4), dtz(4);
+  for (int file = 0; file < 4; file++) {
+    wdl[file] = {{.order = 0, .pieces = {1, 6, 14}}, {.order = 2, .pieces = {1, 14, 6}}};
+    dtz[file] = {{.order = 1, .pieces = {1, 6, 14}, .flags = static_cast<std::uint8_t>(2 | 4 | 8 | 16 | (file >= 2))}};
+    for (TablePart *part : {&wdl[file][0], &wdl[file][1], &dtz[file][0]})
+      part->values.assign(23436, TablePart::UNSET);
+  }
+  for (int pass = 0; pass < 2; pass++) {
+    for (std::size_t state = 0; state < solution.legal.size(); state++) {
+      if (!solution.legal[state])
+        continue;
+      int stm = static_cast<int>(state >> 18), wk = state >> 12 & 63, bk = state >> 6 & 63, square = state & 63;
+      int file = std::min(square & 7, 7 - (square & 7));
+      TablePart &part = dtz[file][0];
+      std::vector<std::uint16_t> &map = part.map[stm];
+      if (!pass)
+        wdl[file][stm].values[pawn_index(stm ? std::array{square, bk, wk} : std::array{square, wk, bk}, stm * 2)] =
+            static_cast<std::uint16_t>(solution.wdl[state] + 2);
+      if (stm != (file >= 2) || !solution.wdl[state])
+        continue;
+      auto plies = static_cast<std::uint16_t>(std::abs(solution.dtz[state]) - 1);
+      if (!pass && std::ranges::find(map, plies) == map.end())
+        map.insert(std::ranges::upper_bound(map, plies), plies);
+      if (pass)
+        part.values[pawn_index({square, wk, bk}, 1)] =
+            static_cast<std::uint16_t>(std::ranges::find(map, plies) - map.begin());
+    }
+  }
+  write_compressed_table(wdl_path, false, wdl);
+  write_compressed_table(dtz_path, true, dtz);
+}
+
+// FEN of a position of a solved ending, with the colours swapped if flipped.
+static std::string endgame_fen(const EndgameSolution &solution, std::size_t state, bool flipped) {
+  char board[64];
+  std::fill(board, board + 64, ' ');
+  int flip = flipped ? 56 : 0;
+  board[(state >> 12 & 63) ^ flip] = flipped ? 'k' : 'K';
+  board[(state >> 6 & 63) ^ flip] = flipped ? 'K' : 'k';
+  board[(state & 63) ^ flip] = static_cast<char>(solution.piece + (flipped ? 'a' - 'A' : 0));
+  std::string fen;
+  for (int rank = 7; rank >= 0; rank--) {
+    int empty = 0;
+    for (int file = 0; file < 8; file++) {
+      if (board[rank * 8 + file] == ' ') {
+        empty++;
+        continue;
+      }
+      if (empty)
+        fen += static_cast<char>('0' + std::exchange(empty, 0));
+      fen += board[rank * 8 + file];
+    }
+    if (empty)
+      fen += static_cast<char>('0' + empty);
+    fen += rank ? "/" : "";
+  }
+  return fen + (static_cast<bool>(state >> 18) != flipped ? " b - - 0 1" : " w - - 0 1");
+}
+
+TEST_CASE("Syzygy compressed tables", "[tablebase]") {
+  // Tables of the real format: written from a retrograde analysis of KQvK, KRvK and KPvK with Re-Pair and Huffman
+  // compressed blocks, DTZ maps for one side to move or the other depending on the file.
+  EndgameSolution queen{'Q'}, rook{'R'}, pawn{'P'};
+  solve_endgame(queen);
+  solve_endgame(rook);
+  solve_endgame(pawn, &queen, &rook);
+  for (const EndgameSolution *solution : {&queen, &rook, &pawn})
+    REQUIRE(std::ranges::all_of(solution->dtz, [](std::int16_t dtz) { return std::abs(dtz) <= 100; }));
+
+  std::filesystem::path directory = std::filesystem::temp_directory_path() / "bazuu_syzygy_compressed_test";
+  std::filesystem::create_directories(directory);
+  write_piece_tables(queen, directory / "KQvK.rtbw", {});
+  write_piece_tables(rook, directory / "KRvK.rtbw", directory / "KRvK.rtbz");
+  write_pawn_tables(pawn, directory / "KPvK.rtbw", directory / "KPvK.rtbz");
+  // Promotions to a minor piece are probed too.
+  write_single_value_table(directory / "KBvK.rtbw", false, 3, {2, 2});
+  write_single_value_table(directory / "KNvK.rtbw", false, 2, {2, 2});
+  REQUIRE(std::filesystem::file_size(directory / "KRvK.rtbw") < 31332 / 4);
+
+  auto tablebase = std::make_unique<BazuuTablebase>();
+  REQUIRE(tablebase->init(directory.string()) == 5);
+  BazuuBoard board;
+  ProbeState state;
+  auto wdl = [&](const char *fen) {
+    board.setup_fen(fen);
+    WDLScore score = tablebase->probe_wdl(board, state);
+    REQUIRE(state != ProbeState::Fail);
+    return score;
+  };
+  auto dtz = [&](const char *fen) {
+    board.setup_fen(fen);
+    int plies = tablebase->probe_dtz(board, state);
+    REQUIRE(state != ProbeState::Fail);
+    return plies;
+  };
+
+  // Rh8 mates, Black to move is stored in the other side of the table.
+  REQUIRE(wdl("k7/8/1K6/8/8/8/8/7R w - - 0 1") == WDLScore::Win);
+  REQUIRE(dtz("k7/8/1K6/8/8/8/8/7R w - - 0 1") == 1);
+  REQUIRE(wdl("k7/8/1K6/8/8/8/8/7R b - - 0 1") == WDLScore::Loss);
+  REQUIRE(dtz("k7/8/1K6/8/8/8/8/7R b - - 0 1") == -2);
+  REQUIRE(wdl("R6k/8/6K1/8/8/8/8/8 b - - 0 1") == WDLScore::Loss);
+  REQUIRE(dtz("R6k/8/6K1/8/8/8/8/8 b - - 0 1") == -1);
+  REQUIRE(wdl("k7/1R6/1K6/8/8/8/8/8 b - - 0 1") == WDLScore::Draw);
+  REQUIRE(wdl("8/8/8/8/8/k7/1R6/7K b - - 0 1") == WDLScore::Draw);
+  REQUIRE(wdl("7k/8/8/8/8/8/8/K6r w - - 0 1") == WDLScore::Loss);
+  REQUIRE(wdl("8/8/8/8/8/8/1Q6/K6k b - - 0 1") == WDLScore::Loss);
+  // The king on the sixth rank ahead of its pawn wins, on the fifth only with the opposition. The rook pawn draws
+  // against the king in the corner, a promotion zeroes the DTZ.
+  REQUIRE(wdl("4k3/8/4K3/4P3/8/8/8/8 w - - 0 1") == WDLScore::Win);
+  REQUIRE(wdl("4k3/8/4K3/4P3/8/8/8/8 b - - 0 1") == WDLScore::Loss);
+  REQUIRE(wdl("8/4k3/8/4K3/4P3/8/8/8 w - - 0 1") == WDLScore::Draw);
+  REQUIRE(wdl("8/4k3/8/4K3/4P3/8/8/8 b - - 0 1") == WDLScore::Loss);
+  REQUIRE(wdl("k7/8/8/8/8/8/P7/K7 w - - 0 1") == WDLScore::Draw);
+  REQUIRE(dtz("8/4P3/8/8/8/8/k7/4K3 w - - 0 1") == 1);
+  REQUIRE(wdl("8/8/8/8/8/8/4p3/K1k5 w - - 0 1") == WDLScore::Loss);
+
+  // Every 89th position of the endings and its mirror with the colours swapped, every third one also for DTZ.
+  std::vector<std::string> wrong;
+  std::size_t probes = 0;
+  for (const EndgameSolution *solution : {&queen, &rook, &pawn}) {
+    for (std::size_t index = 0; index < solution->legal.size(); index += 89) {
+      if (!solution->legal[index])
+        continue;
+      for (bool flipped : {false, true}) {
+        std::string fen = endgame_fen(*solution, index, flipped);
+        board.setup_fen(fen);
+        probes++;
+        if (std::to_underlying(tablebase->probe_wdl(board, state)) != solution->wdl[index] ||
+            state == ProbeState::Fail)
+          wrong.push_back("WDL " + fen);
+        if (solution != &queen && index % 3 == 0 &&
+            (tablebase->probe_dtz(board, state) != solution->dtz[index] || state == ProbeState::Fail))
+          wrong.push_back("DTZ " + fen);
+      }
+    }
+  }
+  REQUIRE(probes > 10000);
+  REQUIRE(wrong.empty());
+  std::filesystem::remove_all(directory);
+}
+
+// ============================================================================
+// OPENING BOOK TESTS
+// ============================================================================
+
+TEST_CASE("Polyglot keys", "[book]") {
+  BazuuBoard board;
+
+  SECTION("En passant only counts when the capture is possible") {
+    board.setup_fen("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1");
+    ZobristKey with_square = board.polyglot_key();
+    board.setup_fen("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1");
+    REQUIRE(board.polyglot_key() == with_square);
+    board.setup_fen("rnbqkbnr/ppp1pppp/8/8/3pP3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1");
+    ZobristKey capturable = board.polyglot_key();
+    board.setup_fen("rnbqkbnr/ppp1pppp/8/8/3pP3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1");
+    REQUIRE(board.polyglot_key() != capturable);
+  }
+
+  SECTION("Standard Random64 keys") {
+    // Keys of the Polyglot book format specification.
+    board.setup_fen(BazuuBoard::STARTING_FEN);
+    REQUIRE(board.polyglot_key() == 0x463B96181691FC9CULL);
+    board.setup_fen("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1");
+    REQUIRE(board.polyglot_key() == 0x823C9B50FD114196ULL);
+    board.setup_fen("rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3");
+    REQUIRE(board.polyglot_key() == 0x22A48B5A8E47FF78ULL);
+    board.setup_fen("rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR b kq - 0 3");
+    REQUIRE(board.polyglot_key() == 0x652A607CA3F242C1ULL);
+    board.setup_fen("rnbqkbnr/p1pppppp/8/8/PpP4P/8/1P1PPPP1/RNBQKBNR b KQkq c3 0 3");
+    REQUIRE(board.polyglot_key() == 0x3C8123EA7B067637ULL);
+    board.setup_fen("rnbqkbnr/p1pppppp/8/8/P6P/R1p5/1P1PPPP1/1NBQKBNR b Kkq - 0 4");
+    REQUIRE(board.polyglot_key() == 0x5C3F9B829B279560ULL);
+  }
+}
+
+TEST_CASE("Polyglot book", "[book]") {
+  std::filesystem::path path = std::filesystem::temp_directory_path() / "bazuu_test_book.bin";
+  BazuuBoard board;
+  board.setup_fen(BazuuBoard::STARTING_FEN);
+  ZobristKey start = board.polyglot_key();
+  board.setup_fen("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1");
+  ZobristKey castles = board.polyglot_key();
+  board.setup_fen("8/4P3/8/8/8/8/8/K6k w - - 0 1");
+  ZobristKey promotes = board.polyglot_key();
+
+  // e2e4, d2d4, e1h1 (castling), e7e8q.
+  REQUIRE(BazuuBook::write(path.string(), {{start, 12 << 6 | 28, 3, 0},
+                                           {castles, 4 << 6 | 7, 1, 0},
+                                           {start, 11 << 6 | 27, 1, 0},
+                                           {promotes, 52 << 6 | 60 | 4 << 12, 1, 0},
+                                           {start - 1, 0, 1, 0},
+                                           {start + 1, 0, 1, 0}}));
+  BazuuBook book;
+  REQUIRE(book.open(path.string()));
+  REQUIRE(book.size() == 6);
+
+  SECTION("Binary search finds the first entry of a position") {
+    std::size_t index = book.find(start);
+    REQUIRE(index < book.size());
+    REQUIRE(book.entry(index).key == start);
+    REQUIRE(book.entry(index).weight == 3);
+    REQUIRE(book.find(start + 2) == book.size());
+  }
+
+  SECTION("Moves are picked by weight") {
+    board.setup_fen(BazuuBoard::STARTING_FEN);
+    REQUIRE(book.probe(board, 0).to_uci() == "e2e4");
+    REQUIRE(book.probe(board, 2).to_uci() == "e2e4");
+    REQUIRE(book.probe(board, 3).to_uci() == "d2d4");
+    REQUIRE(book.probe(board, 7).to_uci() == "d2d4");
+    board.setup_fen("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1");
+    REQUIRE(book.probe(board, 0).is_null());
+  }
+
+  SECTION("Castling and promotions are decoded") {
+    board.setup_fen("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1");
+    BazuuMove castling = book.probe(board, 0);
+    REQUIRE(castling.flag() == MoveFlag::Castling);
+    REQUIRE(castling.to_uci() == "e1g1");
+    REQUIRE(BazuuBook::encode_move(castling) == (4 << 6 | 7));
+    board.setup_fen("8/4P3/8/8/8/8/8/K6k w - - 0 1");
+    REQUIRE(book.probe(board, 0).to_uci() == "e7e8q");
+  }
+
+  book.close();
+  std::ofstream(path, std::ios::app) << "partial";
+  REQUIRE_FALSE(book.open(path.string()));
+  std::filesystem::remove(path);
+}
+
+// ============================================================================
+// SEARCH TESTS
+// ============================================================================
+
+TEST_CASE("Search finds mates", "[search]") {
+  auto board = std::make_unique<BazuuBoard>();
+
+  SECTION("Back rank mate in one") {
+    board->setup_fen("6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1");
+    auto search = std::make_unique<BazuuSearch>(*board);
+    BazuuSearchResult result = search->search({.depth = 4});
+    REQUIRE(result.best_move.to_uci() == "d1d8");
+    REQUIRE(result.score == BazuuSearch::MATE - 1);
+    REQUIRE(board->zobrist_key() == board->generate_hash_keys());
+  }
+
+  SECTION("Checkmated and stalemated roots") {
+    board->setup_fen("3R2k1/5ppp/8/8/8/8/5PPP/6K1 b - - 0 1");
+    auto search = std::make_unique<BazuuSearch>(*board);
+    REQUIRE(search->search({.depth = 2}).score == -BazuuSearch::MATE);
+    board->setup_fen("7k/5Q2/6K1/8/8/8/8/8 b - - 0 1");
+    REQUIRE(search->search({.depth = 2}).score == 0);
+  }
+}
+
+TEST_CASE("Selective search switches", "[search]") {
+  auto board = std::make_unique<BazuuBoard>();
+  board->setup_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+  auto search = std::make_unique<BazuuSearch>(*board);
+
+  BazuuSearchResult pruned = search->search({.depth = 5});
+  REQUIRE(pruned.stats.null_move_cutoffs + pruned.stats.reverse_futility_cutoffs > 0);
+  REQUIRE(pruned.stats.reduced_searches > 0);
+
+  search->options = BazuuSearchOptions{false, false, false, false, false};
+  BazuuSearchResult full = search->search({.depth = 5});
+  REQUIRE(full.stats.null_move_cutoffs == 0);
+  REQUIRE(full.stats.reduced_searches == 0);
+  REQUIRE(full.stats.reverse_futility_cutoffs == 0);
+  REQUIRE(full.stats.futility_prunes == 0);
+  REQUIRE(full.stats.late_move_prunes == 0);
+  REQUIRE(pruned.stats.nodes < full.stats.nodes);
+
+  SECTION("Late move reductions grow with depth and move number") {
+    REQUIRE(BazuuSearch::reduction(1, 1) == 0);
+    REQUIRE(BazuuSearch::reduction(10, 20) > BazuuSearch::reduction(3, 4));
+  }
+
+  SECTION("Node limit stops the search") {
+    BazuuSearchResult limited = search->search({.depth = 64, .nodes = 20000});
+    REQUIRE(limited.depth < 64);
+    REQUIRE_FALSE(limited.best_move.is_null());
+  }
+}
+
+TEST_CASE("Transposition table", "[search][tt]") {
+  BazuuTranspositionTable tt(1);
+  REQUIRE(std::has_single_bit(tt.size()));
+  const ZobristKey key = 0x123456789ABCDEF0ULL;
+  const BazuuMove move = BazuuMove::encode(12, 28, Pieces::wP, Pieces::Empty, Pieces::Empty, MoveFlag::DoublePush);
+  BazuuTTHit hit;
+  REQUIRE_FALSE(tt.probe(key, hit));
+
+  tt.store(key, move, -1234, 5, BazuuTTBound::Exact);
+  REQUIRE(tt.probe(key, hit));
+  REQUIRE(hit.move == move);
+  REQUIRE(hit.score == -1234);
+  REQUIRE(hit.depth == 5);
+  REQUIRE(hit.bound == BazuuTTBound::Exact);
+  // Same bucket, other position.
+  REQUIRE_FALSE(tt.probe(key ^ (1ULL << 63), hit));
+
+  // A much shallower bound of the same search does not replace a deep result, a null move keeps the stored one.
+  tt.store(key, BazuuMove{}, 10, 0, BazuuTTBound::Lower);
+  REQUIRE(tt.probe(key, hit));
+  REQUIRE(hit.depth == 5);
+  tt.store(key, BazuuMove{}, 20, 4, BazuuTTBound::Upper);
+  REQUIRE(tt.probe(key, hit));
+  REQUIRE(hit.move == move);
+  REQUIRE(hit.score == 20);
+  REQUIRE(hit.bound == BazuuTTBound::Upper);
+
+  // A full bucket gives up its shallowest entry, entries of older searches first.
+  for (std::uint64_t i = 1; i < BazuuTranspositionTable::BUCKET_ENTRIES; i++)
+    tt.store(key ^ (i << 60), move, 0, 10, BazuuTTBound::Exact);
+  tt.store(key ^ (7ULL << 60), move, 0, 10, BazuuTTBound::Exact);
+  REQUIRE_FALSE(tt.probe(key, hit));
+  tt.new_search();
+  REQUIRE(tt.hashfull() == 0);
+  tt.store(key, move, 0, 1, BazuuTTBound::Exact);
+  REQUIRE(tt.probe(key, hit));
+  REQUIRE(tt.probe(key ^ (7ULL << 60), hit) + tt.probe(key ^ (1ULL << 60), hit) + tt.probe(key ^ (2ULL << 60), hit) +
+              tt.probe(key ^ (3ULL << 60), hit) ==
+          3);
+
+  tt.clear();
+  REQUIRE_FALSE(tt.probe(key, hit));
+  for (std::uint64_t i = 0; i < 1000; i++)
+    tt.store((i % 250) | (i / 250) << 60 | 1ULL << 40, move, 0, 1, BazuuTTBound::Exact);
+  REQUIRE(tt.hashfull() == 1000);
+}
+
+TEST_CASE("Transposition table snapshots", "[search][tt]") {
+  const std::filesystem::path path = std::filesystem::temp_directory_path() / "bazuu_test.tt";
+  std::filesystem::remove(path);
+  auto board = std::make_unique<BazuuBoard>();
+  board->setup_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+  auto read_file = [&path] {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  };
+
+  BazuuTranspositionTable tt(2);
+  REQUIRE_FALSE(tt.load(path.string()));
+  auto cold_search = std::make_unique<BazuuSearch>(*board);
+  cold_search->tt = &tt;
+  const BazuuSearchResult cold = cold_search->search({.depth = 7});
+  REQUIRE(tt.save(path.string()));
+  const std::string snapshot = read_file();
+  REQUIRE(snapshot.size() == 64 + tt.size() * sizeof(BazuuTranspositionTable::Bucket));
+
+  SECTION("A warm start replays the previous search") {
+    BazuuTranspositionTable warm_tt(1);
+    REQUIRE(warm_tt.load(path.string()));
+    REQUIRE(warm_tt.is_mapped());
+    REQUIRE(warm_tt.size() == tt.size());
+    auto warm_search = std::make_unique<BazuuSearch>(*board);
+    warm_search->tt = &warm_tt;
+    const BazuuSearchResult warm = warm_search->search({.depth = 7});
+    REQUIRE(warm.best_move == cold.best_move);
+    REQUIRE(warm.stats.nodes * 4 < cold.stats.nodes);
+    // Copy on write, the search left the file alone.
+    REQUIRE(read_file() == snapshot);
+    warm_tt.resize(1);
+    REQUIRE_FALSE(warm_tt.is_mapped());
+  }
+
+  SECTION("Snapshots of other keys or layouts are refused") {
+    std::string changed = snapshot;
+    changed[16] ^= 1; // Zobrist key version.
+    std::ofstream(path, std::ios::binary) << changed;
+    BazuuTranspositionTable other(1);
+    REQUIRE_FALSE(other.load(path.string()));
+    REQUIRE_FALSE(other.is_mapped());
+    std::ofstream(path, std::ios::binary) << snapshot.substr(0, snapshot.size() - 64);
+    REQUIRE_FALSE(other.load(path.string()));
+  }
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("Shared transposition table", "[search][tt][process]") {
+  const std::string name = std::format("/bazuu_test_{}", ::getpid());
+  BazuuTranspositionTable::remove_shared(name);
+  // This process creates the segment, the engine processes join it with its size.
+  BazuuTranspositionTable tt(1);
+  REQUIRE(tt.open_shared(name, 4));
+  REQUIRE(tt.is_shared());
+  REQUIRE(tt.size() * sizeof(BazuuTranspositionTable::Bucket) == 4 * 1024 * 1024);
+
+  const char *kiwipete = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+  BazuuEngineProcess engines[2];
+  std::string line;
+  for (BazuuEngineProcess &engine : engines) {
+    REQUIRE(engine.start(BAZUU_BINARY));
+    REQUIRE(engine.send(std::format("setoption name SharedHash value {}", name)));
+    REQUIRE(engine.wait_for("info string", line, 10000));
+    REQUIRE(line == std::format("info string shared hash {} of 4 MB", name));
+  }
+  auto search = [&line](BazuuEngineProcess &engine, const std::string &position) {
+    engine.send(position);
+    engine.send("go depth 8");
+    REQUIRE(engine.wait_for("info depth 8", line, 60000));
+    const std::size_t nodes_at = line.find(" nodes ") + 7;
+    const U64 nodes = std::stoull(line.substr(nodes_at, line.find(' ', nodes_at) - nodes_at));
+    REQUIRE(engine.wait_for("bestmove", line, 60000));
+    return nodes;
+  };
+
+  // The second engine replays the search of the first.
+  const U64 cold = search(engines[0], std::format("position fen {}", kiwipete));
+  const std::string cold_move = line;
+  const U64 warm = search(engines[1], std::format("position fen {}", kiwipete));
+  REQUIRE(warm * 2 < cold);
+  REQUIRE(line == cold_move);
+
+  // This process sees the root result stored by the engines.
+  auto board = std::make_unique<BazuuBoard>();
+  board->setup_fen(kiwipete);
+  BazuuTTHit hit;
+  REQUIRE(tt.probe(board->zobrist_key(), hit));
+  REQUIRE(hit.depth >= 8);
+  REQUIRE("bestmove " + hit.move.to_uci() == cold_move);
+
+  // Both engines search at once, each storing into the table the other probes.
+  for (BazuuEngineProcess &engine : engines) {
+    REQUIRE(engine.send("position startpos moves e2e4 c7c5"));
+    REQUIRE(engine.send("go depth 8"));
+  }
+  board->setup_fen("rnbqkbnr/pp1ppppp/8/2p5/4P3/8/PPPP1PPP/RNBQKBNR w KQkq c6 0 2");
+  for (BazuuEngineProcess &engine : engines) {
+    REQUIRE(engine.wait_for("bestmove", line, 60000));
+    REQUIRE_FALSE(BazuuUci::parse_move(*board, line.substr(9, line.find(' ', 9) - 9)).is_null());
+    engine.stop();
+  }
+  REQUIRE(BazuuTranspositionTable::remove_shared(name));
+  REQUIRE_FALSE(BazuuTranspositionTable::remove_shared(name));
+}
+
+TEST_CASE("MultiPV search", "[search][multipv]") {
+  auto board = std::make_unique<BazuuBoard>();
+  BazuuTranspositionTable tt;
+  auto search = std::make_unique<BazuuSearch>(*board);
+  search->tt = &tt;
+
+  SECTION("Distinct root moves, best first") {
+    board->setup_fen(BazuuBoard::STARTING_FEN);
+    search->multi_pv = 4;
+    const BazuuSearchResult result = search->search({.depth = 5});
+    REQUIRE(result.lines.size() == 4);
+    REQUIRE(result.best_move == result.lines[0].move);
+    REQUIRE(result.score == result.lines[0].score);
+    std::set<std::uint32_t> moves;
+    for (std::size_t i = 0; i < result.lines.size(); i++) {
+      REQUIRE(result.lines[i].pv.front() == result.lines[i].move);
+      if (i > 0)
+        REQUIRE(result.lines[i - 1].score >= result.lines[i].score);
+      moves.insert(result.lines[i].move.data);
+    }
+    REQUIRE(moves.size() == 4);
+  }
+
+  SECTION("Mate scores through the table") {
+    board->setup_fen("6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1");
+    search->multi_pv = 2;
+    const BazuuSearchResult result = search->search({.depth = 4});
+    REQUIRE(result.lines.size() == 2);
+    REQUIRE(result.lines[0].move.to_uci() == "d1d8");
+    REQUIRE(result.lines[0].score == BazuuSearch::MATE - 1);
+    REQUIRE(result.lines[1].score < BazuuSearch::MATE_BOUND);
+    REQUIRE(board->zobrist_key() == board->generate_hash_keys());
+  }
+
+  SECTION("No more lines than legal moves") {
+    board->setup_fen("7k/5Q2/6K1/8/8/8/8/8 b - - 0 1");
+    search->multi_pv = 3;
+    const BazuuSearchResult result = search->search({.depth = 3});
+    REQUIRE(result.lines.size() == 1);
+    REQUIRE(result.score == 0);
+  }
+
+  SECTION("The table saves work on a second search") {
+    board->setup_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    const BazuuSearchResult cold = search->search({.depth = 6});
+    const BazuuSearchResult warm = search->search({.depth = 6});
+    REQUIRE(warm.stats.nodes < cold.stats.nodes);
+  }
+}
+
+TEST_CASE("Search with a network", "[search][nnue]") {
+  auto board = std::make_unique<BazuuBoard>();
+  auto nnue = std::make_unique<BazuuNNUE>();
+  nnue->init_random(42);
+  board->setup_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+  ZobristKey key = board->zobrist_key();
+  auto search = std::make_unique<BazuuSearch>(*board, nnue.get());
+
+  BazuuSearchResult result = search->search({.depth = 3});
+  REQUIRE_FALSE(result.best_move.is_null());
+  REQUIRE(board->zobrist_key() == key);
+
+  // The lazily updated accumulators must agree with a refresh from scratch.
+  auto accumulator = std::make_unique<BazuuAccumulator>();
+  nnue->refresh(*accumulator, *board);
+  REQUIRE(search->evaluate() == nnue->evaluate(*accumulator, board->side_to_move()));
+}
+
+// ============================================================================
+// EPD ANALYSIS TESTS
+// ============================================================================
+
+TEST_CASE("EPD batch analysis", "[analysis]") {
+  std::string records;
+  for (int i = 0; i < 6; i++) {
+    records += "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - bm Rd8#;\n";
+    records += "\n";
+    records += "not a position\n";
+    records += std::string(TRICKY_BOARD_FEN) + "\r\n";
+  }
+  std::istringstream input(records);
+  std::ostringstream output;
+  BazuuAnalysis analysis({.limits = {.depth = 2}, .threads = 3, .queue_size = 2});
+  BazuuAnalysisSummary summary = analysis.run(input, output);
+  REQUIRE(summary.positions == 18);
+  REQUIRE(summary.invalid_positions == 6);
+  REQUIRE(summary.nodes > 0);
+
+  // Results come out in input order whatever the worker finishing first.
+  std::istringstream results(output.str());
+  std::string line;
+  for (int i = 0; i < 18; i++) {
+    REQUIRE(std::getline(results, line));
+    if (i % 3 == 0) {
+      REQUIRE(line.starts_with("6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - bm d1d8; dm 1; acd 2; acn "));
+      REQUIRE(line.ends_with("; pv d1d8;"));
+    } else if (i % 3 == 1)
+      REQUIRE(line == "not a position c0 \"invalid position\";");
+    else
+      REQUIRE(line.starts_with("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - bm "));
+  }
+  REQUIRE_FALSE(std::getline(results, line));
+}
+
+// ============================================================================
+// PACKED POSITION TESTS
+// ============================================================================
+
+TEST_CASE("Packed positions", "[packed]") {
+  auto board = std::make_unique<BazuuBoard>();
+  BazuuPackedPosition packed;
+
+  SECTION("Round trip through 32 bytes") {
+    for (const std::string fen :
+         {BazuuBoard::STARTING_FEN, std::string(TRICKY_BOARD_FEN), std::string(KILLER_BOARD_FEN),
+          std::string(CMK_BOARD_FEN), std::string("rnbqkbnr/1ppppppp/8/8/pP6/8/P1PPPPPP/RNBQKBNR b KQkq b3 0 3"),
+          std::string("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 1000 65535")}) {
+      REQUIRE(board->setup_fen(fen, false) == FenError::Ok);
+      const ZobristKey key = board->zobrist_key();
+      REQUIRE(board->pack(packed));
+      packed.set_score(-1234);
+      packed.set_result(GameResult::BlackWins);
+      REQUIRE(board->setup_fen(BazuuBoard::STARTING_FEN) == FenError::Ok);
+      REQUIRE(board->setup_packed(packed, false) == FenError::Ok);
+      REQUIRE(board->to_fen() == fen);
+      REQUIRE(board->zobrist_key() == key);
+      REQUIRE(packed.score() == -1234);
+      REQUIRE(packed.result() == GameResult::BlackWins);
+    }
+  }
+
+  SECTION("Corrupt records are rejected") {
+    board->setup_fen(BazuuBoard::STARTING_FEN);
+    REQUIRE(board->pack(packed));
+    BazuuPackedPosition corrupt = packed;
+    corrupt.set_piece(3, Pieces::Empty);
+    REQUIRE(board->setup_packed(corrupt) == FenError::BadPiecePlacement);
+    corrupt = packed;
+    corrupt.set_state((packed.state() & ~(0x7FULL << 5)) | 44ULL << 5); // e6 with no black pawn on e5
+    REQUIRE(board->setup_packed(corrupt) == FenError::BadEnPassant);
+    REQUIRE(board->setup_fen("4k3/8/8/8/8/8/8/4K3 w - - 1024 80") == FenError::Ok);
+    REQUIRE_FALSE(board->pack(packed));
+  }
+
+  SECTION("Writer and reader") {
+    const auto path = std::filesystem::temp_directory_path() / "bazuu_test_positions.bin";
+    std::vector<std::string> fens;
+    board->setup_fen(TRICKY_BOARD_FEN);
+    BazuuMoveList list;
+    board->generate_moves(list);
+    {
+      BazuuPackedWriter writer;
+      REQUIRE(writer.open(path.string()));
+      // More positions than the writer buffers, so it writes whole blocks and a partial one.
+      for (std::size_t i = 0; i < BazuuPackedWriter::BUFFER_POSITIONS * 2 + 5; i++) {
+        const BazuuMove move = list.moves[i % list.count];
+        if (!board->make_move(move))
+          continue;
+        fens.push_back(board->to_fen());
+        REQUIRE(board->pack(packed));
+        packed.set_score(static_cast<std::int16_t>(i));
+        REQUIRE(writer.write(packed));
+        board->unmake_move(move);
+      }
+      REQUIRE(writer.written() == fens.size());
+    }
+    BazuuPackedReader reader;
+    REQUIRE(reader.open(path.string()));
+    REQUIRE(reader.size() == fens.size());
+    for (std::size_t i = 0; i < reader.size(); i++) {
+      reader.read(i, packed);
+      REQUIRE(board->setup_packed(packed) == FenError::Ok);
+      REQUIRE(board->to_fen() == fens[i]);
+    }
+    reader.close();
+
+    // A truncated file is not made of whole positions.
+    std::filesystem::resize_file(path, BazuuPackedPosition::SIZE * 3 + 7);
+    REQUIRE_FALSE(reader.open(path.string()));
+    std::filesystem::remove(path);
+  }
+}
+
+// ============================================================================
+// DATA GENERATION TESTS
+// ============================================================================
+
+TEST_CASE("Self-play data generation", "[datagen]") {
+  const auto path = std::filesystem::temp_directory_path() / "bazuu_test_datagen.bin";
+  BazuuPackedWriter writer;
+  REQUIRE(writer.open(path.string()));
+  BazuuDatagen datagen({.games = 4, .threads = 2, .nodes = 300, .max_plies = 40});
+  BazuuDatagenSummary summary = datagen.run(writer);
+  writer.close();
+  REQUIRE(summary.games == 4);
+  REQUIRE(summary.positions > 0);
+
+  BazuuPackedReader reader;
+  REQUIRE(reader.open(path.string()));
+  REQUIRE(reader.size() == summary.positions);
+  auto board = std::make_unique<BazuuBoard>();
+  BazuuPackedPosition packed;
+  for (std::size_t i = 0; i < reader.size(); i++) {
+    reader.read(i, packed);
+    REQUIRE(board->setup_packed(packed) == FenError::Ok);
+    REQUIRE_FALSE(board->in_check());
+    REQUIRE(packed.result() != GameResult::None);
+  }
+  reader.close();
+  std::filesystem::remove(path);
+}
+
+// ============================================================================
+// UCI AND MATCH TESTS
+// ============================================================================
+
+TEST_CASE("UCI commands", "[uci]") {
+  SECTION("Handshake and search") {
+    BazuuUci uci;
+    std::istringstream input("uci\nisready\nposition startpos moves e2e4 e7e5 g1f3\ngo depth 3\n");
+    std::ostringstream output;
+    uci.run(input, output);
+    const std::string replies = output.str();
+    REQUIRE(replies.find("uciok") != std::string::npos);
+    REQUIRE(replies.find("readyok") != std::string::npos);
+    REQUIRE(replies.find("info depth 3") != std::string::npos);
+    const std::size_t bestmove = replies.find("bestmove ");
+    REQUIRE(bestmove != std::string::npos);
+    REQUIRE(replies.substr(bestmove + 9, 4) != "0000");
+
+    // The move played by the engine is legal for black.
+    auto board = std::make_unique<BazuuBoard>();
+    board->setup_fen("rnbqkbnr/pppp1ppp/8/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R b KQkq - 1 2");
+    const std::string move = replies.substr(bestmove + 9, replies.find('\n', bestmove) - bestmove - 9);
+    REQUIRE_FALSE(BazuuUci::parse_move(*board, move).is_null());
+  }
+
+  SECTION("MultiPV") {
+    BazuuUci uci;
+    std::istringstream input("setoption name MultiPV value 3\nsetoption name Hash value 8\nposition startpos\n"
+                             "go depth 4\n");
+    std::ostringstream output;
+    uci.run(input, output);
+    const std::string replies = output.str();
+    REQUIRE(replies.find("info depth 4 multipv 1 ") != std::string::npos);
+    REQUIRE(replies.find("info depth 4 multipv 3 ") != std::string::npos);
+    REQUIRE(replies.find("multipv 4") == std::string::npos);
+    REQUIRE(replies.find("bestmove ") != std::string::npos);
+  }
+
+  SECTION("Hash file") {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "bazuu_test_uci.tt";
+    std::filesystem::remove(path);
+    {
+      BazuuUci uci;
+      std::istringstream input(std::format("setoption name Hash value 1\nsetoption name HashFile value {}\n"
+                                           "position startpos\ngo depth 4\nquit\n",
+                                           path.string()));
+      std::ostringstream output;
+      uci.run(input, output);
+      REQUIRE(output.str().find("info string no valid hash file") != std::string::npos);
+      REQUIRE(std::filesystem::exists(path));
+    }
+    BazuuUci uci;
+    std::ostringstream output;
+    uci.handle(std::format("setoption name HashFile value {}", path.string()), output);
+    REQUIRE(output.str().find("info string loaded hash file") != std::string::npos);
+    std::filesystem::remove(path);
+  }
+
+  SECTION("Invalid input") {
+    BazuuUci uci;
+    std::ostringstream output;
+    REQUIRE(uci.handle("position startpos moves e2e5", output));
+    REQUIRE(uci.handle("position fen 8/8/8/8/8/8/8/8 w - - 0 1", output));
+    REQUIRE(output.str().find("info string invalid position") != std::string::npos);
+    REQUIRE_FALSE(uci.handle("quit", output));
+  }
+
+  SECTION("Time allocation") {
+    BazuuSearchLimits limits = BazuuUci::parse_go("wtime 60000 btime 1000 winc 1000 binc 0", Colours::White);
+    REQUIRE(limits.movetime_ms == (60000 - 50) / 30 + 750);
+    limits = BazuuUci::parse_go("wtime 60000 btime 1000 movestogo 4", Colours::Black);
+    REQUIRE(limits.movetime_ms == (1000 - 50) / 4);
+    limits = BazuuUci::parse_go("depth 7 nodes 1000", Colours::White);
+    REQUIRE(limits.depth == 7);
+    REQUIRE(limits.nodes == 1000);
+    REQUIRE(limits.movetime_ms == 0);
+    REQUIRE(BazuuUci::parse_go("btime 20 winc 5000", Colours::Black).movetime_ms == 1);
+  }
+}
+
+TEST_CASE("Match statistics", "[match]") {
+  BazuuMatchScore even;
+  REQUIRE(even.score() == 0.5);
+  REQUIRE(even.elo() == 0);
+  REQUIRE(even.llr(0, 5) == 0);
+
+  BazuuMatchScore ahead{.wins = 60, .draws = 20, .losses = 20};
+  REQUIRE_THAT(ahead.score(), Catch::Matchers::WithinAbs(0.7, 1e-12));
+  REQUIRE_THAT(ahead.elo(), Catch::Matchers::WithinAbs(147.19, 0.01));
+  REQUIRE(ahead.elo_error() > 0);
+  REQUIRE(ahead.los() > 0.99);
+  REQUIRE_THAT(BazuuMatchScore::expected_score(ahead.elo()), Catch::Matchers::WithinAbs(0.7, 1e-12));
+
+  BazuuMatch match({.elo0 = 0, .elo1 = 5});
+  REQUIRE_THAT(match.upper_bound(), Catch::Matchers::WithinAbs(std::log(19.0), 1e-12));
+  REQUIRE_THAT(match.lower_bound(), Catch::Matchers::WithinAbs(-std::log(19.0), 1e-12));
+  REQUIRE(match.sprt_verdict(ahead) == SprtVerdict::Continue);
+  REQUIRE(match.sprt_verdict({.wins = 600, .draws = 200, .losses = 200}) == SprtVerdict::AcceptH1);
+  REQUIRE(match.sprt_verdict({.wins = 10, .draws = 10, .losses = 10}) == SprtVerdict::Continue);
+  REQUIRE(match.sprt_verdict({.wins = 20000, .draws = 0, .losses = 20000}) == SprtVerdict::AcceptH0);
+  REQUIRE(BazuuMatchScore{.wins = 5, .draws = 90, .losses = 5}.los() == 0.5);
+}
+
+TEST_CASE("Engine match", "[match][process]") {
+  const auto openings = std::filesystem::temp_directory_path() / "bazuu_test_openings.epd";
+  {
+    std::ofstream file(openings);
+    file << "rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - id \"open game\";\n";
+    file << "not a position\n";
+  }
+  std::ostringstream log;
+  BazuuMatch match({.engines = {BAZUU_BINARY, BAZUU_BINARY},
+                    .openings = openings.string(),
+                    .games = 4,
+                    .concurrency = 2,
+                    .nodes = 300,
+                    .max_plies = 30});
+  BazuuMatchSummary summary = match.run(log);
+  REQUIRE_FALSE(summary.failed);
+  REQUIRE(summary.score.games() == 4);
+  for (const char *game : {"Game 1 ", "Game 2 ", "Game 3 ", "Game 4 "})
+    REQUIRE(log.str().find(game) != std::string::npos);
+  REQUIRE(log.str().find("illegal move") == std::string::npos);
+  std::filesystem::remove(openings);
+
+  BazuuMatch missing({.engines = {BAZUU_BINARY, "/nonexistent/engine"}, .nodes = 300});
+  REQUIRE(missing.run(log).failed);
+}
+
+// ============================================================================
+// BENCH TESTS
+// ============================================================================
+
+TEST_CASE("Bench suite", "[bench]") {
+  auto board = std::make_unique<BazuuBoard>();
+  for (const char *fen : BazuuBench::POSITIONS)
+    REQUIRE(board->setup_fen(fen, std::string_view(fen) != KILLER_BOARD_FEN) == FenError::Ok);
+
+  // The node count is the signature of the search, it does not depend on timing.
+  const BazuuBenchSummary first = BazuuBench::run(3);
+  const BazuuBenchSummary second = BazuuBench::run(3);
+  REQUIRE(first.positions.size() == BazuuBench::POSITIONS.size());
+  REQUIRE(first.nodes > 0);
+  REQUIRE(first.nodes == second.nodes);
+  for (std::size_t i = 0; i < first.positions.size(); i++) {
+    REQUIRE(first.positions[i].nodes == second.positions[i].nodes);
+    REQUIRE(first.positions[i].best_move.to_uci() == second.positions[i].best_move.to_uci());
+  }
+
+  std::ostringstream json;
+  BazuuBench::write_json(first, json);
+  const std::string document = json.str();
+  REQUIRE(document.find(std::format("\"nodes\": {},", first.nodes)) != std::string::npos);
+  std::size_t entries = 0;
+  for (std::size_t at = document.find("\"fen\""); at != std::string::npos; at = document.find("\"fen\"", at + 1))
+    entries++;
+  REQUIRE(entries == BazuuBench::POSITIONS.size());
+
+  // Switched off techniques never fire and change the signature.
+  REQUIRE(first.stats.nodes + first.stats.qnodes == first.nodes);
+  REQUIRE(first.stats.reduced_searches > 0);
+  const BazuuBenchSummary unreduced = BazuuBench::run(3, 1, {.late_move_reductions = false});
+  REQUIRE(unreduced.stats.reduced_searches == 0);
+  REQUIRE(unreduced.nodes != first.nodes);
+}
+
+TEST_CASE("Perf counters", "[bench][perf]") {
+  // Hardware events are often missing (virtual machines, perf_event_paranoid), a missing event must read as none.
+  BazuuPerfCounters counters;
+  auto board = std::make_unique<BazuuBoard>();
+  board->setup_fen(BazuuBoard::STARTING_FEN);
+  counters.start();
+  REQUIRE(board->perft(3) == 8902);
+  counters.stop();
+  for (std::uint8_t i = 0; i < BazuuPerfCounters::EVENTS; i++) {
+    const auto event = static_cast<BazuuPerfEvent>(i);
+    const std::optional<double> count = counters.count(event);
+    if (!counters.available(event))
+      REQUIRE_FALSE(count.has_value());
+    if (count)
+      REQUIRE(*count >= 0.0);
+  }
+  if (const std::optional<double> instructions = counters.count(BazuuPerfEvent::Instructions))
+    REQUIRE(*instructions > 8902.0);
+  REQUIRE(std::string_view(BazuuPerfCounters::event_name(BazuuPerfEvent::DTLBMisses)) == "dTLB misses");
+}
+
+// ============================================================================
+// TRACE TESTS
+// ============================================================================
+
+TEST_CASE("Trace scopes", "[trace]") {
+  // The scopes work whether or not the engine itself is built with WITH_TRACING.
+  BazuuTrace::reset();
+  {
+    const BazuuTraceScope search{BazuuTraceZone::Search};
+    {
+      const BazuuTraceScope movegen{BazuuTraceZone::MoveGen};
+    }
+    const BazuuTraceScope quiescence{BazuuTraceZone::Quiescence};
+    const BazuuTraceScope nested{BazuuTraceZone::Quiescence};
+    const BazuuTraceScope eval{BazuuTraceZone::Eval};
+  }
+  std::ostringstream folded;
+  BazuuTrace::write_folded(folded);
+  const std::string stacks = folded.str();
+  REQUIRE(stacks.find("search;movegen ") != std::string::npos);
+  REQUIRE(stacks.find("search;quiescence;eval ") != std::string::npos);
+  REQUIRE(stacks.find("quiescence;quiescence") == std::string::npos);
+  REQUIRE(std::string_view(BazuuTrace::zone_name(BazuuTraceZone::MakeMove)) == "make_move");
+
+  BazuuTrace::reset();
+  std::ostringstream empty;
+  BazuuTrace::write_folded(empty);
+  REQUIRE(empty.str().empty());
+}